@@ -0,0 +1,173 @@
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_driver";
+
+/* First poll interval and its cap, the device needs ~15 ms to leave reset and ~100 ms to calibrate */
+#define AT42QT2120_READY_BACKOFF_MIN_US 1000
+#define AT42QT2120_READY_BACKOFF_MAX_US 8000
+/* Upper bound for a reset or calibration before it is reported as timed out */
+#define AT42QT2120_READY_TIMEOUT_US 1000000
+
+/**
+  * @brief Arms completion tracking after a reset or calibration command was accepted.
+  */
+static void at42qt2120_pending_op_start(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_pending_type_t type, at42qt2120_ready_cb_t callback, void* user_ctx) {
+    int64_t now_us = at42qt2120_time_us(at42qt2120_handle);
+
+    at42qt2120_handle->pending_op = (at42qt2120_pending_op_t){
+        .type = type,
+        .deadline_us = now_us + AT42QT2120_READY_TIMEOUT_US,
+        .next_poll_us = now_us + AT42QT2120_READY_BACKOFF_MIN_US,
+        .backoff_us = AT42QT2120_READY_BACKOFF_MIN_US,
+        .callback = callback,
+        .user_ctx = user_ctx,
+    };
+}
+
+/**
+  * @brief Clears the pending operation and reports its result to the callback.
+  */
+static esp_err_t at42qt2120_pending_op_finish(at42qt2120_handle_t* at42qt2120_handle, esp_err_t result) {
+    at42qt2120_pending_op_t pending_op = at42qt2120_handle->pending_op;
+
+    /* The setup registers are back at their defaults after a reset, reload the shadow */
+    if (result == ESP_OK && pending_op.type == AT42QT2120_PENDING_RESET) {
+        at42qt2120_shadow_invalidate(at42qt2120_handle);
+        result = at42qt2120_shadow_resync(at42qt2120_handle);
+    }
+
+    /* Cleared before the callback so it may start the next operation */
+    at42qt2120_handle->pending_op.type = AT42QT2120_PENDING_NONE;
+    if (pending_op.callback != NULL)
+        pending_op.callback(at42qt2120_handle, result, pending_op.user_ctx);
+
+    return result;
+}
+
+/**
+  * @brief Arms tracking of a new operation in place of the pending one, whose callback learns that it was superseded.
+  *        A restart with the same callback keeps it waiting for the new operation instead.
+  */
+static void at42qt2120_pending_op_replace(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_pending_type_t type, at42qt2120_ready_cb_t callback, void* user_ctx) {
+    at42qt2120_pending_op_t replaced = at42qt2120_handle->pending_op;
+    at42qt2120_pending_op_start(at42qt2120_handle, type, callback, user_ctx);
+
+    bool same_waiter = replaced.callback == callback && replaced.user_ctx == user_ctx;
+    if (replaced.type != AT42QT2120_PENDING_NONE && replaced.callback != NULL && !same_waiter)
+        replaced.callback(at42qt2120_handle, ESP_ERR_INVALID_STATE, replaced.user_ctx);
+}
+
+/**
+  * @brief Starts a reset cycle without waiting for it to finish. A pending reset or calibration is superseded.
+  */
+esp_err_t at42qt2120_reset_async(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_ready_cb_t callback, void* user_ctx) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    /* Write non-zero byte to start reset cycle. A pending operation stays tracked if the write fails */
+    uint8_t write_buf = 0xFF;
+    esp_err_t ret = at42qt2120_register_write(at42qt2120_handle, AT42QT2120_REG_RESET, &write_buf, 1);
+    if (ret != ESP_OK)
+        return ret;
+
+    /* Setup registers are undefined until the reset completed */
+    at42qt2120_shadow_invalidate(at42qt2120_handle);
+    at42qt2120_pending_op_replace(at42qt2120_handle, AT42QT2120_PENDING_RESET, callback, user_ctx);
+    return ESP_OK;
+}
+
+/**
+  * @brief Starts a calibration cycle without waiting for it to finish. A pending calibration is restarted.
+  */
+esp_err_t at42qt2120_calibrate_async(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_ready_cb_t callback, void* user_ctx) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    /* The device NACKs while it resets and calibrates on its own afterwards */
+    ESP_RETURN_ON_FALSE(at42qt2120_handle->pending_op.type != AT42QT2120_PENDING_RESET, ESP_ERR_INVALID_STATE, TAG, "Reset in progress!");
+
+    /* Write non-zero byte to start calibration cycle, the device starts over if it was calibrating */
+    uint8_t write_buf = 0xFF;
+    esp_err_t ret = at42qt2120_register_write(at42qt2120_handle, AT42QT2120_REG_CALIBRATE, &write_buf, 1);
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_pending_op_replace(at42qt2120_handle, AT42QT2120_PENDING_CALIBRATE, callback, user_ctx);
+    return ESP_OK;
+}
+
+/**
+  * @brief Completes the pending operation from a state read elsewhere.
+  */
+void at42qt2120_pending_op_update(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_state_t* state) {
+    if (at42qt2120_handle == NULL || state == NULL || at42qt2120_handle->pending_op.type == AT42QT2120_PENDING_NONE)
+        return;
+
+    /* A status read only succeeds once the device left reset, so the CALIBRATE bit alone tells completion */
+    if (!state->calibrating)
+        at42qt2120_pending_op_finish(at42qt2120_handle, ESP_OK);
+}
+
+/**
+  * @brief Polls the pending operation once its backoff interval elapsed.
+  */
+esp_err_t at42qt2120_poll_ready(at42qt2120_handle_t* at42qt2120_handle) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    at42qt2120_pending_op_t* pending_op = &at42qt2120_handle->pending_op;
+    if (pending_op->type == AT42QT2120_PENDING_NONE)
+        return ESP_OK;
+
+    int64_t now_us = at42qt2120_time_us(at42qt2120_handle);
+    if (now_us < pending_op->next_poll_us)
+        return ESP_ERR_NOT_FINISHED;
+
+    /* The device NACKs while it is resetting, which only means it is not ready yet. A reset
+     * additionally reads the chip ID to make sure the device came back */
+    uint8_t raw[AT42QT2120_REG_SLIDER_POSITION + 1];
+    uint8_t first_reg = pending_op->type == AT42QT2120_PENDING_RESET ? AT42QT2120_REG_CHIP_ID : AT42QT2120_REG_DETECTION_STATUS;
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, first_reg, &raw[first_reg], sizeof(raw) - first_reg);
+    if (ret == ESP_OK && (first_reg != AT42QT2120_REG_CHIP_ID || raw[AT42QT2120_REG_CHIP_ID] == AT42QT2120_CHIP_ID)) {
+        at42qt2120_state_t state;
+        at42qt2120_decode_state(&raw[AT42QT2120_REG_DETECTION_STATUS], &state);
+        if (!state.calibrating)
+            return at42qt2120_pending_op_finish(at42qt2120_handle, ESP_OK);
+    }
+
+    now_us = at42qt2120_time_us(at42qt2120_handle);
+    if (now_us >= pending_op->deadline_us) {
+        at42qt2120_error_report(at42qt2120_handle, AT42QT2120_ERROR_OP_READY_TIMEOUT, AT42QT2120_REG_DETECTION_STATUS, 0, ESP_ERR_TIMEOUT);
+        return at42qt2120_pending_op_finish(at42qt2120_handle, ESP_ERR_TIMEOUT);
+    }
+
+    /* Exponential backoff keeps the bus quiet during the long calibration phase */
+    pending_op->next_poll_us = now_us + pending_op->backoff_us;
+    if (pending_op->backoff_us < AT42QT2120_READY_BACKOFF_MAX_US)
+        pending_op->backoff_us *= 2;
+
+    return ESP_ERR_NOT_FINISHED;
+}
+
+/**
+  * @brief Blocks until the pending operation completed.
+  */
+esp_err_t at42qt2120_wait_ready(at42qt2120_handle_t* at42qt2120_handle, int timeout_ms) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    int64_t deadline_us = timeout_ms < 0 ? INT64_MAX : at42qt2120_time_us(at42qt2120_handle) + (int64_t)timeout_ms * 1000;
+    esp_err_t ret;
+    while ((ret = at42qt2120_poll_ready(at42qt2120_handle)) == ESP_ERR_NOT_FINISHED) {
+        int64_t now_us = at42qt2120_time_us(at42qt2120_handle);
+        if (now_us >= deadline_us)
+            return ESP_ERR_TIMEOUT;
+
+        int64_t wait_us = at42qt2120_handle->pending_op.next_poll_us - now_us;
+        if (wait_us > deadline_us - now_us)
+            wait_us = deadline_us - now_us;
+        at42qt2120_delay_ms(at42qt2120_handle, wait_us > 0 ? (uint32_t)((wait_us + 999) / 1000) : 1);
+    }
+
+    return ret;
+}
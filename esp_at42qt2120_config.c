@@ -0,0 +1,99 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_config.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_config";
+
+/* The configuration is copied to and from the register map as raw bytes */
+_Static_assert(sizeof(at42qt2120_config_t) == AT42QT2120_CONFIG_REG_COUNT, "at42qt2120_config_t must mirror registers 0x08-0x33");
+
+/**
+  * @brief Fills a configuration with the power-on defaults from the datasheet.
+  */
+void at42qt2120_config_default(at42qt2120_config_t* config) {
+    config->low_power_mode = 2;             // 16 ms
+    config->ttd = 20;                       // 3.2 s
+    config->atd = 5;                        // 0.8 s
+    config->detection_integrator = 4;
+    config->touch_recal_delay = 255;        // 40.8 s
+    config->drift_hold_time = 25;           // 4 s
+    config->slider_options = 0;             // Slider/wheel disabled
+    config->charge_time = 0;
+    memset(config->key_dthr, 10, sizeof(config->key_dthr));
+    memset(config->key_ctrl, 0, sizeof(config->key_ctrl));
+    memset(config->key_pulse_scale, 0, sizeof(config->key_pulse_scale));
+}
+
+/**
+  * @brief Stages a complete configuration in the register shadow.
+  */
+esp_err_t at42qt2120_config_stage(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_config_t* config) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+
+    /* Diffing needs to know what the device holds, one burst read covers the whole map */
+    esp_err_t ret = ESP_OK;
+    if (!at42qt2120_handle->shadow.valid)
+        ret = at42qt2120_shadow_resync(at42qt2120_handle);
+
+    const uint8_t* raw = (const uint8_t*)config;
+    for (uint8_t index = 0; index < AT42QT2120_CONFIG_REG_COUNT && ret == ESP_OK; index++)
+        ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_CONFIG_FIRST + index, raw[index]);
+
+    return ret;
+}
+
+/**
+  * @brief Applies a complete configuration as a minimal set of burst writes and verifies it.
+  */
+esp_err_t at42qt2120_apply_config(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_config_t* config, at42qt2120_write_plan_t* plan) {
+    esp_err_t ret = at42qt2120_config_stage(at42qt2120_handle, config);
+    if (ret == ESP_OK && plan != NULL)
+        ret = at42qt2120_shadow_plan(at42qt2120_handle, plan);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    /* Read the whole map back once to confirm the device accepted every value */
+    uint8_t device_regs[AT42QT2120_CONFIG_REG_COUNT];
+    ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_CONFIG_FIRST, device_regs, sizeof(device_regs));
+    if (ret != ESP_OK)
+        return ret;
+
+    const uint8_t* raw = (const uint8_t*)config;
+    for (uint8_t index = 0; index < AT42QT2120_CONFIG_REG_COUNT; index++) {
+        if (device_regs[index] == raw[index])
+            continue;
+
+        /* Keep the shadow honest so the next apply rewrites the mismatching registers */
+        memcpy(at42qt2120_handle->shadow.regs, device_regs, sizeof(device_regs));
+        at42qt2120_error_report(at42qt2120_handle, AT42QT2120_ERROR_OP_VERIFY, AT42QT2120_REG_CONFIG_FIRST + index, device_regs[index],
+                                ESP_ERR_INVALID_RESPONSE);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    return ESP_OK;
+}
+
+/**
+  * @brief Returns the current configuration from the register shadow.
+  */
+esp_err_t at42qt2120_get_config(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_config_t* config) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+
+    if (!at42qt2120_handle->shadow.valid) {
+        esp_err_t ret = at42qt2120_shadow_resync(at42qt2120_handle);
+        if (ret != ESP_OK)
+            return ret;
+    }
+
+    memcpy(config, at42qt2120_handle->shadow.regs, sizeof(*config));
+    return ESP_OK;
+}
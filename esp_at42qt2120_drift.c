@@ -0,0 +1,306 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_drift.h"
+#include "esp_at42qt2120_signals.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_drift";
+
+/**
+  * @brief Initializes a drift monitor.
+  */
+esp_err_t at42qt2120_drift_init(at42qt2120_drift_monitor_t* monitor, at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_drift_config_t* config) {
+    ESP_RETURN_ON_FALSE(monitor != NULL, ESP_ERR_INVALID_ARG, TAG, "monitor is NULL!");
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+    ESP_RETURN_ON_FALSE(config->ewma_shift < 16, ESP_ERR_INVALID_ARG, TAG, "ewma_shift out of range!");
+    ESP_RETURN_ON_FALSE(config->drift_delta > 0 && config->drift_delta <= config->recalibrate_delta, ESP_ERR_INVALID_ARG, TAG, "Invalid drift thresholds!");
+
+    memset(monitor, 0, sizeof(*monitor));
+    monitor->at42qt2120_handle = at42qt2120_handle;
+    monitor->config = *config;
+
+    /* The shadow holds the values to relax back to, a resync is only needed the first time */
+    esp_err_t ret = at42qt2120_shadow_read(at42qt2120_handle, AT42QT2120_REG_TTD_MODE, &monitor->ttd_initial);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_read(at42qt2120_handle, AT42QT2120_REG_ATD_MODE, &monitor->atd_initial);
+    if (ret != ESP_OK)
+        return ret;
+    monitor->ttd = monitor->ttd_initial;
+    monitor->atd = monitor->atd_initial;
+
+    int64_t now_us = at42qt2120_time_us(at42qt2120_handle);
+    monitor->last_touch_us = now_us;
+    monitor->last_calibrate_us = now_us;
+    monitor->last_tune_us = now_us;
+    monitor->last_drift_us = now_us;
+    return ESP_OK;
+}
+
+/**
+  * @brief Deinitializes a drift monitor.
+  */
+esp_err_t at42qt2120_drift_deinit(at42qt2120_drift_monitor_t* monitor) {
+    ESP_RETURN_ON_FALSE(monitor != NULL, ESP_ERR_INVALID_ARG, TAG, "monitor is NULL!");
+
+#ifdef ESP_PLATFORM
+    if (monitor->monitor_task != NULL)
+        ESP_RETURN_ON_ERROR(at42qt2120_drift_stop(monitor), TAG, "Failed to stop monitor task");
+#endif
+
+    monitor->at42qt2120_handle = NULL;
+    return ESP_OK;
+}
+
+/* References restart from the signals after a calibration, the averages restart with them */
+static void at42qt2120_drift_restart(at42qt2120_drift_monitor_t* monitor, int64_t time_us) {
+    monitor->primed = false;
+    monitor->drifting_mask = 0;
+    monitor->stuck_mask = 0;
+    monitor->toward_peak_q8 = 0;
+    monitor->away_peak_q8 = 0;
+    monitor->last_calibrate_us = time_us;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        monitor->keys[key].detect_since_us = 0;
+}
+
+/*
+ * Halves TTD/ATD while the drift in their direction keeps growing, steps them back once the drift is gone.
+ * A drift that shrinks after a tuning step is already followed fast enough.
+ */
+static esp_err_t at42qt2120_drift_tune(at42qt2120_drift_monitor_t* monitor, int32_t toward_q8, int32_t away_q8, int64_t time_us) {
+    const at42qt2120_drift_config_t* config = &monitor->config;
+    if (time_us - monitor->last_tune_us < (int64_t)config->tune_holdoff_ms * 1000)
+        return ESP_OK;
+
+    uint8_t ttd = monitor->ttd;
+    uint8_t atd = monitor->atd;
+    if (toward_q8 > monitor->toward_peak_q8 && ttd > config->ttd_min)
+        ttd = ttd / 2 > config->ttd_min ? ttd / 2 : config->ttd_min;
+    if (away_q8 > monitor->away_peak_q8 && atd > config->atd_min)
+        atd = atd / 2 > config->atd_min ? atd / 2 : config->atd_min;
+
+    bool relax = monitor->drifting_mask == 0 && time_us - monitor->last_drift_us >= (int64_t)config->relax_time_ms * 1000;
+    if (relax) {
+        if (ttd < monitor->ttd_initial)
+            ttd = ttd * 2 < monitor->ttd_initial ? ttd * 2 : monitor->ttd_initial;
+        if (atd < monitor->atd_initial)
+            atd = atd * 2 < monitor->atd_initial ? atd * 2 : monitor->atd_initial;
+    }
+
+    if (ttd == monitor->ttd && atd == monitor->atd)
+        return ESP_OK;
+
+    /* Adjacent registers, a change of both goes out as one burst */
+    esp_err_t ret = at42qt2120_shadow_write(monitor->at42qt2120_handle, AT42QT2120_REG_TTD_MODE, ttd);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_write(monitor->at42qt2120_handle, AT42QT2120_REG_ATD_MODE, atd);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(monitor->at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    if (ttd != monitor->ttd)
+        monitor->toward_peak_q8 = relax ? 0 : toward_q8;
+    if (atd != monitor->atd)
+        monitor->away_peak_q8 = relax ? 0 : away_q8;
+    /* One step back per calm relax_time_ms, a drift that is still there is caught again before it matters */
+    if (relax)
+        monitor->last_drift_us = time_us;
+    monitor->ttd = ttd;
+    monitor->atd = atd;
+    monitor->last_tune_us = time_us;
+    monitor->stats.tunings++;
+    return ESP_OK;
+}
+
+/**
+  * @brief Feeds one sample into the monitor.
+  */
+esp_err_t at42qt2120_drift_update(at42qt2120_drift_monitor_t* monitor, const at42qt2120_state_t* state, const uint16_t signals[AT42QT2120_NUM_KEYS],
+                                  const uint16_t references[AT42QT2120_NUM_KEYS], int64_t time_us) {
+    ESP_RETURN_ON_FALSE(monitor != NULL, ESP_ERR_INVALID_ARG, TAG, "monitor is NULL!");
+    ESP_RETURN_ON_FALSE(state != NULL && signals != NULL && references != NULL, ESP_ERR_INVALID_ARG, TAG, "sample is NULL!");
+
+    const at42qt2120_drift_config_t* config = &monitor->config;
+    at42qt2120_handle_t* at42qt2120_handle = monitor->at42qt2120_handle;
+
+    /* A calibration started elsewhere resets the references just the same */
+    if (state->calibrating || at42qt2120_handle->pending_op.type != AT42QT2120_PENDING_NONE) {
+        at42qt2120_drift_restart(monitor, time_us);
+        return ESP_OK;
+    }
+
+    uint16_t detected = state->key_mask & config->monitored_keys;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        at42qt2120_key_drift_t* key_drift = &monitor->keys[key];
+        if ((detected & (1 << key)) == 0) {
+            key_drift->detect_since_us = 0;
+            monitor->stuck_mask &= ~(1 << key);
+            continue;
+        }
+        if (key_drift->detect_since_us == 0)
+            key_drift->detect_since_us = time_us;
+        else if (time_us - key_drift->detect_since_us >= (int64_t)config->stuck_time_ms * 1000)
+            monitor->stuck_mask |= 1 << key;
+    }
+
+    /* Stuck keys are not touches, or they would block their own calibration */
+    if ((state->key_mask & ~monitor->stuck_mask) != 0 || state->slider_detected) {
+        monitor->last_touch_us = time_us;
+        return ESP_OK;
+    }
+
+    /* The device suspends drift compensation while anything is in detect, so only samples without detection are averaged */
+    bool recalibrate = false;
+    if (state->key_mask == 0) {
+        int32_t drift_q8 = (int32_t)config->drift_delta << 8;
+        int32_t recalibrate_q8 = (int32_t)config->recalibrate_delta << 8;
+        int32_t toward_q8 = 0, away_q8 = 0;
+        monitor->drifting_mask = 0;
+
+        for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+            if ((config->monitored_keys & (1 << key)) == 0)
+                continue;
+
+            at42qt2120_key_drift_t* key_drift = &monitor->keys[key];
+            int32_t delta_q8 = ((int32_t)signals[key] - (int32_t)references[key]) * 256;
+            if (!monitor->primed) {
+                key_drift->mean_q8 = delta_q8;
+                key_drift->deviation_q8 = 0;
+            } else {
+                key_drift->mean_q8 += (delta_q8 - key_drift->mean_q8) >> config->ewma_shift;
+                int32_t deviation_q8 = delta_q8 - key_drift->mean_q8;
+                key_drift->deviation_q8 += ((deviation_q8 < 0 ? -deviation_q8 : deviation_q8) - key_drift->deviation_q8) >> config->ewma_shift;
+            }
+
+            /* Drift moves the delta slowly. A step (an object removed, a calibration under a finger) shows as a large deviation */
+            int32_t magnitude_q8 = key_drift->mean_q8 < 0 ? -key_drift->mean_q8 : key_drift->mean_q8;
+            recalibrate |= magnitude_q8 >= recalibrate_q8;
+            if (magnitude_q8 < drift_q8 || 2 * key_drift->deviation_q8 >= magnitude_q8)
+                continue;
+
+            monitor->drifting_mask |= 1 << key;
+            if (key_drift->mean_q8 > 0)
+                toward_q8 = magnitude_q8 > toward_q8 ? magnitude_q8 : toward_q8;
+            else
+                away_q8 = magnitude_q8 > away_q8 ? magnitude_q8 : away_q8;
+        }
+        monitor->primed = true;
+        monitor->stats.averaged++;
+        if (monitor->drifting_mask != 0)
+            monitor->last_drift_us = time_us;
+
+        /* Whatever a calibration is about to reset needs no tuning */
+        if (config->tune_drift && !recalibrate) {
+            esp_err_t ret = at42qt2120_drift_tune(monitor, toward_q8, away_q8, time_us);
+            if (ret != ESP_OK)
+                return ret;
+        }
+    }
+
+    if (!recalibrate && monitor->stuck_mask == 0)
+        return ESP_OK;
+    if (time_us - monitor->last_touch_us < (int64_t)config->quiet_time_ms * 1000 ||
+        time_us - monitor->last_calibrate_us < (int64_t)config->calibrate_holdoff_ms * 1000)
+        return ESP_OK;
+
+    esp_err_t ret = at42qt2120_calibrate_async(at42qt2120_handle, NULL, NULL);
+    if (ret != ESP_OK)
+        return ret;
+    monitor->stats.calibrations++;
+    at42qt2120_drift_restart(monitor, time_us);
+    return ESP_OK;
+}
+
+/**
+  * @brief Reads one sample and feeds it into the monitor.
+  */
+esp_err_t at42qt2120_drift_sample(at42qt2120_drift_monitor_t* monitor) {
+    ESP_RETURN_ON_FALSE(monitor != NULL, ESP_ERR_INVALID_ARG, TAG, "monitor is NULL!");
+
+    at42qt2120_state_t state;
+    uint16_t signals[AT42QT2120_NUM_KEYS];
+    uint16_t references[AT42QT2120_NUM_KEYS];
+    esp_err_t ret = at42qt2120_read_state(monitor->at42qt2120_handle, &state);
+    if (ret == ESP_OK)
+        ret = at42qt2120_read_signals_references(monitor->at42qt2120_handle, signals, references, NULL);
+    if (ret != ESP_OK) {
+        monitor->stats.read_errors++;
+        return ret;
+    }
+
+    monitor->stats.samples++;
+    return at42qt2120_drift_update(monitor, &state, signals, references, at42qt2120_time_us(monitor->at42qt2120_handle));
+}
+
+#ifdef ESP_PLATFORM
+static void at42qt2120_drift_task(void* arg) {
+    at42qt2120_drift_monitor_t* monitor = (at42qt2120_drift_monitor_t*)arg;
+    TickType_t period_ticks = pdMS_TO_TICKS(monitor->config.sample_period_ms);
+    if (period_ticks == 0)
+        period_ticks = 1;
+
+    while (monitor->running) {
+        at42qt2120_drift_sample(monitor);
+        /* Woken early by at42qt2120_drift_stop() */
+        ulTaskNotifyTake(pdTRUE, period_ticks);
+    }
+
+    xSemaphoreGive(monitor->stopped_sem);
+    vTaskDelete(NULL);
+}
+
+/**
+  * @brief Starts the monitor task.
+  */
+esp_err_t at42qt2120_drift_start(at42qt2120_drift_monitor_t* monitor) {
+    ESP_RETURN_ON_FALSE(monitor != NULL, ESP_ERR_INVALID_ARG, TAG, "monitor is NULL!");
+    ESP_RETURN_ON_FALSE(monitor->monitor_task == NULL, ESP_ERR_INVALID_STATE, TAG, "Monitor task is already running!");
+
+    monitor->stopped_sem = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(monitor->stopped_sem != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create stop semaphore");
+
+    monitor->running = true;
+    if (xTaskCreate(at42qt2120_drift_task, "at42qt2120_drift", monitor->config.task_stack_size, monitor,
+                    monitor->config.task_priority, &monitor->monitor_task) != pdPASS) {
+        monitor->running = false;
+        vSemaphoreDelete(monitor->stopped_sem);
+        monitor->stopped_sem = NULL;
+        ESP_LOGE(TAG, "Failed to create monitor task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Started at42qt2120 drift monitor.");
+    return ESP_OK;
+}
+
+/**
+  * @brief Stops the monitor task.
+  */
+esp_err_t at42qt2120_drift_stop(at42qt2120_drift_monitor_t* monitor) {
+    ESP_RETURN_ON_FALSE(monitor != NULL, ESP_ERR_INVALID_ARG, TAG, "monitor is NULL!");
+    ESP_RETURN_ON_FALSE(monitor->monitor_task != NULL, ESP_ERR_INVALID_STATE, TAG, "Monitor task is not running!");
+
+    /* Let the task finish its current sample instead of deleting it mid-transfer */
+    monitor->running = false;
+    xTaskNotifyGive(monitor->monitor_task);
+    xSemaphoreTake(monitor->stopped_sem, portMAX_DELAY);
+
+    vSemaphoreDelete(monitor->stopped_sem);
+    monitor->stopped_sem = NULL;
+    monitor->monitor_task = NULL;
+
+    ESP_LOGI(TAG, "Stopped at42qt2120 drift monitor.");
+    return ESP_OK;
+}
+#endif
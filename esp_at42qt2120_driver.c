@@ -1,82 +1,171 @@
-#include <driver/i2c_master.h>
 #include <esp_err.h>
 #include <esp_log.h>
 #include <esp_check.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
 
 #include "esp_at42qt2120_driver.h"
 #include "esp_at42qt2120_defines.h"
 
 static const char* TAG = "esp_at42qt2120_driver";
 
+#if AT42QT2120_INSTRUMENTATION
+/* Transaction instrumentation, only compiled in on request */
+static inline uint32_t at42qt2120_instrumentation_now(at42qt2120_handle_t* at42qt2120_handle) {
+    const at42qt2120_clock_t* clock = &at42qt2120_handle->clock;
+    if (clock->now != NULL)
+        return clock->now(clock->ctx);
+
+    const at42qt2120_transport_t* transport = &at42qt2120_handle->transport;
+    return (uint32_t)transport->ops->time_us(transport->ctx);
+}
+
+static void at42qt2120_instrumentation_record(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_transfer_stats_t* stats, uint32_t bytes, esp_err_t ret, uint32_t start) {
+    uint32_t latency = at42qt2120_instrumentation_now(at42qt2120_handle) - start;
+    uint32_t bucket = latency == 0 ? 0 : 32 - __builtin_clz(latency);
+    if (bucket >= AT42QT2120_LATENCY_BUCKETS)
+        bucket = AT42QT2120_LATENCY_BUCKETS - 1;
+
+    stats->transactions++;
+    stats->bytes += bytes;
+    stats->latency_total += latency;
+    stats->latency_histogram[bucket]++;
+    if (latency > stats->latency_max)
+        stats->latency_max = latency;
+    if (ret == ESP_OK)
+        return;
+
+    stats->errors++;
+    at42qt2120_instrumentation_t* instrumentation = &at42qt2120_handle->instrumentation;
+    for (int slot = 0; slot < AT42QT2120_ERROR_CODE_SLOTS; slot++) {
+        at42qt2120_error_count_t* error = &instrumentation->errors[slot];
+        if (error->count == 0)
+            error->code = ret;
+        if (error->code == ret) {
+            error->count++;
+            return;
+        }
+    }
+    instrumentation->other_errors++;
+}
+#endif
+
 /**
-  * @brief Initializes the AT42QT2120 touch sensor on the I2C bus.
+  * @brief Initializes the AT42QT2120 touch sensor on a custom transport.
   */
-esp_err_t at42qt2120_init(i2c_master_bus_handle_t bus_handle, at42qt2120_handle_t* at42qt2120_handle, size_t clock_speed, int time_out) {
-    /* Error checking for input parameters and check if device is connected to the i2c bus*/
+esp_err_t at42qt2120_init_with_transport(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_transport_t* transport, int time_out) {
+    /* Error checking for input parameters and check if device answers on the transport */
     ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
-    ESP_RETURN_ON_FALSE(bus_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "i2c bus is NULL!");
-    ESP_RETURN_ON_ERROR(i2c_master_probe(bus_handle, AT42QT2120_SLAVE_ADDRESS, time_out), TAG, "at42qt2120 device is not connected to the i2c bus");
+    ESP_RETURN_ON_FALSE(transport != NULL && transport->ops != NULL, ESP_ERR_INVALID_ARG, TAG, "transport is NULL!");
+    ESP_RETURN_ON_ERROR(transport->ops->probe(transport->ctx, time_out), TAG, "at42qt2120 device is not responding");
 
-    /* Setting up device configuration to add at42qt2120 to i2c bus */
-    at42qt2120_handle->device_config.dev_addr_length = I2C_ADDR_BIT_LEN_7;
-    at42qt2120_handle->device_config.device_address = AT42QT2120_SLAVE_ADDRESS;
-    at42qt2120_handle->device_config.scl_speed_hz = clock_speed;
+    at42qt2120_handle->transport = *transport;
     at42qt2120_handle->transaction_timeout_ms = time_out;
-    
-    ESP_RETURN_ON_ERROR(i2c_master_bus_add_device(bus_handle, &at42qt2120_handle->device_config, &at42qt2120_handle->device_handle), TAG, "Failed to add at42qt2120 to i2c bus");
-    
-    ESP_LOGI(TAG, "Added at42qt2120 to i2c bus.");
+    at42qt2120_handle->bus_stats = (at42qt2120_bus_stats_t){ 0 };
+    at42qt2120_handle->shadow = (at42qt2120_shadow_t){ 0 };
+    at42qt2120_handle->pending_op = (at42qt2120_pending_op_t){ 0 };
+    at42qt2120_handle->recovery = (at42qt2120_recovery_t){ .config = AT42QT2120_RECOVERY_CONFIG_DEFAULT() };
+    at42qt2120_handle->error_log = (at42qt2120_error_log_t){ 0 };
+#if AT42QT2120_INSTRUMENTATION
+    at42qt2120_handle->clock = (at42qt2120_clock_t){ .now = NULL, .ticks_per_us = 1 };
+    at42qt2120_handle->instrumentation = (at42qt2120_instrumentation_t){ .ticks_per_us = 1 };
+#endif
+
     return ESP_OK;
 }
 
 /**
-  * @brief Deinitializes the AT42QT2120 touch sensor from the I2C bus.
+  * @brief Deinitializes the AT42QT2120 touch sensor and releases its transport.
   */
  esp_err_t at42qt2120_deinit(at42qt2120_handle_t* at42qt2120_handle) {
     /* Error checking for input parameters */
     ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
 
-    ESP_RETURN_ON_ERROR(i2c_master_bus_rm_device(at42qt2120_handle->device_handle), TAG, "Failed to removed at42qt2120 from i2c bus");
-    
-    ESP_LOGI(TAG, "Removed at42qt2120 from i2c bus.");
+    const at42qt2120_transport_t* transport = &at42qt2120_handle->transport;
+    if (transport->ops != NULL && transport->ops->release != NULL)
+        ESP_RETURN_ON_ERROR(transport->ops->release(transport->ctx), TAG, "Failed to release at42qt2120 transport");
+
+    at42qt2120_handle->transport.ops = NULL;
     return ESP_OK;
 }
 
 /* Basic Read and Write functions for at42at2120 */
 /**
-  * @brief Reads a register from the AT42QT2120.
+  * @brief Issues one transaction: a write, or a write followed by a read with a repeated start.
   */
-esp_err_t at42qt2120_register_read(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg_to_read, uint8_t* read_buf, uint8_t read_buf_size) {
-    /* Error checking for input parameters */
-    if (at42qt2120_handle == NULL) {
-        ESP_LOGE(TAG, "at42qt2120_handle is NULL!");
-        return ESP_ERR_INVALID_ARG;
+static esp_err_t at42qt2120_transaction(at42qt2120_handle_t* at42qt2120_handle, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size) {
+    size_t bytes = write_size + read_size;
+    at42qt2120_handle->bus_stats.transactions++;
+    at42qt2120_handle->bus_stats.bytes += bytes;
+
+#if AT42QT2120_INSTRUMENTATION
+    uint32_t start = at42qt2120_instrumentation_now(at42qt2120_handle);
+#endif
+    const at42qt2120_transport_t* transport = &at42qt2120_handle->transport;
+    esp_err_t ret;
+    if (read_buf != NULL)
+        ret = transport->ops->transmit_receive(transport->ctx, write_buf, write_size, read_buf, read_size, at42qt2120_handle->transaction_timeout_ms);
+    else
+        ret = transport->ops->transmit(transport->ctx, write_buf, write_size, at42qt2120_handle->transaction_timeout_ms);
+#if AT42QT2120_INSTRUMENTATION
+    at42qt2120_instrumentation_t* instrumentation = &at42qt2120_handle->instrumentation;
+    at42qt2120_instrumentation_record(at42qt2120_handle, read_buf != NULL ? &instrumentation->read : &instrumentation->write, bytes, ret, start);
+#endif
+
+    return ret;
+}
+
+/**
+  * @brief Runs a transaction with bounded retries, and flags a recovery if they run out.
+  */
+static esp_err_t at42qt2120_transfer(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size) {
+    at42qt2120_recovery_t* recovery = &at42qt2120_handle->recovery;
+
+    /* A resetting device NACKs by design, so it is neither retried nor reported. A device already
+     * flagged for recovery gets a single attempt, a disconnect must not cost every call the retry budget */
+    bool resetting = at42qt2120_handle->pending_op.type == AT42QT2120_PENDING_RESET;
+    bool flagged = recovery->needed && !recovery->active;
+    uint8_t attempts = resetting || flagged ? 1 : 1 + recovery->config.max_retries;
+
+    uint32_t backoff_ms = recovery->config.backoff_min_ms;
+    esp_err_t ret;
+    for (uint8_t attempt = 1;; attempt++) {
+        ret = at42qt2120_transaction(at42qt2120_handle, write_buf, write_size, read_buf, read_size);
+        if (ret == ESP_OK)
+            return ESP_OK;
+        if (attempt >= attempts)
+            break;
+
+        recovery->stats.retries++;
+        at42qt2120_delay_ms(at42qt2120_handle, backoff_ms);
+        backoff_ms = backoff_ms * 2 < recovery->config.backoff_max_ms ? backoff_ms * 2 : recovery->config.backoff_max_ms;
     }
 
-    if (read_buf == NULL || read_buf_size == 0) {
-        ESP_LOGE(TAG, "read_buf is NULL or invalid read_buf_size!!");
+    if (resetting)
+        return ret;
+
+    /* The recovery runs outside the read path, see at42qt2120_recover_poll(). Its own failures do not flag another one */
+    at42qt2120_error_report(at42qt2120_handle, read_buf != NULL ? AT42QT2120_ERROR_OP_READ : AT42QT2120_ERROR_OP_WRITE, reg, 0, ret);
+    if (recovery->config.auto_recover && !recovery->active)
+        recovery->needed = true;
+    return ret;
+}
+
+/**
+  * @brief Reads a register from the AT42QT2120.
+  */
+esp_err_t at42qt2120_register_read(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg_to_read, uint8_t* read_buf, uint8_t read_buf_size) {
+    /* Invalid arguments are a caller bug, not a bus condition: no logging in this hot path */
+    if (at42qt2120_handle == NULL || read_buf == NULL || read_buf_size == 0)
         return ESP_ERR_INVALID_ARG;
-    }
 
-    return i2c_master_transmit_receive(at42qt2120_handle->device_handle, &reg_to_read, 1, read_buf, read_buf_size, at42qt2120_handle->transaction_timeout_ms);
+    return at42qt2120_transfer(at42qt2120_handle, reg_to_read, &reg_to_read, 1, read_buf, read_buf_size);
 }
 
 /**
   * @brief Writes data to a register in the AT42QT2120.
   */
 esp_err_t at42qt2120_register_write(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg_to_write, uint8_t* write_buf, uint8_t write_buf_size) {
-    /* Error checking for input parameters */
-    if (at42qt2120_handle == NULL) {
-        ESP_LOGE(TAG, "at42qt2120_handle is NULL!");
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    if (write_buf == NULL || write_buf_size == 0) {
-        ESP_LOGE(TAG, "write_buf is NULL or invalid write_buf_size!");
+    if (at42qt2120_handle == NULL || write_buf == NULL || write_buf_size == 0)
         return ESP_ERR_INVALID_ARG;
-    }
 
     /* Combine reg_to_write and write_buffer into one buffer */
     uint8_t buffer[write_buf_size + 1];
@@ -84,75 +173,204 @@ esp_err_t at42qt2120_register_write(at42qt2120_handle_t* at42qt2120_handle, uint
     for (uint16_t index = 1; index <= write_buf_size; index++)
         buffer[index] = write_buf[index - 1];
 
-    return i2c_master_transmit(at42qt2120_handle->device_handle, buffer, write_buf_size + 1, at42qt2120_handle->transaction_timeout_ms);
+    esp_err_t ret = at42qt2120_transfer(at42qt2120_handle, reg_to_write, buffer, write_buf_size + 1, NULL, 0);
+    if (ret != ESP_OK)
+        return ret;
+
+    /* Written setup registers go into the shadow, so a burst bridging them later does not write stale bytes back.
+     * The write supersedes a value still staged for the same register */
+    at42qt2120_shadow_t* shadow = &at42qt2120_handle->shadow;
+    for (uint16_t reg = reg_to_write; reg < reg_to_write + write_buf_size; reg++) {
+        if (reg < AT42QT2120_REG_CONFIG_FIRST || reg > AT42QT2120_REG_CONFIG_LAST)
+            continue;
+        shadow->regs[reg - AT42QT2120_REG_CONFIG_FIRST] = write_buf[reg - reg_to_write];
+        shadow->dirty &= ~(1ULL << (reg - AT42QT2120_REG_CONFIG_FIRST));
+    }
+
+    return ESP_OK;
+}
+
+/* Status snapshot functions */
+/**
+  * @brief Decodes the raw status registers (0x02-0x05) into a state snapshot.
+  */
+void at42qt2120_decode_state(const uint8_t raw[AT42QT2120_STATE_REG_COUNT], at42qt2120_state_t* state) {
+    uint8_t detection_status = raw[0];
+
+    state->detection_status = detection_status;
+    state->touch_detected = (detection_status & AT42QT2120_DETECTION_STATUS_TDET) != 0;
+    state->slider_detected = (detection_status & AT42QT2120_DETECTION_STATUS_SDET) != 0;
+    state->overflow = (detection_status & AT42QT2120_DETECTION_STATUS_OVERFLOW) != 0;
+    state->calibrating = (detection_status & AT42QT2120_DETECTION_STATUS_CALIBRATE) != 0;
+    state->key_mask = (uint16_t)(raw[1] | (raw[2] << 8)) & AT42QT2120_KEY_MASK_ALL;
+    state->slider_position = raw[3];
+}
+
+/**
+  * @brief Reads registers 0x02-0x05 in one burst and decodes them.
+  */
+esp_err_t at42qt2120_read_state(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_state_t* state) {
+    ESP_RETURN_ON_FALSE(state != NULL, ESP_ERR_INVALID_ARG, TAG, "state is NULL!");
+
+    /* The device auto-increments its address pointer, so one read covers all four status registers */
+    uint8_t raw[AT42QT2120_STATE_REG_COUNT];
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_DETECTION_STATUS, raw, sizeof(raw));
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_decode_state(raw, state);
+    at42qt2120_pending_op_update(at42qt2120_handle, state);
+
+    /* A calibration nobody started means the device reset itself (brown-out): flag a check of its configuration once */
+    at42qt2120_recovery_t* recovery = &at42qt2120_handle->recovery;
+    if (!state->calibrating) {
+        recovery->calibrate_checked = false;
+    } else if (!recovery->calibrate_checked && recovery->config.auto_recover && !recovery->active &&
+               at42qt2120_handle->pending_op.type == AT42QT2120_PENDING_NONE) {
+        recovery->calibrate_checked = true;
+        recovery->needed = true;
+    }
+
+    return ESP_OK;
 }
 
 /* Specific Register Read/Write functions */
+esp_err_t at42qt2120_read_key_status(at42qt2120_handle_t* at42qt2120_handle, uint16_t* key_mask) {
+    ESP_RETURN_ON_FALSE(key_mask != NULL, ESP_ERR_INVALID_ARG, TAG, "key_mask is NULL!");
+
+    at42qt2120_state_t state;
+    esp_err_t ret = at42qt2120_read_state(at42qt2120_handle, &state);
+    if (ret != ESP_OK)
+        return ret;
+
+    *key_mask = state.key_mask;
+    return ESP_OK;
+}
+
 esp_err_t at42qt2120_read_detection_status(at42qt2120_handle_t* at42qt2120_handle, uint8_t* status_buf) {
-    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_DETECTION_STATUS, status_buf, 1);
-    if (ret != ESP_OK) 
-        ESP_LOGE(TAG, "Failed to read detection status from at42qt2120 device!");
+    ESP_RETURN_ON_FALSE(status_buf != NULL, ESP_ERR_INVALID_ARG, TAG, "status_buf is NULL!");
 
-    return ret;
+    at42qt2120_state_t state;
+    esp_err_t ret = at42qt2120_read_state(at42qt2120_handle, &state);
+    if (ret != ESP_OK)
+        return ret;
+
+    *status_buf = state.detection_status;
+    return ESP_OK;
 }
 
 esp_err_t at42qt2120_read_slider_position(at42qt2120_handle_t* at42qt2120_handle, uint8_t* position_buf) {
-    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_SLIDER_POSITION, position_buf, 1);
-    if (ret != ESP_OK) 
-        ESP_LOGE(TAG, "Failed to read slider position from at42qt2120 device!");
+    ESP_RETURN_ON_FALSE(position_buf != NULL, ESP_ERR_INVALID_ARG, TAG, "position_buf is NULL!");
 
-    return ret;
+    at42qt2120_state_t state;
+    esp_err_t ret = at42qt2120_read_state(at42qt2120_handle, &state);
+    if (ret != ESP_OK)
+        return ret;
+
+    *position_buf = state.slider_position;
+    return ESP_OK;
 }
 
 esp_err_t at42qt2120_calibrate(at42qt2120_handle_t* at42qt2120_handle) {
-    /* Write non-zero byte to start reset cycle */
-    uint8_t write_buf = 0xFF;
-    esp_err_t ret = at42qt2120_register_write(at42qt2120_handle, AT42QT2120_REG_CALIBRATE, &write_buf, 1);
-    if (ret != ESP_OK) 
-        ESP_LOGE(TAG, "at42qt2120 device failed to calibrate!");
-        
-    return ret;
+    /* Completion stays tracked, at42qt2120_wait_ready() blocks until the calibration finished */
+    return at42qt2120_calibrate_async(at42qt2120_handle, NULL, NULL);
 }
 
 esp_err_t at42qt2120_reset(at42qt2120_handle_t* at42qt2120_handle) {
-    /* Write non-zero byte to start reset cycle */
-    uint8_t write_buf = 0xFF;
-    esp_err_t ret = at42qt2120_register_write(at42qt2120_handle, AT42QT2120_REG_RESET, &write_buf, 1);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "at42qt2120 device failed to reset!");
+    /* Returns as soon as the device finished its reset and calibration, the shadow is resynced on completion */
+    esp_err_t ret = at42qt2120_reset_async(at42qt2120_handle, NULL, NULL);
+    if (ret != ESP_OK)
         return ret;
-    }
-    vTaskDelay(pdMS_TO_TICKS(500)); // Delay to ensure reset cycle finishes (~125 ms for reset cycle)
-
-    return ret;
+    return at42qt2120_wait_ready(at42qt2120_handle, -1);
 }
 
 esp_err_t at42qt2120_enable_slider(at42qt2120_handle_t* at42qt2120_handle) {
      /* Write 1 to 8th bit to enable slider mode */
-     uint8_t write_buf = 0x80;
-     esp_err_t ret = at42qt2120_register_write(at42qt2120_handle, AT42QT2120_REG_SLIDER_OPTIONS, &write_buf, 1);
-     if (ret != ESP_OK) 
-         ESP_LOGE(TAG, "at42qt2120 device failed to enable slider mode!");
-      
+     esp_err_t ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_SLIDER_OPTIONS, AT42QT2120_SLIDER_OPTIONS_EN);
+     if (ret == ESP_OK)
+         ret = at42qt2120_shadow_flush(at42qt2120_handle);
      return ret;
 }
 
 esp_err_t at42qt2120_enable_wheel(at42qt2120_handle_t* at42qt2120_handle) {
-    /* Write 1 to 8th and 7th bit to enable slider mode */
-    uint8_t write_buf = 0xC0;
-    esp_err_t ret = at42qt2120_register_write(at42qt2120_handle, AT42QT2120_REG_SLIDER_OPTIONS, &write_buf, 1);
-    if (ret != ESP_OK) 
-        ESP_LOGE(TAG, "at42qt2120 device failed to enable wheel mode!");
-     
+    /* Write 1 to 8th and 7th bit to enable wheel mode */
+    esp_err_t ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_SLIDER_OPTIONS, AT42QT2120_SLIDER_OPTIONS_EN | AT42QT2120_SLIDER_OPTIONS_WHEEL);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(at42qt2120_handle);
     return ret;
 }
 
 esp_err_t at42qt2120_disable_slider_wheel(at42qt2120_handle_t* at42qt2120_handle) {
     /* Write 0 to 8th and 7th bit to disable slider/wheel mode */
-    uint8_t write_buf = 0x00;
-    esp_err_t ret = at42qt2120_register_write(at42qt2120_handle, AT42QT2120_REG_SLIDER_OPTIONS, &write_buf, 1);
-    if (ret != ESP_OK) 
-        ESP_LOGE(TAG, "at42qt2120 device failed to diable slider/wheel mode!");
-     
+    esp_err_t ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_SLIDER_OPTIONS, 0x00);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(at42qt2120_handle);
     return ret;
+}
+
+/* Timing helpers */
+void at42qt2120_delay_ms(at42qt2120_handle_t* at42qt2120_handle, uint32_t delay_ms) {
+    const at42qt2120_transport_t* transport = &at42qt2120_handle->transport;
+    transport->ops->delay_ms(transport->ctx, delay_ms);
+}
+
+int64_t at42qt2120_time_us(at42qt2120_handle_t* at42qt2120_handle) {
+    const at42qt2120_transport_t* transport = &at42qt2120_handle->transport;
+    return transport->ops->time_us(transport->ctx);
+}
+
+/* Bus statistics */
+esp_err_t at42qt2120_get_bus_stats(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_bus_stats_t* stats) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL!");
+
+    *stats = at42qt2120_handle->bus_stats;
+    return ESP_OK;
+}
+
+esp_err_t at42qt2120_reset_bus_stats(at42qt2120_handle_t* at42qt2120_handle) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    at42qt2120_handle->bus_stats = (at42qt2120_bus_stats_t){ 0 };
+    return ESP_OK;
+}
+
+esp_err_t at42qt2120_get_instrumentation(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_instrumentation_t* instrumentation) {
+#if AT42QT2120_INSTRUMENTATION
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(instrumentation != NULL, ESP_ERR_INVALID_ARG, TAG, "instrumentation is NULL!");
+
+    *instrumentation = at42qt2120_handle->instrumentation;
+    return ESP_OK;
+#else
+    (void)at42qt2120_handle;
+    (void)instrumentation;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t at42qt2120_reset_instrumentation(at42qt2120_handle_t* at42qt2120_handle) {
+#if AT42QT2120_INSTRUMENTATION
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    at42qt2120_handle->instrumentation = (at42qt2120_instrumentation_t){ .ticks_per_us = at42qt2120_handle->clock.ticks_per_us };
+    return ESP_OK;
+#else
+    (void)at42qt2120_handle;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t at42qt2120_set_instrumentation_clock(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_clock_t* clock) {
+#if AT42QT2120_INSTRUMENTATION
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(clock == NULL || (clock->now != NULL && clock->ticks_per_us > 0), ESP_ERR_INVALID_ARG, TAG, "Invalid clock!");
+
+    at42qt2120_handle->clock = clock != NULL ? *clock : (at42qt2120_clock_t){ .now = NULL, .ticks_per_us = 1 };
+    return at42qt2120_reset_instrumentation(at42qt2120_handle);
+#else
+    (void)at42qt2120_handle;
+    (void)clock;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
 }
\ No newline at end of file
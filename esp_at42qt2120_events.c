@@ -0,0 +1,290 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#ifdef ESP_PLATFORM
+#include <driver/gpio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_events.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_events";
+
+#ifdef ESP_PLATFORM
+/* Upper bound of back-to-back reads per CHANGE assertion before yielding to the level re-check */
+#define AT42QT2120_EVENT_MAX_READS_PER_WAKE 4
+/* Interval in ms at which the worker re-checks the CHANGE level in case an edge was missed */
+#define AT42QT2120_EVENT_LEVEL_RECHECK_MS 100
+
+/* GPIO backend of the CHANGE line */
+static esp_err_t at42qt2120_gpio_line_enable(void* ctx, void (*isr_handler)(void* arg), void* arg) {
+    gpio_num_t gpio_num = (gpio_num_t)(intptr_t)ctx;
+
+    /* The ISR service may already be installed by the application */
+    esp_err_t ret = gpio_install_isr_service(0);
+    ESP_RETURN_ON_FALSE(ret == ESP_OK || ret == ESP_ERR_INVALID_STATE, ret, TAG, "Failed to install GPIO ISR service");
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(gpio_num, isr_handler, arg), TAG, "Failed to add CHANGE line ISR handler");
+
+    return ESP_OK;
+}
+
+static void at42qt2120_gpio_line_disable(void* ctx) {
+    gpio_isr_handler_remove((gpio_num_t)(intptr_t)ctx);
+}
+
+static bool at42qt2120_gpio_line_is_asserted(void* ctx) {
+    /* CHANGE is active low */
+    return gpio_get_level((gpio_num_t)(intptr_t)ctx) == 0;
+}
+
+/**
+  * @brief Configures a GPIO as the CHANGE line input.
+  */
+esp_err_t at42qt2120_change_line_gpio(gpio_num_t gpio_num, at42qt2120_change_line_t* change_line) {
+    ESP_RETURN_ON_FALSE(change_line != NULL, ESP_ERR_INVALID_ARG, TAG, "change_line is NULL!");
+
+    /* CHANGE is open drain, so the pull-up is required unless the board provides one */
+    gpio_config_t io_config = {
+        .pin_bit_mask = 1ULL << gpio_num,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    ESP_RETURN_ON_ERROR(gpio_config(&io_config), TAG, "Failed to configure CHANGE line GPIO");
+
+    change_line->enable = at42qt2120_gpio_line_enable;
+    change_line->disable = at42qt2120_gpio_line_disable;
+    change_line->is_asserted = at42qt2120_gpio_line_is_asserted;
+    change_line->ctx = (void*)(intptr_t)gpio_num;
+    return ESP_OK;
+}
+#endif
+
+/* Event dispatching */
+static void at42qt2120_event_emit(at42qt2120_event_engine_t* engine, const at42qt2120_event_t* event) {
+    if (engine->config.callback != NULL)
+        engine->config.callback(event, engine->config.user_ctx);
+
+#ifdef ESP_PLATFORM
+    if (engine->event_queue != NULL && xQueueSend(engine->event_queue, event, 0) != pdTRUE)
+        engine->dropped_events++;
+#endif
+}
+
+/**
+  * @brief Dispatches the difference between the previous and the new state.
+  */
+size_t at42qt2120_event_engine_process(at42qt2120_event_engine_t* engine, const at42qt2120_state_t* state) {
+    size_t event_count = 0;
+    at42qt2120_event_t event = {
+        .key_mask = state->key_mask,
+        .position = state->slider_position,
+    };
+
+    /* Only keys whose bit flipped produce an event. With its timers off the decoder never looks at the time */
+    size_t key_event_count = at42qt2120_key_decoder_feed_state(&engine->keys, 0, state);
+    for (; event_count < key_event_count; event_count++) {
+        const at42qt2120_key_event_t* key_event = &engine->keys.batch[event_count];
+        event.type = key_event->type == AT42QT2120_KEY_DOWN ? AT42QT2120_EVENT_KEY_DOWN : AT42QT2120_EVENT_KEY_UP;
+        event.key = key_event->key;
+        at42qt2120_event_emit(engine, &event);
+    }
+
+    event.key = 0;
+    if (state->slider_detected) {
+        if (!engine->slider_detected || state->slider_position != engine->slider_position) {
+            event.type = AT42QT2120_EVENT_SLIDER_MOVE;
+            at42qt2120_event_emit(engine, &event);
+            event_count++;
+        }
+        engine->slider_position = state->slider_position;
+    } else if (engine->slider_detected) {
+        event.type = AT42QT2120_EVENT_SLIDER_RELEASE;
+        event.position = engine->slider_position;
+        at42qt2120_event_emit(engine, &event);
+        event_count++;
+    }
+    engine->slider_detected = state->slider_detected;
+
+    return event_count;
+}
+
+/**
+  * @brief Reads the state once and dispatches the resulting events.
+  */
+esp_err_t at42qt2120_event_engine_service(at42qt2120_event_engine_t* engine) {
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, TAG, "engine is NULL!");
+
+    /* Reading the status registers also releases the CHANGE line. The end of a calibration asserts CHANGE
+     * too, and the same read completes a pending reset/calibration */
+    at42qt2120_state_t state;
+    esp_err_t ret = at42qt2120_read_state(engine->at42qt2120_handle, &state);
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_event_engine_process(engine, &state);
+    return ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+/* Worker task and CHANGE line interrupt */
+static void IRAM_ATTR at42qt2120_event_isr(void* arg) {
+    at42qt2120_event_engine_t* engine = (at42qt2120_event_engine_t*)arg;
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    vTaskNotifyGiveFromISR(engine->worker_task, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+static void at42qt2120_event_worker(void* arg) {
+    at42qt2120_event_engine_t* engine = (at42qt2120_event_engine_t*)arg;
+    const at42qt2120_change_line_t* change_line = &engine->config.change_line;
+
+    while (engine->running) {
+        /* Sleep until CHANGE asserts. The timeout only re-checks the line level, it never touches the bus */
+        uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AT42QT2120_EVENT_LEVEL_RECHECK_MS));
+        if (!engine->running)
+            break;
+        if (notified == 0 && !change_line->is_asserted(change_line->ctx))
+            continue;
+
+        /* One read normally releases CHANGE, read again only if the device reported a new change meanwhile */
+        for (int reads = 0; reads < AT42QT2120_EVENT_MAX_READS_PER_WAKE && engine->running; reads++) {
+            if (at42qt2120_event_engine_service(engine) != ESP_OK || !change_line->is_asserted(change_line->ctx))
+                break;
+        }
+    }
+
+    xSemaphoreGive(engine->stopped_sem);
+    vTaskDelete(NULL);
+}
+#endif
+
+/**
+  * @brief Initializes the event engine.
+  */
+esp_err_t at42qt2120_event_engine_init(at42qt2120_event_engine_t* engine, at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_event_config_t* config) {
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, TAG, "engine is NULL!");
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+
+    memset(engine, 0, sizeof(*engine));
+    engine->at42qt2120_handle = at42qt2120_handle;
+    engine->config = *config;
+
+    at42qt2120_key_config_t key_config = { .keys = AT42QT2120_KEY_MASK_ALL };
+    ESP_RETURN_ON_ERROR(at42qt2120_key_decoder_init(&engine->keys, &key_config), TAG, "Failed to initialize key decoder");
+
+#ifdef ESP_PLATFORM
+    if (config->queue_length > 0) {
+        engine->event_queue = xQueueCreate(config->queue_length, sizeof(at42qt2120_event_t));
+        ESP_RETURN_ON_FALSE(engine->event_queue != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create event queue");
+    }
+#endif
+
+    return ESP_OK;
+}
+
+/**
+  * @brief Deinitializes the event engine.
+  */
+esp_err_t at42qt2120_event_engine_deinit(at42qt2120_event_engine_t* engine) {
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, TAG, "engine is NULL!");
+
+#ifdef ESP_PLATFORM
+    if (engine->worker_task != NULL)
+        ESP_RETURN_ON_ERROR(at42qt2120_event_engine_stop(engine), TAG, "Failed to stop event engine");
+
+    if (engine->event_queue != NULL) {
+        vQueueDelete(engine->event_queue);
+        engine->event_queue = NULL;
+    }
+#endif
+
+    return ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+/**
+  * @brief Starts the worker task and arms the CHANGE line.
+  */
+esp_err_t at42qt2120_event_engine_start(at42qt2120_event_engine_t* engine) {
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, TAG, "engine is NULL!");
+    ESP_RETURN_ON_FALSE(engine->worker_task == NULL, ESP_ERR_INVALID_STATE, TAG, "Event engine is already running!");
+
+    const at42qt2120_change_line_t* change_line = &engine->config.change_line;
+    ESP_RETURN_ON_FALSE(change_line->enable != NULL && change_line->disable != NULL && change_line->is_asserted != NULL,
+                        ESP_ERR_INVALID_ARG, TAG, "CHANGE line backend is incomplete!");
+
+    engine->stopped_sem = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(engine->stopped_sem != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create stop semaphore");
+
+    engine->running = true;
+    if (xTaskCreate(at42qt2120_event_worker, "at42qt2120_evt", engine->config.task_stack_size, engine,
+                    engine->config.task_priority, &engine->worker_task) != pdPASS) {
+        engine->running = false;
+        vSemaphoreDelete(engine->stopped_sem);
+        engine->stopped_sem = NULL;
+        ESP_LOGE(TAG, "Failed to create event worker task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = change_line->enable(change_line->ctx, at42qt2120_event_isr, engine);
+    if (ret != ESP_OK) {
+        at42qt2120_event_engine_stop(engine);
+        ESP_LOGE(TAG, "Failed to enable CHANGE line");
+        return ret;
+    }
+
+    /* CHANGE may already be low (e.g. right after reset), so synchronize with the device once */
+    xTaskNotifyGive(engine->worker_task);
+
+    ESP_LOGI(TAG, "Started at42qt2120 event engine.");
+    return ESP_OK;
+}
+
+/**
+  * @brief Disarms the CHANGE line and waits for the worker task to exit.
+  */
+esp_err_t at42qt2120_event_engine_stop(at42qt2120_event_engine_t* engine) {
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, TAG, "engine is NULL!");
+    ESP_RETURN_ON_FALSE(engine->worker_task != NULL, ESP_ERR_INVALID_STATE, TAG, "Event engine is not running!");
+
+    const at42qt2120_change_line_t* change_line = &engine->config.change_line;
+    change_line->disable(change_line->ctx);
+
+    /* Let the worker finish its current transaction instead of deleting it mid-transfer */
+    engine->running = false;
+    xTaskNotifyGive(engine->worker_task);
+    xSemaphoreTake(engine->stopped_sem, portMAX_DELAY);
+
+    vSemaphoreDelete(engine->stopped_sem);
+    engine->stopped_sem = NULL;
+    engine->worker_task = NULL;
+
+    ESP_LOGI(TAG, "Stopped at42qt2120 event engine.");
+    return ESP_OK;
+}
+
+/**
+  * @brief Waits for the next event in the event queue.
+  */
+esp_err_t at42qt2120_event_engine_receive(at42qt2120_event_engine_t* engine, at42qt2120_event_t* event, int timeout_ms) {
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, TAG, "engine is NULL!");
+    ESP_RETURN_ON_FALSE(event != NULL, ESP_ERR_INVALID_ARG, TAG, "event is NULL!");
+    ESP_RETURN_ON_FALSE(engine->event_queue != NULL, ESP_ERR_INVALID_STATE, TAG, "Event queue is disabled!");
+
+    TickType_t timeout_ticks = (timeout_ms < 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    if (xQueueReceive(engine->event_queue, event, timeout_ticks) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+
+    return ESP_OK;
+}
+#endif
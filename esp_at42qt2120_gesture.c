@@ -0,0 +1,192 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_gesture.h"
+
+static const char* TAG = "esp_at42qt2120_gesture";
+
+/* Q8 fixed point: positions and velocities carry 8 fractional bits */
+#define AT42QT2120_GESTURE_Q8(units) ((int32_t)(units) * 256)
+#define AT42QT2120_GESTURE_UNITS(q8) ((q8) / 256)
+
+/* Wheel angle bound within one touch (8192 revolutions), Q8 positions and their differences stay inside int32 */
+#define AT42QT2120_GESTURE_UNWRAP_LIMIT (1 << 21)
+
+static inline int32_t at42qt2120_gesture_abs(int32_t value) {
+    return value < 0 ? -value : value;
+}
+
+static inline int32_t at42qt2120_gesture_median3(int32_t a, int32_t b, int32_t c) {
+    if (a > b) {
+        int32_t swap = a;
+        a = b;
+        b = swap;
+    }
+    /* a <= b, the median is b clamped by c */
+    if (c < a)
+        return a;
+    return c < b ? c : b;
+}
+
+static inline void at42qt2120_gesture_emit(at42qt2120_gesture_engine_t* engine, at42qt2120_gesture_type_t type, int64_t time_us, int32_t delta, uint32_t duration_us) {
+    at42qt2120_gesture_event_t event = {
+        .type = type,
+        .time_us = time_us,
+        .position = AT42QT2120_GESTURE_UNITS(engine->filtered_q8),
+        .delta = delta,
+        .velocity = AT42QT2120_GESTURE_UNITS(engine->velocity_q8),
+        .duration_us = duration_us,
+    };
+    engine->config.callback(&event, engine->config.user_ctx);
+}
+
+/* Casting the difference to int8_t takes the short way around the wheel. A touch spinning past the bound stops there */
+static inline int32_t at42qt2120_gesture_unwrap(const at42qt2120_gesture_engine_t* engine, uint8_t position) {
+    int32_t unwrapped = engine->unwrapped + (int8_t)(uint8_t)(position - engine->last_raw);
+    return at42qt2120_gesture_abs(unwrapped) <= AT42QT2120_GESTURE_UNWRAP_LIMIT ? unwrapped : engine->unwrapped;
+}
+
+/**
+  * @brief Initializes a gesture engine.
+  */
+esp_err_t at42qt2120_gesture_init(at42qt2120_gesture_engine_t* engine, const at42qt2120_gesture_config_t* config) {
+    ESP_RETURN_ON_FALSE(engine != NULL, ESP_ERR_INVALID_ARG, TAG, "engine is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+    ESP_RETURN_ON_FALSE(config->callback != NULL, ESP_ERR_INVALID_ARG, TAG, "callback is NULL!");
+    ESP_RETURN_ON_FALSE(config->position_shift < 16 && config->velocity_shift < 16, ESP_ERR_INVALID_ARG, TAG, "Filter shift out of range!");
+
+    memset(engine, 0, sizeof(*engine));
+    engine->config = *config;
+    return ESP_OK;
+}
+
+/* Touch down: restart the filters at the first position so no stale history leaks into the new touch */
+static void at42qt2120_gesture_touch_down(at42qt2120_gesture_engine_t* engine, int64_t time_us, uint8_t position) {
+    /* The wheel angle restarts at the raw position, so it only grows within one touch. A pending tap moves along
+     * with it and the double tap still compares the short way around */
+    if (engine->config.wheel && engine->last_tap_time_us != 0)
+        engine->last_tap_position_q8 -= AT42QT2120_GESTURE_Q8(at42qt2120_gesture_unwrap(engine, position) - position);
+    engine->unwrapped = position;
+
+    engine->history[0] = engine->history[1] = engine->history[2] = engine->unwrapped;
+    engine->filtered_q8 = AT42QT2120_GESTURE_Q8(engine->unwrapped);
+    engine->velocity_q8 = 0;
+    engine->down_time_us = time_us;
+    engine->down_position_q8 = engine->filtered_q8;
+    engine->rotate_anchor_q8 = engine->filtered_q8;
+}
+
+/* Touched sample: median, IIR, velocity and wheel rotation */
+static size_t at42qt2120_gesture_track(at42qt2120_gesture_engine_t* engine, int64_t time_us, uint8_t position) {
+    const at42qt2120_gesture_config_t* config = &engine->config;
+
+    engine->unwrapped = config->wheel ? at42qt2120_gesture_unwrap(engine, position) : position;
+
+    engine->history[0] = engine->history[1];
+    engine->history[1] = engine->history[2];
+    engine->history[2] = engine->unwrapped;
+    int32_t median_q8 = AT42QT2120_GESTURE_Q8(at42qt2120_gesture_median3(engine->history[0], engine->history[1], engine->history[2]));
+
+    int32_t previous_q8 = engine->filtered_q8;
+    engine->filtered_q8 += (median_q8 - engine->filtered_q8) >> config->position_shift;
+
+    int64_t dt_us = time_us - engine->last_time_us;
+    if (dt_us > 0) {
+        int64_t instant_q8 = (int64_t)(engine->filtered_q8 - previous_q8) * 1000000 / dt_us;
+        if (instant_q8 > INT32_MAX)
+            instant_q8 = INT32_MAX;
+        else if (instant_q8 < -INT32_MAX)
+            instant_q8 = -INT32_MAX;
+        engine->velocity_q8 += (int32_t)((instant_q8 - engine->velocity_q8) >> config->velocity_shift);
+    }
+
+    if (!config->wheel)
+        return 0;
+
+    /* Whole units only, the remainder stays in the anchor so slow rotations do not get lost */
+    int32_t change_q8 = engine->filtered_q8 - engine->rotate_anchor_q8;
+    if (at42qt2120_gesture_abs(change_q8) < AT42QT2120_GESTURE_Q8(config->rotate_step))
+        return 0;
+
+    int32_t delta = AT42QT2120_GESTURE_UNITS(change_q8);
+    engine->rotate_anchor_q8 += AT42QT2120_GESTURE_Q8(delta);
+    at42qt2120_gesture_emit(engine, AT42QT2120_GESTURE_ROTATE, time_us, delta, 0);
+    return 1;
+}
+
+/* Touch up: classify the finished touch */
+static size_t at42qt2120_gesture_touch_up(at42qt2120_gesture_engine_t* engine, int64_t time_us) {
+    const at42qt2120_gesture_config_t* config = &engine->config;
+    uint32_t duration_us = (uint32_t)(time_us - engine->down_time_us);
+    int32_t travel = AT42QT2120_GESTURE_UNITS(engine->filtered_q8 - engine->down_position_q8);
+
+    if (duration_us <= config->tap_max_duration_us && at42qt2120_gesture_abs(travel) <= config->tap_max_travel) {
+        bool double_tap = engine->last_tap_time_us != 0 && time_us - engine->last_tap_time_us <= config->double_tap_window_us &&
+                          at42qt2120_gesture_abs(engine->filtered_q8 - engine->last_tap_position_q8) <= AT42QT2120_GESTURE_Q8(config->tap_max_travel);
+        if (double_tap) {
+            engine->last_tap_time_us = 0;
+            at42qt2120_gesture_emit(engine, AT42QT2120_GESTURE_DOUBLE_TAP, time_us, travel, duration_us);
+        } else {
+            engine->last_tap_time_us = time_us;
+            engine->last_tap_position_q8 = engine->filtered_q8;
+            at42qt2120_gesture_emit(engine, AT42QT2120_GESTURE_TAP, time_us, travel, duration_us);
+        }
+        return 1;
+    }
+
+    engine->last_tap_time_us = 0;
+    if (at42qt2120_gesture_abs(travel) < config->swipe_min_travel || duration_us == 0)
+        return 0;
+
+    /* Average velocity decides, the smoothed release velocity is reported for flick handling */
+    int64_t average_velocity = (int64_t)at42qt2120_gesture_abs(travel) * 1000000 / duration_us;
+    if (average_velocity < config->swipe_min_velocity)
+        return 0;
+
+    at42qt2120_gesture_emit(engine, AT42QT2120_GESTURE_SWIPE, time_us, travel, duration_us);
+    return 1;
+}
+
+/**
+  * @brief Consumes one sample.
+  */
+size_t at42qt2120_gesture_feed(at42qt2120_gesture_engine_t* engine, int64_t time_us, bool touched, uint8_t position) {
+    size_t event_count = 0;
+    engine->samples++;
+
+    if (touched) {
+        if (!engine->touched)
+            at42qt2120_gesture_touch_down(engine, time_us, position);
+        else
+            event_count = at42qt2120_gesture_track(engine, time_us, position);
+
+        engine->last_raw = position;
+        engine->last_time_us = time_us;
+    } else if (engine->touched) {
+        event_count = at42qt2120_gesture_touch_up(engine, time_us);
+    }
+
+    engine->touched = touched;
+    return event_count;
+}
+
+/**
+  * @brief Consumes the slider/wheel part of a state.
+  */
+size_t at42qt2120_gesture_feed_state(at42qt2120_gesture_engine_t* engine, int64_t time_us, const at42qt2120_state_t* state) {
+    return at42qt2120_gesture_feed(engine, time_us, state->slider_detected, state->slider_position);
+}
+
+/**
+  * @brief Consumes a recorded trace of samples.
+  */
+size_t at42qt2120_gesture_feed_samples(at42qt2120_gesture_engine_t* engine, const at42qt2120_gesture_sample_t* samples, size_t sample_count) {
+    size_t event_count = 0;
+    for (size_t index = 0; index < sample_count; index++)
+        event_count += at42qt2120_gesture_feed(engine, samples[index].time_us, samples[index].touched, samples[index].position);
+
+    return event_count;
+}
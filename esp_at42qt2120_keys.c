@@ -0,0 +1,209 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_keys.h"
+
+static const char* TAG = "esp_at42qt2120_keys";
+
+/* Per sample at most: a long press or repeat per key, a chord at the end of its window, one change per key, a chord ended by a release */
+_Static_assert(AT42QT2120_NUM_KEYS + 1 + AT42QT2120_NUM_KEYS + 1 <= AT42QT2120_KEY_BATCH_MAX, "AT42QT2120_KEY_BATCH_MAX too small");
+
+#define AT42QT2120_KEY_NO_DEADLINE INT64_MAX
+
+static inline int64_t at42qt2120_key_min(int64_t a, int64_t b) {
+    return a < b ? a : b;
+}
+
+static inline void at42qt2120_key_emit(at42qt2120_key_decoder_t* decoder, at42qt2120_key_event_type_t type, uint8_t key, int64_t time_us) {
+    at42qt2120_key_event_t* event = &decoder->batch[decoder->batch_count++];
+    event->type = type;
+    event->key = key;
+    event->key_mask = decoder->debounced;
+    event->repeat = decoder->repeats[key];
+    event->time_us = time_us;
+    event->duration_us = (uint32_t)(time_us - decoder->down_us[key]);
+}
+
+/* Closes the chord window, reporting it if more than one key joined */
+static void at42qt2120_key_close_chord(at42qt2120_key_decoder_t* decoder, int64_t time_us) {
+    if (decoder->chord & (decoder->chord - 1)) {
+        uint8_t key = (uint8_t)__builtin_ctz(decoder->chord);
+        at42qt2120_key_emit(decoder, AT42QT2120_KEY_CHORD, key, time_us);
+        decoder->batch[decoder->batch_count - 1].key_mask = decoder->chord;
+    }
+    decoder->chord = 0;
+    decoder->chord_deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+}
+
+/**
+  * @brief Reports the long presses and repeats that are due and finds the next one. Only timed keys are visited.
+  */
+static void at42qt2120_key_fire_timers(at42qt2120_key_decoder_t* decoder, int64_t time_us) {
+    const at42qt2120_key_config_t* config = &decoder->config;
+    int64_t deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+
+    for (uint16_t timed = decoder->timed; timed != 0; timed &= timed - 1) {
+        uint8_t key = (uint8_t)__builtin_ctz(timed);
+        uint16_t bit = 1 << key;
+        if (decoder->fire_us[key] <= time_us) {
+            if (!(decoder->long_pressed & bit)) {
+                decoder->long_pressed |= bit;
+                at42qt2120_key_emit(decoder, AT42QT2120_KEY_LONG_PRESS, key, time_us);
+            } else {
+                decoder->repeats[key]++;
+                at42qt2120_key_emit(decoder, AT42QT2120_KEY_REPEAT, key, time_us);
+            }
+
+            if (config->repeat_us == 0) {
+                decoder->timed &= ~bit;
+                continue;
+            }
+            /* Stay on the repeat grid, periods missed between samples are skipped */
+            do {
+                decoder->fire_us[key] += config->repeat_us;
+            } while (decoder->fire_us[key] <= time_us);
+        }
+        deadline_us = at42qt2120_key_min(deadline_us, decoder->fire_us[key]);
+    }
+
+    decoder->timer_deadline_us = deadline_us;
+}
+
+/**
+  * @brief Accepts the pending changes that kept their level for the debounce time and finds the next one.
+  */
+static uint16_t at42qt2120_key_debounce(at42qt2120_key_decoder_t* decoder, int64_t time_us, uint16_t raw) {
+    const at42qt2120_key_config_t* config = &decoder->config;
+    uint16_t differing = raw ^ decoder->debounced;
+    if (config->debounce_us == 0)
+        return differing;
+
+    /* Keys flipping back before the debounce time drop out of the pending set, keys starting a change get stamped */
+    for (uint16_t started = differing & ~decoder->pending; started != 0; started &= started - 1) {
+        uint8_t key = (uint8_t)__builtin_ctz(started);
+        decoder->change_us[key] = time_us;
+        decoder->debounce_deadline_us = at42qt2120_key_min(decoder->debounce_deadline_us, time_us + config->debounce_us);
+    }
+    decoder->pending = differing;
+
+    uint16_t accepted = 0;
+    if (differing != 0 && time_us >= decoder->debounce_deadline_us) {
+        int64_t deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+        for (uint16_t pending = differing; pending != 0; pending &= pending - 1) {
+            uint8_t key = (uint8_t)__builtin_ctz(pending);
+            int64_t due_us = decoder->change_us[key] + config->debounce_us;
+            if (due_us <= time_us)
+                accepted |= 1 << key;
+            else
+                deadline_us = at42qt2120_key_min(deadline_us, due_us);
+        }
+        decoder->debounce_deadline_us = deadline_us;
+    }
+
+    decoder->pending &= ~accepted;
+    if (decoder->pending == 0)
+        decoder->debounce_deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+    return accepted;
+}
+
+/**
+  * @brief Initializes a key decoder.
+  */
+esp_err_t at42qt2120_key_decoder_init(at42qt2120_key_decoder_t* decoder, const at42qt2120_key_config_t* config) {
+    ESP_RETURN_ON_FALSE(decoder != NULL, ESP_ERR_INVALID_ARG, TAG, "decoder is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+    ESP_RETURN_ON_FALSE((config->keys & ~AT42QT2120_KEY_MASK_ALL) == 0, ESP_ERR_INVALID_ARG, TAG, "Invalid key mask!");
+
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->config = *config;
+    decoder->debounce_deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+    decoder->timer_deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+    decoder->chord_deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+    decoder->deadline_us = AT42QT2120_KEY_NO_DEADLINE;
+    return ESP_OK;
+}
+
+/**
+  * @brief Consumes one key mask. Without a new bit and before the next deadline this is a single comparison.
+  */
+size_t at42qt2120_key_decoder_feed(at42qt2120_key_decoder_t* decoder, int64_t time_us, uint16_t key_mask) {
+    const at42qt2120_key_config_t* config = &decoder->config;
+    uint16_t raw = key_mask & config->keys;
+    decoder->samples++;
+    decoder->batch_count = 0;
+    if (raw == decoder->raw && time_us < decoder->deadline_us)
+        return 0;
+
+    /* Timers that ran out since the previous sample fire before the changes of this one */
+    if (time_us >= decoder->chord_deadline_us)
+        at42qt2120_key_close_chord(decoder, time_us);
+    if (time_us >= decoder->timer_deadline_us)
+        at42qt2120_key_fire_timers(decoder, time_us);
+
+    uint16_t accepted = at42qt2120_key_debounce(decoder, time_us, raw);
+    uint16_t released = accepted & decoder->debounced;
+    uint16_t pressed = accepted & ~decoder->debounced;
+    decoder->debounced ^= accepted;
+    decoder->raw = raw;
+
+    bool chord_ended = false;
+    for (; released != 0; released &= released - 1) {
+        uint8_t key = (uint8_t)__builtin_ctz(released);
+        uint16_t bit = 1 << key;
+        at42qt2120_key_emit(decoder, AT42QT2120_KEY_UP, key, time_us);
+        decoder->timed &= ~bit;
+        decoder->long_pressed &= ~bit;
+        decoder->repeats[key] = 0;
+        chord_ended |= (decoder->chord & bit) != 0;
+    }
+    if (chord_ended)
+        at42qt2120_key_close_chord(decoder, time_us);
+
+    for (; pressed != 0; pressed &= pressed - 1) {
+        uint8_t key = (uint8_t)__builtin_ctz(pressed);
+        uint16_t bit = 1 << key;
+        decoder->down_us[key] = time_us;
+        at42qt2120_key_emit(decoder, AT42QT2120_KEY_DOWN, key, time_us);
+
+        if (config->long_press_us != 0) {
+            decoder->timed |= bit;
+            decoder->fire_us[key] = time_us + config->long_press_us;
+            decoder->timer_deadline_us = at42qt2120_key_min(decoder->timer_deadline_us, decoder->fire_us[key]);
+        }
+        if (config->chord_window_us != 0) {
+            if (decoder->chord == 0)
+                decoder->chord_deadline_us = time_us + config->chord_window_us;
+            decoder->chord |= bit;
+        }
+    }
+
+    decoder->deadline_us = at42qt2120_key_min(decoder->debounce_deadline_us, at42qt2120_key_min(decoder->timer_deadline_us, decoder->chord_deadline_us));
+    if (decoder->batch_count > 0 && config->callback != NULL)
+        config->callback(decoder->batch, decoder->batch_count, config->user_ctx);
+    return decoder->batch_count;
+}
+
+/**
+  * @brief Consumes the key mask of a state snapshot.
+  */
+size_t at42qt2120_key_decoder_feed_state(at42qt2120_key_decoder_t* decoder, int64_t time_us, const at42qt2120_state_t* state) {
+    return at42qt2120_key_decoder_feed(decoder, time_us, state->key_mask);
+}
+
+/**
+  * @brief Runs the deadlines up to time_us by feeding the last mask again.
+  */
+size_t at42qt2120_key_decoder_tick(at42qt2120_key_decoder_t* decoder, int64_t time_us) {
+    return at42qt2120_key_decoder_feed(decoder, time_us, decoder->raw);
+}
+
+/**
+  * @brief Returns the earliest pending deadline.
+  */
+int64_t at42qt2120_key_decoder_next_deadline(const at42qt2120_key_decoder_t* decoder) {
+    return decoder->deadline_us;
+}
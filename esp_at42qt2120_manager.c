@@ -0,0 +1,492 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#ifdef ESP_PLATFORM
+#include <driver/i2c_master.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_manager.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_manager";
+
+#ifdef ESP_PLATFORM
+/* Event group bits: scan finished per bus in the low byte, worker exited per bus in the next */
+#define AT42QT2120_MANAGER_SCAN_DONE_BIT(bus) (1 << (bus))
+#define AT42QT2120_MANAGER_EXITED_BIT(bus) (1 << (AT42QT2120_MANAGER_MAX_BUSES + (bus)))
+#endif
+
+/* Sort key of a sensor within its bus: direct sensor first, then by mux and channel */
+static uint16_t at42qt2120_manager_order_key(const at42qt2120_sensor_location_t* location) {
+    if (location->mux == AT42QT2120_MANAGER_NO_MUX)
+        return 0;
+
+    return ((uint16_t)(location->mux + 1) * AT42QT2120_MUX_NUM_CHANNELS) + location->channel;
+}
+
+/**
+  * @brief Routes the bus to a sensor, writing mux selections only when they change.
+  */
+static esp_err_t at42qt2120_manager_select(at42qt2120_manager_sensor_t* sensor) {
+    at42qt2120_manager_t* manager = sensor->manager;
+    at42qt2120_manager_bus_t* bus = &manager->buses[sensor->location.bus];
+    uint8_t target_mux = sensor->location.mux;
+    uint8_t target_mask = target_mux == AT42QT2120_MANAGER_NO_MUX ? 0 : (uint8_t)(1 << sensor->location.channel);
+
+    if (bus->active_mux == target_mux && (target_mux == AT42QT2120_MANAGER_NO_MUX || manager->muxes[target_mux].channel_mask == target_mask))
+        return ESP_OK;
+
+    /* Another mux still connects its channel, and with it a device at the same address */
+    if (bus->active_mux != AT42QT2120_MANAGER_NO_MUX && bus->active_mux != target_mux) {
+        at42qt2120_manager_mux_t* active = &manager->muxes[bus->active_mux];
+        esp_err_t ret = active->mux.select(active->mux.ctx, 0, manager->transaction_timeout_ms);
+        bus->mux_switches++;
+        if (ret != ESP_OK)
+            return ret;
+        active->channel_mask = 0;
+        bus->active_mux = AT42QT2120_MANAGER_NO_MUX;
+    }
+
+    if (target_mux != AT42QT2120_MANAGER_NO_MUX) {
+        at42qt2120_manager_mux_t* target = &manager->muxes[target_mux];
+        esp_err_t ret = target->mux.select(target->mux.ctx, target_mask, manager->transaction_timeout_ms);
+        bus->mux_switches++;
+        if (ret != ESP_OK) {
+            /* The channel state is unknown, force a write next time */
+            target->channel_mask = 0xFF;
+            bus->active_mux = target_mux;
+            return ret;
+        }
+        target->channel_mask = target_mask;
+        bus->active_mux = target_mux;
+    }
+
+    return ESP_OK;
+}
+
+/* Mux-selecting transport wrapped around each sensor's own transport. The context is the sensor */
+static esp_err_t at42qt2120_manager_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms) {
+    at42qt2120_manager_sensor_t* sensor = (at42qt2120_manager_sensor_t*)ctx;
+    esp_err_t ret = at42qt2120_manager_select(sensor);
+    if (ret != ESP_OK)
+        return ret;
+
+    return sensor->transport.ops->transmit_receive(sensor->transport.ctx, write_buf, write_size, read_buf, read_size, timeout_ms);
+}
+
+static esp_err_t at42qt2120_manager_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    at42qt2120_manager_sensor_t* sensor = (at42qt2120_manager_sensor_t*)ctx;
+    esp_err_t ret = at42qt2120_manager_select(sensor);
+    if (ret != ESP_OK)
+        return ret;
+
+    return sensor->transport.ops->transmit(sensor->transport.ctx, write_buf, write_size, timeout_ms);
+}
+
+static esp_err_t at42qt2120_manager_probe(void* ctx, int timeout_ms) {
+    at42qt2120_manager_sensor_t* sensor = (at42qt2120_manager_sensor_t*)ctx;
+    esp_err_t ret = at42qt2120_manager_select(sensor);
+    if (ret != ESP_OK)
+        return ret;
+
+    return sensor->transport.ops->probe(sensor->transport.ctx, timeout_ms);
+}
+
+static esp_err_t at42qt2120_manager_release(void* ctx) {
+    at42qt2120_manager_sensor_t* sensor = (at42qt2120_manager_sensor_t*)ctx;
+    if (sensor->transport.ops->release == NULL)
+        return ESP_OK;
+
+    return sensor->transport.ops->release(sensor->transport.ctx);
+}
+
+static void at42qt2120_manager_delay_ms(void* ctx, uint32_t delay_ms) {
+    at42qt2120_manager_sensor_t* sensor = (at42qt2120_manager_sensor_t*)ctx;
+    sensor->transport.ops->delay_ms(sensor->transport.ctx, delay_ms);
+}
+
+static int64_t at42qt2120_manager_time_us(void* ctx) {
+    at42qt2120_manager_sensor_t* sensor = (at42qt2120_manager_sensor_t*)ctx;
+    return sensor->transport.ops->time_us(sensor->transport.ctx);
+}
+
+static const at42qt2120_transport_ops_t at42qt2120_manager_transport_ops = {
+    .transmit_receive = at42qt2120_manager_transmit_receive,
+    .transmit = at42qt2120_manager_transmit,
+    .probe = at42qt2120_manager_probe,
+    .release = at42qt2120_manager_release,
+    .delay_ms = at42qt2120_manager_delay_ms,
+    .time_us = at42qt2120_manager_time_us,
+};
+
+/**
+  * @brief Validates a location and prepares the next free sensor slot for it.
+  */
+static esp_err_t at42qt2120_manager_reserve(at42qt2120_manager_t* manager, const at42qt2120_sensor_location_t* location, at42qt2120_manager_sensor_t** sensor) {
+    ESP_RETURN_ON_FALSE(manager != NULL, ESP_ERR_INVALID_ARG, TAG, "manager is NULL!");
+    ESP_RETURN_ON_FALSE(location != NULL, ESP_ERR_INVALID_ARG, TAG, "location is NULL!");
+    ESP_RETURN_ON_FALSE(manager->sensor_count < AT42QT2120_MANAGER_MAX_SENSORS, ESP_ERR_NO_MEM, TAG, "Too many sensors!");
+    ESP_RETURN_ON_FALSE(location->bus < AT42QT2120_MANAGER_MAX_BUSES, ESP_ERR_INVALID_ARG, TAG, "Invalid bus index!");
+
+    at42qt2120_sensor_location_t normalized = *location;
+    if (normalized.mux == AT42QT2120_MANAGER_NO_MUX) {
+        normalized.channel = 0;
+    } else {
+        ESP_RETURN_ON_FALSE(normalized.mux < manager->mux_count && manager->muxes[normalized.mux].bus == normalized.bus,
+                            ESP_ERR_INVALID_ARG, TAG, "Invalid mux index!");
+        ESP_RETURN_ON_FALSE(normalized.channel < AT42QT2120_MUX_NUM_CHANNELS, ESP_ERR_INVALID_ARG, TAG, "Invalid mux channel!");
+    }
+
+    /* The address is fixed, so a bus position can only hold one sensor */
+    for (uint8_t index = 0; index < manager->sensor_count; index++) {
+        const at42qt2120_sensor_location_t* other = &manager->sensors[index].location;
+        ESP_RETURN_ON_FALSE(other->bus != normalized.bus || other->mux != normalized.mux || other->channel != normalized.channel,
+                            ESP_ERR_INVALID_STATE, TAG, "Bus position is already taken!");
+    }
+
+    *sensor = &manager->sensors[manager->sensor_count];
+    memset(*sensor, 0, sizeof(**sensor));
+    (*sensor)->manager = manager;
+    (*sensor)->location = normalized;
+    return ESP_OK;
+}
+
+/**
+  * @brief Accepts the reserved sensor and inserts it into the scan order of its bus.
+  */
+static void at42qt2120_manager_commit(at42qt2120_manager_t* manager, uint8_t* sensor_index) {
+    uint8_t index = manager->sensor_count++;
+    const at42qt2120_sensor_location_t* location = &manager->sensors[index].location;
+    at42qt2120_manager_bus_t* bus = &manager->buses[location->bus];
+
+    uint16_t key = at42qt2120_manager_order_key(location);
+    uint8_t position = bus->sensor_count;
+    while (position > 0 && at42qt2120_manager_order_key(&manager->sensors[bus->sensors[position - 1]].location) > key) {
+        bus->sensors[position] = bus->sensors[position - 1];
+        position--;
+    }
+    bus->sensors[position] = index;
+    bus->sensor_count++;
+
+    if (location->bus >= manager->bus_count)
+        manager->bus_count = location->bus + 1;
+    if (sensor_index != NULL)
+        *sensor_index = index;
+}
+
+/**
+  * @brief Initializes an empty manager.
+  */
+esp_err_t at42qt2120_manager_init(at42qt2120_manager_t* manager, int time_out) {
+    ESP_RETURN_ON_FALSE(manager != NULL, ESP_ERR_INVALID_ARG, TAG, "manager is NULL!");
+
+    memset(manager, 0, sizeof(*manager));
+    manager->transaction_timeout_ms = time_out;
+    for (uint8_t bus = 0; bus < AT42QT2120_MANAGER_MAX_BUSES; bus++) {
+        manager->buses[bus].active_mux = AT42QT2120_MANAGER_NO_MUX;
+#ifdef ESP_PLATFORM
+        manager->buses[bus].manager = manager;
+#endif
+    }
+
+    return ESP_OK;
+}
+
+/**
+  * @brief Deinitializes every sensor.
+  */
+esp_err_t at42qt2120_manager_deinit(at42qt2120_manager_t* manager) {
+    ESP_RETURN_ON_FALSE(manager != NULL, ESP_ERR_INVALID_ARG, TAG, "manager is NULL!");
+
+#ifdef ESP_PLATFORM
+    if (manager->running)
+        ESP_RETURN_ON_ERROR(at42qt2120_manager_stop(manager), TAG, "Failed to stop manager");
+#endif
+
+    esp_err_t result = ESP_OK;
+    for (uint8_t index = 0; index < manager->sensor_count; index++) {
+        esp_err_t ret = at42qt2120_deinit(&manager->sensors[index].handle);
+        if (ret != ESP_OK && result == ESP_OK)
+            result = ret;
+    }
+
+    manager->sensor_count = 0;
+    for (uint8_t bus = 0; bus < AT42QT2120_MANAGER_MAX_BUSES; bus++)
+        manager->buses[bus].sensor_count = 0;
+
+    return result;
+}
+
+/**
+  * @brief Registers a multiplexer and disconnects all its channels.
+  */
+esp_err_t at42qt2120_manager_add_mux(at42qt2120_manager_t* manager, uint8_t bus, const at42qt2120_mux_t* mux, uint8_t* mux_index) {
+    ESP_RETURN_ON_FALSE(manager != NULL, ESP_ERR_INVALID_ARG, TAG, "manager is NULL!");
+    ESP_RETURN_ON_FALSE(mux != NULL && mux->select != NULL, ESP_ERR_INVALID_ARG, TAG, "mux is NULL!");
+    ESP_RETURN_ON_FALSE(mux_index != NULL, ESP_ERR_INVALID_ARG, TAG, "mux_index is NULL!");
+    ESP_RETURN_ON_FALSE(bus < AT42QT2120_MANAGER_MAX_BUSES, ESP_ERR_INVALID_ARG, TAG, "Invalid bus index!");
+    ESP_RETURN_ON_FALSE(manager->mux_count < AT42QT2120_MANAGER_MAX_MUXES, ESP_ERR_NO_MEM, TAG, "Too many muxes!");
+
+    /* Start from a known state, several muxes may have connected a sensor after power-up */
+    ESP_RETURN_ON_ERROR(mux->select(mux->ctx, 0, manager->transaction_timeout_ms), TAG, "Failed to reset mux");
+
+    at42qt2120_manager_mux_t* entry = &manager->muxes[manager->mux_count];
+    entry->mux = *mux;
+    entry->bus = bus;
+    entry->channel_mask = 0;
+
+    *mux_index = manager->mux_count++;
+    return ESP_OK;
+}
+
+/**
+  * @brief Adds a sensor reachable through the given transport.
+  */
+esp_err_t at42qt2120_manager_add_sensor(at42qt2120_manager_t* manager, const at42qt2120_sensor_location_t* location,
+                                        const at42qt2120_transport_t* transport, int time_out, uint8_t* sensor_index) {
+    ESP_RETURN_ON_FALSE(transport != NULL && transport->ops != NULL, ESP_ERR_INVALID_ARG, TAG, "transport is NULL!");
+
+    at42qt2120_manager_sensor_t* sensor;
+    ESP_RETURN_ON_ERROR(at42qt2120_manager_reserve(manager, location, &sensor), TAG, "Failed to reserve sensor");
+    sensor->transport = *transport;
+
+    /* The probe already goes through the wrapper and selects the channel */
+    at42qt2120_transport_t wrapped = {
+        .ops = &at42qt2120_manager_transport_ops,
+        .ctx = sensor,
+    };
+    ESP_RETURN_ON_ERROR(at42qt2120_init_with_transport(&sensor->handle, &wrapped, time_out), TAG, "Sensor on bus %u is not responding", location->bus);
+
+    at42qt2120_manager_commit(manager, sensor_index);
+    return ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+/**
+  * @brief Adds a sensor on an ESP32 I2C bus.
+  */
+esp_err_t at42qt2120_manager_add_i2c_sensor(at42qt2120_manager_t* manager, i2c_master_bus_handle_t bus_handle, const at42qt2120_sensor_location_t* location,
+                                            size_t clock_speed, int time_out, uint8_t* sensor_index) {
+    at42qt2120_manager_sensor_t* sensor;
+    ESP_RETURN_ON_ERROR(at42qt2120_manager_reserve(manager, location, &sensor), TAG, "Failed to reserve sensor");
+
+    /* at42qt2120_init() probes right away, so route the bus to the sensor first */
+    ESP_RETURN_ON_ERROR(at42qt2120_manager_select(sensor), TAG, "Failed to select mux channel");
+    ESP_RETURN_ON_ERROR(at42qt2120_init(bus_handle, &sensor->handle, clock_speed, time_out), TAG, "Failed to add sensor");
+
+    /* Wrap the I2C transport installed by at42qt2120_init() */
+    sensor->transport = sensor->handle.transport;
+    sensor->handle.transport.ops = &at42qt2120_manager_transport_ops;
+    sensor->handle.transport.ctx = sensor;
+
+    at42qt2120_manager_commit(manager, sensor_index);
+    return ESP_OK;
+}
+
+static esp_err_t at42qt2120_tca9548a_select(void* ctx, uint8_t channel_mask, int timeout_ms) {
+    i2c_master_dev_handle_t device_handle = (i2c_master_dev_handle_t)ctx;
+    return i2c_master_transmit(device_handle, &channel_mask, 1, timeout_ms);
+}
+
+/**
+  * @brief Fills a multiplexer backend for a TCA9548A.
+  */
+esp_err_t at42qt2120_mux_tca9548a(i2c_master_bus_handle_t bus_handle, uint8_t address, size_t clock_speed, at42qt2120_mux_t* mux) {
+    ESP_RETURN_ON_FALSE(bus_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "i2c bus is NULL!");
+    ESP_RETURN_ON_FALSE(mux != NULL, ESP_ERR_INVALID_ARG, TAG, "mux is NULL!");
+
+    i2c_device_config_t device_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = address,
+        .scl_speed_hz = clock_speed,
+    };
+    i2c_master_dev_handle_t device_handle;
+    ESP_RETURN_ON_ERROR(i2c_master_bus_add_device(bus_handle, &device_config, &device_handle), TAG, "Failed to add TCA9548A to i2c bus");
+
+    mux->select = at42qt2120_tca9548a_select;
+    mux->ctx = device_handle;
+    return ESP_OK;
+}
+#endif
+
+/**
+  * @brief Returns the handle of a sensor.
+  */
+at42qt2120_handle_t* at42qt2120_manager_get_handle(at42qt2120_manager_t* manager, uint8_t sensor_index) {
+    if (manager == NULL || sensor_index >= manager->sensor_count)
+        return NULL;
+
+    return &manager->sensors[sensor_index].handle;
+}
+
+/**
+  * @brief Reads every sensor of one bus, in alternating direction so the first read needs no channel switch.
+  */
+static esp_err_t at42qt2120_manager_scan_bus(at42qt2120_manager_t* manager, uint8_t bus_index) {
+    at42qt2120_manager_bus_t* bus = &manager->buses[bus_index];
+    if (bus->sensor_count == 0) {
+        bus->last_scan_us = 0;
+        return ESP_OK;
+    }
+
+    at42qt2120_handle_t* clock_handle = &manager->sensors[bus->sensors[0]].handle;
+    int64_t start_us = at42qt2120_time_us(clock_handle);
+
+    esp_err_t result = ESP_OK;
+    for (uint8_t step = 0; step < bus->sensor_count; step++) {
+        uint8_t position = bus->reverse ? bus->sensor_count - 1 - step : step;
+        at42qt2120_manager_sensor_t* sensor = &manager->sensors[bus->sensors[position]];
+        sensor->last_error = at42qt2120_read_state(&sensor->handle, &sensor->state);
+        if (sensor->last_error != ESP_OK && result == ESP_OK)
+            result = sensor->last_error;
+    }
+
+    bus->reverse = !bus->reverse;
+    bus->last_scan_us = at42qt2120_time_us(clock_handle) - start_us;
+    return result;
+}
+
+/* Runs the recoveries the scan of one bus flagged, once all of its states were read */
+static void at42qt2120_manager_recover_bus(at42qt2120_manager_t* manager, uint8_t bus_index) {
+    at42qt2120_manager_bus_t* bus = &manager->buses[bus_index];
+    for (uint8_t step = 0; step < bus->sensor_count; step++)
+        at42qt2120_recover_poll(&manager->sensors[bus->sensors[step]].handle);
+}
+
+#ifdef ESP_PLATFORM
+/* Worker task scanning one bus whenever at42qt2120_manager_scan() notifies it */
+static void at42qt2120_manager_worker(void* arg) {
+    at42qt2120_manager_bus_t* bus = (at42qt2120_manager_bus_t*)arg;
+    at42qt2120_manager_t* manager = bus->manager;
+    uint8_t bus_index = bus - manager->buses;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!manager->running)
+            break;
+
+        bus->last_result = at42qt2120_manager_scan_bus(manager, bus_index);
+        /* Before the done bit, the caller may use the handles once the scan returned */
+        at42qt2120_manager_recover_bus(manager, bus_index);
+        xEventGroupSetBits(manager->done_group, AT42QT2120_MANAGER_SCAN_DONE_BIT(bus_index));
+    }
+
+    xEventGroupSetBits(manager->done_group, AT42QT2120_MANAGER_EXITED_BIT(bus_index));
+    vTaskDelete(NULL);
+}
+
+/**
+  * @brief Starts one worker task per bus in use.
+  */
+esp_err_t at42qt2120_manager_start(at42qt2120_manager_t* manager, uint32_t task_stack_size, UBaseType_t task_priority) {
+    ESP_RETURN_ON_FALSE(manager != NULL, ESP_ERR_INVALID_ARG, TAG, "manager is NULL!");
+    ESP_RETURN_ON_FALSE(!manager->running, ESP_ERR_INVALID_STATE, TAG, "Manager is already running!");
+
+    manager->done_group = xEventGroupCreate();
+    ESP_RETURN_ON_FALSE(manager->done_group != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create event group");
+
+    manager->running = true;
+    for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++) {
+        at42qt2120_manager_bus_t* bus = &manager->buses[bus_index];
+        if (bus->sensor_count == 0)
+            continue;
+
+        if (xTaskCreate(at42qt2120_manager_worker, "at42qt2120_bus", task_stack_size, bus, task_priority, &bus->worker_task) != pdPASS) {
+            at42qt2120_manager_stop(manager);
+            ESP_LOGE(TAG, "Failed to create bus worker task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    ESP_LOGI(TAG, "Started at42qt2120 manager with %u buses.", manager->bus_count);
+    return ESP_OK;
+}
+
+/**
+  * @brief Stops the worker tasks and waits for them to exit.
+  */
+esp_err_t at42qt2120_manager_stop(at42qt2120_manager_t* manager) {
+    ESP_RETURN_ON_FALSE(manager != NULL, ESP_ERR_INVALID_ARG, TAG, "manager is NULL!");
+    ESP_RETURN_ON_FALSE(manager->running, ESP_ERR_INVALID_STATE, TAG, "Manager is not running!");
+
+    /* Let the workers finish their current scan instead of deleting them mid-transfer */
+    manager->running = false;
+    EventBits_t exited_bits = 0;
+    for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++) {
+        at42qt2120_manager_bus_t* bus = &manager->buses[bus_index];
+        if (bus->worker_task == NULL)
+            continue;
+
+        exited_bits |= AT42QT2120_MANAGER_EXITED_BIT(bus_index);
+        xTaskNotifyGive(bus->worker_task);
+    }
+    if (exited_bits != 0)
+        xEventGroupWaitBits(manager->done_group, exited_bits, pdTRUE, pdTRUE, portMAX_DELAY);
+
+    for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++)
+        manager->buses[bus_index].worker_task = NULL;
+    vEventGroupDelete(manager->done_group);
+    manager->done_group = NULL;
+
+    ESP_LOGI(TAG, "Stopped at42qt2120 manager.");
+    return ESP_OK;
+}
+#endif
+
+/**
+  * @brief Reads the state of every sensor.
+  */
+esp_err_t at42qt2120_manager_scan(at42qt2120_manager_t* manager) {
+    ESP_RETURN_ON_FALSE(manager != NULL, ESP_ERR_INVALID_ARG, TAG, "manager is NULL!");
+
+#ifdef ESP_PLATFORM
+    if (manager->running) {
+        /* Every bus is scanned by its own worker, the call returns once the slowest bus is done */
+        EventBits_t done_bits = 0;
+        for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++) {
+            at42qt2120_manager_bus_t* bus = &manager->buses[bus_index];
+            if (bus->worker_task == NULL)
+                continue;
+
+            done_bits |= AT42QT2120_MANAGER_SCAN_DONE_BIT(bus_index);
+            xTaskNotifyGive(bus->worker_task);
+        }
+        if (done_bits != 0)
+            xEventGroupWaitBits(manager->done_group, done_bits, pdTRUE, pdTRUE, portMAX_DELAY);
+    } else
+#endif
+    {
+        for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++)
+            manager->buses[bus_index].last_result = at42qt2120_manager_scan_bus(manager, bus_index);
+        for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++)
+            at42qt2120_manager_recover_bus(manager, bus_index);
+    }
+
+    for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++) {
+        if (manager->buses[bus_index].last_result != ESP_OK)
+            return manager->buses[bus_index].last_result;
+    }
+
+    return ESP_OK;
+}
+
+/**
+  * @brief Returns the duration of the slowest bus in the last scan.
+  */
+int64_t at42qt2120_manager_scan_latency_us(const at42qt2120_manager_t* manager) {
+    if (manager == NULL)
+        return 0;
+
+    int64_t latency_us = 0;
+    for (uint8_t bus_index = 0; bus_index < manager->bus_count; bus_index++) {
+        if (manager->buses[bus_index].last_scan_us > latency_us)
+            latency_us = manager->buses[bus_index].last_scan_us;
+    }
+
+    return latency_us;
+}
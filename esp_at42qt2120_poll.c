@@ -0,0 +1,190 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_poll.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_poll";
+
+/* Low power mode whose measurement interval is closest to the poll period without exceeding it */
+static uint8_t at42qt2120_poll_low_power_mode(uint32_t period_ms) {
+    uint32_t steps = period_ms / AT42QT2120_LOW_POWER_STEP_MS;
+    if (steps == 0)
+        return 1;
+    return steps > UINT8_MAX ? UINT8_MAX : (uint8_t)steps;
+}
+
+static esp_err_t at42qt2120_poll_set_period(at42qt2120_poll_scheduler_t* scheduler, uint32_t period_ms) {
+    scheduler->period_ms = period_ms;
+    if (!scheduler->config.track_low_power)
+        return ESP_OK;
+
+    uint8_t low_power_mode = at42qt2120_poll_low_power_mode(period_ms);
+    if (low_power_mode == scheduler->low_power_mode)
+        return ESP_OK;
+
+    esp_err_t ret = at42qt2120_shadow_write(scheduler->at42qt2120_handle, AT42QT2120_REG_LOW_POWER_MODE, low_power_mode);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(scheduler->at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    /* Only counted once written, a failed write is retried by the next update */
+    scheduler->low_power_mode = low_power_mode;
+    scheduler->low_power_writes++;
+    return ESP_OK;
+}
+
+/**
+  * @brief Initializes a polling scheduler.
+  */
+esp_err_t at42qt2120_poll_init(at42qt2120_poll_scheduler_t* scheduler, at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_poll_config_t* config) {
+    ESP_RETURN_ON_FALSE(scheduler != NULL, ESP_ERR_INVALID_ARG, TAG, "scheduler is NULL!");
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+    ESP_RETURN_ON_FALSE(config->min_period_ms > 0 && config->min_period_ms <= config->max_period_ms, ESP_ERR_INVALID_ARG, TAG, "Invalid poll period bounds!");
+
+    memset(scheduler, 0, sizeof(*scheduler));
+    scheduler->at42qt2120_handle = at42qt2120_handle;
+    scheduler->config = *config;
+    scheduler->last_activity_us = at42qt2120_time_us(at42qt2120_handle);
+    return at42qt2120_poll_set_period(scheduler, config->min_period_ms);
+}
+
+/**
+  * @brief Deinitializes a polling scheduler.
+  */
+esp_err_t at42qt2120_poll_deinit(at42qt2120_poll_scheduler_t* scheduler) {
+    ESP_RETURN_ON_FALSE(scheduler != NULL, ESP_ERR_INVALID_ARG, TAG, "scheduler is NULL!");
+
+#ifdef ESP_PLATFORM
+    if (scheduler->poll_task != NULL)
+        ESP_RETURN_ON_ERROR(at42qt2120_poll_stop(scheduler), TAG, "Failed to stop polling task");
+#endif
+
+    scheduler->at42qt2120_handle = NULL;
+    return ESP_OK;
+}
+
+/**
+  * @brief Updates the poll period from a state.
+  */
+esp_err_t at42qt2120_poll_update(at42qt2120_poll_scheduler_t* scheduler, const at42qt2120_state_t* state, int64_t time_us) {
+    ESP_RETURN_ON_FALSE(scheduler != NULL, ESP_ERR_INVALID_ARG, TAG, "scheduler is NULL!");
+    ESP_RETURN_ON_FALSE(state != NULL, ESP_ERR_INVALID_ARG, TAG, "state is NULL!");
+
+    const at42qt2120_poll_config_t* config = &scheduler->config;
+    bool touched = state->touch_detected || state->slider_detected;
+    bool moved = false;
+    if (state->slider_detected && scheduler->touched) {
+        int delta = (int)state->slider_position - (int)scheduler->slider_position;
+        moved = (delta < 0 ? -delta : delta) >= config->motion_threshold;
+    }
+    /* A release is activity too, the next touch often follows right after it */
+    bool active = touched || moved || scheduler->touched;
+
+    scheduler->touched = touched;
+    scheduler->slider_position = state->slider_position;
+
+    uint32_t period_ms = scheduler->period_ms;
+    if (active) {
+        scheduler->last_activity_us = time_us;
+        period_ms = config->min_period_ms;
+    } else if (time_us - scheduler->last_activity_us >= (int64_t)config->idle_hold_ms * 1000 && period_ms < config->max_period_ms) {
+        /* Hysteresis: keep the fast rate for idle_hold_ms, then double the period on every idle poll */
+        period_ms = period_ms * 2 < config->max_period_ms ? period_ms * 2 : config->max_period_ms;
+    }
+
+    /* Also with the period unchanged: the bus is only touched while the low power mode differs from the wanted one */
+    return at42qt2120_poll_set_period(scheduler, period_ms);
+}
+
+/**
+  * @brief Reads the state once and updates the poll period.
+  */
+esp_err_t at42qt2120_poll_once(at42qt2120_poll_scheduler_t* scheduler, at42qt2120_state_t* state) {
+    ESP_RETURN_ON_FALSE(scheduler != NULL, ESP_ERR_INVALID_ARG, TAG, "scheduler is NULL!");
+    ESP_RETURN_ON_FALSE(state != NULL, ESP_ERR_INVALID_ARG, TAG, "state is NULL!");
+
+    esp_err_t ret = at42qt2120_read_state(scheduler->at42qt2120_handle, state);
+    if (ret != ESP_OK) {
+        scheduler->read_errors++;
+        return ret;
+    }
+
+    scheduler->polls++;
+    return at42qt2120_poll_update(scheduler, state, at42qt2120_time_us(scheduler->at42qt2120_handle));
+}
+
+#ifdef ESP_PLATFORM
+static void at42qt2120_poll_task(void* arg) {
+    at42qt2120_poll_scheduler_t* scheduler = (at42qt2120_poll_scheduler_t*)arg;
+    at42qt2120_state_t state;
+
+    while (scheduler->running) {
+        if (at42qt2120_poll_once(scheduler, &state) == ESP_OK && scheduler->config.callback != NULL)
+            scheduler->config.callback(&state, scheduler->config.user_ctx);
+        /* A recovery flagged by the read runs once the state was handed on, rate-limited */
+        at42qt2120_recover_poll(scheduler->at42qt2120_handle);
+
+        /* Woken early by at42qt2120_poll_stop(), so long idle periods do not delay stopping */
+        TickType_t period_ticks = pdMS_TO_TICKS(scheduler->period_ms);
+        ulTaskNotifyTake(pdTRUE, period_ticks > 0 ? period_ticks : 1);
+    }
+
+    xSemaphoreGive(scheduler->stopped_sem);
+    vTaskDelete(NULL);
+}
+
+/**
+  * @brief Starts the polling task.
+  */
+esp_err_t at42qt2120_poll_start(at42qt2120_poll_scheduler_t* scheduler) {
+    ESP_RETURN_ON_FALSE(scheduler != NULL, ESP_ERR_INVALID_ARG, TAG, "scheduler is NULL!");
+    ESP_RETURN_ON_FALSE(scheduler->poll_task == NULL, ESP_ERR_INVALID_STATE, TAG, "Polling task is already running!");
+
+    scheduler->stopped_sem = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(scheduler->stopped_sem != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create stop semaphore");
+
+    scheduler->running = true;
+    if (xTaskCreate(at42qt2120_poll_task, "at42qt2120_poll", scheduler->config.task_stack_size, scheduler,
+                    scheduler->config.task_priority, &scheduler->poll_task) != pdPASS) {
+        scheduler->running = false;
+        vSemaphoreDelete(scheduler->stopped_sem);
+        scheduler->stopped_sem = NULL;
+        ESP_LOGE(TAG, "Failed to create polling task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Started at42qt2120 polling task.");
+    return ESP_OK;
+}
+
+/**
+  * @brief Stops the polling task.
+  */
+esp_err_t at42qt2120_poll_stop(at42qt2120_poll_scheduler_t* scheduler) {
+    ESP_RETURN_ON_FALSE(scheduler != NULL, ESP_ERR_INVALID_ARG, TAG, "scheduler is NULL!");
+    ESP_RETURN_ON_FALSE(scheduler->poll_task != NULL, ESP_ERR_INVALID_STATE, TAG, "Polling task is not running!");
+
+    /* Let the task finish its current poll instead of deleting it mid-transfer */
+    scheduler->running = false;
+    xTaskNotifyGive(scheduler->poll_task);
+    xSemaphoreTake(scheduler->stopped_sem, portMAX_DELAY);
+
+    vSemaphoreDelete(scheduler->stopped_sem);
+    scheduler->stopped_sem = NULL;
+    scheduler->poll_task = NULL;
+
+    ESP_LOGI(TAG, "Stopped at42qt2120 polling task.");
+    return ESP_OK;
+}
+#endif
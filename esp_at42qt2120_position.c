@@ -0,0 +1,236 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_position.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_position";
+
+/* Positions are kept in 16-bit units: one slider length or wheel revolution spans 65536 */
+#define AT42QT2120_POSITION_FULL_SCALE 65536
+/* Burst from the key 0 signal up to the key 2 reference */
+#define AT42QT2120_POSITION_BURST_SIZE (AT42QT2120_REG_KEY_02_LSB_REFERENCE - AT42QT2120_REG_KEY_00_MSB_SIGNAL + 1)
+/* The position register is taken only within a sixteenth of the slider of the interpolation, a stale register is further away */
+#define AT42QT2120_POSITION_REGISTER_TOLERANCE (AT42QT2120_POSITION_FULL_SCALE / 16)
+/* No position register read alongside the deltas */
+#define AT42QT2120_POSITION_NO_REGISTER (-1)
+/* A slider calibration needs pairs whose raw positions spread at least an eighth of the slider (standard deviation) */
+#define AT42QT2120_POSITION_MIN_SPREAD (AT42QT2120_POSITION_FULL_SCALE / 8)
+
+static inline int32_t at42qt2120_position_clamp(int32_t value) {
+    return value < 0 ? 0 : (value > AT42QT2120_POSITION_FULL_SCALE - 1 ? AT42QT2120_POSITION_FULL_SCALE - 1 : value);
+}
+
+/**
+  * @brief Initializes a position estimator.
+  */
+esp_err_t at42qt2120_position_init(at42qt2120_position_estimator_t* estimator, at42qt2120_handle_t* at42qt2120_handle,
+                                   const at42qt2120_position_config_t* config) {
+    ESP_RETURN_ON_FALSE(estimator != NULL, ESP_ERR_INVALID_ARG, TAG, "estimator is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+    ESP_RETURN_ON_FALSE(config->resolution_bits >= 8 && config->resolution_bits <= 16, ESP_ERR_INVALID_ARG, TAG, "resolution_bits out of range!");
+    ESP_RETURN_ON_FALSE(config->touch_threshold > 0 && config->release_threshold <= config->touch_threshold, ESP_ERR_INVALID_ARG, TAG, "Invalid touch thresholds!");
+    ESP_RETURN_ON_FALSE(config->filter_shift < 16, ESP_ERR_INVALID_ARG, TAG, "filter_shift out of range!");
+
+    memset(estimator, 0, sizeof(*estimator));
+    estimator->at42qt2120_handle = at42qt2120_handle;
+    estimator->config = *config;
+    estimator->gain_q16 = AT42QT2120_POSITION_FULL_SCALE;
+    return ESP_OK;
+}
+
+/*
+ * Interpolates between the strongest key and its neighbours. With the triangular response of
+ * adjacent electrodes only two keys carry signal, and (next - previous) / sum is exactly the
+ * fraction of the pitch between them.
+ */
+static int32_t at42qt2120_position_interpolate(const int32_t deltas[AT42QT2120_SLIDER_NUM_KEYS], int32_t sum, bool wheel) {
+    int strongest = 0;
+    for (int key = 1; key < AT42QT2120_SLIDER_NUM_KEYS; key++) {
+        if (deltas[key] > deltas[strongest])
+            strongest = key;
+    }
+
+    int32_t previous, next;
+    if (wheel) {
+        previous = deltas[(strongest + AT42QT2120_SLIDER_NUM_KEYS - 1) % AT42QT2120_SLIDER_NUM_KEYS];
+        next = deltas[(strongest + 1) % AT42QT2120_SLIDER_NUM_KEYS];
+    } else {
+        previous = strongest > 0 ? deltas[strongest - 1] : 0;
+        next = strongest < AT42QT2120_SLIDER_NUM_KEYS - 1 ? deltas[strongest + 1] : 0;
+    }
+    int32_t pitches = strongest * AT42QT2120_POSITION_FULL_SCALE + (next - previous) * AT42QT2120_POSITION_FULL_SCALE / sum;
+
+    if (!wheel)
+        return at42qt2120_position_clamp(pitches / (AT42QT2120_SLIDER_NUM_KEYS - 1));
+
+    if (pitches < 0)
+        pitches += AT42QT2120_SLIDER_NUM_KEYS * AT42QT2120_POSITION_FULL_SCALE;
+    return (pitches / AT42QT2120_SLIDER_NUM_KEYS) & (AT42QT2120_POSITION_FULL_SCALE - 1);
+}
+
+/* Summed delta of the slider keys; keys below their reference carry no finger, they would pull the estimate away from it */
+static int32_t at42qt2120_position_strength(const int16_t deltas[AT42QT2120_SLIDER_NUM_KEYS], int32_t positive[AT42QT2120_SLIDER_NUM_KEYS]) {
+    int32_t sum = 0;
+    for (int key = 0; key < AT42QT2120_SLIDER_NUM_KEYS; key++) {
+        positive[key] = deltas[key] > 0 ? deltas[key] : 0;
+        sum += positive[key];
+    }
+    return sum;
+}
+
+/* Position from the deltas, replaced by the chip's position register (0-255) when one is given and agrees */
+static void at42qt2120_position_estimate(at42qt2120_position_estimator_t* estimator, const int16_t deltas[AT42QT2120_SLIDER_NUM_KEYS],
+                                         int32_t chip_position, at42qt2120_position_t* position) {
+    const at42qt2120_position_config_t* config = &estimator->config;
+
+    int32_t positive[AT42QT2120_SLIDER_NUM_KEYS];
+    int32_t sum = at42qt2120_position_strength(deltas, positive);
+
+    bool touched = sum >= (estimator->touched ? config->release_threshold : config->touch_threshold) && sum > 0;
+    if (touched) {
+        int32_t raw = at42qt2120_position_interpolate(positive, sum, config->wheel);
+        int32_t calibrated;
+        if (config->wheel)
+            calibrated = (raw + estimator->offset) & (AT42QT2120_POSITION_FULL_SCALE - 1);
+        else
+            calibrated = at42qt2120_position_clamp((int32_t)(((int64_t)raw * estimator->gain_q16) >> 16) + estimator->offset);
+
+        /* The calibration maps onto the register, so a register value needs none */
+        if (chip_position != AT42QT2120_POSITION_NO_REGISTER) {
+            int32_t chip = config->wheel ? chip_position << 8 : chip_position * (AT42QT2120_POSITION_FULL_SCALE - 1) / 255;
+            int32_t distance = config->wheel ? (int16_t)(uint16_t)(chip - calibrated) : chip - calibrated;
+            if (distance >= -AT42QT2120_POSITION_REGISTER_TOLERANCE && distance <= AT42QT2120_POSITION_REGISTER_TOLERANCE)
+                calibrated = chip;
+        }
+
+        /* The filter restarts at touch down so the previous touch does not leak into this one */
+        if (!estimator->touched || config->filter_shift == 0)
+            estimator->filtered = calibrated;
+        else if (config->wheel)
+            estimator->filtered = (estimator->filtered + ((int16_t)(uint16_t)(calibrated - estimator->filtered) >> config->filter_shift)) & (AT42QT2120_POSITION_FULL_SCALE - 1);
+        else
+            estimator->filtered += (calibrated - estimator->filtered) >> config->filter_shift;
+        estimator->raw = (uint16_t)raw;
+    }
+    estimator->touched = touched;
+
+    position->touched = touched;
+    position->position = (uint16_t)(estimator->filtered >> (16 - config->resolution_bits));
+    position->strength = sum > UINT16_MAX ? UINT16_MAX : (uint16_t)sum;
+}
+
+/**
+  * @brief Computes a position from the deltas of the slider keys.
+  */
+void at42qt2120_position_update(at42qt2120_position_estimator_t* estimator, const int16_t deltas[AT42QT2120_SLIDER_NUM_KEYS],
+                                at42qt2120_position_t* position) {
+    at42qt2120_position_estimate(estimator, deltas, AT42QT2120_POSITION_NO_REGISTER, position);
+}
+
+/**
+  * @brief Reads the slider key signals and references in one burst and computes a position.
+  */
+esp_err_t at42qt2120_position_read(at42qt2120_position_estimator_t* estimator, at42qt2120_position_t* position) {
+    ESP_RETURN_ON_FALSE(estimator != NULL, ESP_ERR_INVALID_ARG, TAG, "estimator is NULL!");
+    ESP_RETURN_ON_FALSE(position != NULL, ESP_ERR_INVALID_ARG, TAG, "position is NULL!");
+
+    /* Signals of keys 3-11 sit between the two halves, one longer burst is still cheaper than two transactions */
+    uint8_t raw[AT42QT2120_POSITION_BURST_SIZE];
+    esp_err_t ret = at42qt2120_register_read(estimator->at42qt2120_handle, AT42QT2120_REG_KEY_00_MSB_SIGNAL, raw, sizeof(raw));
+    if (ret != ESP_OK)
+        return ret;
+
+    const uint8_t* references = raw + (AT42QT2120_REG_KEY_00_MSB_REFERENCE - AT42QT2120_REG_KEY_00_MSB_SIGNAL);
+    int16_t deltas[AT42QT2120_SLIDER_NUM_KEYS];
+    for (int key = 0; key < AT42QT2120_SLIDER_NUM_KEYS; key++) {
+        uint16_t signal = (uint16_t)((raw[2 * key] << 8) | raw[2 * key + 1]);
+        uint16_t reference = (uint16_t)((references[2 * key] << 8) | references[2 * key + 1]);
+        deltas[key] = (int16_t)(signal - reference);
+    }
+
+    /* A weak touch resolves fewer positions per key pitch than the register, a one-byte read is cheap next to the burst */
+    int32_t positive[AT42QT2120_SLIDER_NUM_KEYS];
+    int32_t strength = at42qt2120_position_strength(deltas, positive);
+    int32_t chip_position = AT42QT2120_POSITION_NO_REGISTER;
+    if (strength > 0 && strength >= estimator->config.release_threshold && strength < estimator->config.register_below) {
+        uint8_t slider_position;
+        ret = at42qt2120_register_read(estimator->at42qt2120_handle, AT42QT2120_REG_SLIDER_POSITION, &slider_position, 1);
+        if (ret != ESP_OK)
+            return ret;
+        chip_position = slider_position;
+    }
+
+    at42qt2120_position_estimate(estimator, deltas, chip_position, position);
+    return ESP_OK;
+}
+
+/**
+  * @brief Adds one pair of raw estimate and chip position to the calibration.
+  */
+esp_err_t at42qt2120_position_calibrate_add(at42qt2120_position_estimator_t* estimator, uint8_t chip_position) {
+    ESP_RETURN_ON_FALSE(estimator != NULL, ESP_ERR_INVALID_ARG, TAG, "estimator is NULL!");
+    ESP_RETURN_ON_FALSE(estimator->touched, ESP_ERR_INVALID_STATE, TAG, "Slider is not touched!");
+
+    at42qt2120_position_calibration_t* calibration = &estimator->calibration;
+    if (calibration->samples >= AT42QT2120_POSITION_CALIBRATION_MAX_SAMPLES)
+        return ESP_OK;
+
+    int64_t raw = estimator->raw;
+    calibration->samples++;
+    if (estimator->config.wheel) {
+        /* 256 chip units per revolution; the difference is taken the short way around */
+        calibration->sum_chip += (int16_t)(uint16_t)((chip_position << 8) - estimator->raw);
+        return ESP_OK;
+    }
+
+    /* 0-255 spans the whole slider */
+    int64_t chip = (int64_t)chip_position * (AT42QT2120_POSITION_FULL_SCALE - 1) / 255;
+    calibration->sum_raw += raw;
+    calibration->sum_chip += chip;
+    calibration->sum_raw_raw += raw * raw;
+    calibration->sum_raw_chip += raw * chip;
+    return ESP_OK;
+}
+
+/**
+  * @brief Fits the calibration to the collected pairs.
+  */
+esp_err_t at42qt2120_position_calibrate_finish(at42qt2120_position_estimator_t* estimator) {
+    ESP_RETURN_ON_FALSE(estimator != NULL, ESP_ERR_INVALID_ARG, TAG, "estimator is NULL!");
+
+    const at42qt2120_position_calibration_t* calibration = &estimator->calibration;
+    int64_t samples = calibration->samples;
+    ESP_RETURN_ON_FALSE(samples > 0, ESP_ERR_INVALID_STATE, TAG, "No calibration pairs!");
+
+    if (estimator->config.wheel) {
+        estimator->offset = (int32_t)(calibration->sum_chip / samples);
+        memset(&estimator->calibration, 0, sizeof(estimator->calibration));
+        return ESP_OK;
+    }
+
+    /* Least squares: n^2 * variance of the raw positions, and n^2 * their covariance with the chip positions */
+    int64_t spread = samples * calibration->sum_raw_raw - calibration->sum_raw * calibration->sum_raw;
+    int64_t covariance = samples * calibration->sum_raw_chip - calibration->sum_raw * calibration->sum_chip;
+    ESP_RETURN_ON_FALSE(spread / samples / samples >= (int64_t)AT42QT2120_POSITION_MIN_SPREAD * AT42QT2120_POSITION_MIN_SPREAD,
+                        ESP_ERR_INVALID_STATE, TAG, "Calibration pairs do not span the slider!");
+
+    /* Both fit 1024 pairs of 16-bit values in 2^53; scale them down together until the Q16 shift fits */
+    while (spread > INT64_MAX / AT42QT2120_POSITION_FULL_SCALE / 2 || covariance > INT64_MAX / AT42QT2120_POSITION_FULL_SCALE / 2 ||
+           covariance < -(INT64_MAX / AT42QT2120_POSITION_FULL_SCALE / 2)) {
+        spread /= 2;
+        covariance /= 2;
+    }
+    int64_t gain_q16 = covariance * AT42QT2120_POSITION_FULL_SCALE / spread;
+    ESP_RETURN_ON_FALSE(gain_q16 >= AT42QT2120_POSITION_FULL_SCALE / 2 && gain_q16 <= AT42QT2120_POSITION_FULL_SCALE * 2,
+                        ESP_ERR_INVALID_STATE, TAG, "Calibration gain out of range!");
+
+    estimator->gain_q16 = (int32_t)gain_q16;
+    estimator->offset = (int32_t)((calibration->sum_chip * AT42QT2120_POSITION_FULL_SCALE - gain_q16 * calibration->sum_raw) /
+                                  (samples * AT42QT2120_POSITION_FULL_SCALE));
+    memset(&estimator->calibration, 0, sizeof(estimator->calibration));
+    return ESP_OK;
+}
@@ -0,0 +1,331 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#ifdef ESP_PLATFORM
+#include <nvs.h>
+#endif
+
+#include "esp_at42qt2120_profile.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_profile";
+
+/* Blob layout: 8-byte header, payload, CRC-32 */
+#define AT42QT2120_PROFILE_HEADER_SIZE 8
+#define AT42QT2120_PROFILE_CRC_SIZE 4
+#define AT42QT2120_PROFILE_GESTURE_SIZE 19
+#define AT42QT2120_PROFILE_POLL_SIZE 14
+#define AT42QT2120_PROFILE_PAYLOAD_SIZE (AT42QT2120_CONFIG_REG_COUNT + AT42QT2120_PROFILE_GESTURE_SIZE + AT42QT2120_PROFILE_POLL_SIZE)
+
+_Static_assert(AT42QT2120_PROFILE_HEADER_SIZE + AT42QT2120_PROFILE_PAYLOAD_SIZE + AT42QT2120_PROFILE_CRC_SIZE == AT42QT2120_PROFILE_BLOB_SIZE,
+               "AT42QT2120_PROFILE_BLOB_SIZE does not match the version 1 layout");
+
+static const uint8_t at42qt2120_profile_magic[4] = { 'Q', 'T', '2', '1' };
+
+/* Setup registers that can change on a running device without a recalibration: 0x08-0x0D and the detection thresholds */
+static inline bool at42qt2120_profile_is_live_reg(uint8_t index) {
+    uint8_t reg = AT42QT2120_REG_CONFIG_FIRST + index;
+    return reg <= AT42QT2120_REG_DRIFT_HOLD_TIME || (reg >= AT42QT2120_REG_KEY_00_DTHR && reg < AT42QT2120_REG_KEY_00_DTHR + AT42QT2120_NUM_KEYS);
+}
+
+/**
+  * @brief CRC-32 (IEEE 802.3, reflected) with a 16-entry table, one nibble per step.
+  */
+static uint32_t at42qt2120_profile_crc32(const uint8_t* data, size_t size) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t index = 0; index < size; index++) {
+        crc = (crc >> 4) ^ table[(crc ^ data[index]) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (data[index] >> 4)) & 0x0F];
+    }
+    return ~crc;
+}
+
+static inline uint8_t* at42qt2120_profile_put16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static inline uint8_t* at42qt2120_profile_put32(uint8_t* out, uint32_t value) {
+    out = at42qt2120_profile_put16(out, value & 0xFFFF);
+    return at42qt2120_profile_put16(out, value >> 16);
+}
+
+static inline uint16_t at42qt2120_profile_get16(const uint8_t** in) {
+    uint16_t value = (uint16_t)((*in)[0] | ((*in)[1] << 8));
+    *in += 2;
+    return value;
+}
+
+static inline uint32_t at42qt2120_profile_get32(const uint8_t** in) {
+    uint32_t low = at42qt2120_profile_get16(in);
+    return low | ((uint32_t)at42qt2120_profile_get16(in) << 16);
+}
+
+/**
+  * @brief Fills a profile with the power-on registers and the default settings.
+  */
+void at42qt2120_profile_default(at42qt2120_profile_t* profile) {
+    at42qt2120_config_default(&profile->config);
+    profile->gesture = (at42qt2120_gesture_config_t)AT42QT2120_GESTURE_CONFIG_DEFAULT();
+    profile->poll = (at42qt2120_poll_config_t)AT42QT2120_POLL_CONFIG_DEFAULT();
+}
+
+/**
+  * @brief Serializes a profile, field by field in little-endian order.
+  */
+esp_err_t at42qt2120_profile_encode(const at42qt2120_profile_t* profile, uint8_t* blob, size_t capacity, size_t* size) {
+    ESP_RETURN_ON_FALSE(profile != NULL, ESP_ERR_INVALID_ARG, TAG, "profile is NULL!");
+    ESP_RETURN_ON_FALSE(blob != NULL && size != NULL, ESP_ERR_INVALID_ARG, TAG, "blob or size is NULL!");
+    ESP_RETURN_ON_FALSE(capacity >= AT42QT2120_PROFILE_BLOB_SIZE, ESP_ERR_INVALID_SIZE, TAG, "Profile buffer too small!");
+
+    uint8_t* out = blob;
+    memcpy(out, at42qt2120_profile_magic, sizeof(at42qt2120_profile_magic));
+    out += sizeof(at42qt2120_profile_magic);
+    *out++ = AT42QT2120_PROFILE_VERSION;
+    *out++ = 0;
+    out = at42qt2120_profile_put16(out, AT42QT2120_PROFILE_PAYLOAD_SIZE);
+
+    memcpy(out, &profile->config, AT42QT2120_CONFIG_REG_COUNT);
+    out += AT42QT2120_CONFIG_REG_COUNT;
+
+    const at42qt2120_gesture_config_t* gesture = &profile->gesture;
+    *out++ = gesture->wheel;
+    *out++ = gesture->position_shift;
+    *out++ = gesture->velocity_shift;
+    out = at42qt2120_profile_put32(out, gesture->tap_max_duration_us);
+    out = at42qt2120_profile_put16(out, gesture->tap_max_travel);
+    out = at42qt2120_profile_put32(out, gesture->double_tap_window_us);
+    out = at42qt2120_profile_put16(out, gesture->swipe_min_travel);
+    out = at42qt2120_profile_put16(out, gesture->swipe_min_velocity);
+    out = at42qt2120_profile_put16(out, gesture->rotate_step);
+
+    const at42qt2120_poll_config_t* poll = &profile->poll;
+    out = at42qt2120_profile_put32(out, poll->min_period_ms);
+    out = at42qt2120_profile_put32(out, poll->max_period_ms);
+    out = at42qt2120_profile_put32(out, poll->idle_hold_ms);
+    *out++ = poll->motion_threshold;
+    *out++ = poll->track_low_power;
+
+    out = at42qt2120_profile_put32(out, at42qt2120_profile_crc32(blob, out - blob));
+    *size = out - blob;
+    return ESP_OK;
+}
+
+/**
+  * @brief Checks header and CRC of a blob, then deserializes it.
+  */
+esp_err_t at42qt2120_profile_decode(const uint8_t* blob, size_t size, at42qt2120_profile_t* profile) {
+    ESP_RETURN_ON_FALSE(blob != NULL, ESP_ERR_INVALID_ARG, TAG, "blob is NULL!");
+    ESP_RETURN_ON_FALSE(profile != NULL, ESP_ERR_INVALID_ARG, TAG, "profile is NULL!");
+
+    /* Header and CRC first, nothing is copied out of a blob that fails either */
+    if (size < AT42QT2120_PROFILE_HEADER_SIZE + AT42QT2120_PROFILE_CRC_SIZE || memcmp(blob, at42qt2120_profile_magic, sizeof(at42qt2120_profile_magic)) != 0)
+        return ESP_ERR_INVALID_SIZE;
+    const uint8_t* in = blob + sizeof(at42qt2120_profile_magic) + 2;
+    size_t payload_size = at42qt2120_profile_get16(&in);
+    if (size < AT42QT2120_PROFILE_HEADER_SIZE + payload_size + AT42QT2120_PROFILE_CRC_SIZE)
+        return ESP_ERR_INVALID_SIZE;
+
+    const uint8_t* crc_bytes = blob + AT42QT2120_PROFILE_HEADER_SIZE + payload_size;
+    if (at42qt2120_profile_get32(&crc_bytes) != at42qt2120_profile_crc32(blob, AT42QT2120_PROFILE_HEADER_SIZE + payload_size))
+        return ESP_ERR_INVALID_CRC;
+    if (blob[sizeof(at42qt2120_profile_magic)] != AT42QT2120_PROFILE_VERSION || payload_size != AT42QT2120_PROFILE_PAYLOAD_SIZE)
+        return ESP_ERR_INVALID_VERSION;
+
+    memcpy(&profile->config, in, AT42QT2120_CONFIG_REG_COUNT);
+    in += AT42QT2120_CONFIG_REG_COUNT;
+
+    at42qt2120_gesture_config_t* gesture = &profile->gesture;
+    gesture->wheel = *in++ != 0;
+    gesture->position_shift = *in++;
+    gesture->velocity_shift = *in++;
+    gesture->tap_max_duration_us = at42qt2120_profile_get32(&in);
+    gesture->tap_max_travel = at42qt2120_profile_get16(&in);
+    gesture->double_tap_window_us = at42qt2120_profile_get32(&in);
+    gesture->swipe_min_travel = at42qt2120_profile_get16(&in);
+    gesture->swipe_min_velocity = at42qt2120_profile_get16(&in);
+    gesture->rotate_step = at42qt2120_profile_get16(&in);
+
+    at42qt2120_poll_config_t* poll = &profile->poll;
+    poll->min_period_ms = at42qt2120_profile_get32(&in);
+    poll->max_period_ms = at42qt2120_profile_get32(&in);
+    poll->idle_hold_ms = at42qt2120_profile_get32(&in);
+    poll->motion_threshold = *in++;
+    poll->track_low_power = *in++ != 0;
+    return ESP_OK;
+}
+
+/**
+  * @brief Loads and decodes the stored blob.
+  */
+esp_err_t at42qt2120_profile_load(const at42qt2120_profile_storage_t* storage, at42qt2120_profile_t* profile) {
+    ESP_RETURN_ON_FALSE(storage != NULL && storage->ops != NULL, ESP_ERR_INVALID_ARG, TAG, "storage is NULL!");
+    ESP_RETURN_ON_FALSE(profile != NULL, ESP_ERR_INVALID_ARG, TAG, "profile is NULL!");
+
+    uint8_t blob[AT42QT2120_PROFILE_BLOB_SIZE];
+    size_t size = 0;
+    esp_err_t ret = storage->ops->load(storage->ctx, blob, sizeof(blob), &size);
+    if (ret != ESP_OK)
+        return ret;
+    return at42qt2120_profile_decode(blob, size, profile);
+}
+
+/**
+  * @brief Encodes a profile and hands it to the storage backend.
+  */
+esp_err_t at42qt2120_profile_save(const at42qt2120_profile_storage_t* storage, const at42qt2120_profile_t* profile) {
+    ESP_RETURN_ON_FALSE(storage != NULL && storage->ops != NULL, ESP_ERR_INVALID_ARG, TAG, "storage is NULL!");
+
+    uint8_t blob[AT42QT2120_PROFILE_BLOB_SIZE];
+    size_t size;
+    ESP_RETURN_ON_ERROR(at42qt2120_profile_encode(profile, blob, sizeof(blob), &size), TAG, "Failed to encode profile");
+    return storage->ops->save(storage->ctx, blob, size);
+}
+
+/**
+  * @brief Warm boot: one burst read decides between doing nothing, patching live registers and a cold boot without a reset.
+  */
+esp_err_t at42qt2120_profile_boot(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_profile_storage_t* storage, at42qt2120_profile_t* profile,
+                                  at42qt2120_profile_boot_result_t* result) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(profile != NULL, ESP_ERR_INVALID_ARG, TAG, "profile is NULL!");
+
+    at42qt2120_profile_boot_result_t outcome = { .mode = AT42QT2120_PROFILE_BOOT_WARM, .load_result = ESP_ERR_NOT_FOUND };
+    int64_t start_us = at42qt2120_time_us(at42qt2120_handle);
+    if (storage != NULL)
+        outcome.load_result = at42qt2120_profile_load(storage, profile);
+
+    /* A device answering with its chip ID needs no reset: a calibration takes up any configuration written to it */
+    uint8_t chip_id;
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_CHIP_ID, &chip_id, 1);
+    if (ret == ESP_OK && chip_id != AT42QT2120_CHIP_ID) {
+        at42qt2120_error_report(at42qt2120_handle, AT42QT2120_ERROR_OP_CHIP_ID, AT42QT2120_REG_CHIP_ID, chip_id, ESP_ERR_INVALID_RESPONSE);
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
+    /* The resync is the one burst read of 0x08-0x33, and leaves the shadow ready for the writes below */
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_resync(at42qt2120_handle);
+    if (ret != ESP_OK) {
+        outcome.mode = AT42QT2120_PROFILE_BOOT_COLD;
+        outcome.reset = true;
+        ret = at42qt2120_reset(at42qt2120_handle);
+        if (ret != ESP_OK)
+            return ret;
+    }
+
+    const uint8_t* wanted = (const uint8_t*)&profile->config;
+    for (uint8_t index = 0; index < AT42QT2120_CONFIG_REG_COUNT && outcome.mode != AT42QT2120_PROFILE_BOOT_COLD; index++) {
+        if (at42qt2120_handle->shadow.regs[index] == wanted[index])
+            continue;
+        outcome.mode = at42qt2120_profile_is_live_reg(index) ? AT42QT2120_PROFILE_BOOT_PATCHED : AT42QT2120_PROFILE_BOOT_COLD;
+    }
+
+    if (outcome.mode != AT42QT2120_PROFILE_BOOT_WARM)
+        ret = at42qt2120_apply_config(at42qt2120_handle, &profile->config, NULL);
+    if (ret == ESP_OK && outcome.mode == AT42QT2120_PROFILE_BOOT_COLD)
+        ret = at42qt2120_calibrate(at42qt2120_handle);
+    if (ret == ESP_OK && outcome.mode == AT42QT2120_PROFILE_BOOT_COLD)
+        ret = at42qt2120_wait_ready(at42qt2120_handle, -1);
+    if (ret != ESP_OK)
+        return ret;
+    outcome.duration_us = at42qt2120_time_us(at42qt2120_handle) - start_us;
+
+    /* A missing or unusable blob is replaced, so the next boot can take the warm path */
+    if (storage != NULL && outcome.load_result != ESP_OK) {
+        ret = at42qt2120_profile_save(storage, profile);
+        if (ret != ESP_OK)
+            ESP_LOGW(TAG, "Failed to save profile: %s", esp_err_to_name(ret));
+        outcome.saved = ret == ESP_OK;
+    }
+
+    if (result != NULL)
+        *result = outcome;
+    return ESP_OK;
+}
+
+/**
+  * @brief Reads the blob from a file. A torn write from an earlier save is caught by the CRC.
+  */
+static esp_err_t at42qt2120_profile_file_load(void* ctx, uint8_t* blob, size_t capacity, size_t* size) {
+    at42qt2120_profile_file_t* file = (at42qt2120_profile_file_t*)ctx;
+    FILE* stream = fopen(file->path, "rb");
+    if (stream == NULL)
+        return errno == ENOENT ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+
+    *size = fread(blob, 1, capacity, stream);
+    bool failed = ferror(stream) != 0;
+    fclose(stream);
+    return failed ? ESP_FAIL : ESP_OK;
+}
+
+static esp_err_t at42qt2120_profile_file_save(void* ctx, const uint8_t* blob, size_t size) {
+    at42qt2120_profile_file_t* file = (at42qt2120_profile_file_t*)ctx;
+    FILE* stream = fopen(file->path, "wb");
+    ESP_RETURN_ON_FALSE(stream != NULL, ESP_FAIL, TAG, "Failed to open %s", file->path);
+
+    bool written = fwrite(blob, 1, size, stream) == size;
+    written = fclose(stream) == 0 && written;
+    return written ? ESP_OK : ESP_FAIL;
+}
+
+static const at42qt2120_profile_storage_ops_t at42qt2120_profile_file_ops = {
+    .load = at42qt2120_profile_file_load,
+    .save = at42qt2120_profile_file_save,
+};
+
+void at42qt2120_profile_storage_file(at42qt2120_profile_file_t* file, const char* path, at42qt2120_profile_storage_t* storage) {
+    file->path = path;
+    storage->ops = &at42qt2120_profile_file_ops;
+    storage->ctx = file;
+}
+
+#ifdef ESP_PLATFORM
+/**
+  * @brief Reads the blob from NVS. A missing namespace or key both count as nothing stored.
+  */
+static esp_err_t at42qt2120_profile_nvs_load(void* ctx, uint8_t* blob, size_t capacity, size_t* size) {
+    at42qt2120_profile_nvs_t* nvs = (at42qt2120_profile_nvs_t*)ctx;
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(nvs->namespace_name, NVS_READONLY, &nvs_handle);
+    if (ret == ESP_OK) {
+        *size = capacity;
+        ret = nvs_get_blob(nvs_handle, nvs->key, blob, size);
+        nvs_close(nvs_handle);
+    }
+    return ret == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : ret;
+}
+
+static esp_err_t at42qt2120_profile_nvs_save(void* ctx, const uint8_t* blob, size_t size) {
+    at42qt2120_profile_nvs_t* nvs = (at42qt2120_profile_nvs_t*)ctx;
+    nvs_handle_t nvs_handle;
+    ESP_RETURN_ON_ERROR(nvs_open(nvs->namespace_name, NVS_READWRITE, &nvs_handle), TAG, "Failed to open NVS namespace");
+
+    esp_err_t ret = nvs_set_blob(nvs_handle, nvs->key, blob, size);
+    if (ret == ESP_OK)
+        ret = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+    return ret;
+}
+
+static const at42qt2120_profile_storage_ops_t at42qt2120_profile_nvs_ops = {
+    .load = at42qt2120_profile_nvs_load,
+    .save = at42qt2120_profile_nvs_save,
+};
+
+void at42qt2120_profile_storage_nvs(at42qt2120_profile_nvs_t* nvs, const char* namespace_name, const char* key, at42qt2120_profile_storage_t* storage) {
+    nvs->namespace_name = namespace_name;
+    nvs->key = key;
+    storage->ops = &at42qt2120_profile_nvs_ops;
+    storage->ctx = nvs;
+}
+#endif
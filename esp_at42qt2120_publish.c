@@ -0,0 +1,217 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_publish.h"
+
+static const char* TAG = "esp_at42qt2120_publish";
+
+_Static_assert(sizeof(at42qt2120_snapshot_t) % sizeof(uint32_t) == 0, "snapshot must be a whole number of words");
+_Static_assert((AT42QT2120_SNAPSHOT_RING_SIZE & (AT42QT2120_SNAPSHOT_RING_SIZE - 1)) == 0, "ring size must be a power of two");
+
+#ifdef ESP_PLATFORM
+/* Failed read attempts before a reader sleeps one tick, so a preempted lower priority writer on the same core can finish */
+#define AT42QT2120_PUBLISH_SPIN_LIMIT 64
+#endif
+
+/**
+  * @brief Initializes a publisher.
+  */
+esp_err_t at42qt2120_publisher_init(at42qt2120_publisher_t* publisher, at42qt2120_handle_t* at42qt2120_handle) {
+    ESP_RETURN_ON_FALSE(publisher != NULL, ESP_ERR_INVALID_ARG, TAG, "publisher is NULL!");
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    memset(publisher, 0, sizeof(*publisher));
+    publisher->at42qt2120_handle = at42qt2120_handle;
+    return ESP_OK;
+}
+
+/**
+  * @brief Deinitializes a publisher.
+  */
+esp_err_t at42qt2120_publisher_deinit(at42qt2120_publisher_t* publisher) {
+    ESP_RETURN_ON_FALSE(publisher != NULL, ESP_ERR_INVALID_ARG, TAG, "publisher is NULL!");
+
+#ifdef ESP_PLATFORM
+    if (publisher->acquisition_task != NULL)
+        ESP_RETURN_ON_ERROR(at42qt2120_publisher_stop(publisher), TAG, "Failed to stop publisher");
+#endif
+
+    publisher->at42qt2120_handle = NULL;
+    return ESP_OK;
+}
+
+static inline bool at42qt2120_publisher_state_changed(const at42qt2120_state_t* previous, const at42qt2120_state_t* state) {
+    /* The remaining fields are decoded from the detection status */
+    return previous->detection_status != state->detection_status || previous->key_mask != state->key_mask ||
+           previous->slider_position != state->slider_position;
+}
+
+/**
+  * @brief Publishes a state. Single writer only.
+  */
+void at42qt2120_publisher_publish(at42qt2120_publisher_t* publisher, const at42qt2120_state_t* state, int64_t time_us) {
+    uint32_t sequence = __atomic_load_n(&publisher->sequence, __ATOMIC_RELAXED);
+    at42qt2120_snapshot_t snapshot = {
+        .state = *state,
+        .time_us = time_us,
+        .sequence = sequence / 2 + 1,
+    };
+
+    /* Odd sequence: readers that overlap the copy below will retry */
+    uint32_t words[AT42QT2120_SNAPSHOT_WORDS];
+    memcpy(words, &snapshot, sizeof(words));
+    __atomic_store_n(&publisher->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t index = 0; index < AT42QT2120_SNAPSHOT_WORDS; index++)
+        __atomic_store_n(&publisher->latest[index], words[index], __ATOMIC_RELAXED);
+    __atomic_store_n(&publisher->sequence, sequence + 2, __ATOMIC_RELEASE);
+
+    if (sequence != 0 && !at42qt2120_publisher_state_changed(&publisher->previous_state, state))
+        return;
+    publisher->previous_state = *state;
+
+    /* Single producer: only the consumer moves the tail */
+    uint32_t head = publisher->ring_head;
+    uint32_t tail = __atomic_load_n(&publisher->ring_tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= AT42QT2120_SNAPSHOT_RING_SIZE) {
+        __atomic_fetch_add(&publisher->ring_overruns, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    publisher->ring[head & (AT42QT2120_SNAPSHOT_RING_SIZE - 1)] = snapshot;
+    __atomic_store_n(&publisher->ring_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+  * @brief Reads the state once and publishes it.
+  */
+esp_err_t at42qt2120_publisher_acquire(at42qt2120_publisher_t* publisher) {
+    ESP_RETURN_ON_FALSE(publisher != NULL, ESP_ERR_INVALID_ARG, TAG, "publisher is NULL!");
+
+    at42qt2120_state_t state;
+    esp_err_t ret = at42qt2120_read_state(publisher->at42qt2120_handle, &state);
+    if (ret != ESP_OK) {
+        __atomic_fetch_add(&publisher->read_errors, 1, __ATOMIC_RELAXED);
+        return ret;
+    }
+
+    at42qt2120_publisher_publish(publisher, &state, at42qt2120_time_us(publisher->at42qt2120_handle));
+    return ESP_OK;
+}
+
+/**
+  * @brief Copies the latest snapshot without locking.
+  */
+esp_err_t at42qt2120_publisher_get_latest(const at42qt2120_publisher_t* publisher, at42qt2120_snapshot_t* snapshot) {
+    uint32_t words[AT42QT2120_SNAPSHOT_WORDS];
+#ifdef ESP_PLATFORM
+    uint32_t attempts = 0;
+#endif
+
+    while (true) {
+        uint32_t before = __atomic_load_n(&publisher->sequence, __ATOMIC_ACQUIRE);
+        if (before == 0)
+            return ESP_ERR_NOT_FOUND;
+
+        if ((before & 1) == 0) {
+            for (size_t index = 0; index < AT42QT2120_SNAPSHOT_WORDS; index++)
+                words[index] = __atomic_load_n(&publisher->latest[index], __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&publisher->sequence, __ATOMIC_RELAXED) == before)
+                break;
+        }
+
+#ifdef ESP_PLATFORM
+        if (++attempts % AT42QT2120_PUBLISH_SPIN_LIMIT == 0)
+            vTaskDelay(1);
+#endif
+    }
+
+    memcpy(snapshot, words, sizeof(words));
+    return ESP_OK;
+}
+
+/**
+  * @brief Takes the oldest transition from the ring. Single consumer only.
+  */
+esp_err_t at42qt2120_publisher_ring_pop(at42qt2120_publisher_t* publisher, at42qt2120_snapshot_t* snapshot) {
+    uint32_t tail = publisher->ring_tail;
+    uint32_t head = __atomic_load_n(&publisher->ring_head, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return ESP_ERR_NOT_FOUND;
+
+    *snapshot = publisher->ring[tail & (AT42QT2120_SNAPSHOT_RING_SIZE - 1)];
+    __atomic_store_n(&publisher->ring_tail, tail + 1, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+static void at42qt2120_publisher_task(void* arg) {
+    at42qt2120_publisher_t* publisher = (at42qt2120_publisher_t*)arg;
+    TickType_t period_ticks = pdMS_TO_TICKS(publisher->config.period_ms);
+    if (period_ticks == 0)
+        period_ticks = 1;
+
+    TickType_t last_wake = xTaskGetTickCount();
+    while (publisher->running) {
+        at42qt2120_publisher_acquire(publisher);
+        vTaskDelayUntil(&last_wake, period_ticks);
+    }
+
+    xSemaphoreGive(publisher->stopped_sem);
+    vTaskDelete(NULL);
+}
+
+/**
+  * @brief Starts the acquisition task.
+  */
+esp_err_t at42qt2120_publisher_start(at42qt2120_publisher_t* publisher, const at42qt2120_publisher_config_t* config) {
+    ESP_RETURN_ON_FALSE(publisher != NULL, ESP_ERR_INVALID_ARG, TAG, "publisher is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+    ESP_RETURN_ON_FALSE(publisher->acquisition_task == NULL, ESP_ERR_INVALID_STATE, TAG, "Publisher is already running!");
+
+    publisher->config = *config;
+    publisher->stopped_sem = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(publisher->stopped_sem != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create stop semaphore");
+
+    publisher->running = true;
+    if (xTaskCreatePinnedToCore(at42qt2120_publisher_task, "at42qt2120_pub", config->task_stack_size, publisher,
+                                config->task_priority, &publisher->acquisition_task, config->core_id) != pdPASS) {
+        publisher->running = false;
+        vSemaphoreDelete(publisher->stopped_sem);
+        publisher->stopped_sem = NULL;
+        ESP_LOGE(TAG, "Failed to create acquisition task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Started at42qt2120 publisher.");
+    return ESP_OK;
+}
+
+/**
+  * @brief Stops the acquisition task.
+  */
+esp_err_t at42qt2120_publisher_stop(at42qt2120_publisher_t* publisher) {
+    ESP_RETURN_ON_FALSE(publisher != NULL, ESP_ERR_INVALID_ARG, TAG, "publisher is NULL!");
+    ESP_RETURN_ON_FALSE(publisher->acquisition_task != NULL, ESP_ERR_INVALID_STATE, TAG, "Publisher is not running!");
+
+    /* Let the task finish its current read instead of deleting it mid-transfer */
+    publisher->running = false;
+    xSemaphoreTake(publisher->stopped_sem, portMAX_DELAY);
+
+    vSemaphoreDelete(publisher->stopped_sem);
+    publisher->stopped_sem = NULL;
+    publisher->acquisition_task = NULL;
+
+    ESP_LOGI(TAG, "Stopped at42qt2120 publisher.");
+    return ESP_OK;
+}
+#endif
@@ -0,0 +1,265 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_recovery";
+
+_Static_assert((AT42QT2120_ERROR_RING_SIZE & (AT42QT2120_ERROR_RING_SIZE - 1)) == 0, "error ring size must be a power of two");
+
+/**
+  * @brief Sets the retry and recovery settings.
+  */
+esp_err_t at42qt2120_set_recovery_config(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_recovery_config_t* config) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL, ESP_ERR_INVALID_ARG, TAG, "config is NULL!");
+    ESP_RETURN_ON_FALSE(config->backoff_min_ms <= config->backoff_max_ms, ESP_ERR_INVALID_ARG, TAG, "Invalid backoff bounds!");
+    ESP_RETURN_ON_FALSE(config->recover_interval_min_ms <= config->recover_interval_max_ms, ESP_ERR_INVALID_ARG, TAG, "Invalid recovery interval bounds!");
+
+    at42qt2120_handle->recovery.config = *config;
+    return ESP_OK;
+}
+
+/**
+  * @brief Adds an entry to the error ring.
+  */
+void at42qt2120_error_report(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_error_op_t op, uint8_t reg, uint8_t value, esp_err_t code) {
+    at42qt2120_error_log_t* error_log = &at42qt2120_handle->error_log;
+    const at42qt2120_recovery_config_t* config = &at42qt2120_handle->recovery.config;
+
+    /* A burst of the same failure costs one counter increment */
+    if (error_log->head != error_log->tail) {
+        at42qt2120_error_record_t* newest = &error_log->records[(error_log->head - 1) & (AT42QT2120_ERROR_RING_SIZE - 1)];
+        if (newest->op == op && newest->reg == reg && newest->value == value && newest->code == code && newest->repeats < UINT16_MAX) {
+            newest->repeats++;
+            return;
+        }
+    }
+
+    int64_t now_us = at42qt2120_time_us(at42qt2120_handle);
+    if (now_us - error_log->window_start_us >= (int64_t)config->error_window_ms * 1000) {
+        error_log->window_start_us = now_us;
+        error_log->window_records = 0;
+    }
+    if (config->error_rate_limit != 0 && error_log->window_records >= config->error_rate_limit) {
+        error_log->suppressed++;
+        return;
+    }
+    error_log->window_records++;
+
+    /* Keep the newest entries, they describe the current state of the bus */
+    if (error_log->head - error_log->tail >= AT42QT2120_ERROR_RING_SIZE) {
+        error_log->tail++;
+        error_log->overwritten++;
+    }
+    error_log->records[error_log->head & (AT42QT2120_ERROR_RING_SIZE - 1)] = (at42qt2120_error_record_t){
+        .time_us = now_us,
+        .code = code,
+        .op = op,
+        .reg = reg,
+        .value = value,
+        .repeats = 0,
+    };
+    error_log->head++;
+}
+
+/**
+  * @brief Takes the oldest entry from the error ring.
+  */
+esp_err_t at42qt2120_error_pop(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_error_record_t* record) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(record != NULL, ESP_ERR_INVALID_ARG, TAG, "record is NULL!");
+
+    at42qt2120_error_log_t* error_log = &at42qt2120_handle->error_log;
+    if (error_log->head == error_log->tail)
+        return ESP_ERR_NOT_FOUND;
+
+    *record = error_log->records[error_log->tail & (AT42QT2120_ERROR_RING_SIZE - 1)];
+    error_log->tail++;
+    return ESP_OK;
+}
+
+/**
+  * @brief Copies the retry and recovery counters.
+  */
+esp_err_t at42qt2120_get_recovery_stats(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_recovery_stats_t* stats) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL!");
+
+    *stats = at42qt2120_handle->recovery.stats;
+    return ESP_OK;
+}
+
+/* Re-probes the address with the same bounded backoff as a failed transaction */
+static esp_err_t at42qt2120_recover_probe(at42qt2120_handle_t* at42qt2120_handle) {
+    const at42qt2120_recovery_config_t* config = &at42qt2120_handle->recovery.config;
+    const at42qt2120_transport_t* transport = &at42qt2120_handle->transport;
+    uint32_t backoff_ms = config->backoff_min_ms;
+    esp_err_t ret;
+
+    for (uint8_t attempt = 0;; attempt++) {
+        ret = transport->ops->probe(transport->ctx, at42qt2120_handle->transaction_timeout_ms);
+        if (ret == ESP_OK || attempt >= config->max_retries)
+            break;
+
+        at42qt2120_delay_ms(at42qt2120_handle, backoff_ms);
+        backoff_ms = backoff_ms * 2 < config->backoff_max_ms ? backoff_ms * 2 : config->backoff_max_ms;
+    }
+
+    if (ret != ESP_OK)
+        at42qt2120_error_report(at42qt2120_handle, AT42QT2120_ERROR_OP_PROBE, 0, 0, ret);
+    return ret;
+}
+
+/**
+  * @brief Writes back the setup registers that differ from the wanted values, then recalibrates.
+  *        Staging every value on an invalidated shadow and resyncing leaves exactly the lost registers dirty.
+  */
+static esp_err_t at42qt2120_recover_reapply(at42qt2120_handle_t* at42qt2120_handle, const uint8_t wanted[AT42QT2120_CONFIG_REG_COUNT]) {
+    at42qt2120_shadow_invalidate(at42qt2120_handle);
+    for (uint8_t index = 0; index < AT42QT2120_CONFIG_REG_COUNT; index++)
+        at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_CONFIG_FIRST + index, wanted[index]);
+
+    esp_err_t ret = at42qt2120_shadow_resync(at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    uint8_t lost = (uint8_t)__builtin_popcountll(at42qt2120_handle->shadow.dirty);
+    if (lost == 0)
+        return ESP_OK;
+
+    ret = at42qt2120_shadow_flush(at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_handle->recovery.stats.reapplied++;
+    at42qt2120_error_report(at42qt2120_handle, AT42QT2120_ERROR_OP_REAPPLY, AT42QT2120_REG_CONFIG_FIRST, lost, ESP_OK);
+
+    /* The references were taken with the default setup, take them again with the restored one */
+    if (at42qt2120_handle->pending_op.type == AT42QT2120_PENDING_NONE)
+        ret = at42qt2120_calibrate_async(at42qt2120_handle, NULL, NULL);
+    return ret;
+}
+
+/*
+ * One pass of the recovery. A wrong chip ID starts a reset; a blocking pass waits for it and starts over,
+ * otherwise the pass ends with ESP_ERR_NOT_FINISHED and the next one continues once the reset completed.
+ */
+static esp_err_t at42qt2120_recover_device(at42qt2120_handle_t* at42qt2120_handle, bool blocking) {
+    at42qt2120_recovery_t* recovery = &at42qt2120_handle->recovery;
+    esp_err_t ret = at42qt2120_recover_probe(at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    /* Staged values are part of the wanted configuration and get written as well. After the
+     * recovery's own reset the shadow holds the defaults, so the configuration is kept from before */
+    if (!recovery->resetting) {
+        at42qt2120_shadow_t* shadow = &at42qt2120_handle->shadow;
+        recovery->cached = shadow->valid;
+        memcpy(recovery->wanted, shadow->regs, sizeof(recovery->wanted));
+    }
+
+    uint8_t chip_id;
+    ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_CHIP_ID, &chip_id, 1);
+    if (ret != ESP_OK)
+        return ret;
+
+    if (chip_id != AT42QT2120_CHIP_ID) {
+        at42qt2120_error_report(at42qt2120_handle, AT42QT2120_ERROR_OP_CHIP_ID, AT42QT2120_REG_CHIP_ID, chip_id, ESP_ERR_INVALID_RESPONSE);
+        if (recovery->resetting)
+            return ESP_ERR_INVALID_RESPONSE;
+
+        /* The device answers but is not in a sane state: reset it, bounded by the reset deadline */
+        recovery->stats.device_resets++;
+        ret = at42qt2120_reset_async(at42qt2120_handle, NULL, NULL);
+        if (ret != ESP_OK)
+            return ret;
+        recovery->resetting = true;
+        if (!blocking)
+            return ESP_ERR_NOT_FINISHED;
+
+        ret = at42qt2120_wait_ready(at42qt2120_handle, -1);
+        if (ret != ESP_OK)
+            return ret;
+        return at42qt2120_recover_device(at42qt2120_handle, true);
+    }
+
+    /* Without a cached configuration there is nothing the device could have lost */
+    if (!recovery->cached)
+        return ESP_OK;
+
+    return at42qt2120_recover_reapply(at42qt2120_handle, recovery->wanted);
+}
+
+/* Runs a recovery pass and keeps the counters; a pass that continues after the reset counts as the same recovery */
+static esp_err_t at42qt2120_recover_run(at42qt2120_handle_t* at42qt2120_handle, bool blocking) {
+    at42qt2120_recovery_t* recovery = &at42qt2120_handle->recovery;
+    recovery->active = true;
+    if (!recovery->resetting)
+        recovery->stats.recoveries++;
+
+    esp_err_t ret = at42qt2120_recover_device(at42qt2120_handle, blocking);
+    if (ret != ESP_ERR_NOT_FINISHED)
+        recovery->resetting = false;
+    if (ret == ESP_OK)
+        recovery->needed = false;
+    else if (ret != ESP_ERR_NOT_FINISHED)
+        recovery->stats.failed++;
+
+    recovery->active = false;
+    return ret;
+}
+
+/**
+  * @brief Re-probes, verifies and if needed reconfigures the device.
+  */
+esp_err_t at42qt2120_recover(at42qt2120_handle_t* at42qt2120_handle) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(!at42qt2120_handle->recovery.active, ESP_ERR_INVALID_STATE, TAG, "Recovery already in progress!");
+
+    /* A reset started by at42qt2120_recover_poll() is waited for and continued here */
+    at42qt2120_recovery_t* recovery = &at42qt2120_handle->recovery;
+    if (recovery->resetting && at42qt2120_handle->pending_op.type == AT42QT2120_PENDING_RESET)
+        at42qt2120_wait_ready(at42qt2120_handle, -1);
+
+    esp_err_t ret = at42qt2120_recover_run(at42qt2120_handle, true);
+    if (ret == ESP_OK)
+        recovery->interval_ms = 0;
+    return ret;
+}
+
+/**
+  * @brief Runs a flagged recovery, rate-limited and without waiting for its reset.
+  */
+esp_err_t at42qt2120_recover_poll(at42qt2120_handle_t* at42qt2120_handle) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    at42qt2120_recovery_t* recovery = &at42qt2120_handle->recovery;
+    if (!recovery->needed || recovery->active)
+        return ESP_OK;
+
+    /* The recovery's reset completes like any other, a timeout is caught by the chip ID check that follows */
+    if (recovery->resetting && at42qt2120_handle->pending_op.type == AT42QT2120_PENDING_RESET &&
+        at42qt2120_poll_ready(at42qt2120_handle) == ESP_ERR_NOT_FINISHED)
+        return ESP_ERR_NOT_FINISHED;
+
+    int64_t now_us = at42qt2120_time_us(at42qt2120_handle);
+    if (!recovery->resetting && now_us < recovery->next_attempt_us)
+        return ESP_ERR_NOT_FINISHED;
+
+    esp_err_t ret = at42qt2120_recover_run(at42qt2120_handle, false);
+    if (ret == ESP_OK) {
+        recovery->interval_ms = 0;
+    } else if (ret != ESP_ERR_NOT_FINISHED) {
+        const at42qt2120_recovery_config_t* config = &recovery->config;
+        recovery->interval_ms = recovery->interval_ms == 0 ? config->recover_interval_min_ms : recovery->interval_ms * 2;
+        if (recovery->interval_ms > config->recover_interval_max_ms)
+            recovery->interval_ms = config->recover_interval_max_ms;
+        recovery->next_attempt_us = at42qt2120_time_us(at42qt2120_handle) + (int64_t)recovery->interval_ms * 1000;
+    }
+    return ret;
+}
@@ -0,0 +1,177 @@
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_shadow";
+
+/* Clean registers a burst may span to merge two dirty ranges. Rewriting a byte is cheaper than a new transaction */
+#define AT42QT2120_SHADOW_MAX_GAP 2
+
+#define AT42QT2120_SHADOW_BIT(index) (1ULL << (index))
+#define AT42QT2120_SHADOW_RANGE(first, length) ((((length) >= 64) ? ~0ULL : ((1ULL << (length)) - 1)) << (first))
+
+static inline bool at42qt2120_is_config_reg(uint8_t reg) {
+    return reg >= AT42QT2120_REG_CONFIG_FIRST && reg <= AT42QT2120_REG_CONFIG_LAST;
+}
+
+/**
+  * @brief Finds the next contiguous burst covering the lowest dirty registers.
+  *        Clean gaps are only bridged when the shadow is valid, as their cached value must match the device.
+  */
+static bool at42qt2120_shadow_next_burst(uint64_t dirty, bool bridge_gaps, uint8_t* first, uint8_t* length) {
+    if (dirty == 0)
+        return false;
+
+    uint8_t max_gap = bridge_gaps ? AT42QT2120_SHADOW_MAX_GAP : 0;
+    uint8_t start = (uint8_t)__builtin_ctzll(dirty);
+    uint8_t end = start;
+    for (uint8_t index = start + 1; index < AT42QT2120_CONFIG_REG_COUNT; index++) {
+        if ((dirty & AT42QT2120_SHADOW_BIT(index)) == 0)
+            continue;
+        if (index - end - 1 > max_gap)
+            break;
+        end = index;
+    }
+
+    *first = start;
+    *length = end - start + 1;
+    return true;
+}
+
+/**
+  * @brief Stages a setup register value in the shadow.
+  */
+esp_err_t at42qt2120_shadow_write(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg, uint8_t value) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(at42qt2120_is_config_reg(reg), ESP_ERR_INVALID_ARG, TAG, "Register 0x%02X is not a setup register!", reg);
+
+    at42qt2120_shadow_t* shadow = &at42qt2120_handle->shadow;
+    uint8_t index = reg - AT42QT2120_REG_CONFIG_FIRST;
+
+    /* A value matching the cache (device value or an already staged value) needs no further write */
+    if (shadow->valid && shadow->regs[index] == value)
+        return ESP_OK;
+
+    shadow->regs[index] = value;
+    shadow->dirty |= AT42QT2120_SHADOW_BIT(index);
+    return ESP_OK;
+}
+
+/**
+  * @brief Stages a read-modify-write of a setup register.
+  */
+esp_err_t at42qt2120_shadow_update_bits(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg, uint8_t mask, uint8_t value) {
+    uint8_t current;
+    esp_err_t ret = at42qt2120_shadow_read(at42qt2120_handle, reg, &current);
+    if (ret != ESP_OK)
+        return ret;
+
+    return at42qt2120_shadow_write(at42qt2120_handle, reg, (current & ~mask) | (value & mask));
+}
+
+/**
+  * @brief Reads a setup register from the shadow.
+  */
+esp_err_t at42qt2120_shadow_read(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg, uint8_t* value) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(value != NULL, ESP_ERR_INVALID_ARG, TAG, "value is NULL!");
+    ESP_RETURN_ON_FALSE(at42qt2120_is_config_reg(reg), ESP_ERR_INVALID_ARG, TAG, "Register 0x%02X is not a setup register!", reg);
+
+    at42qt2120_shadow_t* shadow = &at42qt2120_handle->shadow;
+    uint8_t index = reg - AT42QT2120_REG_CONFIG_FIRST;
+
+    if (!shadow->valid && (shadow->dirty & AT42QT2120_SHADOW_BIT(index)) == 0) {
+        esp_err_t ret = at42qt2120_shadow_resync(at42qt2120_handle);
+        if (ret != ESP_OK)
+            return ret;
+    }
+
+    *value = shadow->regs[index];
+    return ESP_OK;
+}
+
+/**
+  * @brief Computes the coalesced bursts covering all dirty setup registers.
+  */
+esp_err_t at42qt2120_shadow_plan(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_write_plan_t* plan) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(plan != NULL, ESP_ERR_INVALID_ARG, TAG, "plan is NULL!");
+
+    const at42qt2120_shadow_t* shadow = &at42qt2120_handle->shadow;
+    uint64_t dirty = shadow->dirty;
+    uint8_t first, length;
+
+    plan->burst_count = 0;
+    plan->byte_count = 0;
+    while (at42qt2120_shadow_next_burst(dirty, shadow->valid, &first, &length)) {
+        plan->bursts[plan->burst_count].reg = AT42QT2120_REG_CONFIG_FIRST + first;
+        plan->bursts[plan->burst_count].length = length;
+        plan->burst_count++;
+        plan->byte_count += length;
+        dirty &= ~AT42QT2120_SHADOW_RANGE(first, length);
+    }
+
+    return ESP_OK;
+}
+
+/**
+  * @brief Writes all dirty setup registers as coalesced bursts.
+  */
+esp_err_t at42qt2120_shadow_flush(at42qt2120_handle_t* at42qt2120_handle) {
+    at42qt2120_write_plan_t plan;
+    esp_err_t ret = at42qt2120_shadow_plan(at42qt2120_handle, &plan);
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_shadow_t* shadow = &at42qt2120_handle->shadow;
+    for (uint8_t burst = 0; burst < plan.burst_count; burst++) {
+        uint8_t first = plan.bursts[burst].reg - AT42QT2120_REG_CONFIG_FIRST;
+        uint8_t length = plan.bursts[burst].length;
+
+        /* A failed burst stays dirty for the next flush */
+        ret = at42qt2120_register_write(at42qt2120_handle, plan.bursts[burst].reg, &shadow->regs[first], length);
+        if (ret != ESP_OK)
+            return ret;
+        shadow->dirty &= ~AT42QT2120_SHADOW_RANGE(first, length);
+    }
+
+    return ESP_OK;
+}
+
+/**
+  * @brief Reloads the shadow from the device with one burst read.
+  */
+esp_err_t at42qt2120_shadow_resync(at42qt2120_handle_t* at42qt2120_handle) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    at42qt2120_shadow_t* shadow = &at42qt2120_handle->shadow;
+    uint8_t device_regs[AT42QT2120_CONFIG_REG_COUNT];
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_CONFIG_FIRST, device_regs, sizeof(device_regs));
+    if (ret != ESP_OK)
+        return ret;
+
+    /* Staged values win over the device contents, they are still to be flushed */
+    for (uint8_t index = 0; index < AT42QT2120_CONFIG_REG_COUNT; index++) {
+        if ((shadow->dirty & AT42QT2120_SHADOW_BIT(index)) == 0)
+            shadow->regs[index] = device_regs[index];
+        else if (shadow->regs[index] == device_regs[index])
+            shadow->dirty &= ~AT42QT2120_SHADOW_BIT(index);
+    }
+    shadow->valid = true;
+
+    return ESP_OK;
+}
+
+/**
+  * @brief Marks the shadow as no longer mirroring the device.
+  */
+esp_err_t at42qt2120_shadow_invalidate(at42qt2120_handle_t* at42qt2120_handle) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+
+    at42qt2120_handle->shadow.valid = false;
+    return ESP_OK;
+}
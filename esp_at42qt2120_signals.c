@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_signals.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_signals";
+
+/**
+  * @brief Assembles big-endian register pairs (MSB at the lower address) into 16-bit values.
+  *        Fixed trip count and no aliasing between raw and values lets the compiler vectorize it.
+  */
+static inline void at42qt2120_decode_words(const uint8_t* restrict raw, uint16_t* restrict values) {
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        values[key] = (uint16_t)((raw[2 * key] << 8) | raw[2 * key + 1]);
+}
+
+/**
+  * @brief Computes signal - reference for all 12 keys.
+  */
+void at42qt2120_compute_deltas(const uint16_t signals[AT42QT2120_NUM_KEYS], const uint16_t references[AT42QT2120_NUM_KEYS],
+                               int16_t deltas[AT42QT2120_NUM_KEYS]) {
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        deltas[key] = (int16_t)(signals[key] - references[key]);
+}
+
+/**
+  * @brief Reads the signal block in one burst.
+  */
+esp_err_t at42qt2120_read_signals(at42qt2120_handle_t* at42qt2120_handle, uint16_t signals[AT42QT2120_NUM_KEYS]) {
+    ESP_RETURN_ON_FALSE(signals != NULL, ESP_ERR_INVALID_ARG, TAG, "signals is NULL!");
+
+    uint8_t raw[AT42QT2120_SIGNAL_BLOCK_SIZE];
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_KEY_00_MSB_SIGNAL, raw, sizeof(raw));
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_decode_words(raw, signals);
+    return ESP_OK;
+}
+
+/**
+  * @brief Reads the reference block in one burst.
+  */
+esp_err_t at42qt2120_read_references(at42qt2120_handle_t* at42qt2120_handle, uint16_t references[AT42QT2120_NUM_KEYS]) {
+    ESP_RETURN_ON_FALSE(references != NULL, ESP_ERR_INVALID_ARG, TAG, "references is NULL!");
+
+    uint8_t raw[AT42QT2120_REFERENCE_BLOCK_SIZE];
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_KEY_00_MSB_REFERENCE, raw, sizeof(raw));
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_decode_words(raw, references);
+    return ESP_OK;
+}
+
+/**
+  * @brief Reads the signal and reference blocks in one 48-byte burst.
+  */
+esp_err_t at42qt2120_read_signals_references(at42qt2120_handle_t* at42qt2120_handle, uint16_t signals[AT42QT2120_NUM_KEYS],
+                                             uint16_t references[AT42QT2120_NUM_KEYS], int16_t deltas[AT42QT2120_NUM_KEYS]) {
+    ESP_RETURN_ON_FALSE(signals != NULL, ESP_ERR_INVALID_ARG, TAG, "signals is NULL!");
+    ESP_RETURN_ON_FALSE(references != NULL, ESP_ERR_INVALID_ARG, TAG, "references is NULL!");
+
+    /* The reference block directly follows the signal block, so one burst covers both */
+    uint8_t raw[AT42QT2120_SIGNAL_BLOCK_SIZE + AT42QT2120_REFERENCE_BLOCK_SIZE];
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_KEY_00_MSB_SIGNAL, raw, sizeof(raw));
+    if (ret != ESP_OK)
+        return ret;
+
+    at42qt2120_decode_words(raw, signals);
+    at42qt2120_decode_words(raw + AT42QT2120_SIGNAL_BLOCK_SIZE, references);
+    if (deltas != NULL)
+        at42qt2120_compute_deltas(signals, references, deltas);
+
+    return ESP_OK;
+}
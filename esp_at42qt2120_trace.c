@@ -0,0 +1,314 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_trace.h"
+
+static const char* TAG = "esp_at42qt2120_trace";
+
+/* Record flags: operation in bits 0-1, failed transaction in bit 2 */
+#define AT42QT2120_TRACE_OP_MASK 0x03
+#define AT42QT2120_TRACE_FAILED 0x04
+
+static const uint8_t at42qt2120_trace_magic[4] = { 'Q', 'T', 'T', 'R' };
+
+static inline uint8_t* at42qt2120_trace_put32(uint8_t* out, uint32_t value) {
+    for (int index = 0; index < 4; index++)
+        *out++ = (value >> (8 * index)) & 0xFF;
+    return out;
+}
+
+static inline uint32_t at42qt2120_trace_get32(const uint8_t* in) {
+    return in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+/* Byte of the oldest record at the given offset, across the end of the ring */
+static inline uint8_t at42qt2120_trace_tail_byte(const at42qt2120_trace_t* trace, size_t offset) {
+    return trace->buffer[(trace->tail + offset) % trace->capacity];
+}
+
+/**
+  * @brief Removes the oldest record from the ring. Its time becomes the base time of the next one.
+  */
+static void at42qt2120_trace_drop_oldest(at42qt2120_trace_t* trace) {
+    uint8_t flags = at42qt2120_trace_tail_byte(trace, 0);
+    size_t size = 1;
+    uint64_t delta = 0;
+    uint8_t byte;
+    int shift = 0;
+    do {
+        byte = at42qt2120_trace_tail_byte(trace, size++);
+        delta |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    at42qt2120_trace_op_t op = flags & AT42QT2120_TRACE_OP_MASK;
+    if (op != AT42QT2120_TRACE_PROBE) {
+        uint8_t length = at42qt2120_trace_tail_byte(trace, size + 1);
+        size += 2;
+        if (op == AT42QT2120_TRACE_WRITE || !(flags & AT42QT2120_TRACE_FAILED))
+            size += length;
+    }
+    if (flags & AT42QT2120_TRACE_FAILED)
+        size += 4;
+
+    trace->base_time_us += delta;
+    trace->tail = (trace->tail + size) % trace->capacity;
+    trace->used -= size;
+    trace->records--;
+    trace->dropped++;
+}
+
+/**
+  * @brief Encodes one transaction and appends it to the ring, dropping the oldest records until it fits.
+  */
+static void at42qt2120_trace_append(at42qt2120_trace_t* trace, int64_t time_us, at42qt2120_trace_op_t op, uint8_t reg, size_t length,
+                                    esp_err_t result, const uint8_t* payload) {
+    if (length > UINT8_MAX) {
+        trace->dropped++;
+        return;
+    }
+    if (trace->records == 0)
+        trace->base_time_us = trace->last_time_us = time_us;
+
+    uint8_t record[AT42QT2120_TRACE_MAX_RECORD_SIZE];
+    uint8_t* out = record;
+    *out++ = op | (result != ESP_OK ? AT42QT2120_TRACE_FAILED : 0);
+    uint64_t delta = time_us > trace->last_time_us ? (uint64_t)(time_us - trace->last_time_us) : 0;
+    do {
+        *out = delta & 0x7F;
+        delta >>= 7;
+        *out++ |= delta != 0 ? 0x80 : 0;
+    } while (delta != 0);
+    if (op != AT42QT2120_TRACE_PROBE) {
+        *out++ = reg;
+        *out++ = (uint8_t)length;
+    }
+    if (result != ESP_OK)
+        out = at42qt2120_trace_put32(out, (uint32_t)result);
+    if (payload != NULL && (op == AT42QT2120_TRACE_WRITE || result == ESP_OK)) {
+        memcpy(out, payload, length);
+        out += length;
+    }
+
+    size_t size = out - record;
+    if (size > trace->capacity) {
+        trace->dropped++;
+        return;
+    }
+    while (trace->capacity - trace->used < size)
+        at42qt2120_trace_drop_oldest(trace);
+
+    size_t first = trace->capacity - trace->head;
+    if (first > size)
+        first = size;
+    memcpy(trace->buffer + trace->head, record, first);
+    memcpy(trace->buffer, record + first, size - first);
+    trace->head = (trace->head + size) % trace->capacity;
+    trace->used += size;
+    trace->records++;
+    trace->last_time_us = time_us;
+}
+
+static esp_err_t at42qt2120_trace_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size,
+                                                   int timeout_ms) {
+    at42qt2120_trace_t* trace = (at42qt2120_trace_t*)ctx;
+    const at42qt2120_transport_t* inner = &trace->inner;
+    if (!trace->enabled)
+        return inner->ops->transmit_receive(inner->ctx, write_buf, write_size, read_buf, read_size, timeout_ms);
+
+    int64_t time_us = inner->ops->time_us(inner->ctx);
+    esp_err_t ret = inner->ops->transmit_receive(inner->ctx, write_buf, write_size, read_buf, read_size, timeout_ms);
+    at42qt2120_trace_append(trace, time_us, AT42QT2120_TRACE_READ, write_size > 0 ? write_buf[0] : 0, read_size, ret, read_buf);
+    return ret;
+}
+
+static esp_err_t at42qt2120_trace_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    at42qt2120_trace_t* trace = (at42qt2120_trace_t*)ctx;
+    const at42qt2120_transport_t* inner = &trace->inner;
+    if (!trace->enabled)
+        return inner->ops->transmit(inner->ctx, write_buf, write_size, timeout_ms);
+
+    int64_t time_us = inner->ops->time_us(inner->ctx);
+    esp_err_t ret = inner->ops->transmit(inner->ctx, write_buf, write_size, timeout_ms);
+    if (write_size > 0)
+        at42qt2120_trace_append(trace, time_us, AT42QT2120_TRACE_WRITE, write_buf[0], write_size - 1, ret, write_buf + 1);
+    else
+        at42qt2120_trace_append(trace, time_us, AT42QT2120_TRACE_WRITE, 0, 0, ret, NULL);
+    return ret;
+}
+
+static esp_err_t at42qt2120_trace_probe(void* ctx, int timeout_ms) {
+    at42qt2120_trace_t* trace = (at42qt2120_trace_t*)ctx;
+    const at42qt2120_transport_t* inner = &trace->inner;
+    if (!trace->enabled)
+        return inner->ops->probe(inner->ctx, timeout_ms);
+
+    int64_t time_us = inner->ops->time_us(inner->ctx);
+    esp_err_t ret = inner->ops->probe(inner->ctx, timeout_ms);
+    at42qt2120_trace_append(trace, time_us, AT42QT2120_TRACE_PROBE, 0, 0, ret, NULL);
+    return ret;
+}
+
+static esp_err_t at42qt2120_trace_release(void* ctx) {
+    at42qt2120_trace_t* trace = (at42qt2120_trace_t*)ctx;
+    if (trace->inner.ops->release == NULL)
+        return ESP_OK;
+    return trace->inner.ops->release(trace->inner.ctx);
+}
+
+static void at42qt2120_trace_delay_ms(void* ctx, uint32_t delay_ms) {
+    at42qt2120_trace_t* trace = (at42qt2120_trace_t*)ctx;
+    trace->inner.ops->delay_ms(trace->inner.ctx, delay_ms);
+}
+
+static int64_t at42qt2120_trace_time_us(void* ctx) {
+    at42qt2120_trace_t* trace = (at42qt2120_trace_t*)ctx;
+    return trace->inner.ops->time_us(trace->inner.ctx);
+}
+
+static const at42qt2120_transport_ops_t at42qt2120_trace_ops = {
+    .transmit_receive = at42qt2120_trace_transmit_receive,
+    .transmit = at42qt2120_trace_transmit,
+    .probe = at42qt2120_trace_probe,
+    .release = at42qt2120_trace_release,
+    .delay_ms = at42qt2120_trace_delay_ms,
+    .time_us = at42qt2120_trace_time_us,
+};
+
+/**
+  * @brief Binds the recorder to its ring and inner transport. Recording starts enabled.
+  */
+esp_err_t at42qt2120_trace_init(at42qt2120_trace_t* trace, uint8_t* buffer, size_t capacity, const at42qt2120_transport_t* inner,
+                                at42qt2120_transport_t* transport) {
+    ESP_RETURN_ON_FALSE(trace != NULL && buffer != NULL, ESP_ERR_INVALID_ARG, TAG, "trace or buffer is NULL!");
+    ESP_RETURN_ON_FALSE(inner != NULL && inner->ops != NULL && transport != NULL, ESP_ERR_INVALID_ARG, TAG, "inner or transport is NULL!");
+    ESP_RETURN_ON_FALSE(capacity >= AT42QT2120_TRACE_MAX_RECORD_SIZE, ESP_ERR_INVALID_SIZE, TAG, "Trace buffer too small!");
+
+    memset(trace, 0, sizeof(*trace));
+    trace->inner = *inner;
+    trace->buffer = buffer;
+    trace->capacity = capacity;
+    trace->enabled = true;
+
+    transport->ops = &at42qt2120_trace_ops;
+    transport->ctx = trace;
+    return ESP_OK;
+}
+
+void at42qt2120_trace_enable(at42qt2120_trace_t* trace, bool enabled) {
+    trace->enabled = enabled;
+}
+
+void at42qt2120_trace_clear(at42qt2120_trace_t* trace) {
+    trace->head = trace->tail = trace->used = 0;
+    trace->records = trace->dropped = 0;
+}
+
+size_t at42qt2120_trace_dump_size(const at42qt2120_trace_t* trace) {
+    return AT42QT2120_TRACE_HEADER_SIZE + trace->used;
+}
+
+/**
+  * @brief Writes the header, then the ring from its oldest record on.
+  */
+esp_err_t at42qt2120_trace_dump(const at42qt2120_trace_t* trace, uint8_t* dump, size_t capacity, size_t* size) {
+    ESP_RETURN_ON_FALSE(trace != NULL, ESP_ERR_INVALID_ARG, TAG, "trace is NULL!");
+    ESP_RETURN_ON_FALSE(dump != NULL && size != NULL, ESP_ERR_INVALID_ARG, TAG, "dump or size is NULL!");
+    ESP_RETURN_ON_FALSE(capacity >= at42qt2120_trace_dump_size(trace), ESP_ERR_INVALID_SIZE, TAG, "Dump buffer too small!");
+
+    uint8_t* out = dump;
+    memcpy(out, at42qt2120_trace_magic, sizeof(at42qt2120_trace_magic));
+    out += sizeof(at42qt2120_trace_magic);
+    *out++ = AT42QT2120_TRACE_VERSION;
+    *out++ = 0;
+    *out++ = 0;
+    *out++ = 0;
+    out = at42qt2120_trace_put32(out, (uint32_t)trace->base_time_us);
+    out = at42qt2120_trace_put32(out, (uint32_t)((uint64_t)trace->base_time_us >> 32));
+    out = at42qt2120_trace_put32(out, trace->records);
+    out = at42qt2120_trace_put32(out, trace->dropped);
+
+    size_t first = trace->capacity - trace->tail;
+    if (first > trace->used)
+        first = trace->used;
+    memcpy(out, trace->buffer + trace->tail, first);
+    memcpy(out + first, trace->buffer, trace->used - first);
+    *size = AT42QT2120_TRACE_HEADER_SIZE + trace->used;
+    return ESP_OK;
+}
+
+/**
+  * @brief Checks magic and version, and starts the reader at the base time.
+  */
+esp_err_t at42qt2120_trace_reader_init(at42qt2120_trace_reader_t* reader, const uint8_t* dump, size_t size) {
+    ESP_RETURN_ON_FALSE(reader != NULL && dump != NULL, ESP_ERR_INVALID_ARG, TAG, "reader or dump is NULL!");
+
+    if (size < AT42QT2120_TRACE_HEADER_SIZE || memcmp(dump, at42qt2120_trace_magic, sizeof(at42qt2120_trace_magic)) != 0)
+        return ESP_ERR_INVALID_SIZE;
+    if (dump[sizeof(at42qt2120_trace_magic)] != AT42QT2120_TRACE_VERSION)
+        return ESP_ERR_INVALID_VERSION;
+
+    reader->data = dump;
+    reader->size = size;
+    reader->offset = AT42QT2120_TRACE_HEADER_SIZE;
+    reader->time_us = (int64_t)(at42qt2120_trace_get32(dump + 8) | ((uint64_t)at42qt2120_trace_get32(dump + 12) << 32));
+    reader->records = at42qt2120_trace_get32(dump + 16);
+    reader->dropped = at42qt2120_trace_get32(dump + 20);
+    return ESP_OK;
+}
+
+/**
+  * @brief Decodes the record at the reader's offset, checking every field against the end of the dump.
+  */
+esp_err_t at42qt2120_trace_next(at42qt2120_trace_reader_t* reader, at42qt2120_trace_record_t* record) {
+    ESP_RETURN_ON_FALSE(reader != NULL && record != NULL, ESP_ERR_INVALID_ARG, TAG, "reader or record is NULL!");
+
+    const uint8_t* in = reader->data + reader->offset;
+    const uint8_t* end = reader->data + reader->size;
+    if (in == end)
+        return ESP_ERR_NOT_FOUND;
+
+    uint8_t flags = *in++;
+    uint64_t delta = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        if (in == end || shift > 63)
+            return ESP_ERR_INVALID_SIZE;
+        byte = *in++;
+        delta |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    record->op = flags & AT42QT2120_TRACE_OP_MASK;
+    record->reg = 0;
+    record->length = 0;
+    if (record->op != AT42QT2120_TRACE_PROBE) {
+        if (end - in < 2)
+            return ESP_ERR_INVALID_SIZE;
+        record->reg = *in++;
+        record->length = *in++;
+    }
+    record->result = ESP_OK;
+    if (flags & AT42QT2120_TRACE_FAILED) {
+        if (end - in < 4)
+            return ESP_ERR_INVALID_SIZE;
+        record->result = (esp_err_t)at42qt2120_trace_get32(in);
+        in += 4;
+    }
+    record->payload = NULL;
+    if (record->length > 0 && (record->op == AT42QT2120_TRACE_WRITE || record->result == ESP_OK)) {
+        if (end - in < record->length)
+            return ESP_ERR_INVALID_SIZE;
+        record->payload = in;
+        in += record->length;
+    }
+
+    reader->time_us += (int64_t)delta;
+    record->time_us = reader->time_us;
+    reader->offset = in - reader->data;
+    return ESP_OK;
+}
@@ -0,0 +1,88 @@
+#include <driver/i2c_master.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_transport.h"
+
+static const char* TAG = "esp_at42qt2120_driver";
+
+/* ESP-IDF I2C master backend. The context is the at42qt2120 handle owning the device */
+static esp_err_t at42qt2120_i2c_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms) {
+    at42qt2120_handle_t* at42qt2120_handle = (at42qt2120_handle_t*)ctx;
+    return i2c_master_transmit_receive(at42qt2120_handle->device_handle, write_buf, write_size, read_buf, read_size, timeout_ms);
+}
+
+static esp_err_t at42qt2120_i2c_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    at42qt2120_handle_t* at42qt2120_handle = (at42qt2120_handle_t*)ctx;
+    return i2c_master_transmit(at42qt2120_handle->device_handle, write_buf, write_size, timeout_ms);
+}
+
+static esp_err_t at42qt2120_i2c_probe(void* ctx, int timeout_ms) {
+    at42qt2120_handle_t* at42qt2120_handle = (at42qt2120_handle_t*)ctx;
+    return i2c_master_probe(at42qt2120_handle->bus_handle, at42qt2120_handle->device_config.device_address, timeout_ms);
+}
+
+static esp_err_t at42qt2120_i2c_release(void* ctx) {
+    at42qt2120_handle_t* at42qt2120_handle = (at42qt2120_handle_t*)ctx;
+    ESP_RETURN_ON_ERROR(i2c_master_bus_rm_device(at42qt2120_handle->device_handle), TAG, "Failed to removed at42qt2120 from i2c bus");
+
+    ESP_LOGI(TAG, "Removed at42qt2120 from i2c bus.");
+    return ESP_OK;
+}
+
+static void at42qt2120_i2c_delay_ms(void* ctx, uint32_t delay_ms) {
+    /* Round up so short waits never collapse to zero ticks */
+    TickType_t ticks = (delay_ms * configTICK_RATE_HZ + 999) / 1000;
+    vTaskDelay(ticks);
+}
+
+static int64_t at42qt2120_i2c_time_us(void* ctx) {
+    return esp_timer_get_time();
+}
+
+static const at42qt2120_transport_ops_t at42qt2120_i2c_transport_ops = {
+    .transmit_receive = at42qt2120_i2c_transmit_receive,
+    .transmit = at42qt2120_i2c_transmit,
+    .probe = at42qt2120_i2c_probe,
+    .release = at42qt2120_i2c_release,
+    .delay_ms = at42qt2120_i2c_delay_ms,
+    .time_us = at42qt2120_i2c_time_us,
+};
+
+/**
+  * @brief Initializes the AT42QT2120 touch sensor on the I2C bus.
+  */
+esp_err_t at42qt2120_init(i2c_master_bus_handle_t bus_handle, at42qt2120_handle_t* at42qt2120_handle, size_t clock_speed, int time_out) {
+    /* Error checking for input parameters */
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(bus_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "i2c bus is NULL!");
+
+    /* Setting up device configuration to add at42qt2120 to i2c bus */
+    at42qt2120_handle->device_config.dev_addr_length = I2C_ADDR_BIT_LEN_7;
+    at42qt2120_handle->device_config.device_address = AT42QT2120_SLAVE_ADDRESS;
+    at42qt2120_handle->device_config.scl_speed_hz = clock_speed;
+    at42qt2120_handle->bus_handle = bus_handle;
+
+    ESP_RETURN_ON_ERROR(i2c_master_bus_add_device(bus_handle, &at42qt2120_handle->device_config, &at42qt2120_handle->device_handle), TAG, "Failed to add at42qt2120 to i2c bus");
+
+    /* Check if device is connected to the i2c bus */
+    at42qt2120_transport_t transport = {
+        .ops = &at42qt2120_i2c_transport_ops,
+        .ctx = at42qt2120_handle,
+    };
+    esp_err_t ret = at42qt2120_init_with_transport(at42qt2120_handle, &transport, time_out);
+    if (ret != ESP_OK) {
+        i2c_master_bus_rm_device(at42qt2120_handle->device_handle);
+        ESP_LOGE(TAG, "at42qt2120 device is not connected to the i2c bus");
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Added at42qt2120 to i2c bus.");
+    return ESP_OK;
+}
@@ -0,0 +1,412 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_tune.h"
+#include "esp_at42qt2120_signals.h"
+#include "esp_at42qt2120_poll.h"
+#include "esp_at42qt2120_defines.h"
+
+static const char* TAG = "esp_at42qt2120_tune";
+
+/* Low power mode during the sweep: the shortest measurement interval, 8 ms */
+#define AT42QT2120_TUNE_SWEEP_LOW_POWER_MODE 1
+/* Quantization alone leaves 1/sqrt(12) counts of noise, in Q8 */
+#define AT42QT2120_TUNE_MIN_NOISE_Q8 74
+/* A pulse step is only worth its burst time if it improves the key by at least 1/16 */
+#define AT42QT2120_TUNE_MIN_GAIN_SHIFT 4
+
+/**
+  * @brief Touch delta and noise of one key in one sweep step.
+  */
+typedef struct {
+    int32_t delta_q8;                       // Touched mean - untouched mean of signal - reference, Q8 counts
+    uint32_t noise_q8;                      // Standard deviation of signal - reference around each phase's mean, Q8 counts
+    uint32_t level;                         // Untouched mean signal in counts
+} at42qt2120_tune_measurement_t;
+
+/**
+  * @brief State of one sweep.
+  */
+typedef struct {
+    at42qt2120_handle_t* at42qt2120_handle;
+    const at42qt2120_tune_config_t* config;
+    uint8_t scales[AT42QT2120_TUNE_MAX_PULSE + 1][AT42QT2120_NUM_KEYS];
+    at42qt2120_tune_measurement_t pulses[AT42QT2120_TUNE_MAX_PULSE + 1][AT42QT2120_NUM_KEYS];     // At charge time 0
+    at42qt2120_tune_measurement_t charges[AT42QT2120_TUNE_MAX_CHARGE_TIME + 1][AT42QT2120_NUM_KEYS];  // At max_pulse
+    uint32_t steps;
+    uint32_t reads;
+} at42qt2120_tune_sweep_t;
+
+static uint32_t at42qt2120_tune_isqrt(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > value)
+        bit >>= 2;
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+static uint32_t at42qt2120_tune_burst_us(const at42qt2120_tune_config_t* config, const at42qt2120_config_t* device_config) {
+    uint32_t pulse_us = config->pulse_time_us + (uint32_t)device_config->charge_time * config->charge_step_time_us;
+    uint32_t burst_us = 0;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        burst_us += pulse_us << (device_config->key_pulse_scale[key] >> 4);
+    return burst_us;
+}
+
+/**
+  * @brief Worst case: a touch right after a measurement waits one interval, then the integrator confirms it.
+  */
+uint32_t at42qt2120_tune_response_time(const at42qt2120_tune_config_t* config, const at42qt2120_config_t* device_config, uint32_t* burst_time_us) {
+    uint32_t burst_us = at42qt2120_tune_burst_us(config, device_config);
+    uint32_t interval_us = (uint32_t)device_config->low_power_mode * AT42QT2120_LOW_POWER_STEP_MS * 1000;
+    uint32_t spacing_us = config->confirm_spacing_us > burst_us ? config->confirm_spacing_us : burst_us;
+    uint8_t integrator = device_config->detection_integrator ? device_config->detection_integrator : 1;
+
+    if (burst_time_us != NULL)
+        *burst_time_us = burst_us;
+    return (interval_us > burst_us ? interval_us : burst_us) + (integrator - 1) * spacing_us + burst_us;
+}
+
+/**
+  * @brief Writes one setting for all keys in one flush, then samples them untouched and touched.
+  */
+static esp_err_t at42qt2120_tune_step(at42qt2120_tune_sweep_t* sweep, const at42qt2120_config_t* setting, at42qt2120_tune_measurement_t measurements[AT42QT2120_NUM_KEYS]) {
+    at42qt2120_handle_t* at42qt2120_handle = sweep->at42qt2120_handle;
+    const at42qt2120_tune_config_t* config = sweep->config;
+
+    esp_err_t ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_CHARGE_TIME, setting->charge_time);
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS && ret == ESP_OK; key++)
+        ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_KEY_00_PULSE_SCALE + key, setting->key_pulse_scale[key]);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    /* One sample per measurement: a long burst stretches the interval */
+    uint32_t burst_us = at42qt2120_tune_burst_us(config, setting);
+    uint32_t interval_us = AT42QT2120_TUNE_SWEEP_LOW_POWER_MODE * AT42QT2120_LOW_POWER_STEP_MS * 1000;
+    uint32_t period_ms = ((burst_us > interval_us ? burst_us : interval_us) + 999) / 1000;
+
+    int64_t sums[AT42QT2120_NUM_KEYS] = { 0 };
+    int64_t squares[AT42QT2120_NUM_KEYS] = { 0 };
+    int64_t touched_sums[AT42QT2120_NUM_KEYS] = { 0 };
+    int64_t touched_squares[AT42QT2120_NUM_KEYS] = { 0 };
+    int64_t levels[AT42QT2120_NUM_KEYS] = { 0 };
+    uint16_t signals[AT42QT2120_NUM_KEYS];
+    uint16_t references[AT42QT2120_NUM_KEYS];
+    int16_t deltas[AT42QT2120_NUM_KEYS];
+    uint32_t touched_samples = config->samples / 2;
+
+    at42qt2120_delay_ms(at42qt2120_handle, 2 * period_ms);
+    for (uint32_t sample = 0; sample < config->samples + touched_samples; sample++) {
+        if (sample == config->samples) {
+            config->touch(config->keys, config->user_ctx);
+            at42qt2120_delay_ms(at42qt2120_handle, 2 * period_ms);
+        }
+
+        ret = at42qt2120_read_signals_references(at42qt2120_handle, signals, references, deltas);
+        if (ret != ESP_OK) {
+            config->touch(0, config->user_ctx);
+            return ret;
+        }
+        sweep->reads++;
+
+        for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+            if (sample >= config->samples) {
+                touched_sums[key] += deltas[key];
+                touched_squares[key] += (int64_t)deltas[key] * deltas[key];
+                continue;
+            }
+            sums[key] += deltas[key];
+            squares[key] += (int64_t)deltas[key] * deltas[key];
+            levels[key] += signals[key];
+        }
+        at42qt2120_delay_ms(at42qt2120_handle, period_ms);
+    }
+    config->touch(0, config->user_ctx);
+
+    int64_t samples = config->samples;
+    int64_t touched = touched_samples;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        /* Variance pooled over both phases (a touch moves the mean, not the noise): n * squared deviations in each, then Q16 */
+        uint64_t spread = (uint64_t)(samples * squares[key] - sums[key] * sums[key]) * touched +
+                          (uint64_t)(touched * touched_squares[key] - touched_sums[key] * touched_sums[key]) * samples;
+        uint64_t divisor = (uint64_t)(samples * touched * (samples + touched - 2));
+        uint64_t variance_q16 = spread <= UINT64_MAX >> 16 ? (spread << 16) / divisor : spread / divisor << 16;
+        uint32_t noise_q8 = at42qt2120_tune_isqrt(variance_q16);
+
+        measurements[key].noise_q8 = noise_q8 > AT42QT2120_TUNE_MIN_NOISE_Q8 ? noise_q8 : AT42QT2120_TUNE_MIN_NOISE_Q8;
+        measurements[key].delta_q8 = (int32_t)(touched_sums[key] * 256 / (int64_t)touched_samples - sums[key] * 256 / samples);
+        measurements[key].level = (uint32_t)(levels[key] / samples);
+    }
+    sweep->steps++;
+    return ESP_OK;
+}
+
+/**
+  * @brief Sweeps pulse at charge time 0, then charge time at max_pulse.
+  */
+static esp_err_t at42qt2120_tune_sweep(at42qt2120_tune_sweep_t* sweep, const at42qt2120_config_t* original) {
+    at42qt2120_handle_t* at42qt2120_handle = sweep->at42qt2120_handle;
+    const at42qt2120_tune_config_t* config = sweep->config;
+
+    /* Calibrated once at the lowest setting; the signals only grow from there, which keeps the keys out of drift compensation */
+    at42qt2120_config_t setting = *original;
+    setting.low_power_mode = AT42QT2120_TUNE_SWEEP_LOW_POWER_MODE;
+    setting.charge_time = 0;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        if (config->keys & (1 << key))
+            setting.key_pulse_scale[key] = 0;
+    }
+    esp_err_t ret = at42qt2120_apply_config(at42qt2120_handle, &setting, NULL);
+    if (ret == ESP_OK)
+        ret = at42qt2120_calibrate(at42qt2120_handle);
+    if (ret == ESP_OK)
+        ret = at42qt2120_wait_ready(at42qt2120_handle, -1);
+    if (ret != ESP_OK)
+        return ret;
+
+    for (uint8_t pulse = 0; pulse <= config->max_pulse; pulse++) {
+        for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+            if ((config->keys & (1 << key)) == 0)
+                continue;
+
+            /* Scale keeps the untouched signal in range, based on the level seen at pulse 0 */
+            uint8_t scale = 0;
+            if (pulse > 0) {
+                while (scale < 15 && ((uint64_t)sweep->pulses[0][key].level << pulse >> scale) > config->max_signal)
+                    scale++;
+            }
+            sweep->scales[pulse][key] = scale;
+            setting.key_pulse_scale[key] = (uint8_t)(pulse << 4 | scale);
+        }
+        ret = at42qt2120_tune_step(sweep, &setting, sweep->pulses[pulse]);
+        if (ret != ESP_OK)
+            return ret;
+    }
+
+    memcpy(sweep->charges[0], sweep->pulses[config->max_pulse], sizeof(sweep->charges[0]));
+    for (uint8_t charge_time = 1; charge_time <= config->max_charge_time; charge_time++) {
+        setting.charge_time = charge_time;
+        ret = at42qt2120_tune_step(sweep, &setting, sweep->charges[charge_time]);
+        if (ret != ESP_OK)
+            return ret;
+    }
+    return ESP_OK;
+}
+
+/* Predicted touch delta and noise of a key at a pulse and charge time: the pulse sweep scaled by the charge time sweep */
+static void at42qt2120_tune_predict(const at42qt2120_tune_sweep_t* sweep, uint8_t key, uint8_t pulse, uint8_t charge_time, int32_t* delta_q8,
+                                    uint32_t* noise_q8) {
+    const at42qt2120_tune_measurement_t* measured = &sweep->pulses[pulse][key];
+    const at42qt2120_tune_measurement_t* charged = &sweep->charges[charge_time][key];
+    const at42qt2120_tune_measurement_t* reference = &sweep->charges[0][key];
+
+    int64_t delta = (int64_t)measured->delta_q8 * (charged->delta_q8 > 0 ? charged->delta_q8 : 0) / reference->delta_q8;
+    uint64_t noise = (uint64_t)measured->noise_q8 * charged->noise_q8 / reference->noise_q8;
+    *delta_q8 = (int32_t)delta;
+    *noise_q8 = noise > AT42QT2120_TUNE_MIN_NOISE_Q8 ? (uint32_t)noise : AT42QT2120_TUNE_MIN_NOISE_Q8;
+}
+
+static uint32_t at42qt2120_tune_snr_q8(const at42qt2120_tune_sweep_t* sweep, uint8_t key, uint8_t pulse, uint8_t charge_time) {
+    int32_t delta_q8;
+    uint32_t noise_q8;
+    at42qt2120_tune_predict(sweep, key, pulse, charge_time, &delta_q8, &noise_q8);
+    if (delta_q8 <= 0)
+        return 0;
+    uint64_t snr_q8 = (uint64_t)delta_q8 * 256 / noise_q8;
+    return snr_q8 > UINT16_MAX ? UINT16_MAX : (uint32_t)snr_q8;
+}
+
+/**
+  * @brief Greedy pulse allocation at one charge time. Returns the lowest ratio of the tuned keys.
+  */
+static uint32_t at42qt2120_tune_allocate(const at42qt2120_tune_sweep_t* sweep, uint8_t charge_time, at42qt2120_config_t* candidate) {
+    const at42qt2120_tune_config_t* config = sweep->config;
+    uint32_t interval_us = (uint32_t)candidate->low_power_mode * AT42QT2120_LOW_POWER_STEP_MS * 1000;
+    uint8_t pulses[AT42QT2120_NUM_KEYS] = { 0 };
+    uint16_t frozen = (uint16_t)~config->keys;
+
+    candidate->charge_time = charge_time;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        if (config->keys & (1 << key))
+            candidate->key_pulse_scale[key] = sweep->scales[0][key];
+    }
+
+    while ((frozen & AT42QT2120_KEY_MASK_ALL) != AT42QT2120_KEY_MASK_ALL) {
+        uint8_t weakest = 0;
+        uint32_t weakest_snr_q8 = UINT32_MAX;
+        for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+            if (frozen & (1 << key))
+                continue;
+            uint32_t snr_q8 = at42qt2120_tune_snr_q8(sweep, key, pulses[key], charge_time);
+            if (snr_q8 < weakest_snr_q8) {
+                weakest = key;
+                weakest_snr_q8 = snr_q8;
+            }
+        }
+
+        /* Single steps are too close to tell apart from the estimation noise, so the key has to gain somewhere above its pulse */
+        uint32_t best_q8 = 0;
+        for (uint8_t pulse = pulses[weakest] + 1; pulse <= config->max_pulse; pulse++) {
+            uint32_t snr_q8 = at42qt2120_tune_snr_q8(sweep, weakest, pulse, charge_time);
+            best_q8 = snr_q8 > best_q8 ? snr_q8 : best_q8;
+        }
+        if (best_q8 < weakest_snr_q8 + (weakest_snr_q8 >> AT42QT2120_TUNE_MIN_GAIN_SHIFT)) {
+            frozen |= 1 << weakest;
+            continue;
+        }
+        uint8_t pulse = pulses[weakest] + 1;
+
+        uint8_t previous = candidate->key_pulse_scale[weakest];
+        candidate->key_pulse_scale[weakest] = (uint8_t)(pulse << 4 | sweep->scales[pulse][weakest]);
+        uint32_t burst_us;
+        uint32_t response_us = at42qt2120_tune_response_time(config, candidate, &burst_us);
+        if (response_us > config->response_time_us || burst_us > interval_us) {
+            candidate->key_pulse_scale[weakest] = previous;
+            frozen |= 1 << weakest;
+            continue;
+        }
+        pulses[weakest] = pulse;
+    }
+
+    uint32_t lowest_q8 = UINT32_MAX;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        if (config->keys & (1 << key)) {
+            uint32_t snr_q8 = at42qt2120_tune_snr_q8(sweep, key, pulses[key], charge_time);
+            lowest_q8 = snr_q8 < lowest_q8 ? snr_q8 : lowest_q8;
+        }
+    }
+    return lowest_q8;
+}
+
+/**
+  * @brief Picks the charge time and pulses, then derives thresholds and the predicted performance.
+  */
+static void at42qt2120_tune_select(const at42qt2120_tune_sweep_t* sweep, const at42qt2120_config_t* original, at42qt2120_tune_result_t* result) {
+    const at42qt2120_tune_config_t* config = sweep->config;
+
+    /* Ties go to the shorter charge time and with it the shorter burst */
+    uint32_t best_q8 = 0;
+    at42qt2120_config_t candidate = *original;
+    result->config = *original;
+    for (uint8_t charge_time = 0; charge_time <= config->max_charge_time; charge_time++) {
+        uint32_t snr_q8 = at42qt2120_tune_allocate(sweep, charge_time, &candidate);
+        if (charge_time == 0 || snr_q8 > best_q8) {
+            best_q8 = snr_q8;
+            result->config = candidate;
+        }
+    }
+
+    at42qt2120_config_t* tuned = &result->config;
+    result->charge_time = tuned->charge_time;
+    result->snr_q8 = (uint16_t)best_q8;
+    result->baseline_snr_q8 = UINT16_MAX;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        if ((config->keys & (1 << key)) == 0)
+            continue;
+
+        uint32_t baseline_q8 = at42qt2120_tune_snr_q8(sweep, key, 0, 0);
+        result->baseline_snr_q8 = baseline_q8 < result->baseline_snr_q8 ? (uint16_t)baseline_q8 : result->baseline_snr_q8;
+
+        at42qt2120_tune_key_t* tuned_key = &result->keys[key];
+        tuned_key->pulse = tuned->key_pulse_scale[key] >> 4;
+        tuned_key->scale = tuned->key_pulse_scale[key] & 0x0F;
+        int32_t delta_q8;
+        uint32_t noise_q8;
+        at42qt2120_tune_predict(sweep, key, tuned_key->pulse, tuned->charge_time, &delta_q8, &noise_q8);
+
+        /* threshold_percent of the touch delta, kept min_noise_sigmas away from idle and touch level if the ratio allows */
+        int64_t threshold_q8 = (int64_t)delta_q8 * config->threshold_percent / 100;
+        int64_t guard_q8 = (int64_t)noise_q8 * config->min_noise_sigmas;
+        if (guard_q8 <= delta_q8 - guard_q8)
+            threshold_q8 = threshold_q8 < guard_q8 ? guard_q8 : (threshold_q8 > delta_q8 - guard_q8 ? delta_q8 - guard_q8 : threshold_q8);
+        else
+            threshold_q8 = delta_q8 / 2;
+        int64_t dthr = (threshold_q8 + 128) / 256;
+        dthr = dthr < 1 ? 1 : (dthr > UINT8_MAX ? UINT8_MAX : dthr);
+        tuned->key_dthr[key] = (uint8_t)dthr;
+
+        int32_t above_q8 = delta_q8 - (int32_t)dthr * 256;
+        int32_t nearer_q8 = above_q8 < (int32_t)dthr * 256 ? above_q8 : (int32_t)dthr * 256;
+        int64_t margin_q8 = nearer_q8 > 0 ? (int64_t)nearer_q8 * 256 / noise_q8 : 0;
+
+        tuned_key->dthr = (uint8_t)dthr;
+        tuned_key->delta = (uint16_t)(delta_q8 / 256);
+        tuned_key->noise_q8 = noise_q8 > UINT16_MAX ? UINT16_MAX : (uint16_t)noise_q8;
+        tuned_key->snr_q8 = (uint16_t)at42qt2120_tune_snr_q8(sweep, key, tuned_key->pulse, tuned->charge_time);
+        tuned_key->margin_q8 = margin_q8 > UINT16_MAX ? UINT16_MAX : (uint16_t)margin_q8;
+    }
+    result->response_time_us = at42qt2120_tune_response_time(config, tuned, &result->burst_time_us);
+}
+
+/**
+  * @brief Sweeps, restores the device and selects the tuned settings.
+  */
+esp_err_t at42qt2120_tune(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_tune_config_t* config, at42qt2120_tune_result_t* result) {
+    ESP_RETURN_ON_FALSE(at42qt2120_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "at42qt2120_handle is NULL!");
+    ESP_RETURN_ON_FALSE(config != NULL && result != NULL, ESP_ERR_INVALID_ARG, TAG, "config or result is NULL!");
+    ESP_RETURN_ON_FALSE(config->touch != NULL, ESP_ERR_INVALID_ARG, TAG, "touch callback is NULL!");
+    ESP_RETURN_ON_FALSE((config->keys & AT42QT2120_KEY_MASK_ALL) != 0, ESP_ERR_INVALID_ARG, TAG, "No keys to tune!");
+    ESP_RETURN_ON_FALSE(config->max_pulse <= AT42QT2120_TUNE_MAX_PULSE && config->max_charge_time <= AT42QT2120_TUNE_MAX_CHARGE_TIME,
+                        ESP_ERR_INVALID_ARG, TAG, "Sweep range out of bounds!");
+    ESP_RETURN_ON_FALSE(config->samples >= 4, ESP_ERR_INVALID_ARG, TAG, "Too few samples!");
+    ESP_RETURN_ON_FALSE(config->threshold_percent > 0 && config->threshold_percent < 100, ESP_ERR_INVALID_ARG, TAG, "threshold_percent out of range!");
+
+    at42qt2120_config_t original;
+    esp_err_t ret = at42qt2120_get_config(at42qt2120_handle, &original);
+    if (ret != ESP_OK)
+        return ret;
+    ESP_RETURN_ON_FALSE(original.low_power_mode != 0, ESP_ERR_INVALID_STATE, TAG, "Device is not measuring (low power mode 0)!");
+
+    /* Even without extra pulses the target must be reachable with the device's interval and integrator */
+    at42qt2120_config_t untuned = original;
+    untuned.charge_time = 0;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        if (config->keys & (1 << key))
+            untuned.key_pulse_scale[key] = 0;
+    }
+    ESP_RETURN_ON_FALSE(at42qt2120_tune_response_time(config, &untuned, NULL) <= config->response_time_us, ESP_ERR_INVALID_STATE, TAG,
+                        "Response time target below what the measurement interval allows!");
+
+    at42qt2120_tune_sweep_t sweep = { .at42qt2120_handle = at42qt2120_handle, .config = config };
+    int64_t start_us = at42qt2120_time_us(at42qt2120_handle);
+    ret = at42qt2120_tune_sweep(&sweep, &original);
+
+    /* The device goes back to where it was whatever the sweep did */
+    esp_err_t restore_ret = at42qt2120_apply_config(at42qt2120_handle, &original, NULL);
+    if (restore_ret == ESP_OK)
+        restore_ret = at42qt2120_calibrate(at42qt2120_handle);
+    if (restore_ret == ESP_OK)
+        restore_ret = at42qt2120_wait_ready(at42qt2120_handle, -1);
+    if (ret != ESP_OK)
+        return ret;
+    if (restore_ret != ESP_OK)
+        return restore_ret;
+
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        if ((config->keys & (1 << key)) && (sweep.pulses[0][key].delta_q8 <= 0 || sweep.charges[0][key].delta_q8 <= 0)) {
+            ESP_LOGE(TAG, "No touch delta on key %u", key);
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    memset(result, 0, sizeof(*result));
+    at42qt2120_tune_select(&sweep, &original, result);
+    result->steps = sweep.steps;
+    result->reads = sweep.reads;
+    result->duration_us = at42qt2120_time_us(at42qt2120_handle) - start_us;
+    return ESP_OK;
+}
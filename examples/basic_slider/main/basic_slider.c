@@ -7,10 +7,14 @@
 
 #include "esp_at42qt2120_driver.h"
 #include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_events.h"
+#include "esp_at42qt2120_poll.h"
 
 #define I2C_MASTER_PORT I2C_NUM_0 
 #define I2C_MASTER_SDA_IO 6
 #define I2C_MASTER_SCL_IO 7
+#define AT42QT2120_CHANGE_IO 5
+#define USE_EVENT_MODE 1 // Set to 0 to poll the slider position instead of waiting on the CHANGE line
 #define CONFIG_LOG_MAXIMUM_LEVEL ESP_LOG_VERBOSE
 
 static const char* TAG = "MAIN";
@@ -59,11 +63,35 @@ void app_main(void) {
     ESP_LOGI(TAG, "Calibrating ....");
     at42qt2120_calibrate(&Slider_Handle);
     
-    /* Continuously read for slider position */
-    uint8_t Position = 0;
+#if USE_EVENT_MODE
+    /* Read the slider only when the CHANGE line asserts */
+    at42qt2120_event_config_t event_config = AT42QT2120_EVENT_CONFIG_DEFAULT();
+    at42qt2120_change_line_gpio(AT42QT2120_CHANGE_IO, &event_config.change_line);
+
+    at42qt2120_event_engine_t Event_Engine;
+    at42qt2120_event_engine_init(&Event_Engine, &Slider_Handle, &event_config);
+    at42qt2120_event_engine_start(&Event_Engine);
+
+    at42qt2120_event_t Event;
+    for (;;) {
+        if (at42qt2120_event_engine_receive(&Event_Engine, &Event, -1) != ESP_OK)
+            continue;
+        if (Event.type == AT42QT2120_EVENT_SLIDER_MOVE)
+            ESP_LOGI(TAG, "%d", Event.position);
+        else if (Event.type == AT42QT2120_EVENT_SLIDER_RELEASE)
+            ESP_LOGI(TAG, "Released");
+    }
+#else
+    /* Poll the slider, fast while it is touched and slower while it is idle */
+    at42qt2120_poll_config_t poll_config = AT42QT2120_POLL_CONFIG_DEFAULT();
+    at42qt2120_poll_scheduler_t Poll_Scheduler;
+    at42qt2120_poll_init(&Poll_Scheduler, &Slider_Handle, &poll_config);
+
+    at42qt2120_state_t State;
     for (;;) {
-        at42qt2120_read_slider_position(&Slider_Handle, &Position);
-        ESP_LOGI(TAG, "%d", Position);
-        vTaskDelay(pdMS_TO_TICKS(10));
+        if (at42qt2120_poll_once(&Poll_Scheduler, &State) == ESP_OK && State.slider_detected)
+            ESP_LOGI(TAG, "%d", State.slider_position);
+        vTaskDelay(pdMS_TO_TICKS(Poll_Scheduler.period_ms));
     }
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,1685 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_config.h"
+#include "esp_at42qt2120_signals.h"
+#include "esp_at42qt2120_events.h"
+#include "esp_at42qt2120_manager.h"
+#include "esp_at42qt2120_gesture.h"
+#include "esp_at42qt2120_publish.h"
+#include "esp_at42qt2120_poll.h"
+#include "esp_at42qt2120_drift.h"
+#include "esp_at42qt2120_position.h"
+#include "esp_at42qt2120_profile.h"
+#include "esp_at42qt2120_tune.h"
+#include "esp_at42qt2120_keys.h"
+#include "esp_at42qt2120_sim.h"
+
+#define BENCH_ITERATIONS 100000
+
+static const char* TAG = "HOST_BENCHMARK";
+
+/* A simulated device and the driver handle talking to it */
+typedef struct {
+    at42qt2120_sim_t sim;
+    at42qt2120_handle_t handle;
+} bench_device_t;
+
+/* Scripted trace: key 4 tap, key 7 + key 9 chord, then a slider swipe from 20 to 230 */
+static const at42qt2120_sim_touch_t bench_trace[] = {
+    { .time_us = 300000, .key_mask = 1 << 4, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 420000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 700000, .key_mask = (1 << 7) | (1 << 9), .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 900000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1200000, .key_mask = 0, .slider_position = 20 },
+    { .time_us = 1250000, .key_mask = 0, .slider_position = 90 },
+    { .time_us = 1300000, .key_mask = 0, .slider_position = 160 },
+    { .time_us = 1350000, .key_mask = 0, .slider_position = 230 },
+    { .time_us = 1400000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+};
+#define BENCH_TRACE_END_US 2000000
+
+/* Multi-sensor setup: sensors behind TCA9548A-style muxes, spread over up to six buses */
+#define BENCH_SENSOR_COUNT 48
+#define BENCH_MAX_BUSES 6
+#define BENCH_SCANS 100
+
+/* Slider gestures: tap, double tap, fast swipe down, slow drag back up */
+static const at42qt2120_sim_touch_t bench_slider_gestures[] = {
+    { .time_us = 300000, .key_mask = 0, .slider_position = 60 },
+    { .time_us = 400000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 700000, .key_mask = 0, .slider_position = 180 },
+    { .time_us = 800000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 900000, .key_mask = 0, .slider_position = 182 },
+    { .time_us = 1000000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1300000, .key_mask = 0, .slider_position = 230 },
+    { .time_us = 1350000, .key_mask = 0, .slider_position = 160 },
+    { .time_us = 1400000, .key_mask = 0, .slider_position = 90 },
+    { .time_us = 1450000, .key_mask = 0, .slider_position = 20 },
+    { .time_us = 1500000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1800000, .key_mask = 0, .slider_position = 20 },
+    { .time_us = 2300000, .key_mask = 0, .slider_position = 40 },
+    { .time_us = 2800000, .key_mask = 0, .slider_position = 60 },
+    { .time_us = 3300000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+};
+
+/* Wheel gestures: clockwise across the 255/0 wrap-around, then back */
+static const at42qt2120_sim_touch_t bench_wheel_gestures[] = {
+    { .time_us = 300000, .key_mask = 0, .slider_position = 180 },
+    { .time_us = 350000, .key_mask = 0, .slider_position = 210 },
+    { .time_us = 400000, .key_mask = 0, .slider_position = 240 },
+    { .time_us = 450000, .key_mask = 0, .slider_position = 14 },
+    { .time_us = 500000, .key_mask = 0, .slider_position = 44 },
+    { .time_us = 550000, .key_mask = 0, .slider_position = 74 },
+    { .time_us = 700000, .key_mask = 0, .slider_position = 30 },
+    { .time_us = 800000, .key_mask = 0, .slider_position = 240 },
+    { .time_us = 900000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+};
+#define BENCH_GESTURE_END_US 3500000
+#define BENCH_GESTURE_MAX_SAMPLES (BENCH_GESTURE_END_US / 10000)
+#define BENCH_GESTURE_REPEATS 2000
+
+/* Publication: one writer thread, reader threads on the latest snapshot and one ring consumer */
+#define BENCH_PUBLISH_COUNT 2000000
+#define BENCH_PUBLISH_READERS 2
+#define BENCH_RING_PUBLISH_COUNT 200000
+
+/* Polling without CHANGE: long idle phases around a tap, a swipe, a held key and a quick follow-up tap */
+static const at42qt2120_sim_touch_t bench_poll_trace[] = {
+    { .time_us = 3000000, .key_mask = 1 << 5, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 3150000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 6000000, .key_mask = 0, .slider_position = 20 },
+    { .time_us = 6100000, .key_mask = 0, .slider_position = 70 },
+    { .time_us = 6200000, .key_mask = 0, .slider_position = 120 },
+    { .time_us = 6300000, .key_mask = 0, .slider_position = 170 },
+    { .time_us = 6400000, .key_mask = 0, .slider_position = 220 },
+    { .time_us = 6500000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 9000000, .key_mask = 1 << 8, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 10500000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 10800000, .key_mask = 1 << 8, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 10900000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+};
+#define BENCH_POLL_END_US 15000000
+
+/* Fault injection: random NACKs plus scheduled glitches and brown-outs during 10 ms polling */
+#define BENCH_FAULT_END_US 20000000
+#define BENCH_FAULT_NACK_PER_MILLE 20
+typedef enum {
+    BENCH_FAULT_GLITCH,
+    BENCH_FAULT_BROWN_OUT,
+    BENCH_FAULT_BROWN_OUT_BAD_ID,
+} bench_fault_type_t;
+
+static const struct {
+    int64_t time_us;
+    bench_fault_type_t type;
+    int64_t duration_us;
+} bench_faults[] = {
+    { 3000000, BENCH_FAULT_GLITCH, 20000 },
+    { 6000000, BENCH_FAULT_BROWN_OUT, 0 },
+    { 12000000, BENCH_FAULT_BROWN_OUT_BAD_ID, 0 },
+    { 16000000, BENCH_FAULT_GLITCH, 200000 },
+};
+
+/* Drift scenario: taps every few seconds, one key drifting faster than the default TTD follows, one drifting away, an object resting on a key */
+#define BENCH_DRIFT_END_US 900000000LL
+#define BENCH_DRIFT_POLL_MS 10
+#define BENCH_DRIFT_SAMPLE_MS 250
+#define BENCH_DRIFT_TAP_PERIOD_US 6700000
+#define BENCH_DRIFT_TAP_US 150000
+#define BENCH_DRIFT_TOWARD_KEY 5
+#define BENCH_DRIFT_TOWARD_MC_PER_S 1000
+#define BENCH_DRIFT_TOWARD_END_US 450000000LL
+#define BENCH_DRIFT_AWAY_KEY 10
+#define BENCH_DRIFT_AWAY_MC_PER_S (-600)
+#define BENCH_DRIFT_OBJECT_KEY 8
+#define BENCH_DRIFT_OBJECT_START_US 200000000LL
+#define BENCH_DRIFT_OBJECT_END_US 290000000LL
+#define BENCH_DRIFT_TAPS (BENCH_DRIFT_END_US / BENCH_DRIFT_TAP_PERIOD_US)
+#define BENCH_DRIFT_TIMER_US 30000000
+
+/* Position estimator: finger positions in 1/256 slider units, calibration at rest, a fine sweep, touch-downs and a swipe polled at 1 kHz */
+#define BENCH_POSITION_CALIBRATION_POINTS 16
+#define BENCH_POSITION_SETTLE_US 40000
+#define BENCH_POSITION_SWEEP_STEP 16
+#define BENCH_POSITION_TOUCHES 50
+#define BENCH_POSITION_POLL_US 1000
+#define BENCH_POSITION_SWIPE_US 300000
+
+typedef struct {
+    at42qt2120_publisher_t* publisher;
+    volatile bool* done;
+    unsigned long reads;
+    unsigned long torn;
+} bench_reader_t;
+
+typedef struct {
+    at42qt2120_publisher_t* publisher;
+    volatile bool* done;
+    unsigned long popped;
+    unsigned long out_of_order;
+} bench_consumer_t;
+
+static double host_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void bench_device_init(bench_device_t* device) {
+    at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+    at42qt2120_sim_init(&device->sim, &sim_config);
+
+    at42qt2120_transport_t transport;
+    at42qt2120_sim_transport(&device->sim, &transport);
+    ESP_ERROR_CHECK(at42qt2120_init_with_transport(&device->handle, &transport, 100));
+
+    /* Let the power-on calibration finish */
+    at42qt2120_sim_advance(&device->sim, 200000);
+}
+
+/* Bus cost of one full status poll: four single-register reads against one burst */
+static void bench_status_poll(void) {
+    bench_device_t device;
+    bench_device_init(&device);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    printf("\n== Status poll (detection, key status, slider) ==\n");
+
+    at42qt2120_bus_stats_t stats;
+    int64_t bus_time_us = device.sim.stats.bus_time_us;
+    uint8_t value;
+    at42qt2120_reset_bus_stats(handle);
+    at42qt2120_register_read(handle, AT42QT2120_REG_DETECTION_STATUS, &value, 1);
+    at42qt2120_register_read(handle, AT42QT2120_REG_KEY_STATUS_07_00, &value, 1);
+    at42qt2120_register_read(handle, AT42QT2120_REG_KEY_STATUS_11_08, &value, 1);
+    at42qt2120_register_read(handle, AT42QT2120_REG_SLIDER_POSITION, &value, 1);
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("single registers     : %2lu transactions, %3lu bytes, %4lld us bus time\n",
+           (unsigned long)stats.transactions, (unsigned long)stats.bytes, (long long)(device.sim.stats.bus_time_us - bus_time_us));
+
+    at42qt2120_state_t state;
+    bus_time_us = device.sim.stats.bus_time_us;
+    at42qt2120_reset_bus_stats(handle);
+    at42qt2120_read_state(handle, &state);
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("at42qt2120_read_state: %2lu transactions, %3lu bytes, %4lld us bus time\n",
+           (unsigned long)stats.transactions, (unsigned long)stats.bytes, (long long)(device.sim.stats.bus_time_us - bus_time_us));
+
+    double start_ns = host_time_ns();
+    for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++)
+        at42qt2120_read_state(handle, &state);
+    printf("at42qt2120_read_state: %.1f ns host CPU per call (simulated transport)\n", (host_time_ns() - start_ns) / BENCH_ITERATIONS);
+}
+
+/* Boot-time configuration: one write per register against the shadow's burst plan */
+static void bench_config_plan(void) {
+    bench_device_t device;
+    bench_device_init(&device);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    printf("\n== Boot configuration ==\n");
+
+    at42qt2120_config_t config;
+    at42qt2120_config_default(&config);
+    config.slider_options = AT42QT2120_SLIDER_OPTIONS_EN;
+    config.charge_time = 1;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        config.key_dthr[key] = 18;
+        config.key_pulse_scale[key] = 0x21;
+    }
+
+    at42qt2120_bus_stats_t stats;
+    at42qt2120_reset_bus_stats(handle);
+    const uint8_t* raw = (const uint8_t*)&config;
+    for (uint8_t index = 0; index < AT42QT2120_CONFIG_REG_COUNT; index++) {
+        uint8_t value = raw[index];
+        at42qt2120_register_write(handle, AT42QT2120_REG_CONFIG_FIRST + index, &value, 1);
+    }
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("single register writes: %2lu transactions, %3lu bytes\n", (unsigned long)stats.transactions, (unsigned long)stats.bytes);
+
+    /* Start again from power-on defaults so the plan has the same work to do */
+    at42qt2120_reset(handle);
+    at42qt2120_write_plan_t plan;
+    at42qt2120_reset_bus_stats(handle);
+    ESP_ERROR_CHECK(at42qt2120_apply_config(handle, &config, &plan));
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("at42qt2120_apply_config: %2lu transactions, %3lu bytes (including one verify read)\n",
+           (unsigned long)stats.transactions, (unsigned long)stats.bytes);
+    for (uint8_t burst = 0; burst < plan.burst_count; burst++)
+        printf("  burst %u: 0x%02X-0x%02X (%u bytes)\n", burst, plan.bursts[burst].reg,
+               plan.bursts[burst].reg + plan.bursts[burst].length - 1, plan.bursts[burst].length);
+
+    at42qt2120_reset_bus_stats(handle);
+    ESP_ERROR_CHECK(at42qt2120_apply_config(handle, &config, &plan));
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("re-apply unchanged     : %2lu transactions, %u bursts\n", (unsigned long)stats.transactions, plan.burst_count);
+}
+
+/* Raw data acquisition: 48 single-byte reads against one burst */
+static void bench_signals(void) {
+    bench_device_t device;
+    bench_device_init(&device);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    printf("\n== Signals and references ==\n");
+
+    at42qt2120_bus_stats_t stats;
+    uint8_t raw[AT42QT2120_SIGNAL_BLOCK_SIZE + AT42QT2120_REFERENCE_BLOCK_SIZE];
+    at42qt2120_reset_bus_stats(handle);
+    for (uint8_t index = 0; index < sizeof(raw); index++)
+        at42qt2120_register_read(handle, AT42QT2120_REG_KEY_00_MSB_SIGNAL + index, &raw[index], 1);
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("single registers                  : %2lu transactions, %4lu bytes\n", (unsigned long)stats.transactions, (unsigned long)stats.bytes);
+
+    uint16_t signals[AT42QT2120_NUM_KEYS], references[AT42QT2120_NUM_KEYS];
+    int16_t deltas[AT42QT2120_NUM_KEYS];
+    at42qt2120_reset_bus_stats(handle);
+    at42qt2120_read_signals_references(handle, signals, references, deltas);
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("at42qt2120_read_signals_references: %2lu transactions, %4lu bytes\n", (unsigned long)stats.transactions, (unsigned long)stats.bytes);
+    printf("key 0: signal %u, reference %u, delta %d\n", signals[0], references[0], deltas[0]);
+}
+
+static void bench_ready(at42qt2120_handle_t* at42qt2120_handle, esp_err_t result, void* user_ctx) {
+    (void)at42qt2120_handle;
+    *(esp_err_t*)user_ctx = result;
+}
+
+/* Reset and calibration: fixed 500 ms delay against completion detection */
+static void bench_reset_calibrate(void) {
+    bench_device_t device;
+    bench_device_init(&device);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    printf("\n== Reset and calibration ==\n");
+    printf("fixed delay          : 500000 us until the application may continue\n");
+
+    at42qt2120_bus_stats_t stats;
+    at42qt2120_reset_bus_stats(handle);
+    int64_t start_us = device.sim.now_us;
+    ESP_ERROR_CHECK(at42qt2120_reset(handle));
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("at42qt2120_reset     : %6lld us, %2lu transactions (%lu NACKed)\n", (long long)(device.sim.now_us - start_us),
+           (unsigned long)stats.transactions, (unsigned long)device.sim.stats.nacks);
+
+    at42qt2120_reset_bus_stats(handle);
+    start_us = device.sim.now_us;
+    ESP_ERROR_CHECK(at42qt2120_calibrate(handle));
+    ESP_ERROR_CHECK(at42qt2120_wait_ready(handle, 1000));
+    at42qt2120_get_bus_stats(handle, &stats);
+    printf("at42qt2120_calibrate : %6lld us, %2lu transactions\n", (long long)(device.sim.now_us - start_us), (unsigned long)stats.transactions);
+
+    /* Non-blocking: the application keeps running in 1 ms steps and only polls */
+    esp_err_t result = ESP_ERR_NOT_FINISHED;
+    unsigned busy_steps = 0;
+    start_us = device.sim.now_us;
+    ESP_ERROR_CHECK(at42qt2120_calibrate_async(handle, bench_ready, &result));
+    while (result == ESP_ERR_NOT_FINISHED) {
+        at42qt2120_sim_advance(&device.sim, 1000);
+        at42qt2120_poll_ready(handle);
+        busy_steps++;
+    }
+    printf("calibrate_async      : %6lld us, callback %s after %u application steps\n", (long long)(device.sim.now_us - start_us),
+           esp_err_to_name(result), busy_steps);
+}
+
+/* Scan of many sensors: latency against the number of buses they are spread over */
+static void bench_manager(void) {
+    static at42qt2120_sim_t sims[BENCH_SENSOR_COUNT];
+    static at42qt2120_sim_bus_t buses[BENCH_MAX_BUSES];
+    static at42qt2120_manager_t manager;
+    static const int bus_counts[] = { 1, 2, 3, 6 };
+
+    printf("\n== Multi-sensor scan, %d sensors behind 8-channel muxes ==\n", BENCH_SENSOR_COUNT);
+
+    for (size_t config = 0; config < sizeof(bus_counts) / sizeof(bus_counts[0]); config++) {
+        int bus_count = bus_counts[config];
+        at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+        ESP_ERROR_CHECK(at42qt2120_manager_init(&manager, 100));
+        for (int bus = 0; bus < bus_count; bus++)
+            at42qt2120_sim_bus_init(&buses[bus], sim_config.scl_speed_hz);
+
+        /* Sensors are added round-robin over the buses, as they would be wired across a panel */
+        uint8_t mux_index[BENCH_MAX_BUSES][AT42QT2120_SIM_BUS_MAX_MUXES];
+        for (int sensor = 0; sensor < BENCH_SENSOR_COUNT; sensor++) {
+            int bus = sensor % bus_count;
+            int slot = sensor / bus_count;
+            int mux = slot / AT42QT2120_MUX_NUM_CHANNELS;
+            if (slot % AT42QT2120_MUX_NUM_CHANNELS == 0) {
+                at42qt2120_mux_t mux_backend;
+                ESP_ERROR_CHECK(at42qt2120_sim_bus_add_mux(&buses[bus], &mux_backend));
+                ESP_ERROR_CHECK(at42qt2120_manager_add_mux(&manager, bus, &mux_backend, &mux_index[bus][mux]));
+            }
+
+            at42qt2120_sim_init(&sims[sensor], &sim_config);
+            at42qt2120_transport_t transport;
+            ESP_ERROR_CHECK(at42qt2120_sim_bus_add_device(&buses[bus], &sims[sensor], mux, slot % AT42QT2120_MUX_NUM_CHANNELS, &transport));
+
+            at42qt2120_sensor_location_t location = {
+                .bus = bus,
+                .mux = mux_index[bus][mux],
+                .channel = slot % AT42QT2120_MUX_NUM_CHANNELS,
+            };
+            ESP_ERROR_CHECK(at42qt2120_manager_add_sensor(&manager, &location, &transport, 100, NULL));
+        }
+        for (int bus = 0; bus < bus_count; bus++)
+            at42qt2120_sim_bus_advance(&buses[bus], 200000);
+
+        /* Touch one key per sensor so every state is distinguishable */
+        for (int sensor = 0; sensor < BENCH_SENSOR_COUNT; sensor++)
+            at42qt2120_sim_set_touch(&sims[sensor], 1 << (sensor % AT42QT2120_NUM_KEYS), AT42QT2120_SIM_NO_SLIDER_TOUCH);
+        for (int bus = 0; bus < bus_count; bus++)
+            at42qt2120_sim_bus_advance(&buses[bus], 100000);
+
+        uint32_t setup_mux_writes = 0;
+        for (int bus = 0; bus < bus_count; bus++)
+            setup_mux_writes += buses[bus].mux_writes;
+
+        int64_t worst_us = 0;
+        for (int scan = 0; scan < BENCH_SCANS; scan++) {
+            ESP_ERROR_CHECK(at42qt2120_manager_scan(&manager));
+            if (at42qt2120_manager_scan_latency_us(&manager) > worst_us)
+                worst_us = at42qt2120_manager_scan_latency_us(&manager);
+        }
+
+        /* Every sensor must report its own touch, i.e. no transaction reached a neighbour */
+        int wrong_states = 0;
+        for (int sensor = 0; sensor < BENCH_SENSOR_COUNT; sensor++)
+            wrong_states += manager.sensors[sensor].state.key_mask != (1 << (sensor % AT42QT2120_NUM_KEYS));
+
+        uint32_t mux_writes = 0, misrouted = 0;
+        for (int bus = 0; bus < bus_count; bus++) {
+            mux_writes += buses[bus].mux_writes;
+            misrouted += buses[bus].misrouted + buses[bus].collisions;
+        }
+        printf("%d bus%s: scan latency %5lld us, %4.1f mux writes per scan, %d wrong states, %lu misrouted\n", bus_count, bus_count > 1 ? "es" : "  ",
+               (long long)worst_us, (double)(mux_writes - setup_mux_writes) / BENCH_SCANS, wrong_states, (unsigned long)misrouted);
+        at42qt2120_manager_deinit(&manager);
+    }
+}
+
+static void bench_print_gesture(const at42qt2120_gesture_event_t* event, void* user_ctx) {
+    static const char* names[] = { "tap", "double tap", "swipe", "rotate" };
+    if (user_ctx != NULL)
+        return;
+
+    printf("  %7lld us %-10s position %4ld, delta %4ld, velocity %5ld/s, duration %6lu us\n", (long long)event->time_us, names[event->type],
+           (long)event->position, (long)event->delta, (long)event->velocity, (unsigned long)event->duration_us);
+}
+
+/* Records a 10 ms poll of the simulated slider/wheel, as an application would */
+static size_t bench_record_gestures(const at42qt2120_sim_touch_t* trace, size_t trace_length, bool wheel, at42qt2120_gesture_sample_t* samples) {
+    bench_device_t device;
+    bench_device_init(&device);
+    if (wheel)
+        at42qt2120_enable_wheel(&device.handle);
+    else
+        at42qt2120_enable_slider(&device.handle);
+    at42qt2120_sim_set_trace(&device.sim, trace, trace_length);
+
+    size_t sample_count = 0;
+    while (device.sim.now_us < BENCH_GESTURE_END_US && sample_count < BENCH_GESTURE_MAX_SAMPLES) {
+        at42qt2120_sim_advance(&device.sim, 10000);
+        at42qt2120_state_t state;
+        if (at42qt2120_read_state(&device.handle, &state) != ESP_OK)
+            continue;
+
+        samples[sample_count].time_us = at42qt2120_time_us(&device.handle);
+        samples[sample_count].touched = state.slider_detected;
+        samples[sample_count].position = state.slider_position;
+        sample_count++;
+    }
+
+    return sample_count;
+}
+
+/* Gesture recognition on recorded slider and wheel traces */
+static void bench_gestures(void) {
+    static at42qt2120_gesture_sample_t samples[BENCH_GESTURE_MAX_SAMPLES];
+
+    for (int wheel = 0; wheel <= 1; wheel++) {
+        size_t sample_count = wheel ? bench_record_gestures(bench_wheel_gestures, sizeof(bench_wheel_gestures) / sizeof(bench_wheel_gestures[0]), true, samples)
+                                    : bench_record_gestures(bench_slider_gestures, sizeof(bench_slider_gestures) / sizeof(bench_slider_gestures[0]), false, samples);
+        printf("\n== %s gestures, %zu samples recorded at 10 ms ==\n", wheel ? "Wheel" : "Slider", sample_count);
+
+        at42qt2120_gesture_config_t config = AT42QT2120_GESTURE_CONFIG_DEFAULT();
+        config.wheel = wheel;
+        config.rotate_step = 32;
+        config.callback = bench_print_gesture;
+        at42qt2120_gesture_engine_t engine;
+        ESP_ERROR_CHECK(at42qt2120_gesture_init(&engine, &config));
+        at42qt2120_gesture_feed_samples(&engine, samples, sample_count);
+
+        /* Same trace again without printing, to time the engine alone */
+        config.user_ctx = &engine;
+        ESP_ERROR_CHECK(at42qt2120_gesture_init(&engine, &config));
+        double start_ns = host_time_ns();
+        for (int repeat = 0; repeat < BENCH_GESTURE_REPEATS; repeat++)
+            at42qt2120_gesture_feed_samples(&engine, samples, sample_count);
+        printf("gesture engine: %.1f ns per sample\n", (host_time_ns() - start_ns) / ((double)BENCH_GESTURE_REPEATS * sample_count));
+    }
+}
+
+/* Synthetic states whose fields all derive from the publication number, so a torn copy is detectable */
+static void bench_publish_state(uint32_t count, at42qt2120_state_t* state) {
+    uint8_t raw[AT42QT2120_STATE_REG_COUNT] = { (count / 4) & 1 ? AT42QT2120_DETECTION_STATUS_TDET : 0, (count / 4) & 0xFF, (count / 1024) & 0x0F, (count / 4) & 0xFF };
+    at42qt2120_decode_state(raw, state);
+}
+
+static bool bench_snapshot_consistent(const at42qt2120_snapshot_t* snapshot) {
+    at42qt2120_state_t expected;
+    bench_publish_state(snapshot->sequence, &expected);
+    return snapshot->time_us == (int64_t)snapshot->sequence * 10 && snapshot->state.key_mask == expected.key_mask &&
+           snapshot->state.slider_position == expected.slider_position && snapshot->state.detection_status == expected.detection_status;
+}
+
+static void* bench_reader(void* arg) {
+    bench_reader_t* reader = (bench_reader_t*)arg;
+    at42qt2120_snapshot_t snapshot;
+    while (!*reader->done) {
+        if (at42qt2120_publisher_get_latest(reader->publisher, &snapshot) != ESP_OK)
+            continue;
+        reader->reads++;
+        reader->torn += !bench_snapshot_consistent(&snapshot);
+    }
+    return NULL;
+}
+
+static void* bench_consumer(void* arg) {
+    bench_consumer_t* consumer = (bench_consumer_t*)arg;
+    at42qt2120_snapshot_t snapshot;
+    uint32_t previous = 0;
+    while (true) {
+        bool done = *consumer->done;
+        while (at42qt2120_publisher_ring_pop(consumer->publisher, &snapshot) == ESP_OK) {
+            consumer->popped++;
+            consumer->out_of_order += snapshot.sequence <= previous || !bench_snapshot_consistent(&snapshot);
+            previous = snapshot.sequence;
+        }
+        if (done)
+            break;
+    }
+    return NULL;
+}
+
+static void bench_publisher(void) {
+    static at42qt2120_publisher_t publisher;
+    bench_device_t device;
+    bench_device_init(&device);
+    ESP_ERROR_CHECK(at42qt2120_publisher_init(&publisher, &device.handle));
+
+    printf("\n== Latest-state publication ==\n");
+
+    /* Single thread: reader cost against a bus read */
+    at42qt2120_bus_stats_t stats;
+    int64_t bus_time_us = device.sim.stats.bus_time_us;
+    at42qt2120_reset_bus_stats(&device.handle);
+    ESP_ERROR_CHECK(at42qt2120_publisher_acquire(&publisher));
+    at42qt2120_get_bus_stats(&device.handle, &stats);
+    printf("acquisition         : %lu transaction, %lld us bus time per state\n", (unsigned long)stats.transactions,
+           (long long)(device.sim.stats.bus_time_us - bus_time_us));
+
+    at42qt2120_snapshot_t snapshot;
+    at42qt2120_reset_bus_stats(&device.handle);
+    double start_ns = host_time_ns();
+    for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++)
+        at42qt2120_publisher_get_latest(&publisher, &snapshot);
+    at42qt2120_get_bus_stats(&device.handle, &stats);
+    printf("get_latest          : %.1f ns per call, %lu bus transactions\n", (host_time_ns() - start_ns) / BENCH_ITERATIONS, (unsigned long)stats.transactions);
+
+    /* Stress: the writer publishes back to back while reader threads copy the latest snapshot */
+    ESP_ERROR_CHECK(at42qt2120_publisher_init(&publisher, &device.handle));
+    volatile bool done = false;
+    bench_reader_t readers[BENCH_PUBLISH_READERS];
+    pthread_t reader_threads[BENCH_PUBLISH_READERS];
+    for (int index = 0; index < BENCH_PUBLISH_READERS; index++) {
+        readers[index] = (bench_reader_t){ .publisher = &publisher, .done = &done };
+        pthread_create(&reader_threads[index], NULL, bench_reader, &readers[index]);
+    }
+
+    start_ns = host_time_ns();
+    for (uint32_t count = 1; count <= BENCH_PUBLISH_COUNT; count++) {
+        at42qt2120_state_t state;
+        bench_publish_state(count, &state);
+        at42qt2120_publisher_publish(&publisher, &state, (int64_t)count * 10);
+    }
+    double publish_ns = (host_time_ns() - start_ns) / BENCH_PUBLISH_COUNT;
+
+    done = true;
+    unsigned long reads = 0, torn = 0;
+    for (int index = 0; index < BENCH_PUBLISH_READERS; index++) {
+        pthread_join(reader_threads[index], NULL);
+        reads += readers[index].reads;
+        torn += readers[index].torn;
+    }
+    printf("publish             : %.1f ns per state with %d reader threads running\n", publish_ns, BENCH_PUBLISH_READERS);
+    printf("readers             : %lu snapshots read, %lu torn\n", reads, torn);
+
+    /* Transitions: the writer pauses like an acquisition task between reads, a consumer thread drains the ring */
+    ESP_ERROR_CHECK(at42qt2120_publisher_init(&publisher, &device.handle));
+    done = false;
+    pthread_t consumer_thread;
+    bench_consumer_t consumer = { .publisher = &publisher, .done = &done };
+    pthread_create(&consumer_thread, NULL, bench_consumer, &consumer);
+    for (uint32_t count = 1; count <= BENCH_RING_PUBLISH_COUNT; count++) {
+        at42qt2120_state_t state;
+        bench_publish_state(count, &state);
+        at42qt2120_publisher_publish(&publisher, &state, (int64_t)count * 10);
+        if (count % (AT42QT2120_SNAPSHOT_RING_SIZE * 2) == 0)
+            nanosleep(&(struct timespec){ .tv_nsec = 100000 }, NULL);
+    }
+    done = true;
+    pthread_join(consumer_thread, NULL);
+    /* The first publication and every fourth one change the state */
+    printf("transition ring     : %lu of %u transitions popped, %lu overruns, %lu out of order\n", consumer.popped,
+           BENCH_RING_PUBLISH_COUNT / 4 + 1, (unsigned long)publisher.ring_overruns, consumer.out_of_order);
+    at42qt2120_publisher_deinit(&publisher);
+}
+
+/* Public API calls measured by the instrumentation section */
+static at42qt2120_config_t bench_api_config;
+
+static esp_err_t bench_api_read_state(at42qt2120_handle_t* handle) {
+    at42qt2120_state_t state;
+    return at42qt2120_read_state(handle, &state);
+}
+
+static esp_err_t bench_api_read_key_status(at42qt2120_handle_t* handle) {
+    uint16_t key_mask;
+    return at42qt2120_read_key_status(handle, &key_mask);
+}
+
+static esp_err_t bench_api_read_signals_references(at42qt2120_handle_t* handle) {
+    uint16_t signals[AT42QT2120_NUM_KEYS], references[AT42QT2120_NUM_KEYS];
+    return at42qt2120_read_signals_references(handle, signals, references, NULL);
+}
+
+static esp_err_t bench_api_apply_config(at42qt2120_handle_t* handle) {
+    return at42qt2120_apply_config(handle, &bench_api_config, NULL);
+}
+
+static esp_err_t bench_api_get_config(at42qt2120_handle_t* handle) {
+    at42qt2120_config_t config;
+    return at42qt2120_get_config(handle, &config);
+}
+
+static esp_err_t bench_api_calibrate(at42qt2120_handle_t* handle) {
+    ESP_RETURN_ON_ERROR(at42qt2120_calibrate(handle), TAG, "calibrate failed");
+    return at42qt2120_wait_ready(handle, -1);
+}
+
+static const struct {
+    const char* name;
+    esp_err_t (*call)(at42qt2120_handle_t* handle);
+} bench_api_calls[] = {
+    { "read_state", bench_api_read_state },
+    { "read_key_status", bench_api_read_key_status },
+    { "read_signals_references", bench_api_read_signals_references },
+    { "enable_wheel", at42qt2120_enable_wheel },
+    { "apply_config", bench_api_apply_config },
+    { "get_config", bench_api_get_config },
+    { "calibrate + wait_ready", bench_api_calibrate },
+    { "reset", at42qt2120_reset },
+};
+
+/* Per-call transaction counts, errors and latency histogram (simulated bus time in us) */
+static void bench_instrumentation(void) {
+    bench_device_t device;
+    bench_device_init(&device);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    printf("\n== Instrumentation per API call (latency in simulated us) ==\n");
+
+    at42qt2120_instrumentation_t instrumentation;
+    if (at42qt2120_get_instrumentation(handle, &instrumentation) == ESP_ERR_NOT_SUPPORTED) {
+        printf("compiled out (AT42QT2120_INSTRUMENTATION=0)\n");
+        return;
+    }
+
+    at42qt2120_config_default(&bench_api_config);
+    bench_api_config.charge_time = 2;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        bench_api_config.key_dthr[key] = 14;
+
+    printf("%-24s %5s %5s %6s %6s %6s %6s  %s\n", "call", "reads", "writes", "bytes", "errors", "mean", "max", "histogram [<2^n us]:count");
+    for (size_t index = 0; index < sizeof(bench_api_calls) / sizeof(bench_api_calls[0]); index++) {
+        ESP_ERROR_CHECK(at42qt2120_reset_instrumentation(handle));
+        bench_api_calls[index].call(handle);
+        ESP_ERROR_CHECK(at42qt2120_get_instrumentation(handle, &instrumentation));
+
+        const at42qt2120_transfer_stats_t* read = &instrumentation.read;
+        const at42qt2120_transfer_stats_t* write = &instrumentation.write;
+        uint32_t transactions = read->transactions + write->transactions;
+        uint64_t total = read->latency_total + write->latency_total;
+        printf("%-24s %5lu %6lu %6lu %6lu %6llu %6lu ", bench_api_calls[index].name, (unsigned long)read->transactions, (unsigned long)write->transactions,
+               (unsigned long)(read->bytes + write->bytes), (unsigned long)(read->errors + write->errors),
+               (unsigned long long)(transactions > 0 ? total / transactions : 0),
+               (unsigned long)(read->latency_max > write->latency_max ? read->latency_max : write->latency_max));
+        for (int bucket = 0; bucket < AT42QT2120_LATENCY_BUCKETS; bucket++) {
+            uint32_t count = read->latency_histogram[bucket] + write->latency_histogram[bucket];
+            if (count > 0)
+                printf(" [%d]:%lu", bucket, (unsigned long)count);
+        }
+        for (int slot = 0; slot < AT42QT2120_ERROR_CODE_SLOTS && instrumentation.errors[slot].count > 0; slot++)
+            printf("  %s x%lu", esp_err_to_name(instrumentation.errors[slot].code), (unsigned long)instrumentation.errors[slot].count);
+        printf("\n");
+    }
+}
+
+static void bench_count_event(const at42qt2120_event_t* event, void* user_ctx) {
+    (void)event;
+    (*(unsigned*)user_ctx)++;
+}
+
+/* Event delivery over the scripted trace: 10 ms polling against the CHANGE line */
+static void bench_event_engine(void) {
+    printf("\n== Event delivery over a %d ms touch trace ==\n", BENCH_TRACE_END_US / 1000);
+
+    for (int change_driven = 0; change_driven <= 1; change_driven++) {
+        bench_device_t device;
+        bench_device_init(&device);
+        at42qt2120_enable_slider(&device.handle);
+        at42qt2120_sim_set_trace(&device.sim, bench_trace, sizeof(bench_trace) / sizeof(bench_trace[0]));
+
+        unsigned event_count = 0;
+        at42qt2120_event_config_t event_config = AT42QT2120_EVENT_CONFIG_DEFAULT();
+        event_config.callback = bench_count_event;
+        event_config.user_ctx = &event_count;
+
+        at42qt2120_event_engine_t engine;
+        at42qt2120_event_engine_init(&engine, &device.handle, &event_config);
+
+        at42qt2120_reset_bus_stats(&device.handle);
+        int64_t step_us = change_driven ? 100 : 10000;
+        while (device.sim.now_us < BENCH_TRACE_END_US) {
+            at42qt2120_sim_advance(&device.sim, step_us);
+            if (!change_driven || at42qt2120_sim_change_asserted(&device.sim))
+                at42qt2120_event_engine_service(&engine);
+        }
+
+        at42qt2120_bus_stats_t stats;
+        at42qt2120_get_bus_stats(&device.handle, &stats);
+        printf("%-13s: %3u events, %3lu transactions, %5lu bytes\n", change_driven ? "CHANGE line" : "10 ms polling",
+               event_count, (unsigned long)stats.transactions, (unsigned long)stats.bytes);
+        at42qt2120_event_engine_deinit(&engine);
+    }
+}
+
+static inline bool bench_touch_active(const at42qt2120_sim_touch_t* touch) {
+    return touch->key_mask != 0 || touch->slider_position != AT42QT2120_SIM_NO_SLIDER_TOUCH;
+}
+
+/* Fixed against adaptive polling over the poll trace: bus utilization, device measurements and response latency */
+static void bench_poll_scheduler(void) {
+    printf("\n== Polling without CHANGE over a %d s touch trace ==\n", BENCH_POLL_END_US / 1000000);
+    printf("%-26s %6s %9s %12s %9s %15s %12s %7s\n", "schedule", "polls", "bus util", "measurements", "LP writes", "press max/mean", "release max", "missed");
+
+    static const struct {
+        const char* name;
+        uint32_t min_period_ms;
+        uint32_t max_period_ms;
+        bool track_low_power;
+    } schedules[] = {
+        { "fixed 10 ms", 10, 10, false },
+        { "adaptive 16-64 ms", 16, 64, false },
+        { "adaptive 16-64 ms + LP", 16, 64, true },
+        { "adaptive 16-256 ms + LP", 16, 256, true },
+    };
+    const size_t trace_length = sizeof(bench_poll_trace) / sizeof(bench_poll_trace[0]);
+
+    for (size_t index = 0; index < sizeof(schedules) / sizeof(schedules[0]); index++) {
+        bench_device_t device;
+        bench_device_init(&device);
+        at42qt2120_enable_slider(&device.handle);
+        at42qt2120_sim_set_trace(&device.sim, bench_poll_trace, trace_length);
+
+        at42qt2120_poll_config_t poll_config = AT42QT2120_POLL_CONFIG_DEFAULT();
+        poll_config.min_period_ms = schedules[index].min_period_ms;
+        poll_config.max_period_ms = schedules[index].max_period_ms;
+        poll_config.track_low_power = schedules[index].track_low_power;
+
+        at42qt2120_poll_scheduler_t scheduler;
+        ESP_ERROR_CHECK(at42qt2120_poll_init(&scheduler, &device.handle, &poll_config));
+
+        int64_t start_us = device.sim.now_us;
+        int64_t bus_time_us = device.sim.stats.bus_time_us;
+        uint32_t measurements = device.sim.measurements;
+
+        /* Each press and release in the trace is answered by the first poll that reports it */
+        size_t next_step = 0;
+        bool expected = false;
+        int64_t change_us = 0, press_max_us = 0, press_total_us = 0, release_max_us = 0;
+        unsigned presses = 0, missed_touches = 0;
+        bool reported = false;
+        at42qt2120_state_t state;
+        while (device.sim.now_us < BENCH_POLL_END_US) {
+            if (at42qt2120_poll_once(&scheduler, &state) == ESP_OK) {
+                int64_t now_us = device.sim.now_us;
+                while (next_step < trace_length && bench_poll_trace[next_step].time_us <= now_us) {
+                    bool active = bench_touch_active(&bench_poll_trace[next_step]);
+                    if (active != expected) {
+                        /* A touch over before any poll saw it is lost, and so is its release */
+                        bool missed = !reported && change_us != 0;
+                        missed_touches += missed && expected;
+                        expected = active;
+                        change_us = bench_poll_trace[next_step].time_us;
+                        reported = missed;
+                    }
+                    next_step++;
+                }
+
+                bool touched = state.touch_detected || state.slider_detected;
+                if (!reported && change_us != 0 && touched == expected) {
+                    int64_t latency_us = now_us - change_us;
+                    reported = true;
+                    if (expected) {
+                        presses++;
+                        press_total_us += latency_us;
+                        press_max_us = latency_us > press_max_us ? latency_us : press_max_us;
+                    } else {
+                        release_max_us = latency_us > release_max_us ? latency_us : release_max_us;
+                    }
+                }
+            }
+            at42qt2120_delay_ms(&device.handle, scheduler.period_ms);
+        }
+
+        int64_t elapsed_us = device.sim.now_us - start_us;
+        printf("%-26s %6lu %8.3f%% %12lu %9lu %7lld/%3lld ms %9lld ms %7u\n", schedules[index].name, (unsigned long)scheduler.polls,
+               100.0 * (double)(device.sim.stats.bus_time_us - bus_time_us) / (double)elapsed_us,
+               (unsigned long)(device.sim.measurements - measurements), (unsigned long)scheduler.low_power_writes,
+               (long long)(press_max_us / 1000), (long long)(presses > 0 ? press_total_us / presses / 1000 : 0), (long long)(release_max_us / 1000), missed_touches);
+        at42qt2120_poll_deinit(&scheduler);
+    }
+}
+
+static const char* bench_error_op_name(at42qt2120_error_op_t op) {
+    switch (op) {
+    case AT42QT2120_ERROR_OP_READ: return "read";
+    case AT42QT2120_ERROR_OP_WRITE: return "write";
+    case AT42QT2120_ERROR_OP_PROBE: return "probe";
+    case AT42QT2120_ERROR_OP_CHIP_ID: return "chip id";
+    case AT42QT2120_ERROR_OP_REAPPLY: return "re-apply";
+    case AT42QT2120_ERROR_OP_VERIFY: return "verify";
+    case AT42QT2120_ERROR_OP_READY_TIMEOUT: return "timeout";
+    }
+    return "?";
+}
+
+/* Polling through random NACKs, glitches and brown-outs with and without the recovery layer */
+static void bench_recovery(void) {
+    printf("\n== Fault injection over %d s of 10 ms polling (%d.%d%% random NACKs, 2 glitches, 2 brown-outs) ==\n",
+           BENCH_FAULT_END_US / 1000000, BENCH_FAULT_NACK_PER_MILLE / 10, BENCH_FAULT_NACK_PER_MILLE % 10);
+    printf("%-9s %6s %7s %12s %13s %11s %8s %10s %8s %11s\n", "recovery", "polls", "failed", "longest read", "longest step", "longest gap", "retries",
+           "recoveries", "re-apply", "config kept");
+
+    at42qt2120_config_t config;
+    at42qt2120_config_default(&config);
+    config.slider_options = AT42QT2120_SLIDER_OPTIONS_EN;
+    config.charge_time = 2;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        config.key_dthr[key] = 14;
+
+    for (int enabled = 0; enabled <= 1; enabled++) {
+        bench_device_t device;
+        bench_device_init(&device);
+        at42qt2120_handle_t* handle = &device.handle;
+        ESP_ERROR_CHECK(at42qt2120_apply_config(handle, &config, NULL));
+
+        at42qt2120_recovery_config_t recovery_config = AT42QT2120_RECOVERY_CONFIG_DEFAULT();
+        if (!enabled) {
+            recovery_config.max_retries = 0;
+            recovery_config.auto_recover = false;
+        }
+        ESP_ERROR_CHECK(at42qt2120_set_recovery_config(handle, &recovery_config));
+
+        at42qt2120_sim_faults_t faults = { .nack_per_mille = BENCH_FAULT_NACK_PER_MILLE, .seed = 42 };
+        at42qt2120_sim_set_faults(&device.sim, &faults);
+
+        size_t next_fault = 0;
+        unsigned polls = 0, failed = 0;
+        int64_t longest_call_us = 0, longest_step_us = 0, longest_gap_us = 0, last_success_us = device.sim.now_us;
+        at42qt2120_state_t state;
+        while (device.sim.now_us < BENCH_FAULT_END_US) {
+            if (next_fault < sizeof(bench_faults) / sizeof(bench_faults[0]) && device.sim.now_us >= bench_faults[next_fault].time_us) {
+                if (bench_faults[next_fault].type == BENCH_FAULT_GLITCH)
+                    at42qt2120_sim_glitch(&device.sim, bench_faults[next_fault].duration_us);
+                else
+                    at42qt2120_sim_brown_out(&device.sim, bench_faults[next_fault].type == BENCH_FAULT_BROWN_OUT_BAD_ID);
+                next_fault++;
+            }
+
+            int64_t start_us = device.sim.now_us;
+            esp_err_t ret = at42qt2120_read_state(handle, &state);
+            int64_t end_us = device.sim.now_us;
+            polls++;
+            longest_call_us = end_us - start_us > longest_call_us ? end_us - start_us : longest_call_us;
+            if (ret == ESP_OK) {
+                longest_gap_us = end_us - last_success_us > longest_gap_us ? end_us - last_success_us : longest_gap_us;
+                last_success_us = end_us;
+            } else {
+                failed++;
+            }
+
+            /* The recovery runs after the state was handled, never inside the read */
+            start_us = device.sim.now_us;
+            at42qt2120_recover_poll(handle);
+            longest_step_us = device.sim.now_us - start_us > longest_step_us ? device.sim.now_us - start_us : longest_step_us;
+            at42qt2120_delay_ms(handle, 10);
+        }
+
+        /* The device must end up with the configuration that was applied before the faults */
+        bool config_kept = memcmp(&device.sim.regs[AT42QT2120_REG_CONFIG_FIRST], &config, sizeof(config)) == 0;
+
+        at42qt2120_recovery_stats_t stats;
+        at42qt2120_get_recovery_stats(handle, &stats);
+        printf("%-9s %6u %7u %9lld us %10lld us %8lld us %8lu %10lu %8lu %11s\n", enabled ? "on" : "off", polls, failed,
+               (long long)longest_call_us, (long long)longest_step_us, (long long)longest_gap_us, (unsigned long)stats.retries, (unsigned long)stats.recoveries,
+               (unsigned long)stats.reapplied, config_kept ? "yes" : "no");
+
+        if (!enabled)
+            continue;
+
+        printf("error ring (%lu suppressed by the rate limit, %lu overwritten):\n", (unsigned long)handle->error_log.suppressed,
+               (unsigned long)handle->error_log.overwritten);
+        at42qt2120_error_record_t record;
+        while (at42qt2120_error_pop(handle, &record) == ESP_OK) {
+            if (record.op == AT42QT2120_ERROR_OP_REAPPLY)
+                printf("  %8lld us %-8s %u registers\n", (long long)record.time_us, bench_error_op_name(record.op), record.value);
+            else if (record.op == AT42QT2120_ERROR_OP_CHIP_ID || record.op == AT42QT2120_ERROR_OP_VERIFY)
+                printf("  %8lld us %-8s reg 0x%02X read 0x%02X %-24s x%u\n", (long long)record.time_us, bench_error_op_name(record.op), record.reg,
+                       record.value, esp_err_to_name(record.code), record.repeats + 1);
+            else
+                printf("  %8lld us %-8s reg 0x%02X %-24s x%u\n", (long long)record.time_us, bench_error_op_name(record.op), record.reg,
+                       esp_err_to_name(record.code), record.repeats + 1);
+        }
+    }
+}
+
+/* Finger taps of the drift scenario, cycling over keys 3-11 */
+static uint8_t bench_drift_tap_key(size_t tap) {
+    return 3 + tap % (AT42QT2120_NUM_KEYS - 3);
+}
+
+static int64_t bench_drift_tap_start_us(size_t tap) {
+    return 5000000 + (int64_t)tap * BENCH_DRIFT_TAP_PERIOD_US;
+}
+
+static uint16_t bench_drift_object_mask(int64_t time_us) {
+    return time_us >= BENCH_DRIFT_OBJECT_START_US && time_us < BENCH_DRIFT_OBJECT_END_US ? 1 << BENCH_DRIFT_OBJECT_KEY : 0;
+}
+
+/* Merges the taps and the object into one sorted trace */
+static size_t bench_drift_trace(at42qt2120_sim_touch_t* trace) {
+    int64_t object_edges[] = { BENCH_DRIFT_OBJECT_START_US, BENCH_DRIFT_OBJECT_END_US };
+    size_t length = 0, edge = 0;
+
+    for (size_t tap = 0; tap < BENCH_DRIFT_TAPS; tap++) {
+        int64_t start_us = bench_drift_tap_start_us(tap);
+        while (edge < 2 && object_edges[edge] < start_us) {
+            trace[length++] = (at42qt2120_sim_touch_t){ .time_us = object_edges[edge], .key_mask = bench_drift_object_mask(object_edges[edge]), .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH };
+            edge++;
+        }
+        trace[length++] = (at42qt2120_sim_touch_t){ .time_us = start_us, .key_mask = (uint16_t)(bench_drift_object_mask(start_us) | 1 << bench_drift_tap_key(tap)),
+                                                    .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH };
+        trace[length++] = (at42qt2120_sim_touch_t){ .time_us = start_us + BENCH_DRIFT_TAP_US, .key_mask = bench_drift_object_mask(start_us),
+                                                    .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH };
+    }
+    return length;
+}
+
+/* Drift compensation strategies over a long run: nothing, a periodic calibration, and the drift monitor */
+static void bench_drift(void) {
+    printf("\n== Drift over %lld s (key %d %+.1f counts/s until %lld s, key %d %+.1f counts/s, object on key %d %lld-%lld s) ==\n",
+           BENCH_DRIFT_END_US / 1000000, BENCH_DRIFT_TOWARD_KEY, BENCH_DRIFT_TOWARD_MC_PER_S / 1000.0, BENCH_DRIFT_TOWARD_END_US / 1000000,
+           BENCH_DRIFT_AWAY_KEY, BENCH_DRIFT_AWAY_MC_PER_S / 1000.0, BENCH_DRIFT_OBJECT_KEY, BENCH_DRIFT_OBJECT_START_US / 1000000, BENCH_DRIFT_OBJECT_END_US / 1000000);
+    printf("false detect: time a key other than the tapped one was in detect, including the object\n");
+    printf("%-16s %12s %9s %12s %11s %8s %8s %10s\n", "strategy", "calibrations", "downtime", "false detect", "taps missed", "tunings", "TTD/ATD", "bus bytes/s");
+
+    static at42qt2120_sim_touch_t trace[2 * BENCH_DRIFT_TAPS + 2];
+    size_t trace_length = bench_drift_trace(trace);
+
+    static const char* strategies[] = { "none", "calibrate 30 s", "drift monitor" };
+    for (size_t strategy = 0; strategy < sizeof(strategies) / sizeof(strategies[0]); strategy++) {
+        bench_device_t device;
+        bench_device_init(&device);
+        at42qt2120_handle_t* handle = &device.handle;
+        at42qt2120_sim_set_trace(&device.sim, trace, trace_length);
+        at42qt2120_sim_set_drift(&device.sim, BENCH_DRIFT_TOWARD_KEY, BENCH_DRIFT_TOWARD_MC_PER_S);
+        at42qt2120_sim_set_drift(&device.sim, BENCH_DRIFT_AWAY_KEY, BENCH_DRIFT_AWAY_MC_PER_S);
+
+        at42qt2120_drift_monitor_t monitor;
+        at42qt2120_drift_config_t drift_config = AT42QT2120_DRIFT_CONFIG_DEFAULT();
+        ESP_ERROR_CHECK(at42qt2120_drift_init(&monitor, handle, &drift_config));
+
+        int64_t start_us = device.sim.now_us;
+        uint32_t bus_bytes = device.sim.stats.bytes;
+        int64_t next_sample_us = start_us, next_timer_us = start_us + BENCH_DRIFT_TIMER_US;
+        int64_t calibrating_us = 0, false_detect_us = 0;
+        unsigned calibrations = 0, taps_missed = 0;
+        size_t tap = 0;
+        bool tap_seen = false;
+        bool drift_stopped = false;
+        at42qt2120_state_t state;
+
+        while (device.sim.now_us < BENCH_DRIFT_END_US) {
+            int64_t now_us = device.sim.now_us;
+            if (!drift_stopped && now_us >= BENCH_DRIFT_TOWARD_END_US) {
+                at42qt2120_sim_set_drift(&device.sim, BENCH_DRIFT_TOWARD_KEY, 0);
+                drift_stopped = true;
+            }
+
+            if (at42qt2120_read_state(handle, &state) == ESP_OK) {
+                /* A tap counts once the poll after it ended has had its chance to see it */
+                while (tap < BENCH_DRIFT_TAPS && now_us >= bench_drift_tap_start_us(tap) + BENCH_DRIFT_TAP_US + 50000) {
+                    taps_missed += !tap_seen;
+                    tap_seen = false;
+                    tap++;
+                }
+                int64_t tap_start_us = bench_drift_tap_start_us(tap);
+                bool tapping = tap < BENCH_DRIFT_TAPS && now_us >= tap_start_us && now_us < tap_start_us + BENCH_DRIFT_TAP_US + 50000;
+                uint16_t finger_mask = tapping ? 1 << bench_drift_tap_key(tap) : 0;
+                if (tapping && (state.key_mask & finger_mask) != 0)
+                    tap_seen = true;
+                if ((state.key_mask & ~finger_mask) != 0)
+                    false_detect_us += BENCH_DRIFT_POLL_MS * 1000;
+                if (state.calibrating)
+                    calibrating_us += BENCH_DRIFT_POLL_MS * 1000;
+            }
+
+            if (strategy == 1 && now_us >= next_timer_us) {
+                if (at42qt2120_calibrate_async(handle, NULL, NULL) == ESP_OK)
+                    calibrations++;
+                next_timer_us += BENCH_DRIFT_TIMER_US;
+            }
+            if (strategy == 2 && now_us >= next_sample_us) {
+                at42qt2120_drift_sample(&monitor);
+                next_sample_us += BENCH_DRIFT_SAMPLE_MS * 1000;
+            }
+            at42qt2120_delay_ms(handle, BENCH_DRIFT_POLL_MS);
+        }
+
+        if (strategy == 2)
+            calibrations = monitor.stats.calibrations;
+        uint8_t ttd, atd;
+        at42qt2120_shadow_read(handle, AT42QT2120_REG_TTD_MODE, &ttd);
+        at42qt2120_shadow_read(handle, AT42QT2120_REG_ATD_MODE, &atd);
+        int64_t elapsed_s = (device.sim.now_us - start_us) / 1000000;
+        printf("%-16s %12u %6lld ms %10.1f s %6u/%-4u %8lu %4u/%-3u %10lu\n", strategies[strategy], calibrations, (long long)(calibrating_us / 1000),
+               (double)false_detect_us / 1e6, taps_missed, (unsigned)BENCH_DRIFT_TAPS, (unsigned long)monitor.stats.tunings, ttd, atd,
+               (unsigned long)((device.sim.stats.bytes - bus_bytes) / elapsed_s));
+        at42qt2120_drift_deinit(&monitor);
+    }
+}
+
+/* Slider or wheel setup and touch delta of one position run */
+typedef struct {
+    const char* name;
+    bool wheel;
+    uint16_t touch_delta;
+} bench_position_case_t;
+
+static const bench_position_case_t bench_position_cases[] = {
+    { "slider, 60-count touch", false, 60 },
+    { "slider, 600-count touch", false, 600 },
+    { "wheel, 600-count touch", true, 600 },
+};
+
+/* Accuracy and latency of one position source */
+typedef struct {
+    uint32_t codes;                         // Distinct positions reported over the sweep
+    double error_sum_sq;                    // Sum of the squared sweep errors, 1/256 units
+    int32_t error_max;                      // Largest sweep error, 1/256 units
+    uint32_t sweep_samples;
+    int64_t touch_down_us;                  // Summed time from touch-down to the first touched report
+    double swipe_error_sum;                 // Sum of the absolute errors while swiping, 1/256 units
+    uint32_t swipe_samples;
+    uint32_t read_bytes;                    // Bus bytes of one read
+} bench_position_result_t;
+
+static void bench_position_set_finger(at42qt2120_sim_t* sim, bool wheel, int32_t position_q8) {
+    if (wheel)
+        position_q8 &= 0xFFFF;
+    at42qt2120_sim_set_touch(sim, 0, (int16_t)(position_q8 >> 8));
+    sim->touch.slider_fraction = (uint8_t)(position_q8 & 0xFF);
+}
+
+/* Estimator output in 1/256 slider units, the register is in whole units */
+static int32_t bench_position_estimate_q8(const at42qt2120_position_t* position, bool wheel, uint8_t resolution_bits) {
+    if (wheel)
+        return position->position << (16 - resolution_bits);
+    return (int32_t)((int64_t)position->position * (255 * 256) / ((1 << resolution_bits) - 1));
+}
+
+static int32_t bench_position_error(int32_t reported_q8, int32_t true_q8, bool wheel) {
+    int32_t error = reported_q8 - true_q8;
+    if (wheel)
+        error = (int16_t)(uint16_t)error;
+    return error < 0 ? -error : error;
+}
+
+static void bench_position_sample(bench_position_result_t* result, int32_t error, uint32_t code, uint8_t* seen) {
+    result->error_sum_sq += (double)error * error;
+    if (error > result->error_max)
+        result->error_max = error;
+    result->sweep_samples++;
+    if (!(seen[code / 8] & (1 << (code % 8)))) {
+        seen[code / 8] |= 1 << (code % 8);
+        result->codes++;
+    }
+}
+
+/* The position register against the interpolating estimator on the same simulated finger */
+static void bench_position_run(const bench_position_case_t* position_case, bench_position_result_t results[2]) {
+    static uint8_t seen[2][65536 / 8];
+    memset(seen, 0, sizeof(seen));
+    memset(results, 0, 2 * sizeof(results[0]));
+    bool wheel = position_case->wheel;
+
+    bench_device_t device;
+    at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+    sim_config.touch_delta = position_case->touch_delta;
+    at42qt2120_sim_init(&device.sim, &sim_config);
+    at42qt2120_transport_t transport;
+    at42qt2120_sim_transport(&device.sim, &transport);
+    ESP_ERROR_CHECK(at42qt2120_init_with_transport(&device.handle, &transport, 100));
+    at42qt2120_sim_advance(&device.sim, 200000);
+    if (wheel)
+        at42qt2120_enable_wheel(&device.handle);
+    else
+        at42qt2120_enable_slider(&device.handle);
+
+    at42qt2120_position_config_t config = AT42QT2120_POSITION_CONFIG_DEFAULT();
+    config.wheel = wheel;
+    at42qt2120_position_estimator_t estimator;
+    ESP_ERROR_CHECK(at42qt2120_position_init(&estimator, &device.handle, &config));
+    at42qt2120_state_t state;
+    at42qt2120_position_t position;
+
+    /* Calibration: the finger rests on whole units spread over the slider */
+    for (int point = 0; point < BENCH_POSITION_CALIBRATION_POINTS; point++) {
+        bench_position_set_finger(&device.sim, wheel, (8 + point * 239 / (BENCH_POSITION_CALIBRATION_POINTS - 1)) * 256);
+        at42qt2120_sim_advance(&device.sim, BENCH_POSITION_SETTLE_US);
+        ESP_ERROR_CHECK(at42qt2120_position_read(&estimator, &position));
+        ESP_ERROR_CHECK(at42qt2120_read_state(&device.handle, &state));
+        if (state.slider_detected)
+            at42qt2120_position_calibrate_add(&estimator, state.slider_position);
+    }
+    ESP_ERROR_CHECK(at42qt2120_position_calibrate_finish(&estimator));
+
+    uint32_t bytes = device.sim.stats.bytes;
+    at42qt2120_read_state(&device.handle, &state);
+    results[0].read_bytes = device.sim.stats.bytes - bytes;
+    bytes = device.sim.stats.bytes;
+    at42qt2120_position_read(&estimator, &position);
+    results[1].read_bytes = device.sim.stats.bytes - bytes;
+
+    /* Sweep in 1/16 unit steps, each position held until the next measurement */
+    int32_t sweep_start = wheel ? 0 : 8 * 256, sweep_end = wheel ? 256 * 256 : 247 * 256;
+    for (int32_t true_q8 = sweep_start; true_q8 < sweep_end; true_q8 += BENCH_POSITION_SWEEP_STEP) {
+        bench_position_set_finger(&device.sim, wheel, true_q8);
+        at42qt2120_sim_advance(&device.sim, 20000);
+        if (at42qt2120_read_state(&device.handle, &state) == ESP_OK && state.slider_detected)
+            bench_position_sample(&results[0], bench_position_error(state.slider_position * 256, true_q8, wheel), state.slider_position, seen[0]);
+        if (at42qt2120_position_read(&estimator, &position) == ESP_OK && position.touched)
+            bench_position_sample(&results[1], bench_position_error(bench_position_estimate_q8(&position, wheel, config.resolution_bits), true_q8, wheel),
+                                  position.position, seen[1]);
+    }
+
+    /* Touch-downs at varying phase against the measurement cycle, both sources polled every millisecond */
+    for (int touch = 0; touch < BENCH_POSITION_TOUCHES; touch++) {
+        at42qt2120_sim_set_touch(&device.sim, 0, AT42QT2120_SIM_NO_SLIDER_TOUCH);
+        at42qt2120_sim_advance(&device.sim, 100000 + touch * 317);
+        int64_t down_us = device.sim.now_us;
+        bench_position_set_finger(&device.sim, wheel, 128 * 256);
+        int64_t first_us[2] = { 0, 0 };
+        while ((first_us[0] == 0 || first_us[1] == 0) && device.sim.now_us - down_us < 100000) {
+            if (first_us[0] == 0 && at42qt2120_read_state(&device.handle, &state) == ESP_OK && state.slider_detected)
+                first_us[0] = device.sim.now_us;
+            if (first_us[1] == 0 && at42qt2120_position_read(&estimator, &position) == ESP_OK && position.touched)
+                first_us[1] = device.sim.now_us;
+            at42qt2120_sim_advance(&device.sim, BENCH_POSITION_POLL_US);
+        }
+        results[0].touch_down_us += first_us[0] - down_us;
+        results[1].touch_down_us += first_us[1] - down_us;
+    }
+
+    /* Swipe over most of the slider (wheel: one revolution), the finger moves every millisecond */
+    at42qt2120_sim_set_touch(&device.sim, 0, AT42QT2120_SIM_NO_SLIDER_TOUCH);
+    at42qt2120_sim_advance(&device.sim, 100000);
+    int32_t swipe_start = 20 * 256, swipe_travel = wheel ? 256 * 256 : 210 * 256;
+    for (int64_t elapsed_us = 0; elapsed_us < BENCH_POSITION_SWIPE_US; elapsed_us += BENCH_POSITION_POLL_US) {
+        int32_t true_q8 = swipe_start + (int32_t)(swipe_travel * elapsed_us / BENCH_POSITION_SWIPE_US);
+        bench_position_set_finger(&device.sim, wheel, true_q8);
+        at42qt2120_sim_advance(&device.sim, BENCH_POSITION_POLL_US);
+        if (at42qt2120_read_state(&device.handle, &state) == ESP_OK && state.slider_detected) {
+            results[0].swipe_error_sum += bench_position_error(state.slider_position * 256, true_q8, wheel);
+            results[0].swipe_samples++;
+        }
+        if (at42qt2120_position_read(&estimator, &position) == ESP_OK && position.touched) {
+            results[1].swipe_error_sum += bench_position_error(bench_position_estimate_q8(&position, wheel, config.resolution_bits), true_q8, wheel);
+            results[1].swipe_samples++;
+        }
+    }
+}
+
+/* Resolution, accuracy and latency of the 8-bit position register against the 12-bit interpolation */
+static void bench_position(void) {
+    static const char* sources[] = { "register (8-bit)", "interpolated (12-bit)" };
+
+    printf("\n== Slider position: register against interpolated key signals ==\n");
+    printf("errors in 1/256 slider units, sweep in 1/16 unit steps, %d touch-downs and a %d ms swipe polled every %d us\n",
+           BENCH_POSITION_TOUCHES, BENCH_POSITION_SWIPE_US / 1000, BENCH_POSITION_POLL_US);
+    printf("%-26s %6s %10s %10s %11s %12s %10s\n", "source", "codes", "rms error", "max error", "touch-down", "swipe error", "bytes/read");
+
+    for (size_t index = 0; index < sizeof(bench_position_cases) / sizeof(bench_position_cases[0]); index++) {
+        bench_position_result_t results[2];
+        bench_position_run(&bench_position_cases[index], results);
+        printf("%s\n", bench_position_cases[index].name);
+        for (int source = 0; source < 2; source++) {
+            const bench_position_result_t* result = &results[source];
+            printf("  %-24s %6lu %10.1f %10ld %8.1f ms %12.1f %10lu\n", sources[source], (unsigned long)result->codes,
+                   result->sweep_samples ? sqrt(result->error_sum_sq / result->sweep_samples) : 0.0, (long)result->error_max,
+                   (double)result->touch_down_us / BENCH_POSITION_TOUCHES / 1000, result->swipe_samples ? result->swipe_error_sum / result->swipe_samples : 0.0,
+                   (unsigned long)result->read_bytes);
+        }
+    }
+}
+
+/* Boot scenarios of the profile benchmark, run in order on one simulated device */
+typedef enum {
+    BENCH_BOOT_LEGACY,                      // Reset, write every register and calibrate, as without a profile
+    BENCH_BOOT_FIRST,                       // Power-on, nothing stored yet
+    BENCH_BOOT_HOST_RESET,                  // Host restarts, the device kept its registers
+    BENCH_BOOT_LOW_POWER,                   // Host restarts after the poll scheduler changed the low power mode
+    BENCH_BOOT_POWER_CYCLE,                 // Device lost its registers, the profile is stored
+    BENCH_BOOT_CORRUPT,                     // Device lost its registers, the stored blob is damaged
+    BENCH_BOOT_BROWN_OUT,                   // Device came back from a brown-out reporting a wrong chip ID
+} bench_boot_t;
+
+/* Tuned profile: slider on keys 0-2, raised thresholds and pulses on the buttons, faster drift, custom gestures and polling */
+static void bench_profile_tuned(at42qt2120_profile_t* profile) {
+    at42qt2120_profile_default(profile);
+    profile->config.ttd = 10;
+    profile->config.detection_integrator = 3;
+    profile->config.slider_options = AT42QT2120_SLIDER_OPTIONS_EN;
+    profile->config.charge_time = 1;
+    for (int key = 3; key < AT42QT2120_NUM_KEYS; key++) {
+        profile->config.key_dthr[key] = 14 + key;
+        profile->config.key_pulse_scale[key] = 0x21;
+    }
+    profile->gesture.swipe_min_travel = 64;
+    profile->poll.max_period_ms = 128;
+}
+
+/* Cold, warm and patched boots: time until the device is ready and bus traffic */
+static void bench_profile(void) {
+    static const char* scenarios[] = { "reset + write + calibrate", "first boot (nothing stored)", "host reset", "host reset, LP mode changed",
+                                       "device power cycle", "power cycle, corrupt blob", "brown-out, wrong chip ID" };
+    static const char* modes[] = { "warm", "patched", "cold" };
+
+    char path[] = "/tmp/at42qt2120_profile_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return;
+    close(fd);
+    unlink(path);
+    at42qt2120_profile_file_t file;
+    at42qt2120_profile_storage_t storage;
+    at42qt2120_profile_storage_file(&file, path, &storage);
+
+    printf("\n== Profile boot (%d-byte blob in a file) ==\n", AT42QT2120_PROFILE_BLOB_SIZE);
+    printf("%-30s %-8s %-22s %8s %13s %6s %6s\n", "scenario", "path", "stored profile", "saved", "ready after", "trans", "bytes");
+
+    bench_device_t device;
+    at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+    at42qt2120_sim_init(&device.sim, &sim_config);
+    at42qt2120_sim_advance(&device.sim, 200000);
+    at42qt2120_transport_t transport;
+    at42qt2120_sim_transport(&device.sim, &transport);
+
+    for (bench_boot_t scenario = BENCH_BOOT_LEGACY; scenario <= BENCH_BOOT_BROWN_OUT; scenario++) {
+        if (scenario == BENCH_BOOT_FIRST || scenario == BENCH_BOOT_POWER_CYCLE || scenario == BENCH_BOOT_CORRUPT) {
+            at42qt2120_sim_init(&device.sim, &sim_config);
+            at42qt2120_sim_advance(&device.sim, 200000);
+        }
+        if (scenario == BENCH_BOOT_LOW_POWER)
+            device.sim.regs[AT42QT2120_REG_LOW_POWER_MODE] = 8;
+        if (scenario == BENCH_BOOT_BROWN_OUT) {
+            at42qt2120_sim_brown_out(&device.sim, true);
+            at42qt2120_sim_advance(&device.sim, 200000);
+        }
+        if (scenario == BENCH_BOOT_CORRUPT) {
+            FILE* stream = fopen(path, "r+b");
+            if (stream != NULL) {
+                fseek(stream, 20, SEEK_SET);
+                fputc(0x5A, stream);
+                fclose(stream);
+            }
+        }
+        ESP_ERROR_CHECK(at42qt2120_init_with_transport(&device.handle, &transport, 100));
+
+        at42qt2120_profile_t profile;
+        bench_profile_tuned(&profile);
+        uint32_t transactions = device.sim.stats.transactions, bytes = device.sim.stats.bytes;
+        at42qt2120_profile_boot_result_t result = { .mode = AT42QT2120_PROFILE_BOOT_COLD, .load_result = ESP_ERR_NOT_FOUND };
+        if (scenario == BENCH_BOOT_LEGACY) {
+            int64_t start_us = device.sim.now_us;
+            ESP_ERROR_CHECK(at42qt2120_reset(&device.handle));
+            ESP_ERROR_CHECK(at42qt2120_apply_config(&device.handle, &profile.config, NULL));
+            ESP_ERROR_CHECK(at42qt2120_calibrate(&device.handle));
+            ESP_ERROR_CHECK(at42qt2120_wait_ready(&device.handle, -1));
+            result.duration_us = device.sim.now_us - start_us;
+        } else {
+            ESP_ERROR_CHECK(at42qt2120_profile_boot(&device.handle, &storage, &profile, &result));
+        }
+
+        const char* mode = scenario == BENCH_BOOT_LEGACY ? "-" : result.reset ? "reset" : modes[result.mode];
+        printf("%-30s %-8s %-22s %8s %10.2f ms %6lu %6lu\n", scenarios[scenario], mode,
+               scenario == BENCH_BOOT_LEGACY ? "-" : esp_err_to_name(result.load_result), result.saved ? "yes" : "no", result.duration_us / 1000.0,
+               (unsigned long)(device.sim.stats.transactions - transactions), (unsigned long)(device.sim.stats.bytes - bytes));
+    }
+    unlink(path);
+}
+
+/* Noise models for the auto-tune: overlay thickness sets the touch delta, per pulse and in counts */
+typedef enum {
+    BENCH_TUNE_THIN,                        // Thin overlay, quiet supply
+    BENCH_TUNE_THICK,                       // Thick overlay, noisy electrodes, resistive traces on keys 8-11
+    BENCH_TUNE_HUM,                         // Thick overlay with noise common to all keys (mains hum)
+} bench_tune_model_t;
+
+typedef struct {
+    const char* name;
+    bench_tune_model_t model;
+    uint32_t response_time_us;
+} bench_tune_case_t;
+
+static const bench_tune_case_t bench_tune_cases[] = {
+    { "thin overlay, quiet", BENCH_TUNE_THIN, 40000 },
+    { "thick overlay, noisy", BENCH_TUNE_THICK, 40000 },
+    { "thick overlay, noisy, 25 ms", BENCH_TUNE_THICK, 25000 },
+    { "thick overlay, mains hum", BENCH_TUNE_HUM, 40000 },
+};
+
+/* Outcome of the sensor with a configuration applied: touches on all keys at varying phase, then idle time */
+typedef struct {
+    uint32_t touches;
+    uint32_t detected;
+    int64_t worst_response_us;
+    uint32_t false_detections;
+} bench_tune_check_t;
+
+#define BENCH_TUNE_TOUCHES 20
+#define BENCH_TUNE_IDLE_US 10000000
+
+static void bench_tune_sensor(bench_tune_model_t model, at42qt2120_sim_sensor_t* sensor) {
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->seed = 0x7E57;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        at42qt2120_sim_key_model_t* key_model = &sensor->keys[key];
+        switch (model) {
+        case BENCH_TUNE_THIN:
+            key_model->touch_delta = 40 + 2 * key;
+            key_model->noise_cc = 60;
+            break;
+        case BENCH_TUNE_THICK:
+            key_model->touch_delta = 6 + key % 4;
+            key_model->noise_cc = 150 + 10 * key;
+            key_model->charge_loss_pm = key >= 8 ? 600 : 0;
+            break;
+        case BENCH_TUNE_HUM:
+            key_model->touch_delta = 6 + key % 4;
+            key_model->noise_cc = 50;
+            break;
+        }
+    }
+    if (model == BENCH_TUNE_HUM)
+        sensor->common_noise_cc = 150;
+}
+
+static void bench_tune_touch(uint16_t key_mask, void* user_ctx) {
+    at42qt2120_sim_set_touch((at42qt2120_sim_t*)user_ctx, key_mask, AT42QT2120_SIM_NO_SLIDER_TOUCH);
+}
+
+static uint16_t bench_tune_detected(const at42qt2120_sim_t* sim) {
+    return sim->regs[AT42QT2120_REG_KEY_STATUS_07_00] | (sim->regs[AT42QT2120_REG_KEY_STATUS_11_08] << 8);
+}
+
+/* Measured on the simulated device itself, every 250 us, so bus traffic does not blur the response times */
+static void bench_tune_check(bench_device_t* device, const at42qt2120_config_t* config, bench_tune_check_t* check) {
+    ESP_ERROR_CHECK(at42qt2120_apply_config(&device->handle, config, NULL));
+    ESP_ERROR_CHECK(at42qt2120_calibrate(&device->handle));
+    ESP_ERROR_CHECK(at42qt2120_wait_ready(&device->handle, -1));
+    memset(check, 0, sizeof(*check));
+
+    at42qt2120_sim_t* sim = &device->sim;
+    for (int touch = 0; touch < BENCH_TUNE_TOUCHES; touch++) {
+        at42qt2120_sim_advance(sim, 300000 + touch * 1700);
+        at42qt2120_sim_set_touch(sim, AT42QT2120_KEY_MASK_ALL, AT42QT2120_SIM_NO_SLIDER_TOUCH);
+        int64_t touched_us = sim->now_us;
+        check->touches++;
+        while (sim->now_us - touched_us < 200000 && bench_tune_detected(sim) != AT42QT2120_KEY_MASK_ALL)
+            at42qt2120_sim_advance(sim, 250);
+        if (bench_tune_detected(sim) == AT42QT2120_KEY_MASK_ALL) {
+            check->detected++;
+            if (sim->now_us - touched_us > check->worst_response_us)
+                check->worst_response_us = sim->now_us - touched_us;
+        }
+        at42qt2120_sim_advance(sim, 100000);
+        at42qt2120_sim_set_touch(sim, 0, AT42QT2120_SIM_NO_SLIDER_TOUCH);
+    }
+
+    at42qt2120_sim_advance(sim, 500000);
+    uint16_t previous = bench_tune_detected(sim);
+    for (int64_t end_us = sim->now_us + BENCH_TUNE_IDLE_US; sim->now_us < end_us;) {
+        at42qt2120_sim_advance(sim, 1000);
+        uint16_t detected = bench_tune_detected(sim);
+        check->false_detections += __builtin_popcount(detected & ~previous);
+        previous = detected;
+    }
+}
+
+/* Auto-tune under several noise models: sweep cost, chosen settings, and the sensor before and after */
+static void bench_tune(void) {
+    double serial_s = 0;
+    printf("\n== Auto-tune (pulse/scale, charge time, thresholds; all 12 keys touched together) ==\n");
+    printf("%-28s %9s %9s %6s %3s %10s %10s %9s | %10s %9s %6s\n", "model", "sweep", "host CPU", "reads", "CT", "pulse", "SNR",
+           "response", "detected", "worst", "false");
+
+    for (size_t index = 0; index < sizeof(bench_tune_cases) / sizeof(bench_tune_cases[0]); index++) {
+        const bench_tune_case_t* tune_case = &bench_tune_cases[index];
+        bench_device_t device;
+        bench_device_init(&device);
+        at42qt2120_sim_sensor_t sensor;
+        bench_tune_sensor(tune_case->model, &sensor);
+        at42qt2120_sim_set_sensor(&device.sim, &sensor);
+
+        at42qt2120_config_t untuned;
+        ESP_ERROR_CHECK(at42qt2120_get_config(&device.handle, &untuned));
+        bench_tune_check_t before;
+        bench_tune_check(&device, &untuned, &before);
+
+        at42qt2120_tune_config_t config = AT42QT2120_TUNE_CONFIG_DEFAULT();
+        config.response_time_us = tune_case->response_time_us;
+        config.touch = bench_tune_touch;
+        config.user_ctx = &device.sim;
+        at42qt2120_tune_result_t result;
+        double start_ns = host_time_ns();
+        ESP_ERROR_CHECK(at42qt2120_tune(&device.handle, &config, &result));
+        double host_ms = (host_time_ns() - start_ns) / 1e6;
+
+        bench_tune_check_t after;
+        bench_tune_check(&device, &result.config, &after);
+
+        uint8_t min_pulse = 15, max_pulse = 0;
+        for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+            min_pulse = result.keys[key].pulse < min_pulse ? result.keys[key].pulse : min_pulse;
+            max_pulse = result.keys[key].pulse > max_pulse ? result.keys[key].pulse : max_pulse;
+        }
+        uint32_t untuned_response_us = at42qt2120_tune_response_time(&config, &untuned, NULL);
+        /* The same steps for one key at a time, each behind a calibration */
+        at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+        serial_s = AT42QT2120_NUM_KEYS * (result.duration_us / 1e6 + result.steps * sim_config.calibrate_time_us / 1e6);
+
+        printf("%-28s %9s %9s %6s %3s %10s %10.1f %6.1f ms | %7lu/%-2lu %6.1f ms %6lu   (power-on settings)\n", tune_case->name, "", "", "", "0",
+               "0", result.baseline_snr_q8 / 256.0, untuned_response_us / 1000.0, (unsigned long)before.detected, (unsigned long)before.touches,
+               before.worst_response_us / 1000.0, (unsigned long)before.false_detections);
+        printf("%-28s %6.2f s %6.1f ms %6lu %3u %7u-%-2u %10.1f %6.1f ms | %7lu/%-2lu %6.1f ms %6lu   (tuned)\n", "", result.duration_us / 1e6, host_ms,
+               (unsigned long)result.reads, result.charge_time, min_pulse, max_pulse, result.snr_q8 / 256.0, result.response_time_us / 1000.0,
+               (unsigned long)after.detected, (unsigned long)after.touches, after.worst_response_us / 1000.0, (unsigned long)after.false_detections);
+    }
+    printf("Sweep: device time with all keys per burst read; one key at a time with a calibration per step: %.1f s.\n", serial_s);
+    printf("SNR: lowest touch delta / noise deviation over the keys. Response: predicted worst case; worst: measured on the simulator.\n");
+    printf("Detected: touches of all 12 keys confirmed within 200 ms. False: detections during %d s untouched.\n", BENCH_TUNE_IDLE_US / 1000000);
+}
+
+/* Key decoder on the simulator: a tap, a two-key chord and a held key polled at 1 kHz */
+static const at42qt2120_sim_touch_t bench_keys_trace[] = {
+    { .time_us = 300000, .key_mask = 1 << 4, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 420000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 700000, .key_mask = (1 << 7) | (1 << 9), .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 900000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1100000, .key_mask = 1 << 2, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1900000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+};
+#define BENCH_KEYS_TRACE_END_US 2100000
+
+/* Synthetic typing: a minute of taps, chords and held keys whose edges flicker, sampled at several rates */
+#define BENCH_KEYS_DURATION_US 60000000
+#define BENCH_KEYS_MAX_EDGES 32768
+#define BENCH_KEYS_DEBOUNCE_US 5000
+
+typedef struct {
+    int64_t time_us;
+    uint16_t toggle;                        // Keys whose raw level flips at time_us
+} bench_key_edge_t;
+
+typedef struct {
+    unsigned counts[AT42QT2120_KEY_CHORD + 1];
+    unsigned batches;
+} bench_key_counts_t;
+
+/* Per-key debounce and hold timers, every key visited on every sample: the decoder most applications write */
+typedef struct {
+    uint32_t debounce_us;
+    uint32_t long_press_us;
+    uint32_t repeat_us;
+    uint16_t stable;
+    bool changing[AT42QT2120_NUM_KEYS];
+    bool long_pressed[AT42QT2120_NUM_KEYS];
+    int64_t since_us[AT42QT2120_NUM_KEYS];
+    int64_t fire_us[AT42QT2120_NUM_KEYS];
+    unsigned events;
+} bench_naive_keys_t;
+
+static void bench_naive_keys_feed(bench_naive_keys_t* naive, int64_t time_us, uint16_t raw) {
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        uint16_t bit = 1 << key;
+        if ((raw ^ naive->stable) & bit) {
+            if (!naive->changing[key]) {
+                naive->changing[key] = true;
+                naive->since_us[key] = time_us;
+            }
+            if (time_us - naive->since_us[key] >= naive->debounce_us) {
+                naive->changing[key] = false;
+                naive->stable ^= bit;
+                naive->events++;
+                naive->long_pressed[key] = false;
+                naive->fire_us[key] = time_us + naive->long_press_us;
+            }
+        } else {
+            naive->changing[key] = false;
+        }
+
+        if ((naive->stable & bit) && naive->long_press_us != 0 && time_us >= naive->fire_us[key] &&
+            (naive->repeat_us != 0 || !naive->long_pressed[key])) {
+            naive->events++;
+            naive->long_pressed[key] = true;
+            do {
+                naive->fire_us[key] += naive->repeat_us != 0 ? naive->repeat_us : naive->long_press_us;
+            } while (naive->fire_us[key] <= time_us);
+        }
+    }
+}
+
+static void bench_keys_count(const at42qt2120_key_event_t* events, size_t event_count, void* user_ctx) {
+    bench_key_counts_t* counts = (bench_key_counts_t*)user_ctx;
+    counts->batches++;
+    for (size_t index = 0; index < event_count; index++)
+        counts->counts[events[index].type]++;
+}
+
+static void bench_keys_print(const at42qt2120_key_event_t* events, size_t event_count, void* user_ctx) {
+    static const char* names[] = { "down", "up", "long press", "repeat", "chord" };
+    (void)user_ctx;
+    printf("  %7lld us:", (long long)events[0].time_us);
+    for (size_t index = 0; index < event_count; index++) {
+        const at42qt2120_key_event_t* event = &events[index];
+        printf("%s %s", index > 0 ? "," : "", names[event->type]);
+        if (event->type == AT42QT2120_KEY_CHORD)
+            printf(" mask 0x%03x", event->key_mask);
+        else
+            printf(" key %u", event->key);
+        if (event->type == AT42QT2120_KEY_REPEAT)
+            printf(" #%u", event->repeat);
+        if (event->type != AT42QT2120_KEY_DOWN && event->type != AT42QT2120_KEY_CHORD)
+            printf(" after %lu ms", (unsigned long)event->duration_us / 1000);
+    }
+    printf("\n");
+}
+
+static int bench_key_edge_compare(const void* a, const void* b) {
+    int64_t left = ((const bench_key_edge_t*)a)->time_us, right = ((const bench_key_edge_t*)b)->time_us;
+    return (left > right) - (left < right);
+}
+
+/* Adds an edge of one key followed by flicker: up to three short excursions back to the old level within 3 ms */
+static size_t bench_keys_add_edge(bench_key_edge_t* edges, size_t edge_count, uint32_t* seed, int64_t time_us, uint16_t bit) {
+    edges[edge_count++] = (bench_key_edge_t){ .time_us = time_us, .toggle = bit };
+    int flickers = (*seed = *seed * 1103515245 + 12345) >> 16 & 3;
+    for (int flicker = 0; flicker < flickers; flicker++) {
+        int64_t start_us = time_us + 300 + flicker * 900;
+        edges[edge_count++] = (bench_key_edge_t){ .time_us = start_us, .toggle = bit };
+        edges[edge_count++] = (bench_key_edge_t){ .time_us = start_us + 150 + ((*seed >> 8) & 255), .toggle = bit };
+    }
+    return edge_count;
+}
+
+/* Taps of 50-200 ms every 50-250 ms, one in twelve a chord of two or three keys, one in fifty held for 1.2-2 s */
+static size_t bench_keys_generate(bench_key_edge_t* edges, unsigned* presses) {
+    uint32_t seed = 0x4B455953;
+    int64_t free_us[AT42QT2120_NUM_KEYS] = { 0 };
+    size_t edge_count = 0;
+    *presses = 0;
+
+    for (int64_t time_us = 100000; time_us < BENCH_KEYS_DURATION_US - 3000000 && edge_count < BENCH_KEYS_MAX_EDGES - 64;) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t random = seed >> 8;
+        time_us += 50000 + random % 200000;
+        int kind = (random >> 12) % 100;
+        int keys = kind < 8 ? 2 + (random >> 20) % 2 : 1;
+        int64_t duration_us = kind >= 8 && kind < 10 ? 1200000 + random % 800000 : 50000 + (random >> 4) % 150000;
+
+        for (int index = 0; index < keys; index++) {
+            seed = seed * 1103515245 + 12345;
+            uint8_t key = (seed >> 16) % AT42QT2120_NUM_KEYS;
+            int64_t down_us = time_us + (index > 0 ? (seed >> 8) % 20000 : 0);
+            if (free_us[key] > down_us)
+                continue;
+            edge_count = bench_keys_add_edge(edges, edge_count, &seed, down_us, 1 << key);
+            edge_count = bench_keys_add_edge(edges, edge_count, &seed, down_us + duration_us, 1 << key);
+            free_us[key] = down_us + duration_us + 20000;
+            (*presses)++;
+        }
+    }
+
+    qsort(edges, edge_count, sizeof(edges[0]), bench_key_edge_compare);
+    return edge_count;
+}
+
+/* Key decoder: batches on the simulator, then throughput and flicker rejection against a per-key timer decoder */
+static void bench_keys(void) {
+    printf("\n== Key decoder on the simulator, state polled at 1 kHz ==\n");
+    bench_device_t device;
+    bench_device_init(&device);
+    at42qt2120_sim_set_trace(&device.sim, bench_keys_trace, sizeof(bench_keys_trace) / sizeof(bench_keys_trace[0]));
+
+    at42qt2120_key_config_t config = AT42QT2120_KEY_CONFIG_DEFAULT();
+    config.callback = bench_keys_print;
+    at42qt2120_key_decoder_t decoder;
+    ESP_ERROR_CHECK(at42qt2120_key_decoder_init(&decoder, &config));
+    for (int64_t poll_us = device.sim.now_us; device.sim.now_us < BENCH_KEYS_TRACE_END_US;) {
+        poll_us += 1000;
+        at42qt2120_sim_advance_to(&device.sim, poll_us);
+        at42qt2120_state_t state;
+        int64_t time_us = at42qt2120_time_us(&device.handle);
+        if (at42qt2120_read_state(&device.handle, &state) == ESP_OK)
+            at42qt2120_key_decoder_feed_state(&decoder, time_us, &state);
+    }
+
+    static bench_key_edge_t edges[BENCH_KEYS_MAX_EDGES];
+    static uint16_t masks[BENCH_KEYS_DURATION_US / 100];
+    unsigned presses;
+    size_t edge_count = bench_keys_generate(edges, &presses);
+    printf("\n== Key decoder over %d s of synthetic typing (%u presses, %zu raw edges including flicker) ==\n", BENCH_KEYS_DURATION_US / 1000000, presses,
+           edge_count);
+    printf("%6s %9s %8s %6s %6s %6s %7s %6s %8s | %12s %12s\n", "rate", "debounce", "samples", "down", "up", "chord", "long", "repeat", "batches",
+           "decoder", "per-key scan");
+
+    static const int rates_hz[] = { 1000, 4000, 10000 };
+    for (size_t rate = 0; rate < sizeof(rates_hz) / sizeof(rates_hz[0]); rate++) {
+        int64_t step_us = 1000000 / rates_hz[rate];
+        size_t sample_count = 0, edge = 0;
+        uint16_t raw = 0;
+        for (int64_t time_us = 0; time_us < BENCH_KEYS_DURATION_US; time_us += step_us) {
+            while (edge < edge_count && edges[edge].time_us <= time_us)
+                raw ^= edges[edge++].toggle;
+            masks[sample_count++] = raw;
+        }
+
+        for (uint32_t debounce_us = 0; debounce_us <= BENCH_KEYS_DEBOUNCE_US; debounce_us += BENCH_KEYS_DEBOUNCE_US) {
+            bench_key_counts_t counts = { 0 };
+            config = (at42qt2120_key_config_t)AT42QT2120_KEY_CONFIG_DEFAULT();
+            config.debounce_us = debounce_us;
+            config.callback = bench_keys_count;
+            config.user_ctx = &counts;
+            ESP_ERROR_CHECK(at42qt2120_key_decoder_init(&decoder, &config));
+            double start_ns = host_time_ns();
+            for (size_t sample = 0; sample < sample_count; sample++)
+                at42qt2120_key_decoder_feed(&decoder, (int64_t)sample * step_us, masks[sample]);
+            double decoder_ns = (host_time_ns() - start_ns) / sample_count;
+
+            bench_naive_keys_t naive = { .debounce_us = debounce_us, .long_press_us = config.long_press_us, .repeat_us = config.repeat_us };
+            start_ns = host_time_ns();
+            for (size_t sample = 0; sample < sample_count; sample++)
+                bench_naive_keys_feed(&naive, (int64_t)sample * step_us, masks[sample]);
+            double naive_ns = (host_time_ns() - start_ns) / sample_count;
+
+            unsigned decoded = counts.counts[AT42QT2120_KEY_DOWN] + counts.counts[AT42QT2120_KEY_UP] + counts.counts[AT42QT2120_KEY_LONG_PRESS] +
+                               counts.counts[AT42QT2120_KEY_REPEAT];
+            printf("%4d k %6.1f ms %8zu %6u %6u %6u %7u %6u %8u | %6.1f ns/smp %6.1f ns/smp%s\n", rates_hz[rate] / 1000, debounce_us / 1000.0, sample_count,
+                   counts.counts[AT42QT2120_KEY_DOWN], counts.counts[AT42QT2120_KEY_UP], counts.counts[AT42QT2120_KEY_CHORD],
+                   counts.counts[AT42QT2120_KEY_LONG_PRESS], counts.counts[AT42QT2120_KEY_REPEAT], counts.batches, decoder_ns, naive_ns,
+                   decoded == naive.events ? "" : "  (event counts differ)");
+        }
+    }
+    printf("Down: %u presses were typed, more downs are flicker passed through. Per-key scan: same debounce, long press and repeat, no chords.\n",
+           presses);
+}
+
+int main(void) {
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    ESP_LOGI(TAG, "Running host benchmarks");
+
+    bench_status_poll();
+    bench_config_plan();
+    bench_signals();
+    bench_reset_calibrate();
+    bench_instrumentation();
+    bench_event_engine();
+    bench_manager();
+    bench_gestures();
+    bench_publisher();
+    bench_poll_scheduler();
+    bench_recovery();
+    bench_drift();
+    bench_position();
+    bench_profile();
+    bench_tune();
+    bench_keys();
+
+    return 0;
+}
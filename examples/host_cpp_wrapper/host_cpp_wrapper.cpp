@@ -0,0 +1,318 @@
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <esp_err.h>
+#include <esp_log.h>
+
+#include "esp_at42qt2120.hpp"
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_sim.h"
+
+#define BENCH_ITERATIONS 200000
+#define BENCH_ROUNDS 5
+#define BENCH_LOG_SIZE 4096
+
+static const char* TAG = "HOST_CPP_WRAPPER";
+
+namespace regs = at42qt2120::regs;
+namespace fields = at42qt2120::fields;
+namespace bursts = at42qt2120::bursts;
+
+/* The register map is checked against the C defines at compile time */
+static_assert(regs::key_dthr<3>::address == AT42QT2120_REG_KEY_03_DTHR, "DTHR map differs");
+static_assert(regs::key_ctrl<11>::address == AT42QT2120_REG_KEY_11_CTRL, "CTRL map differs");
+static_assert(regs::key_pulse_scale<7>::address == AT42QT2120_REG_KEY_07_PULSE_SCALE, "Pulse/scale map differs");
+static_assert(regs::key_signal<5>::address == AT42QT2120_REG_KEY_05_MSB_SIGNAL, "Signal map differs");
+static_assert(regs::key_reference<11>::address == AT42QT2120_REG_KEY_11_MSB_REFERENCE, "Reference map differs");
+static_assert(fields::slider_enable::of<1>() == AT42QT2120_SLIDER_OPTIONS_EN, "Slider enable bit differs");
+static_assert(fields::slider_wheel::of<1>() == AT42QT2120_SLIDER_OPTIONS_WHEEL, "Wheel bit differs");
+static_assert(fields::touch_detected::mask == AT42QT2120_DETECTION_STATUS_TDET, "TDET bit differs");
+static_assert(fields::calibrating::mask == AT42QT2120_DETECTION_STATUS_CALIBRATE, "CALIBRATE bit differs");
+static_assert(bursts::state::offset<regs::slider_position>() == 3, "State burst layout differs");
+static_assert(bursts::references::offset<regs::key_reference<3>>() == 6, "Reference burst layout differs");
+
+/* Decoded results of one sequence, compared between the C and the C++ run */
+typedef struct {
+    bool touched;
+    uint16_t key_mask;
+    uint16_t signal;
+    uint16_t reference;
+} bench_result_t;
+
+/* Transport that logs every transaction (direction, written bytes, read length) before passing it on */
+typedef struct {
+    at42qt2120_transport_t inner;
+    uint8_t log[BENCH_LOG_SIZE];
+    size_t log_size;
+    uint32_t transactions;
+} bench_recorder_t;
+
+static void bench_record(bench_recorder_t* recorder, uint8_t kind, const uint8_t* write_buf, size_t write_size, size_t read_size) {
+    recorder->transactions++;
+    if (recorder->log_size + write_size + 3 > BENCH_LOG_SIZE)
+        return;
+    recorder->log[recorder->log_size++] = kind;
+    recorder->log[recorder->log_size++] = (uint8_t)write_size;
+    memcpy(&recorder->log[recorder->log_size], write_buf, write_size);
+    recorder->log_size += write_size;
+    recorder->log[recorder->log_size++] = (uint8_t)read_size;
+}
+
+static esp_err_t bench_recorder_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms) {
+    bench_recorder_t* recorder = (bench_recorder_t*)ctx;
+    bench_record(recorder, 'R', write_buf, write_size, read_size);
+    return recorder->inner.ops->transmit_receive(recorder->inner.ctx, write_buf, write_size, read_buf, read_size, timeout_ms);
+}
+
+static esp_err_t bench_recorder_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    bench_recorder_t* recorder = (bench_recorder_t*)ctx;
+    bench_record(recorder, 'W', write_buf, write_size, 0);
+    return recorder->inner.ops->transmit(recorder->inner.ctx, write_buf, write_size, timeout_ms);
+}
+
+static esp_err_t bench_recorder_probe(void* ctx, int timeout_ms) {
+    bench_recorder_t* recorder = (bench_recorder_t*)ctx;
+    return recorder->inner.ops->probe(recorder->inner.ctx, timeout_ms);
+}
+
+static void bench_recorder_delay_ms(void* ctx, uint32_t delay_ms) {
+    bench_recorder_t* recorder = (bench_recorder_t*)ctx;
+    recorder->inner.ops->delay_ms(recorder->inner.ctx, delay_ms);
+}
+
+static int64_t bench_recorder_time_us(void* ctx) {
+    bench_recorder_t* recorder = (bench_recorder_t*)ctx;
+    return recorder->inner.ops->time_us(recorder->inner.ctx);
+}
+
+static const at42qt2120_transport_ops_t bench_recorder_ops = {
+    .transmit_receive = bench_recorder_transmit_receive,
+    .transmit = bench_recorder_transmit,
+    .probe = bench_recorder_probe,
+    .release = NULL,
+    .delay_ms = bench_recorder_delay_ms,
+    .time_us = bench_recorder_time_us,
+};
+
+/* Transport without a device behind it, so the timing below measures the driver and the wrapper only */
+static esp_err_t bench_null_transmit_receive(void*, const uint8_t*, size_t, uint8_t* read_buf, size_t read_size, int) {
+    memset(read_buf, 0, read_size);
+    return ESP_OK;
+}
+
+static esp_err_t bench_null_transmit(void*, const uint8_t*, size_t, int) {
+    return ESP_OK;
+}
+
+static esp_err_t bench_null_probe(void*, int) {
+    return ESP_OK;
+}
+
+static void bench_null_delay_ms(void*, uint32_t) {
+}
+
+static int64_t bench_null_time_us(void*) {
+    return 0;
+}
+
+static const at42qt2120_transport_ops_t bench_null_ops = {
+    .transmit_receive = bench_null_transmit_receive,
+    .transmit = bench_null_transmit,
+    .probe = bench_null_probe,
+    .release = NULL,
+    .delay_ms = bench_null_delay_ms,
+    .time_us = bench_null_time_us,
+};
+
+/*
+ * The same work written against the C API and against the wrapper. Each lives in its own section
+ * so the linker reports its size, flatten keeps the wrapper templates out of .text.
+ */
+#define BENCH_SEQUENCE_ATTRIBUTES(section_name) __attribute__((noinline, flatten, section(section_name)))
+
+BENCH_SEQUENCE_ATTRIBUTES("at42qt2120_c_path")
+static esp_err_t bench_sequence_c(at42qt2120_handle_t* at42qt2120_handle, uint8_t value, bench_result_t* result) {
+    uint8_t state[AT42QT2120_STATE_REG_COUNT];
+    esp_err_t ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_DETECTION_STATUS, state, sizeof(state));
+    if (ret != ESP_OK)
+        return ret;
+    result->touched = (state[0] & AT42QT2120_DETECTION_STATUS_TDET) != 0;
+    result->key_mask = (uint16_t)(state[1] | (state[2] << 8));
+
+    uint8_t signal[2];
+    ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_KEY_05_MSB_SIGNAL, signal, sizeof(signal));
+    if (ret != ESP_OK)
+        return ret;
+    result->signal = (uint16_t)((signal[0] << 8) | signal[1]);
+
+    uint8_t references[AT42QT2120_REFERENCE_BLOCK_SIZE];
+    ret = at42qt2120_register_read(at42qt2120_handle, AT42QT2120_REG_KEY_00_MSB_REFERENCE, references, sizeof(references));
+    if (ret != ESP_OK)
+        return ret;
+    result->reference = (uint16_t)((references[6] << 8) | references[7]);
+
+    ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_KEY_03_DTHR, value);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    ret = at42qt2120_shadow_update_bits(at42qt2120_handle, AT42QT2120_REG_KEY_07_PULSE_SCALE, 0x0F, value & 0x0F);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(at42qt2120_handle);
+    if (ret != ESP_OK)
+        return ret;
+
+    uint8_t slider_options = (value & 1) ? AT42QT2120_SLIDER_OPTIONS_EN | AT42QT2120_SLIDER_OPTIONS_WHEEL : AT42QT2120_SLIDER_OPTIONS_EN;
+    ret = at42qt2120_shadow_write(at42qt2120_handle, AT42QT2120_REG_SLIDER_OPTIONS, slider_options);
+    if (ret == ESP_OK)
+        ret = at42qt2120_shadow_flush(at42qt2120_handle);
+    return ret;
+}
+
+BENCH_SEQUENCE_ATTRIBUTES("at42qt2120_cpp_path")
+static esp_err_t bench_sequence_cpp(at42qt2120_handle_t* at42qt2120_handle, uint8_t value, bench_result_t* result) {
+    at42qt2120::device touch(at42qt2120_handle);
+
+    bursts::state::value_type state;
+    esp_err_t ret = touch.read<bursts::state>(state);
+    if (ret != ESP_OK)
+        return ret;
+    result->touched = bursts::state::get<fields::touch_detected>(state);
+    result->key_mask = bursts::state::get<regs::key_status>(state);
+
+    ret = touch.read<regs::key_signal<5>>(result->signal);
+    if (ret != ESP_OK)
+        return ret;
+
+    bursts::references::value_type references;
+    ret = touch.read<bursts::references>(references);
+    if (ret != ESP_OK)
+        return ret;
+    result->reference = bursts::references::get<regs::key_reference<3>>(references);
+
+    ret = touch.write<regs::key_dthr<3>>(value);
+    if (ret != ESP_OK)
+        return ret;
+
+    ret = touch.write<fields::key_scale<7>>(value);
+    if (ret != ESP_OK)
+        return ret;
+
+    constexpr uint8_t slider = fields::slider_enable::of<1>();
+    constexpr uint8_t wheel = fields::slider_enable::of<1>() | fields::slider_wheel::of<1>();
+    return touch.write<regs::slider_options>((value & 1) ? wheel : slider);
+}
+
+extern "C" {
+extern const char __start_at42qt2120_c_path[], __stop_at42qt2120_c_path[];
+extern const char __start_at42qt2120_cpp_path[], __stop_at42qt2120_cpp_path[];
+}
+
+typedef esp_err_t (*bench_sequence_t)(at42qt2120_handle_t* at42qt2120_handle, uint8_t value, bench_result_t* result);
+
+/* Values written by the sequences; a repeated value shows that the shadow suppresses the writes in both */
+static const uint8_t bench_values[] = { 0x21, 0x22, 0x22, 0x35, 0x0A };
+
+typedef struct {
+    at42qt2120_sim_t sim;
+    bench_recorder_t recorder;
+    at42qt2120_handle_t handle;
+    bench_result_t results[sizeof(bench_values)];
+} bench_run_t;
+
+static void bench_record_sequence(bench_run_t* run, bench_sequence_t sequence) {
+    at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+    at42qt2120_sim_init(&run->sim, &sim_config);
+    at42qt2120_sim_set_touch(&run->sim, 0x0024, AT42QT2120_SIM_NO_SLIDER_TOUCH);
+
+    memset(&run->recorder, 0, sizeof(run->recorder));
+    at42qt2120_sim_transport(&run->sim, &run->recorder.inner);
+    at42qt2120_transport_t transport = { .ops = &bench_recorder_ops, .ctx = &run->recorder };
+    ESP_ERROR_CHECK(at42qt2120_init_with_transport(&run->handle, &transport, 100));
+    at42qt2120_sim_advance(&run->sim, 200000);
+
+    for (size_t index = 0; index < sizeof(bench_values); index++) {
+        ESP_ERROR_CHECK(sequence(&run->handle, bench_values[index], &run->results[index]));
+        at42qt2120_sim_advance(&run->sim, 20000);
+    }
+}
+
+/* Bus traffic of both sequences must match byte for byte, returns false if anything differs */
+static bool bench_transactions(void) {
+    static bench_run_t c_run, cpp_run;
+
+    printf("\n== Transactions (C API against C++ wrapper) ==\n");
+
+    bench_record_sequence(&c_run, bench_sequence_c);
+    bench_record_sequence(&cpp_run, bench_sequence_cpp);
+
+    bool same_log = c_run.recorder.log_size == cpp_run.recorder.log_size && memcmp(c_run.recorder.log, cpp_run.recorder.log, c_run.recorder.log_size) == 0;
+    bool same_results = memcmp(c_run.results, cpp_run.results, sizeof(c_run.results)) == 0;
+    bool same_regs = memcmp(c_run.sim.regs, cpp_run.sim.regs, sizeof(c_run.sim.regs)) == 0;
+
+    printf("C API      : %3lu transactions, %4zu logged bytes\n", (unsigned long)c_run.recorder.transactions, c_run.recorder.log_size);
+    printf("C++ wrapper: %3lu transactions, %4zu logged bytes\n", (unsigned long)cpp_run.recorder.transactions, cpp_run.recorder.log_size);
+    printf("transaction bytes %s, decoded values %s, device registers %s\n", same_log ? "identical" : "DIFFER",
+           same_results ? "identical" : "DIFFER", same_regs ? "identical" : "DIFFER");
+    printf("key mask 0x%03X, key 5 signal %u, key 3 reference %u\n", cpp_run.results[0].key_mask, cpp_run.results[0].signal, cpp_run.results[0].reference);
+
+    return same_log && same_results && same_regs;
+}
+
+static double host_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static double bench_time_sequence(at42qt2120_handle_t* at42qt2120_handle, bench_sequence_t sequence) {
+    bench_result_t result;
+    double start_ns = host_time_ns();
+    for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++)
+        sequence(at42qt2120_handle, (uint8_t)iteration, &result);
+    return (host_time_ns() - start_ns) / BENCH_ITERATIONS;
+}
+
+/*
+ * Code size from the linker sections, host CPU time against a transport that returns at once.
+ * Both paths make the same calls with the same constants. With GCC 12 -O2 on x86-64 the wrapper
+ * path keeps a stack address in one more callee-saved register: 9 bytes more code (307 against
+ * 298), host CPU time equal within the noise of the measurement.
+ */
+static void bench_overhead(void) {
+    printf("\n== Overhead (C API against C++ wrapper) ==\n");
+
+    size_t c_size = (size_t)(__stop_at42qt2120_c_path - __start_at42qt2120_c_path);
+    size_t cpp_size = (size_t)(__stop_at42qt2120_cpp_path - __start_at42qt2120_cpp_path);
+    printf("code size  : C %zu bytes, C++ %zu bytes\n", c_size, cpp_size);
+
+    at42qt2120_handle_t handle;
+    at42qt2120_transport_t transport = { .ops = &bench_null_ops, .ctx = NULL };
+    ESP_ERROR_CHECK(at42qt2120_init_with_transport(&handle, &transport, 100));
+    ESP_ERROR_CHECK(at42qt2120_shadow_resync(&handle));
+
+    /* Interleaved rounds, the best of each side filters out scheduler noise */
+    double c_ns = 0, cpp_ns = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        double round_c_ns = bench_time_sequence(&handle, bench_sequence_c);
+        double round_cpp_ns = bench_time_sequence(&handle, bench_sequence_cpp);
+        if (round == 0 || round_c_ns < c_ns)
+            c_ns = round_c_ns;
+        if (round == 0 || round_cpp_ns < cpp_ns)
+            cpp_ns = round_cpp_ns;
+    }
+    printf("host CPU   : C %.1f ns, C++ %.1f ns per sequence (6 transactions)\n", c_ns, cpp_ns);
+}
+
+int main(void) {
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    ESP_LOGI(TAG, "Comparing the C++ wrapper with the C API");
+
+    /* The timing is informative, differing bus traffic fails the run */
+    bool identical = bench_transactions();
+    bench_overhead();
+
+    return identical ? 0 : 1;
+}
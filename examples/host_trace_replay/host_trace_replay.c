@@ -0,0 +1,606 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_signals.h"
+#include "esp_at42qt2120_events.h"
+#include "esp_at42qt2120_gesture.h"
+#include "esp_at42qt2120_position.h"
+#include "esp_at42qt2120_trace.h"
+#include "esp_at42qt2120_replay.h"
+#include "esp_at42qt2120_sim.h"
+
+/* Recorded session: 10 ms status polls, 20 ms signal bursts, 3 s of scripted touches on a bus with NACKs and one glitch */
+#define REPLAY_SESSION_END_US 3000000
+#define REPLAY_POLL_US 10000
+#define REPLAY_SIGNALS_EVERY 2
+#define REPLAY_GLITCH_AT_US 1800000
+#define REPLAY_GLITCH_US 30000
+#define REPLAY_NACK_PER_MILLE 5
+#define REPLAY_RING_SIZE (64 * 1024)
+/* Replay passes timed for the throughput, stopping earlier after this much host time */
+#define REPLAY_PASSES 200
+#define REPLAY_MIN_NS 5e8
+/* Lines a diff looks ahead to resynchronize, and differences it prints */
+#define REPLAY_DIFF_WINDOW 16
+#define REPLAY_DIFF_SHOWN 8
+
+static const char* TAG = "HOST_TRACE_REPLAY";
+
+/* Key 4 tap, key 7 + key 9 chord, a slider tap, a fast swipe and a slow drag, key 2 held across the glitch */
+static const at42qt2120_sim_touch_t replay_session[] = {
+    { .time_us = 300000, .key_mask = 1 << 4, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 420000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 700000, .key_mask = (1 << 7) | (1 << 9), .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 900000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1100000, .key_mask = 0, .slider_position = 60 },
+    { .time_us = 1200000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1400000, .key_mask = 0, .slider_position = 20 },
+    { .time_us = 1450000, .key_mask = 0, .slider_position = 100 },
+    { .time_us = 1500000, .key_mask = 0, .slider_position = 180 },
+    { .time_us = 1550000, .key_mask = 0, .slider_position = 240 },
+    { .time_us = 1600000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 1750000, .key_mask = 1 << 2, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 2000000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 2200000, .key_mask = 0, .slider_position = 200 },
+    { .time_us = 2400000, .key_mask = 0, .slider_position = 160 },
+    { .time_us = 2600000, .key_mask = 0, .slider_position = 120 },
+    { .time_us = 2800000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+};
+
+/* Stages a transaction is replayed through */
+typedef enum {
+    REPLAY_STAGE_DRIVER,                    // Driver call, including retries and recovery on the replay transport
+    REPLAY_STAGE_EVENTS,                    // Key and slider events from a state
+    REPLAY_STAGE_GESTURE,                   // Gestures from the slider position of a state
+    REPLAY_STAGE_FILTER,                    // Interpolated and filtered position from a signal burst
+    REPLAY_STAGE_COUNT,
+} replay_stage_t;
+
+typedef struct {
+    unsigned long calls;
+    double total_ns;
+    double max_ns;
+} replay_latency_t;
+
+/* Outputs of the stages, one line each */
+typedef struct {
+    char* text;
+    size_t size;
+    size_t capacity;
+    size_t lines;
+} replay_output_t;
+
+/* A handle and the stages fed from it, live on the simulator or on a replay */
+typedef struct {
+    at42qt2120_handle_t handle;
+    at42qt2120_event_engine_t events;
+    at42qt2120_gesture_engine_t gesture;
+    at42qt2120_position_estimator_t position;
+    bool position_touched;
+    int64_t time_us;
+    replay_output_t* output;
+    bool timed;
+    replay_latency_t latency[REPLAY_STAGE_COUNT];
+} replay_pipeline_t;
+
+static double host_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void replay_output_printf(replay_output_t* output, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static void replay_output_printf(replay_output_t* output, const char* format, ...) {
+    va_list args;
+    for (;;) {
+        va_start(args, format);
+        int length = vsnprintf(output->text + output->size, output->capacity - output->size, format, args);
+        va_end(args);
+        if (output->size + length < output->capacity)
+            break;
+        output->capacity = output->capacity * 2 + length + 256;
+        output->text = realloc(output->text, output->capacity);
+        if (output->text == NULL)
+            abort();
+    }
+    output->size += strlen(output->text + output->size);
+    output->lines++;
+}
+
+static void replay_output_free(replay_output_t* output) {
+    free(output->text);
+    *output = (replay_output_t){ 0 };
+}
+
+static inline double replay_stage_begin(const replay_pipeline_t* pipeline) {
+    return pipeline->timed ? host_time_ns() : 0;
+}
+
+static inline void replay_stage_end(replay_pipeline_t* pipeline, replay_stage_t stage, double start_ns) {
+    if (!pipeline->timed)
+        return;
+
+    double elapsed_ns = host_time_ns() - start_ns;
+    replay_latency_t* latency = &pipeline->latency[stage];
+    latency->calls++;
+    latency->total_ns += elapsed_ns;
+    if (elapsed_ns > latency->max_ns)
+        latency->max_ns = elapsed_ns;
+}
+
+static void replay_on_event(const at42qt2120_event_t* event, void* user_ctx) {
+    static const char* names[] = { "key down", "key up", "slider move", "slider release" };
+    replay_pipeline_t* pipeline = (replay_pipeline_t*)user_ctx;
+    if (pipeline->output != NULL)
+        replay_output_printf(pipeline->output, "%lld event %s key %u position %u mask 0x%03x\n", (long long)pipeline->time_us, names[event->type],
+                             event->key, event->position, event->key_mask);
+}
+
+static void replay_on_gesture(const at42qt2120_gesture_event_t* event, void* user_ctx) {
+    static const char* names[] = { "tap", "double tap", "swipe", "rotate" };
+    replay_pipeline_t* pipeline = (replay_pipeline_t*)user_ctx;
+    if (pipeline->output != NULL)
+        replay_output_printf(pipeline->output, "%lld gesture %s position %ld delta %ld velocity %ld duration %lu\n", (long long)event->time_us,
+                             names[event->type], (long)event->position, (long)event->delta, (long)event->velocity, (unsigned long)event->duration_us);
+}
+
+static esp_err_t replay_pipeline_init(replay_pipeline_t* pipeline, const at42qt2120_transport_t* transport, const at42qt2120_gesture_config_t* gesture_config,
+                                      replay_output_t* output) {
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->output = output;
+    ESP_RETURN_ON_ERROR(at42qt2120_init_with_transport(&pipeline->handle, transport, 100), TAG, "Failed to initialize handle");
+
+    at42qt2120_event_config_t event_config = AT42QT2120_EVENT_CONFIG_DEFAULT();
+    event_config.callback = replay_on_event;
+    event_config.user_ctx = pipeline;
+    ESP_RETURN_ON_ERROR(at42qt2120_event_engine_init(&pipeline->events, &pipeline->handle, &event_config), TAG, "Failed to initialize events");
+
+    at42qt2120_gesture_config_t config = *gesture_config;
+    config.callback = replay_on_gesture;
+    config.user_ctx = pipeline;
+    ESP_RETURN_ON_ERROR(at42qt2120_gesture_init(&pipeline->gesture, &config), TAG, "Failed to initialize gestures");
+
+    at42qt2120_position_config_t position_config = AT42QT2120_POSITION_CONFIG_DEFAULT();
+    position_config.wheel = gesture_config->wheel;
+    position_config.filter_shift = 2;
+    return at42qt2120_position_init(&pipeline->position, &pipeline->handle, &position_config);
+}
+
+static void replay_pipeline_deinit(replay_pipeline_t* pipeline) {
+    at42qt2120_event_engine_deinit(&pipeline->events);
+}
+
+/* Status poll: one state read feeding the event and gesture stages */
+static void replay_poll_state(replay_pipeline_t* pipeline) {
+    /* Taken before the transaction, so live and replay see the recorded start time */
+    pipeline->time_us = at42qt2120_time_us(&pipeline->handle);
+
+    at42qt2120_state_t state;
+    double start_ns = replay_stage_begin(pipeline);
+    esp_err_t ret = at42qt2120_read_state(&pipeline->handle, &state);
+    replay_stage_end(pipeline, REPLAY_STAGE_DRIVER, start_ns);
+    if (ret != ESP_OK)
+        return;
+
+    start_ns = replay_stage_begin(pipeline);
+    at42qt2120_event_engine_process(&pipeline->events, &state);
+    replay_stage_end(pipeline, REPLAY_STAGE_EVENTS, start_ns);
+
+    start_ns = replay_stage_begin(pipeline);
+    at42qt2120_gesture_feed_state(&pipeline->gesture, pipeline->time_us, &state);
+    replay_stage_end(pipeline, REPLAY_STAGE_GESTURE, start_ns);
+}
+
+/* Signal burst: signals and references of all keys feeding the position filter */
+static void replay_poll_signals(replay_pipeline_t* pipeline) {
+    pipeline->time_us = at42qt2120_time_us(&pipeline->handle);
+
+    uint16_t signals[AT42QT2120_NUM_KEYS], references[AT42QT2120_NUM_KEYS];
+    int16_t deltas[AT42QT2120_NUM_KEYS];
+    double start_ns = replay_stage_begin(pipeline);
+    esp_err_t ret = at42qt2120_read_signals_references(&pipeline->handle, signals, references, deltas);
+    replay_stage_end(pipeline, REPLAY_STAGE_DRIVER, start_ns);
+    if (ret != ESP_OK)
+        return;
+
+    at42qt2120_position_t position;
+    start_ns = replay_stage_begin(pipeline);
+    at42qt2120_position_update(&pipeline->position, deltas, &position);
+    replay_stage_end(pipeline, REPLAY_STAGE_FILTER, start_ns);
+
+    if (pipeline->output != NULL && (position.touched || pipeline->position_touched))
+        replay_output_printf(pipeline->output, "%lld position %s %u strength %u\n", (long long)pipeline->time_us, position.touched ? "touched" : "released",
+                             position.position, position.strength);
+    pipeline->position_touched = position.touched;
+}
+
+/**
+  * @brief Issues the driver call that produces the next record. Status polls and signal bursts go through the
+  *        stages, other transactions are replayed as plain register reads and writes. Retries and recovery take
+  *        the records that follow. A record no driver call takes (e.g. a probe of a recovery) is skipped.
+  */
+static void replay_dispatch(replay_pipeline_t* pipeline, at42qt2120_replay_t* replay) {
+    const at42qt2120_trace_record_t* record = at42qt2120_replay_peek(replay);
+    uint32_t replayed = replay->replayed;
+
+    if (record->op == AT42QT2120_TRACE_READ && record->reg == AT42QT2120_REG_DETECTION_STATUS && record->length == AT42QT2120_STATE_REG_COUNT) {
+        replay_poll_state(pipeline);
+    } else if (record->op == AT42QT2120_TRACE_READ && record->reg == AT42QT2120_REG_KEY_00_MSB_SIGNAL && record->length == 2 * AT42QT2120_SIGNAL_BLOCK_SIZE) {
+        replay_poll_signals(pipeline);
+    } else if (record->op != AT42QT2120_TRACE_PROBE) {
+        uint8_t buf[UINT8_MAX];
+        uint8_t reg = record->reg, length = record->length;
+        double start_ns = replay_stage_begin(pipeline);
+        if (record->op == AT42QT2120_TRACE_READ) {
+            at42qt2120_register_read(&pipeline->handle, reg, buf, length);
+        } else {
+            if (length > 0)
+                memcpy(buf, record->payload, length);
+            at42qt2120_register_write(&pipeline->handle, reg, buf, length);
+        }
+        replay_stage_end(pipeline, REPLAY_STAGE_DRIVER, start_ns);
+    }
+
+    if (replay->replayed == replayed && at42qt2120_replay_peek(replay) == record)
+        at42qt2120_replay_skip(replay);
+}
+
+/* Feeds a whole dump through a fresh pipeline */
+static esp_err_t replay_run(const uint8_t* dump, size_t size, const at42qt2120_gesture_config_t* gesture_config, replay_output_t* output, bool timed,
+                            at42qt2120_replay_t* replay, replay_pipeline_t* pipeline) {
+    ESP_RETURN_ON_ERROR(at42qt2120_replay_init(replay, dump, size), TAG, "Failed to open trace");
+    at42qt2120_transport_t transport;
+    at42qt2120_replay_transport(replay, &transport);
+    ESP_RETURN_ON_ERROR(replay_pipeline_init(pipeline, &transport, gesture_config, output), TAG, "Failed to set up pipeline");
+
+    /* Failed transactions were logged when they were recorded */
+    esp_log_level_set("*", ESP_LOG_NONE);
+    pipeline->timed = timed;
+    while (at42qt2120_replay_peek(replay) != NULL)
+        replay_dispatch(pipeline, replay);
+    replay_pipeline_deinit(pipeline);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    return ESP_OK;
+}
+
+typedef struct {
+    const char* text;
+    int length;
+} replay_line_t;
+
+/* Line boundaries of an output, which stays untouched */
+static replay_line_t* replay_output_lines(const replay_output_t* output, size_t* count) {
+    replay_line_t* lines = malloc((output->lines + 1) * sizeof(replay_line_t));
+    if (lines == NULL)
+        abort();
+    *count = 0;
+    const char* end = output->text + output->size;
+    for (const char* line = output->text; line != NULL && line < end && *count < output->lines; (*count)++) {
+        const char* newline = memchr(line, '\n', end - line);
+        lines[*count] = (replay_line_t){ .text = line, .length = (int)((newline != NULL ? newline : end) - line) };
+        line = newline != NULL ? newline + 1 : NULL;
+    }
+    return lines;
+}
+
+static inline bool replay_line_equal(const replay_line_t* left, const replay_line_t* right) {
+    return left->length == right->length && memcmp(left->text, right->text, left->length) == 0;
+}
+
+/**
+  * @brief Compares expected and actual outputs line by line. After a difference both sides look ahead
+  *        REPLAY_DIFF_WINDOW lines for the nearest common line to resynchronize. Returns the lines that differ.
+  */
+static size_t replay_diff(const replay_output_t* expected, const replay_output_t* actual) {
+    size_t left_count, right_count;
+    replay_line_t* left = replay_output_lines(expected, &left_count);
+    replay_line_t* right = replay_output_lines(actual, &right_count);
+    size_t i = 0, j = 0, differences = 0;
+
+    while (i < left_count || j < right_count) {
+        if (i < left_count && j < right_count && replay_line_equal(&left[i], &right[j])) {
+            i++;
+            j++;
+            continue;
+        }
+
+        /* Smallest skip on either side that lands on a common line, otherwise one line from each */
+        size_t skip_left = i < left_count ? 1 : 0, skip_right = j < right_count ? 1 : 0;
+        bool found = false;
+        for (size_t distance = 1; distance <= 2 * REPLAY_DIFF_WINDOW && !found; distance++) {
+            for (size_t a = 0; a <= distance && !found; a++) {
+                size_t b = distance - a;
+                if (a <= REPLAY_DIFF_WINDOW && b <= REPLAY_DIFF_WINDOW && i + a < left_count && j + b < right_count &&
+                    replay_line_equal(&left[i + a], &right[j + b])) {
+                    skip_left = a;
+                    skip_right = b;
+                    found = true;
+                }
+            }
+        }
+
+        for (size_t k = 0; k < skip_left; k++, i++, differences++)
+            if (differences < REPLAY_DIFF_SHOWN)
+                printf("  - %.*s\n", left[i].length, left[i].text);
+        for (size_t k = 0; k < skip_right; k++, j++, differences++)
+            if (differences < REPLAY_DIFF_SHOWN)
+                printf("  + %.*s\n", right[j].length, right[j].text);
+    }
+    if (differences > REPLAY_DIFF_SHOWN)
+        printf("  ... %zu more\n", differences - REPLAY_DIFF_SHOWN);
+
+    free(left);
+    free(right);
+    return differences;
+}
+
+static void replay_print_stats(const at42qt2120_replay_t* replay, const replay_output_t* output) {
+    printf("records: %lu replayed, %lu skipped, %lu mismatched transactions, %lu writes with other data, %lu unrecorded probes\n",
+           (unsigned long)replay->replayed, (unsigned long)replay->skipped, (unsigned long)replay->mismatches, (unsigned long)replay->write_diffs,
+           (unsigned long)replay->extra_probes);
+    if (replay->status != ESP_ERR_NOT_FOUND)
+        printf("trace truncated after %lu records\n", (unsigned long)(replay->replayed + replay->skipped));
+    printf("outputs: %zu lines\n", output->lines);
+}
+
+static void replay_print_latency(const replay_pipeline_t* pipeline) {
+    static const char* names[] = { "driver", "events", "gesture", "filter" };
+    for (int stage = 0; stage < REPLAY_STAGE_COUNT; stage++) {
+        const replay_latency_t* latency = &pipeline->latency[stage];
+        if (latency->calls > 0)
+            printf("  %-8s: %6lu calls, %7.1f ns mean, %8.1f ns max\n", names[stage], latency->calls, latency->total_ns / latency->calls, latency->max_ns);
+    }
+}
+
+/* Replays a dump until enough host time has passed, without outputs or stage timers */
+static void replay_throughput(const uint8_t* dump, size_t size, const at42qt2120_gesture_config_t* gesture_config) {
+    at42qt2120_replay_t replay;
+    replay_pipeline_t pipeline;
+    unsigned long records = 0;
+    int passes = 0;
+    double start_ns = host_time_ns();
+    while (passes < REPLAY_PASSES && (passes == 0 || host_time_ns() - start_ns < REPLAY_MIN_NS)) {
+        if (replay_run(dump, size, gesture_config, NULL, false, &replay, &pipeline) != ESP_OK)
+            return;
+        records += replay.replayed + replay.skipped;
+        passes++;
+    }
+
+    double elapsed_ns = host_time_ns() - start_ns;
+    printf("throughput: %d passes, %.0f records/s, %.1f ns per record, %.1f MB/s of trace\n", passes, records / elapsed_ns * 1e9, elapsed_ns / records,
+           (double)size * passes / elapsed_ns * 1e3);
+}
+
+static uint8_t* replay_load(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    uint8_t* data = NULL;
+    size_t capacity = 0;
+    *size = 0;
+    for (;;) {
+        if (*size == capacity) {
+            capacity = capacity * 2 + 4096;
+            data = realloc(data, capacity);
+            if (data == NULL)
+                abort();
+        }
+        size_t read = fread(data + *size, 1, capacity - *size, file);
+        if (read == 0)
+            break;
+        *size += read;
+    }
+    fclose(file);
+    return data;
+}
+
+static bool replay_save(const char* path, const void* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+    bool ok = fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
+
+static replay_output_t replay_output_from(uint8_t* text, size_t size) {
+    replay_output_t output = { .text = (char*)text, .size = size, .capacity = size };
+    for (size_t index = 0; index < size; index++)
+        output.lines += text[index] == '\n';
+    if (size > 0 && text[size - 1] != '\n')
+        output.lines++;
+    return output;
+}
+
+/**
+  * @brief Records the scripted session live on the simulator, through the recorder, with the stages producing
+  *        the outputs the replays are compared with.
+  */
+static esp_err_t replay_record_session(uint8_t** dump, size_t* size, const at42qt2120_gesture_config_t* gesture_config, replay_output_t* output) {
+    static at42qt2120_sim_t sim;
+    static uint8_t ring[REPLAY_RING_SIZE];
+    at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+    at42qt2120_sim_init(&sim, &sim_config);
+    at42qt2120_sim_set_trace(&sim, replay_session, sizeof(replay_session) / sizeof(replay_session[0]));
+    at42qt2120_sim_faults_t faults = { .nack_per_mille = REPLAY_NACK_PER_MILLE, .seed = 19 };
+    at42qt2120_sim_set_faults(&sim, &faults);
+
+    at42qt2120_transport_t sim_transport, transport;
+    at42qt2120_sim_transport(&sim, &sim_transport);
+    at42qt2120_trace_t trace;
+    ESP_RETURN_ON_ERROR(at42qt2120_trace_init(&trace, ring, sizeof(ring), &sim_transport, &transport), TAG, "Failed to set up recorder");
+
+    replay_pipeline_t pipeline;
+    ESP_RETURN_ON_ERROR(replay_pipeline_init(&pipeline, &transport, gesture_config, output), TAG, "Failed to set up pipeline");
+    /* Let the power-on calibration finish */
+    at42qt2120_sim_advance(&sim, 200000);
+    at42qt2120_enable_slider(&pipeline.handle);
+
+    /* The injected faults make some signal bursts fail, which the driver logs */
+    esp_log_level_set("*", ESP_LOG_NONE);
+    bool glitched = false;
+    for (int64_t poll = 1; sim.now_us < REPLAY_SESSION_END_US; poll++) {
+        at42qt2120_sim_advance_to(&sim, 200000 + poll * REPLAY_POLL_US);
+        if (!glitched && sim.now_us >= REPLAY_GLITCH_AT_US) {
+            at42qt2120_sim_glitch(&sim, REPLAY_GLITCH_US);
+            glitched = true;
+        }
+        replay_poll_state(&pipeline);
+        if (poll % REPLAY_SIGNALS_EVERY == 0)
+            replay_poll_signals(&pipeline);
+    }
+    replay_pipeline_deinit(&pipeline);
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    at42qt2120_recovery_stats_t recovery;
+    at42qt2120_get_recovery_stats(&pipeline.handle, &recovery);
+    *size = at42qt2120_trace_dump_size(&trace);
+    *dump = malloc(*size);
+    if (*dump == NULL)
+        abort();
+    ESP_RETURN_ON_ERROR(at42qt2120_trace_dump(&trace, *dump, *size, size), TAG, "Failed to dump trace");
+    printf("recorded: %lu records in %zu bytes (%.1f bytes per record), %lu dropped, %lu injected NACKs, %lu retries, %lu recoveries\n",
+           (unsigned long)trace.records, *size, (double)trace.used / trace.records, (unsigned long)trace.dropped, (unsigned long)sim.injected_nacks,
+           (unsigned long)recovery.retries, (unsigned long)recovery.recoveries);
+    printf("outputs: %zu lines\n", output->lines);
+    return ESP_OK;
+}
+
+/* Without a trace: record the session, replay it, compare with the live outputs and with a changed gesture configuration */
+static int replay_demo(const char* trace_path, const char* output_path) {
+    at42qt2120_gesture_config_t gesture_config = AT42QT2120_GESTURE_CONFIG_DEFAULT();
+
+    printf("== Recording %d ms on the simulator (%d ms status polls, signal bursts every %d ms, %d per mille NACKs, %d ms glitch) ==\n",
+           REPLAY_SESSION_END_US / 1000, REPLAY_POLL_US / 1000, REPLAY_SIGNALS_EVERY * REPLAY_POLL_US / 1000, REPLAY_NACK_PER_MILLE, REPLAY_GLITCH_US / 1000);
+    uint8_t* dump;
+    size_t size;
+    replay_output_t live = { 0 };
+    if (replay_record_session(&dump, &size, &gesture_config, &live) != ESP_OK)
+        return 1;
+    if (trace_path != NULL && !replay_save(trace_path, dump, size))
+        ESP_LOGE(TAG, "Failed to write %s", trace_path);
+    if (output_path != NULL && !replay_save(output_path, live.text, live.size))
+        ESP_LOGE(TAG, "Failed to write %s", output_path);
+
+    printf("\n== Replay ==\n");
+    at42qt2120_replay_t replay;
+    replay_pipeline_t pipeline;
+    replay_output_t replayed = { 0 }, repeated = { 0 };
+    if (replay_run(dump, size, &gesture_config, &replayed, true, &replay, &pipeline) != ESP_OK)
+        return 1;
+    replay_print_stats(&replay, &replayed);
+    replay_print_latency(&pipeline);
+    replay_throughput(dump, size, &gesture_config);
+
+    replay_run(dump, size, &gesture_config, &repeated, false, &replay, &pipeline);
+    size_t live_differences = replay_diff(&live, &replayed);
+    size_t repeat_differences = replay_diff(&replayed, &repeated);
+    printf("differences: %zu against the live run, %zu between two replays\n", live_differences, repeat_differences);
+
+    printf("\n== Replay with swipe_min_travel 120 and tap_max_duration_us 60000 ==\n");
+    gesture_config.swipe_min_travel = 120;
+    gesture_config.tap_max_duration_us = 60000;
+    replay_output_t changed = { 0 };
+    replay_run(dump, size, &gesture_config, &changed, false, &replay, &pipeline);
+    printf("differences: %zu\n", replay_diff(&replayed, &changed));
+
+    replay_output_free(&live);
+    replay_output_free(&replayed);
+    replay_output_free(&repeated);
+    replay_output_free(&changed);
+    free(dump);
+    return live_differences == 0 && repeat_differences == 0 ? 0 : 1;
+}
+
+/* With a trace: replay it once with outputs and stage timers, compare with expected outputs, measure the throughput */
+static int replay_file(const char* trace_path, const char* expected_path, const char* output_path, bool wheel) {
+    size_t size;
+    uint8_t* dump = replay_load(trace_path, &size);
+    if (dump == NULL) {
+        ESP_LOGE(TAG, "Failed to read %s", trace_path);
+        return 1;
+    }
+
+    at42qt2120_gesture_config_t gesture_config = AT42QT2120_GESTURE_CONFIG_DEFAULT();
+    gesture_config.wheel = wheel;
+    at42qt2120_replay_t replay;
+    replay_pipeline_t pipeline;
+    replay_output_t output = { 0 };
+    if (replay_run(dump, size, &gesture_config, &output, true, &replay, &pipeline) != ESP_OK) {
+        free(dump);
+        return 1;
+    }
+
+    printf("== Replay of %s: %zu bytes, %lu records, %lu dropped while recording ==\n", trace_path, size, (unsigned long)replay.reader.records,
+           (unsigned long)replay.reader.dropped);
+    replay_print_stats(&replay, &output);
+    replay_print_latency(&pipeline);
+    replay_throughput(dump, size, &gesture_config);
+    if (output_path != NULL && !replay_save(output_path, output.text, output.size))
+        ESP_LOGE(TAG, "Failed to write %s", output_path);
+
+    int status = replay.status == ESP_ERR_NOT_FOUND ? 0 : 1;
+    if (expected_path != NULL) {
+        size_t expected_size;
+        uint8_t* text = replay_load(expected_path, &expected_size);
+        if (text == NULL) {
+            ESP_LOGE(TAG, "Failed to read %s", expected_path);
+            status = 1;
+        } else {
+            replay_output_t expected = replay_output_from(text, expected_size);
+            size_t differences = replay_diff(&expected, &output);
+            printf("differences: %zu against %s\n", differences, expected_path);
+            if (differences > 0)
+                status = 1;
+            replay_output_free(&expected);
+        }
+    }
+
+    replay_output_free(&output);
+    free(dump);
+    return status;
+}
+
+int main(int argc, char** argv) {
+    const char* trace_path = NULL;
+    const char* expected_path = NULL;
+    const char* output_path = NULL;
+    bool wheel = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "w:e:o:W")) != -1) {
+        switch (option) {
+        case 'w':
+            trace_path = optarg;
+            break;
+        case 'e':
+            expected_path = optarg;
+            break;
+        case 'o':
+            output_path = optarg;
+            break;
+        case 'W':
+            wheel = true;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-w trace] [-o outputs]                  record the demo session, replay and compare it\n"
+                            "       %s [-e expected] [-o outputs] [-W] trace  replay a dumped trace (-W: wheel)\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+
+    if (optind < argc)
+        return replay_file(argv[optind], expected_path, output_path, wheel);
+    return replay_demo(trace_path, output_path);
+}
@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <string.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_check.h>
+
+#include "esp_at42qt2120_replay.h"
+
+static const char* TAG = "esp_at42qt2120_replay";
+
+/* Loads the record after the current one, or notes why there is none */
+static void at42qt2120_replay_advance(at42qt2120_replay_t* replay) {
+    replay->status = at42qt2120_trace_next(&replay->reader, &replay->record);
+    replay->pending = replay->status == ESP_OK;
+}
+
+/* Takes the next record if it is the given transaction, moving the time to its start */
+static const at42qt2120_trace_record_t* at42qt2120_replay_match(at42qt2120_replay_t* replay, at42qt2120_trace_op_t op, uint8_t reg, size_t length) {
+    const at42qt2120_trace_record_t* record = &replay->record;
+    if (!replay->pending || record->op != op || (op != AT42QT2120_TRACE_PROBE && (record->reg != reg || record->length != length)))
+        return NULL;
+
+    if (record->time_us > replay->now_us)
+        replay->now_us = record->time_us;
+    replay->replayed++;
+    return record;
+}
+
+static esp_err_t at42qt2120_replay_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms) {
+    (void)timeout_ms;
+    at42qt2120_replay_t* replay = (at42qt2120_replay_t*)ctx;
+    const at42qt2120_trace_record_t* record = at42qt2120_replay_match(replay, AT42QT2120_TRACE_READ, write_size > 0 ? write_buf[0] : 0, read_size);
+    if (record == NULL) {
+        replay->mismatches++;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    esp_err_t ret = record->result;
+    if (ret == ESP_OK)
+        memcpy(read_buf, record->payload, read_size);
+    at42qt2120_replay_advance(replay);
+    return ret;
+}
+
+static esp_err_t at42qt2120_replay_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    (void)timeout_ms;
+    at42qt2120_replay_t* replay = (at42qt2120_replay_t*)ctx;
+    size_t length = write_size > 0 ? write_size - 1 : 0;
+    const at42qt2120_trace_record_t* record = at42qt2120_replay_match(replay, AT42QT2120_TRACE_WRITE, write_size > 0 ? write_buf[0] : 0, length);
+    if (record == NULL) {
+        replay->mismatches++;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (length > 0 && memcmp(write_buf + 1, record->payload, length) != 0)
+        replay->write_diffs++;
+    esp_err_t ret = record->result;
+    at42qt2120_replay_advance(replay);
+    return ret;
+}
+
+static esp_err_t at42qt2120_replay_probe(void* ctx, int timeout_ms) {
+    (void)timeout_ms;
+    at42qt2120_replay_t* replay = (at42qt2120_replay_t*)ctx;
+    const at42qt2120_trace_record_t* record = at42qt2120_replay_match(replay, AT42QT2120_TRACE_PROBE, 0, 0);
+    if (record == NULL) {
+        replay->extra_probes++;
+        return ESP_OK;
+    }
+
+    esp_err_t ret = record->result;
+    at42qt2120_replay_advance(replay);
+    return ret;
+}
+
+static void at42qt2120_replay_delay_ms(void* ctx, uint32_t delay_ms) {
+    at42qt2120_replay_t* replay = (at42qt2120_replay_t*)ctx;
+    replay->now_us += (int64_t)delay_ms * 1000;
+}
+
+static int64_t at42qt2120_replay_time_us(void* ctx) {
+    at42qt2120_replay_t* replay = (at42qt2120_replay_t*)ctx;
+    if (replay->pending && replay->record.time_us > replay->now_us)
+        return replay->record.time_us;
+    return replay->now_us;
+}
+
+static const at42qt2120_transport_ops_t at42qt2120_replay_transport_ops = {
+    .transmit_receive = at42qt2120_replay_transmit_receive,
+    .transmit = at42qt2120_replay_transmit,
+    .probe = at42qt2120_replay_probe,
+    .release = NULL,
+    .delay_ms = at42qt2120_replay_delay_ms,
+    .time_us = at42qt2120_replay_time_us,
+};
+
+/**
+  * @brief Opens the dump and loads its first record. The time starts at the base time of the dump.
+  */
+esp_err_t at42qt2120_replay_init(at42qt2120_replay_t* replay, const uint8_t* dump, size_t size) {
+    ESP_RETURN_ON_FALSE(replay != NULL, ESP_ERR_INVALID_ARG, TAG, "replay is NULL!");
+
+    memset(replay, 0, sizeof(*replay));
+    ESP_RETURN_ON_ERROR(at42qt2120_trace_reader_init(&replay->reader, dump, size), TAG, "Invalid trace");
+    replay->now_us = replay->reader.time_us;
+    at42qt2120_replay_advance(replay);
+    return ESP_OK;
+}
+
+void at42qt2120_replay_transport(at42qt2120_replay_t* replay, at42qt2120_transport_t* transport) {
+    transport->ops = &at42qt2120_replay_transport_ops;
+    transport->ctx = replay;
+}
+
+const at42qt2120_trace_record_t* at42qt2120_replay_peek(const at42qt2120_replay_t* replay) {
+    return replay->pending ? &replay->record : NULL;
+}
+
+void at42qt2120_replay_skip(at42qt2120_replay_t* replay) {
+    if (!replay->pending)
+        return;
+    replay->skipped++;
+    at42qt2120_replay_advance(replay);
+}
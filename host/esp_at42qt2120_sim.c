@@ -0,0 +1,700 @@
+#include <stdlib.h>
+#include <string.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_sim.h"
+#include "esp_at42qt2120_defines.h"
+
+/* Measurement interval per unit of AT42QT2120_REG_LOW_POWER_MODE */
+#define AT42QT2120_SIM_LP_STEP_US 8000
+/* Spacing of the confirmation measurements while a detection integrator is counting up (fast-in DI) */
+#define AT42QT2120_SIM_FAST_DI_US 2000
+/* Spacing between the slider/wheel key centres in 1/256 position units (8-bit position scaled by 256) */
+#define AT42QT2120_SIM_SLIDER_PITCH ((255 * 256) / (AT42QT2120_SLIDER_NUM_KEYS - 1))
+#define AT42QT2120_SIM_WHEEL_PITCH ((256 * 256) / AT42QT2120_SLIDER_NUM_KEYS)
+/* Unit of the drift, drift hold and recalibration delay registers */
+#define AT42QT2120_SIM_DRIFT_STEP_US 160000
+/* Standard deviation of the sum of four uniform 16-bit samples, the noise generator's unit */
+#define AT42QT2120_SIM_NOISE_SIGMA 37837
+
+/* Power-on values of the setup registers 0x08-0x33 */
+static void at42qt2120_sim_load_defaults(at42qt2120_sim_t* sim) {
+    uint8_t* regs = sim->regs;
+
+    memset(&regs[AT42QT2120_REG_CONFIG_FIRST], 0, AT42QT2120_CONFIG_REG_COUNT);
+    regs[AT42QT2120_REG_LOW_POWER_MODE] = 2;
+    regs[AT42QT2120_REG_TTD_MODE] = 20;
+    regs[AT42QT2120_REG_ATD_MODE] = 5;
+    regs[AT42QT2120_REG_DETECTION_INTEGRATOR] = 4;
+    regs[AT42QT2120_REG_TOUCH_RECAL_DELAY] = 255;
+    regs[AT42QT2120_REG_DRIFT_HOLD_TIME] = 25;
+    memset(&regs[AT42QT2120_REG_KEY_00_DTHR], 10, AT42QT2120_NUM_KEYS);
+}
+
+static inline uint16_t at42qt2120_sim_baseline(const at42qt2120_sim_t* sim, int key) {
+    return sim->config.reference_base + 7 * key;
+}
+
+/* Untouched signal of a key: its baseline moved by the environmental drift */
+static int32_t at42qt2120_sim_environment(const at42qt2120_sim_t* sim, int key) {
+    int64_t drift_mc = sim->drift_base_mc[key] + (int64_t)sim->drift_rates[key] * (sim->now_us - sim->drift_since_us) / 1000000;
+    return at42qt2120_sim_baseline(sim, key) + (int32_t)(drift_mc / 1000);
+}
+
+static inline void at42qt2120_sim_put_word(uint8_t* regs, uint8_t reg, uint16_t value) {
+    regs[reg] = value >> 8;
+    regs[reg + 1] = value & 0xFF;
+}
+
+static const at42qt2120_sim_touch_t* at42qt2120_sim_current_touch(at42qt2120_sim_t* sim) {
+    if (sim->trace == NULL)
+        return &sim->touch;
+
+    /* Traces are sorted and time only moves forward, so the active step never moves back */
+    while (sim->trace_index + 1 < sim->trace_length && sim->trace[sim->trace_index + 1].time_us <= sim->now_us)
+        sim->trace_index++;
+
+    static const at42qt2120_sim_touch_t no_touch = { .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH };
+    if (sim->trace_length == 0 || sim->trace[sim->trace_index].time_us > sim->now_us)
+        return &no_touch;
+    return &sim->trace[sim->trace_index];
+}
+
+/* Spreads a slider/wheel touch over keys 0-2 with a triangular response centred on each key */
+static void at42qt2120_sim_slider_deltas(const at42qt2120_sim_t* sim, const at42qt2120_sim_touch_t* touch, bool wheel, int32_t deltas[AT42QT2120_NUM_KEYS]) {
+    int32_t scaled_position = touch->slider_position * 256 + touch->slider_fraction;
+    int32_t pitch = wheel ? AT42QT2120_SIM_WHEEL_PITCH : AT42QT2120_SIM_SLIDER_PITCH;
+
+    for (int key = 0; key < AT42QT2120_SLIDER_NUM_KEYS; key++) {
+        int32_t distance = abs(scaled_position - key * pitch);
+        if (wheel && distance > 128 * 256)
+            distance = 256 * 256 - distance;
+        if (distance < pitch)
+            deltas[key] = (int32_t)sim->config.touch_delta * (pitch - distance) / pitch;
+    }
+}
+
+/* xorshift32 on its own state, so noise does not shift the fault sequence */
+static uint32_t at42qt2120_sim_noise_random(at42qt2120_sim_t* sim) {
+    uint32_t state = sim->noise_state;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    sim->noise_state = state;
+    return state;
+}
+
+/* Approximately normal sample scaled to sigma_cc: the sum of four uniform samples */
+static int64_t at42qt2120_sim_noise(at42qt2120_sim_t* sim, uint32_t sigma_cc) {
+    if (sigma_cc == 0)
+        return 0;
+
+    int64_t sum = 0;
+    for (int index = 0; index < 4; index++)
+        sum += (int64_t)(at42qt2120_sim_noise_random(sim) & 0xFFFF) - 32768;
+    return sum * sigma_cc / AT42QT2120_SIM_NOISE_SIGMA;
+}
+
+/* Measured signal of every key: environment plus the touch currently applied, accumulated over the burst of the key */
+static void at42qt2120_sim_signals(at42qt2120_sim_t* sim, int32_t signals[AT42QT2120_NUM_KEYS]) {
+    const uint8_t* regs = sim->regs;
+    const at42qt2120_sim_touch_t* touch = at42qt2120_sim_current_touch(sim);
+    bool slider_enabled = (regs[AT42QT2120_REG_SLIDER_OPTIONS] & AT42QT2120_SLIDER_OPTIONS_EN) != 0;
+    bool wheel = (regs[AT42QT2120_REG_SLIDER_OPTIONS] & AT42QT2120_SLIDER_OPTIONS_WHEEL) != 0;
+    int first_key = slider_enabled ? AT42QT2120_SLIDER_NUM_KEYS : 0;
+
+    int32_t deltas[AT42QT2120_NUM_KEYS] = { 0 };
+    for (int key = first_key; key < AT42QT2120_NUM_KEYS; key++) {
+        if (touch->key_mask & (1 << key))
+            deltas[key] = sim->config.touch_delta;
+    }
+    if (slider_enabled && touch->slider_position != AT42QT2120_SIM_NO_SLIDER_TOUCH)
+        at42qt2120_sim_slider_deltas(sim, touch, wheel, deltas);
+
+    /* Noise common to all keys is correlated over a burst, it adds up linearly with the pulses */
+    const at42qt2120_sim_sensor_t* sensor = &sim->sensor;
+    int64_t common_cc = at42qt2120_sim_noise(sim, sensor->common_noise_cc);
+    uint8_t charge_time = regs[AT42QT2120_REG_CHARGE_TIME];
+
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        const at42qt2120_sim_key_model_t* model = &sensor->keys[key];
+        uint8_t pulse = regs[AT42QT2120_REG_KEY_00_PULSE_SCALE + key] >> 4;
+        uint8_t scale = regs[AT42QT2120_REG_KEY_00_PULSE_SCALE + key] & 0x0F;
+
+        int64_t delta = deltas[key];
+        if (model->touch_delta != 0 && sim->config.touch_delta != 0)
+            delta = delta * model->touch_delta / sim->config.touch_delta;
+        int32_t efficiency_pm = 1000 - (charge_time < 16 ? model->charge_loss_pm >> charge_time : 0);
+
+        /* One pulse in 1/100 counts, summed over 2^pulse pulses; uncorrelated noise grows with sqrt(2^pulse) only */
+        int64_t pulse_cc = (int64_t)at42qt2120_sim_environment(sim, key) * 100 + delta * efficiency_pm / 10 + common_cc;
+        int64_t sqrt_pulses_q8 = (int64_t)((pulse & 1) ? 362 : 256) << (pulse / 2);
+        int64_t sum_cc = (pulse_cc << pulse) + at42qt2120_sim_noise(sim, model->noise_cc) * sqrt_pulses_q8 / 256;
+
+        int64_t divisor = (int64_t)100 << scale;
+        int64_t signal = (sum_cc + divisor / 2) / divisor;
+        signals[key] = signal < 0 ? 0 : (signal > UINT16_MAX ? UINT16_MAX : (int32_t)signal);
+    }
+}
+
+/*
+ * Drift compensation: while nothing is in detect and the drift hold time has passed, each reference
+ * follows its signal by one count per TTD (signal above the reference) or ATD (below) 160 ms steps.
+ */
+static void at42qt2120_sim_drift(at42qt2120_sim_t* sim, const int32_t signals[AT42QT2120_NUM_KEYS], bool detected) {
+    const uint8_t* regs = sim->regs;
+    if (detected) {
+        sim->drift_hold_until_us = sim->now_us + (int64_t)regs[AT42QT2120_REG_DRIFT_HOLD_TIME] * AT42QT2120_SIM_DRIFT_STEP_US;
+        for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+            sim->drift_step_us[key] = sim->now_us;
+        return;
+    }
+    if (sim->now_us < sim->drift_hold_until_us)
+        return;
+
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        int32_t difference = signals[key] - sim->references[key];
+        uint8_t rate = difference > 0 ? regs[AT42QT2120_REG_TTD_MODE] : regs[AT42QT2120_REG_ATD_MODE];
+        if (difference == 0 || rate == 0) {
+            sim->drift_step_us[key] = sim->now_us;
+            continue;
+        }
+        if (sim->now_us - sim->drift_step_us[key] < (int64_t)rate * AT42QT2120_SIM_DRIFT_STEP_US)
+            continue;
+        sim->references[key] += difference > 0 ? 1 : -1;
+        sim->drift_step_us[key] = sim->now_us;
+    }
+}
+
+static int64_t at42qt2120_sim_measurement_interval_us(const at42qt2120_sim_t* sim) {
+    /* A low power mode of 0 stops measurements altogether */
+    return (int64_t)sim->regs[AT42QT2120_REG_LOW_POWER_MODE] * AT42QT2120_SIM_LP_STEP_US;
+}
+
+int64_t at42qt2120_sim_burst_us(const at42qt2120_sim_t* sim) {
+    int64_t pulse_us = AT42QT2120_SIM_PULSE_US + (int64_t)sim->regs[AT42QT2120_REG_CHARGE_TIME] * AT42QT2120_SIM_CHARGE_STEP_US;
+    int64_t burst_us = 0;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        burst_us += pulse_us << (sim->regs[AT42QT2120_REG_KEY_00_PULSE_SCALE + key] >> 4);
+    return burst_us;
+}
+
+/* One acquisition cycle: signals, detection integrator, status registers and CHANGE. Returns true while a detection is being confirmed */
+static bool at42qt2120_sim_measure(at42qt2120_sim_t* sim) {
+    uint8_t* regs = sim->regs;
+    const at42qt2120_sim_touch_t* touch = at42qt2120_sim_current_touch(sim);
+    bool slider_enabled = (regs[AT42QT2120_REG_SLIDER_OPTIONS] & AT42QT2120_SLIDER_OPTIONS_EN) != 0;
+    int first_key = slider_enabled ? AT42QT2120_SLIDER_NUM_KEYS : 0;
+    bool calibrating = sim->calibrate_until_us != 0;
+    sim->measurements++;
+
+    int32_t signals[AT42QT2120_NUM_KEYS];
+    int32_t deltas[AT42QT2120_NUM_KEYS];
+    at42qt2120_sim_signals(sim, signals);
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        deltas[key] = signals[key] - sim->references[key];
+        at42qt2120_sim_put_word(regs, AT42QT2120_REG_KEY_00_MSB_SIGNAL + 2 * key, (uint16_t)signals[key]);
+        at42qt2120_sim_put_word(regs, AT42QT2120_REG_KEY_00_MSB_REFERENCE + 2 * key, sim->references[key]);
+    }
+
+    /* A key enters detect after detection_integrator consecutive measurements above its threshold */
+    uint8_t integrator_limit = regs[AT42QT2120_REG_DETECTION_INTEGRATOR] ? regs[AT42QT2120_REG_DETECTION_INTEGRATOR] : 1;
+    uint16_t key_mask = 0;
+    for (int key = first_key; key < AT42QT2120_NUM_KEYS; key++) {
+        uint8_t threshold = regs[AT42QT2120_REG_KEY_00_DTHR + key];
+        if (!calibrating && threshold != 0 && deltas[key] >= threshold) {
+            if (sim->integrator[key] < integrator_limit)
+                sim->integrator[key]++;
+        } else {
+            sim->integrator[key] = 0;
+        }
+        if (sim->integrator[key] >= integrator_limit)
+            key_mask |= 1 << key;
+    }
+
+    bool slider_detected = false;
+    if (slider_enabled) {
+        int32_t slider_delta = deltas[0] + deltas[1] + deltas[2];
+        uint8_t threshold = regs[AT42QT2120_REG_KEY_00_DTHR];
+        if (!calibrating && threshold != 0 && slider_delta >= threshold) {
+            if (sim->slider_integrator < integrator_limit)
+                sim->slider_integrator++;
+        } else {
+            sim->slider_integrator = 0;
+        }
+        slider_detected = sim->slider_integrator >= integrator_limit;
+        if (slider_detected)
+            regs[AT42QT2120_REG_SLIDER_POSITION] = (uint8_t)touch->slider_position;
+    }
+    if (!calibrating)
+        at42qt2120_sim_drift(sim, signals, key_mask != 0 || slider_detected);
+
+    uint8_t detection_status = 0;
+    if (key_mask != 0 || slider_detected)
+        detection_status |= AT42QT2120_DETECTION_STATUS_TDET;
+    if (slider_detected)
+        detection_status |= AT42QT2120_DETECTION_STATUS_SDET;
+    if (calibrating)
+        detection_status |= AT42QT2120_DETECTION_STATUS_CALIBRATE;
+    /* The burst did not fit in the measurement interval */
+    if (at42qt2120_sim_burst_us(sim) > at42qt2120_sim_measurement_interval_us(sim)) {
+        detection_status |= AT42QT2120_DETECTION_STATUS_OVERFLOW;
+        sim->overflows++;
+    }
+
+    regs[AT42QT2120_REG_DETECTION_STATUS] = detection_status;
+    regs[AT42QT2120_REG_KEY_STATUS_07_00] = key_mask & 0xFF;
+    regs[AT42QT2120_REG_KEY_STATUS_11_08] = key_mask >> 8;
+
+    if (memcmp(&regs[AT42QT2120_REG_DETECTION_STATUS], sim->reported_status, sizeof(sim->reported_status)) != 0)
+        sim->change_pending = true;
+
+    for (int key = first_key; key < AT42QT2120_NUM_KEYS; key++) {
+        if (sim->integrator[key] > 0 && sim->integrator[key] < integrator_limit)
+            return true;
+    }
+    return slider_enabled && sim->slider_integrator > 0 && sim->slider_integrator < integrator_limit;
+}
+
+static void at42qt2120_sim_start_calibration(at42qt2120_sim_t* sim, int64_t start_us) {
+    sim->calibrate_until_us = start_us + sim->config.calibrate_time_us;
+    sim->regs[AT42QT2120_REG_DETECTION_STATUS] |= AT42QT2120_DETECTION_STATUS_CALIBRATE;
+}
+
+/* The references take the signals of the moment, including a finger or object resting on a key */
+static void at42qt2120_sim_finish_calibration(at42qt2120_sim_t* sim) {
+    int32_t signals[AT42QT2120_NUM_KEYS];
+    at42qt2120_sim_signals(sim, signals);
+
+    sim->calibrate_until_us = 0;
+    sim->drift_hold_until_us = 0;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        sim->references[key] = (uint16_t)signals[key];
+        sim->integrator[key] = 0;
+        sim->drift_step_us[key] = sim->now_us;
+    }
+    sim->slider_integrator = 0;
+}
+
+void at42qt2120_sim_advance_to(at42qt2120_sim_t* sim, int64_t time_us) {
+    while (true) {
+        int64_t interval_us = at42qt2120_sim_measurement_interval_us(sim);
+        int64_t measurement_us = interval_us > 0 ? sim->next_measurement_us : INT64_MAX;
+        int64_t calibration_us = sim->calibrate_until_us != 0 ? sim->calibrate_until_us : INT64_MAX;
+        int64_t next_us = measurement_us < calibration_us ? measurement_us : calibration_us;
+        if (next_us > time_us)
+            break;
+
+        sim->now_us = next_us;
+        if (calibration_us == next_us)
+            at42qt2120_sim_finish_calibration(sim);
+        bool confirming = at42qt2120_sim_measure(sim);
+        /* The device skips its low power sleep until a detection is confirmed or rejected; no measurement is shorter than its burst */
+        if (measurement_us == next_us) {
+            int64_t spacing_us = confirming && interval_us > AT42QT2120_SIM_FAST_DI_US ? AT42QT2120_SIM_FAST_DI_US : interval_us;
+            int64_t burst_us = at42qt2120_sim_burst_us(sim);
+            sim->next_measurement_us = next_us + (burst_us > spacing_us ? burst_us : spacing_us);
+        }
+    }
+
+    if (time_us > sim->now_us)
+        sim->now_us = time_us;
+}
+
+void at42qt2120_sim_advance(at42qt2120_sim_t* sim, int64_t time_us) {
+    at42qt2120_sim_advance_to(sim, sim->now_us + time_us);
+}
+
+static void at42qt2120_sim_reset(at42qt2120_sim_t* sim) {
+    sim->busy_until_us = sim->now_us + sim->config.reset_time_us;
+    at42qt2120_sim_load_defaults(sim);
+    memset(&sim->regs[AT42QT2120_REG_DETECTION_STATUS], 0, 4);
+    memset(sim->integrator, 0, sizeof(sim->integrator));
+    sim->slider_integrator = 0;
+
+    /* Measurements resume with the calibration that follows the reset. CHANGE asserts once it is done */
+    at42qt2120_sim_start_calibration(sim, sim->busy_until_us);
+    sim->next_measurement_us = sim->busy_until_us;
+    memset(sim->reported_status, 0xFF, sizeof(sim->reported_status));
+}
+
+void at42qt2120_sim_init(at42qt2120_sim_t* sim, const at42qt2120_sim_config_t* config) {
+    memset(sim, 0, sizeof(*sim));
+    sim->config = *config;
+    sim->touch.slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH;
+    sim->regs[AT42QT2120_REG_CHIP_ID] = AT42QT2120_SIM_CHIP_ID;
+    sim->regs[AT42QT2120_REG_FIRMWARE_VERSION] = AT42QT2120_SIM_FIRMWARE_VERSION;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        sim->references[key] = at42qt2120_sim_baseline(sim, key);
+
+    /* Power-on behaves like a reset that finished at time 0 */
+    at42qt2120_sim_reset(sim);
+    sim->busy_until_us = 0;
+    at42qt2120_sim_start_calibration(sim, 0);
+    sim->next_measurement_us = 0;
+}
+
+void at42qt2120_sim_set_trace(at42qt2120_sim_t* sim, const at42qt2120_sim_touch_t* trace, size_t trace_length) {
+    sim->trace = trace;
+    sim->trace_length = trace != NULL ? trace_length : 0;
+    sim->trace_index = 0;
+}
+
+void at42qt2120_sim_set_touch(at42qt2120_sim_t* sim, uint16_t key_mask, int16_t slider_position) {
+    sim->touch.time_us = sim->now_us;
+    sim->touch.key_mask = key_mask & AT42QT2120_KEY_MASK_ALL;
+    sim->touch.slider_position = slider_position;
+    sim->touch.slider_fraction = 0;
+}
+
+void at42qt2120_sim_set_faults(at42qt2120_sim_t* sim, const at42qt2120_sim_faults_t* faults) {
+    sim->faults = *faults;
+    sim->fault_state = faults->seed != 0 ? faults->seed : 0x2120;
+}
+
+void at42qt2120_sim_set_sensor(at42qt2120_sim_t* sim, const at42qt2120_sim_sensor_t* sensor) {
+    sim->sensor = *sensor;
+    sim->noise_state = sensor->seed != 0 ? sensor->seed : 0x5EED;
+}
+
+void at42qt2120_sim_set_drift(at42qt2120_sim_t* sim, uint8_t key, int32_t millicounts_per_s) {
+    if (key >= AT42QT2120_NUM_KEYS)
+        return;
+
+    /* Fold the drift so far into the base of every key, then restart all of them at the current time */
+    for (int index = 0; index < AT42QT2120_NUM_KEYS; index++)
+        sim->drift_base_mc[index] += (int64_t)sim->drift_rates[index] * (sim->now_us - sim->drift_since_us) / 1000000;
+    sim->drift_since_us = sim->now_us;
+    sim->drift_rates[key] = millicounts_per_s;
+}
+
+void at42qt2120_sim_glitch(at42qt2120_sim_t* sim, int64_t duration_us) {
+    sim->glitch_until_us = sim->now_us + duration_us;
+}
+
+void at42qt2120_sim_brown_out(at42qt2120_sim_t* sim, bool corrupt_chip_id) {
+    at42qt2120_sim_reset(sim);
+    if (corrupt_chip_id)
+        sim->regs[AT42QT2120_REG_CHIP_ID] = (uint8_t)~AT42QT2120_SIM_CHIP_ID;
+}
+
+bool at42qt2120_sim_change_asserted(const at42qt2120_sim_t* sim) {
+    return sim->change_pending;
+}
+
+static int64_t at42qt2120_sim_wire_time_us(uint32_t scl_speed_hz, size_t wire_bytes) {
+    if (scl_speed_hz == 0)
+        return 0;
+
+    /* 9 clocks per byte (8 data + ACK) plus start and stop conditions */
+    int64_t clocks = (int64_t)wire_bytes * 9 + 2;
+    return (clocks * 1000000 + scl_speed_hz - 1) / scl_speed_hz;
+}
+
+int64_t at42qt2120_sim_bus_time_us(const at42qt2120_sim_t* sim, size_t wire_bytes) {
+    return at42qt2120_sim_wire_time_us(sim->config.scl_speed_hz, wire_bytes);
+}
+
+/* xorshift32: cheap and reproducible, quality is irrelevant for fault injection */
+static uint32_t at42qt2120_sim_fault_random(at42qt2120_sim_t* sim) {
+    uint32_t state = sim->fault_state;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    sim->fault_state = state;
+    return state;
+}
+
+static bool at42qt2120_sim_inject_nack(at42qt2120_sim_t* sim) {
+    bool nack = sim->now_us < sim->glitch_until_us ||
+                (sim->faults.nack_per_mille != 0 && at42qt2120_sim_fault_random(sim) % 1000 < sim->faults.nack_per_mille);
+    if (nack)
+        sim->injected_nacks++;
+    return nack;
+}
+
+/* Accounts for a transaction and returns false if the device NACKs it */
+static bool at42qt2120_sim_bus_transaction(at42qt2120_sim_t* sim, size_t wire_bytes) {
+    bool acked = sim->now_us >= sim->busy_until_us;
+    if (acked && at42qt2120_sim_inject_nack(sim))
+        acked = false;
+
+    /* A NACKed transaction stops after the address byte */
+    size_t bytes = acked ? wire_bytes : 1;
+    int64_t bus_time_us = at42qt2120_sim_bus_time_us(sim, bytes);
+
+    sim->stats.transactions++;
+    sim->stats.bytes += bytes;
+    sim->stats.bus_time_us += bus_time_us;
+    if (!acked)
+        sim->stats.nacks++;
+
+    at42qt2120_sim_advance(sim, bus_time_us);
+    return acked;
+}
+
+static void at42qt2120_sim_write_reg(at42qt2120_sim_t* sim, uint8_t reg, uint8_t value) {
+    switch (reg) {
+    case AT42QT2120_REG_CALIBRATE:
+        if (value != 0)
+            at42qt2120_sim_start_calibration(sim, sim->now_us);
+        break;
+    case AT42QT2120_REG_RESET:
+        /* A reset command also clears a bad state left behind by a brown-out */
+        if (value != 0) {
+            sim->regs[AT42QT2120_REG_CHIP_ID] = AT42QT2120_SIM_CHIP_ID;
+            at42qt2120_sim_reset(sim);
+        }
+        break;
+    case AT42QT2120_REG_LOW_POWER_MODE:
+        /* Leaving sleep restarts the measurement timer */
+        if (sim->regs[reg] == 0 && value != 0)
+            sim->next_measurement_us = sim->now_us;
+        sim->regs[reg] = value;
+        break;
+    default:
+        /* Status, signal and reference registers are read-only */
+        if (reg >= AT42QT2120_REG_CONFIG_FIRST && reg <= AT42QT2120_REG_CONFIG_LAST)
+            sim->regs[reg] = value;
+        break;
+    }
+}
+
+/* Host transport backend */
+static esp_err_t at42qt2120_sim_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms) {
+    at42qt2120_sim_t* sim = (at42qt2120_sim_t*)ctx;
+    (void)timeout_ms;
+
+    /* Address + register pointer, repeated start + address, then the data */
+    if (!at42qt2120_sim_bus_transaction(sim, 1 + write_size + 1 + read_size))
+        return ESP_FAIL;
+
+    uint8_t reg = write_buf[0];
+    for (size_t index = 0; index < read_size; index++) {
+        size_t address = (size_t)reg + index;
+        read_buf[index] = address < AT42QT2120_SIM_REG_COUNT ? sim->regs[address] : 0;
+    }
+
+    /* Reading the status registers releases CHANGE */
+    if (reg <= AT42QT2120_REG_DETECTION_STATUS && reg + read_size > AT42QT2120_REG_DETECTION_STATUS) {
+        memcpy(sim->reported_status, &sim->regs[AT42QT2120_REG_DETECTION_STATUS], sizeof(sim->reported_status));
+        sim->change_pending = false;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t at42qt2120_sim_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    at42qt2120_sim_t* sim = (at42qt2120_sim_t*)ctx;
+    (void)timeout_ms;
+
+    if (!at42qt2120_sim_bus_transaction(sim, 1 + write_size))
+        return ESP_FAIL;
+
+    uint8_t reg = write_buf[0];
+    for (size_t index = 1; index < write_size; index++) {
+        size_t address = (size_t)reg + index - 1;
+        if (address < AT42QT2120_SIM_REG_COUNT)
+            at42qt2120_sim_write_reg(sim, (uint8_t)address, write_buf[index]);
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t at42qt2120_sim_probe(void* ctx, int timeout_ms) {
+    at42qt2120_sim_t* sim = (at42qt2120_sim_t*)ctx;
+    (void)timeout_ms;
+
+    return at42qt2120_sim_bus_transaction(sim, 1) ? ESP_OK : ESP_FAIL;
+}
+
+static void at42qt2120_sim_delay_ms(void* ctx, uint32_t delay_ms) {
+    at42qt2120_sim_advance((at42qt2120_sim_t*)ctx, (int64_t)delay_ms * 1000);
+}
+
+static int64_t at42qt2120_sim_time_us(void* ctx) {
+    return ((at42qt2120_sim_t*)ctx)->now_us;
+}
+
+static const at42qt2120_transport_ops_t at42qt2120_sim_transport_ops = {
+    .transmit_receive = at42qt2120_sim_transmit_receive,
+    .transmit = at42qt2120_sim_transmit,
+    .probe = at42qt2120_sim_probe,
+    .release = NULL,
+    .delay_ms = at42qt2120_sim_delay_ms,
+    .time_us = at42qt2120_sim_time_us,
+};
+
+void at42qt2120_sim_transport(at42qt2120_sim_t* sim, at42qt2120_transport_t* transport) {
+    transport->ops = &at42qt2120_sim_transport_ops;
+    transport->ctx = sim;
+}
+
+/* Shared bus with multiplexers */
+void at42qt2120_sim_bus_init(at42qt2120_sim_bus_t* bus, uint32_t scl_speed_hz) {
+    memset(bus, 0, sizeof(*bus));
+    bus->scl_speed_hz = scl_speed_hz;
+}
+
+/* Charges bus time for a transaction that involves no device, e.g. a mux write or a NACK */
+static void at42qt2120_sim_bus_charge(at42qt2120_sim_bus_t* bus, size_t wire_bytes) {
+    int64_t bus_time_us = at42qt2120_sim_wire_time_us(bus->scl_speed_hz, wire_bytes);
+
+    bus->stats.transactions++;
+    bus->stats.bytes += wire_bytes;
+    bus->stats.bus_time_us += bus_time_us;
+    bus->now_us += bus_time_us;
+}
+
+/* Returns the device that answers the fixed address with the current mux settings (NULL if none or several) */
+static at42qt2120_sim_t* at42qt2120_sim_bus_route(at42qt2120_sim_bus_device_t* device) {
+    at42qt2120_sim_bus_t* bus = device->bus;
+    at42qt2120_sim_t* target = NULL;
+    size_t connected = 0;
+
+    for (size_t index = 0; index < bus->device_count; index++) {
+        const at42qt2120_sim_bus_device_t* other = &bus->devices[index];
+        if (other->mux == AT42QT2120_MANAGER_NO_MUX || (bus->muxes[other->mux].channel_mask & (1 << other->channel)) != 0) {
+            target = other->sim;
+            connected++;
+        }
+    }
+
+    if (connected > 1) {
+        bus->collisions++;
+        return NULL;
+    }
+    if (target != NULL && target != device->sim)
+        bus->misrouted++;
+
+    return target;
+}
+
+/* Brings the device up to bus time before a transaction */
+static at42qt2120_sim_t* at42qt2120_sim_bus_begin(at42qt2120_sim_bus_device_t* device, at42qt2120_sim_stats_t* before) {
+    at42qt2120_sim_t* sim = at42qt2120_sim_bus_route(device);
+    if (sim == NULL) {
+        /* Nobody (or more than one device) drives the ACK, the transaction stops after the address byte */
+        at42qt2120_sim_bus_charge(device->bus, 1);
+        device->bus->stats.nacks++;
+        return NULL;
+    }
+
+    at42qt2120_sim_advance_to(sim, device->bus->now_us);
+    *before = sim->stats;
+    return sim;
+}
+
+/* Moves the device's share of the transaction to the bus */
+static void at42qt2120_sim_bus_end(at42qt2120_sim_bus_device_t* device, const at42qt2120_sim_t* sim, const at42qt2120_sim_stats_t* before) {
+    at42qt2120_sim_bus_t* bus = device->bus;
+
+    bus->stats.transactions += sim->stats.transactions - before->transactions;
+    bus->stats.nacks += sim->stats.nacks - before->nacks;
+    bus->stats.bytes += sim->stats.bytes - before->bytes;
+    bus->stats.bus_time_us += sim->stats.bus_time_us - before->bus_time_us;
+    if (sim->now_us > bus->now_us)
+        bus->now_us = sim->now_us;
+}
+
+static esp_err_t at42qt2120_sim_bus_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms) {
+    at42qt2120_sim_bus_device_t* device = (at42qt2120_sim_bus_device_t*)ctx;
+    at42qt2120_sim_stats_t before;
+    at42qt2120_sim_t* sim = at42qt2120_sim_bus_begin(device, &before);
+    if (sim == NULL)
+        return ESP_FAIL;
+
+    esp_err_t ret = at42qt2120_sim_transmit_receive(sim, write_buf, write_size, read_buf, read_size, timeout_ms);
+    at42qt2120_sim_bus_end(device, sim, &before);
+    return ret;
+}
+
+static esp_err_t at42qt2120_sim_bus_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    at42qt2120_sim_bus_device_t* device = (at42qt2120_sim_bus_device_t*)ctx;
+    at42qt2120_sim_stats_t before;
+    at42qt2120_sim_t* sim = at42qt2120_sim_bus_begin(device, &before);
+    if (sim == NULL)
+        return ESP_FAIL;
+
+    esp_err_t ret = at42qt2120_sim_transmit(sim, write_buf, write_size, timeout_ms);
+    at42qt2120_sim_bus_end(device, sim, &before);
+    return ret;
+}
+
+static esp_err_t at42qt2120_sim_bus_probe(void* ctx, int timeout_ms) {
+    at42qt2120_sim_bus_device_t* device = (at42qt2120_sim_bus_device_t*)ctx;
+    at42qt2120_sim_stats_t before;
+    at42qt2120_sim_t* sim = at42qt2120_sim_bus_begin(device, &before);
+    if (sim == NULL)
+        return ESP_FAIL;
+
+    esp_err_t ret = at42qt2120_sim_probe(sim, timeout_ms);
+    at42qt2120_sim_bus_end(device, sim, &before);
+    return ret;
+}
+
+static void at42qt2120_sim_bus_delay_ms(void* ctx, uint32_t delay_ms) {
+    at42qt2120_sim_bus_device_t* device = (at42qt2120_sim_bus_device_t*)ctx;
+    device->bus->now_us += (int64_t)delay_ms * 1000;
+}
+
+static int64_t at42qt2120_sim_bus_device_time_us(void* ctx) {
+    return ((at42qt2120_sim_bus_device_t*)ctx)->bus->now_us;
+}
+
+static const at42qt2120_transport_ops_t at42qt2120_sim_bus_transport_ops = {
+    .transmit_receive = at42qt2120_sim_bus_transmit_receive,
+    .transmit = at42qt2120_sim_bus_transmit,
+    .probe = at42qt2120_sim_bus_probe,
+    .release = NULL,
+    .delay_ms = at42qt2120_sim_bus_delay_ms,
+    .time_us = at42qt2120_sim_bus_device_time_us,
+};
+
+static esp_err_t at42qt2120_sim_mux_select(void* ctx, uint8_t channel_mask, int timeout_ms) {
+    at42qt2120_sim_mux_t* mux = (at42qt2120_sim_mux_t*)ctx;
+    (void)timeout_ms;
+
+    /* Address + control register */
+    at42qt2120_sim_bus_charge(mux->bus, 2);
+    mux->bus->mux_writes++;
+    mux->channel_mask = channel_mask;
+    return ESP_OK;
+}
+
+esp_err_t at42qt2120_sim_bus_add_mux(at42qt2120_sim_bus_t* bus, at42qt2120_mux_t* mux) {
+    if (bus->mux_count >= AT42QT2120_SIM_BUS_MAX_MUXES)
+        return ESP_ERR_NO_MEM;
+
+    at42qt2120_sim_mux_t* sim_mux = &bus->muxes[bus->mux_count++];
+    sim_mux->bus = bus;
+    sim_mux->channel_mask = 0;
+
+    mux->select = at42qt2120_sim_mux_select;
+    mux->ctx = sim_mux;
+    return ESP_OK;
+}
+
+esp_err_t at42qt2120_sim_bus_add_device(at42qt2120_sim_bus_t* bus, at42qt2120_sim_t* sim, uint8_t mux, uint8_t channel, at42qt2120_transport_t* transport) {
+    if (bus->device_count >= AT42QT2120_SIM_BUS_MAX_DEVICES)
+        return ESP_ERR_NO_MEM;
+    if (mux != AT42QT2120_MANAGER_NO_MUX && (mux >= bus->mux_count || channel >= AT42QT2120_MUX_NUM_CHANNELS))
+        return ESP_ERR_INVALID_ARG;
+
+    at42qt2120_sim_bus_device_t* device = &bus->devices[bus->device_count++];
+    device->bus = bus;
+    device->sim = sim;
+    device->mux = mux;
+    device->channel = channel;
+
+    at42qt2120_sim_advance_to(sim, bus->now_us);
+    transport->ops = &at42qt2120_sim_bus_transport_ops;
+    transport->ctx = device;
+    return ESP_OK;
+}
+
+void at42qt2120_sim_bus_advance(at42qt2120_sim_bus_t* bus, int64_t time_us) {
+    bus->now_us += time_us;
+    for (size_t index = 0; index < bus->device_count; index++)
+        at42qt2120_sim_advance_to(bus->devices[index].sim, bus->now_us);
+}
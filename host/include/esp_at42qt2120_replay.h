@@ -0,0 +1,88 @@
+#ifndef ESP_AT42QT2120_REPLAY_H
+#define ESP_AT42QT2120_REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_transport.h"
+#include "esp_at42qt2120_trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_replay.h
+ * @brief Host transport answering the driver from a recorded trace.
+ *
+ * Every transaction is matched against the next record of a dump (esp_at42qt2120_trace.h): a
+ * read of the same register and length gets the recorded data and result, a write of the same
+ * register and length gets the recorded result and its data is compared with the recorded one.
+ * A transaction that does not match fails with ESP_ERR_INVALID_RESPONSE and leaves the record in
+ * place; the application decides whether to skip it (at42qt2120_replay_skip()).
+ *
+ * Time comes from the trace: it stands at the start of the next record until a transaction takes
+ * that record, and transport delays add to it. Reading the time right before a transaction thus
+ * gives the same value in the replay as on the recording device, and a replay gives the same
+ * results every time.
+ *
+ * A probe that is not in the trace succeeds, so a handle can be initialized on a trace that was
+ * recorded after its initialization. It is counted in extra_probes.
+ */
+
+/**
+ * @brief Structure representing a replay.
+ */
+typedef struct {
+    at42qt2120_trace_reader_t reader;       // Reader of the dump
+    at42qt2120_trace_record_t record;       // Next record to replay (valid while pending)
+    bool pending;                           // A record is left to replay
+    esp_err_t status;                       // ESP_ERR_NOT_FOUND at the end of the trace, ESP_ERR_INVALID_SIZE on a truncated one
+    int64_t now_us;                         // Replay time
+    uint32_t replayed;                      // Records taken by matching transactions
+    uint32_t skipped;                       // Records skipped by the application
+    uint32_t mismatches;                    // Transactions that did not match the next record
+    uint32_t write_diffs;                   // Matching writes whose data differed from the recorded data
+    uint32_t extra_probes;                  // Probes answered without a record
+} at42qt2120_replay_t;
+
+/**
+ * @brief Starts a replay at the first record of a dump.
+ *
+ * @param replay Pointer to the replay structure.
+ * @param dump The dump, must outlive the replay.
+ * @param size Size of the dump.
+ * @return esp_err_t ESP_OK on success, otherwise the error of at42qt2120_trace_reader_init().
+ */
+esp_err_t at42qt2120_replay_init(at42qt2120_replay_t* replay, const uint8_t* dump, size_t size);
+
+/**
+ * @brief Fills a transport that answers from the replay.
+ *
+ * @param replay Pointer to the replay structure.
+ * @param transport Pointer to the transport to fill.
+ */
+void at42qt2120_replay_transport(at42qt2120_replay_t* replay, at42qt2120_transport_t* transport);
+
+/**
+ * @brief Returns the next record to replay.
+ *
+ * @param replay Pointer to the replay structure.
+ * @return const at42qt2120_trace_record_t* The record, NULL at the end of the trace.
+ */
+const at42qt2120_trace_record_t* at42qt2120_replay_peek(const at42qt2120_replay_t* replay);
+
+/**
+ * @brief Drops the next record without replaying it, e.g. one the driver did not ask for.
+ *
+ * @param replay Pointer to the replay structure.
+ */
+void at42qt2120_replay_skip(at42qt2120_replay_t* replay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,364 @@
+#ifndef ESP_AT42QT2120_SIM_H
+#define ESP_AT42QT2120_SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_transport.h"
+#include "esp_at42qt2120_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_sim.h
+ * @brief Register-accurate AT42QT2120 device model and host transport backend.
+ *
+ * The simulator runs on a virtual microsecond clock that only advances through bus
+ * transactions (at the configured SCL speed), transport delays and explicit calls to
+ * at42qt2120_sim_advance(). It models the chip ID, auto-incrementing burst reads and writes,
+ * reset and calibration timing, measurement cycles paced by the low power mode register,
+ * the detection integrator (with fast confirmation measurements once a key crosses its
+ * threshold), slider/wheel position and the CHANGE line. Touches are driven by a scripted
+ * trace.
+ *
+ * Each key can drift at a constant rate, e.g. with temperature. The device follows drift like
+ * the real part: references move one count per TTD/ATD step while nothing is in detect and the
+ * drift hold time has passed. A calibration takes the signals of the moment as references, so
+ * calibrating with a finger on a key leaves that key below its reference once the finger is gone.
+ *
+ * An optional sensor model (at42qt2120_sim_set_sensor()) gives every key its own touch delta,
+ * noise and series resistance. A measurement accumulates 2^pulse pulses per key and divides the
+ * sum by 2^scale (KEY_PULSE_SCALE): signal and touch delta grow with 2^pulse, uncorrelated noise
+ * with sqrt(2^pulse), noise common to all keys (supply, mains) with 2^pulse. A resistive electrode
+ * misses part of its touch delta, every charge time step halves the shortfall. Each pulse takes
+ * AT42QT2120_SIM_PULSE_US plus AT42QT2120_SIM_CHARGE_STEP_US per charge time step. A burst longer
+ * than the measurement interval sets OVERFLOW and stretches the interval, and confirmation
+ * measurements are spaced at least one burst apart.
+ *
+ * Several simulated devices can share a simulated bus (at42qt2120_sim_bus_t) behind
+ * TCA9548A-style multiplexers. The bus has its own clock that every transaction on it
+ * advances; the devices catch up with it lazily when they are addressed. Each bus models
+ * one independent I2C port, so buses run in parallel in virtual time.
+ */
+
+/** @brief Number of registers modelled by the simulator (0x00-0x63) */
+#define AT42QT2120_SIM_REG_COUNT (AT42QT2120_REG_KEY_11_LSB_REFERENCE + 1)
+/** @brief Chip ID reported by the simulator */
+#define AT42QT2120_SIM_CHIP_ID AT42QT2120_CHIP_ID
+/** @brief Firmware version reported by the simulator */
+#define AT42QT2120_SIM_FIRMWARE_VERSION 0x15
+/** @brief Acquisition time of one pulse of one key at charge time 0, in microseconds */
+#define AT42QT2120_SIM_PULSE_US 4
+/** @brief Acquisition time added to every pulse per charge time step, in microseconds */
+#define AT42QT2120_SIM_CHARGE_STEP_US 1
+/** @brief Value of at42qt2120_sim_touch_t::slider_position while the slider is not touched */
+#define AT42QT2120_SIM_NO_SLIDER_TOUCH (-1)
+
+/**
+ * @brief One step of a scripted touch trace. It holds from time_us until the next step.
+ */
+typedef struct {
+    int64_t time_us;                        // Virtual time the step starts at
+    uint16_t key_mask;                      // Keys touched during the step
+    int16_t slider_position;                // Finger position on the slider/wheel (0-255), AT42QT2120_SIM_NO_SLIDER_TOUCH if none
+    uint8_t slider_fraction;                // Finger position below one slider unit, in 1/256 (the position register drops it)
+} at42qt2120_sim_touch_t;
+
+/**
+ * @brief Simulator configuration.
+ */
+typedef struct {
+    uint32_t scl_speed_hz;                  // Bus clock used to model transaction time (0 makes transactions instantaneous)
+    uint32_t reset_time_us;                 // Time the device NACKs after a reset command
+    uint32_t calibrate_time_us;             // Duration of a calibration cycle
+    uint16_t reference_base;                // Reference level of key 0, further keys are slightly offset
+    uint16_t touch_delta;                   // Signal delta of a fully touched key
+} at42qt2120_sim_config_t;
+
+/** @brief Default simulator configuration */
+#define AT42QT2120_SIM_CONFIG_DEFAULT() {   \
+    .scl_speed_hz = 400000,                 \
+    .reset_time_us = 15000,                 \
+    .calibrate_time_us = 110000,            \
+    .reference_base = 700,                  \
+    .touch_delta = 60,                      \
+}
+
+/**
+ * @brief Random fault injection of a simulated device.
+ */
+typedef struct {
+    uint16_t nack_per_mille;                // Probability that a transaction is NACKed, in 1/1000
+    uint32_t seed;                          // Seed of the fault generator (0 picks a fixed default), equal seeds give equal faults
+} at42qt2120_sim_faults_t;
+
+/**
+ * @brief Electrode model of one key. Counts are those of a single pulse (pulse 0, scale 0).
+ */
+typedef struct {
+    uint16_t touch_delta;                   // Signal of a full touch with complete charge transfer (0 takes config.touch_delta)
+    uint16_t noise_cc;                      // Standard deviation of the uncorrelated noise of one pulse, in 1/100 counts
+    uint16_t charge_loss_pm;                // Touch delta missing at charge time 0 in 1/1000, halved by every charge time step
+} at42qt2120_sim_key_model_t;
+
+/**
+ * @brief Sensor and noise model of a simulated device. All zero is the ideal sensor.
+ */
+typedef struct {
+    at42qt2120_sim_key_model_t keys[AT42QT2120_NUM_KEYS];   // Model per key
+    uint16_t common_noise_cc;                               // Standard deviation of the noise shared by all keys, in 1/100 counts per pulse
+    uint32_t seed;                                          // Seed of the noise generator (0 picks a fixed default)
+} at42qt2120_sim_sensor_t;
+
+/**
+ * @brief Bus activity seen by the simulated device.
+ */
+typedef struct {
+    uint32_t transactions;                  // Transactions addressed to the device (including NACKed ones)
+    uint32_t nacks;                         // Transactions NACKed while the device was resetting
+    uint32_t bytes;                         // Bytes on the wire, including address bytes
+    int64_t bus_time_us;                    // Time the bus was busy with the device's transactions
+} at42qt2120_sim_stats_t;
+
+/**
+ * @brief Structure representing a simulated AT42QT2120.
+ */
+typedef struct {
+    at42qt2120_sim_config_t config;                 // Configuration given to at42qt2120_sim_init()
+    uint8_t regs[AT42QT2120_SIM_REG_COUNT];         // Register file as seen by the host
+    uint16_t references[AT42QT2120_NUM_KEYS];       // Current reference per key
+    uint8_t integrator[AT42QT2120_NUM_KEYS];        // Consecutive measurements above threshold per key
+    uint8_t slider_integrator;                      // Consecutive measurements with the slider above threshold
+    uint8_t reported_status[4];                     // Status registers (0x02-0x05) as of the last host read
+    bool change_pending;                            // CHANGE line asserted
+    int64_t now_us;                                 // Virtual time
+    int64_t busy_until_us;                          // Device NACKs until this time (reset in progress)
+    int64_t calibrate_until_us;                     // Calibration in progress until this time (0 if none)
+    int64_t next_measurement_us;                    // Time of the next measurement cycle
+    const at42qt2120_sim_touch_t* trace;            // Scripted touch trace (NULL if unused)
+    size_t trace_length;                            // Number of steps in trace
+    size_t trace_index;                             // Step active at now_us
+    at42qt2120_sim_touch_t touch;                   // Touch applied when no trace is set
+    at42qt2120_sim_stats_t stats;                   // Bus activity counters
+    uint32_t measurements;                          // Measurement cycles run (a proxy for the device's supply current)
+    at42qt2120_sim_faults_t faults;                 // Random fault injection settings
+    uint32_t fault_state;                           // State of the fault generator
+    int64_t glitch_until_us;                        // Every transaction is NACKed until this time (bus glitch)
+    uint32_t injected_nacks;                        // Transactions NACKed by fault injection or a glitch
+    int32_t drift_rates[AT42QT2120_NUM_KEYS];       // Environmental drift per key in 1/1000 counts per second
+    int64_t drift_base_mc[AT42QT2120_NUM_KEYS];     // Drift accumulated up to drift_since_us in 1/1000 counts
+    int64_t drift_since_us;                         // Time the drift rates were last changed
+    int64_t drift_step_us[AT42QT2120_NUM_KEYS];     // Time of the last drift compensation step per key
+    int64_t drift_hold_until_us;                    // Drift compensation is suspended until this time (drift hold after a detection)
+    at42qt2120_sim_sensor_t sensor;                 // Sensor and noise model
+    uint32_t noise_state;                           // State of the noise generator
+    uint32_t overflows;                             // Measurements whose burst exceeded the measurement interval
+} at42qt2120_sim_t;
+
+/** @brief Maximum number of devices on a simulated bus */
+#define AT42QT2120_SIM_BUS_MAX_DEVICES 64
+/** @brief Maximum number of multiplexers on a simulated bus (TCA9548A addresses 0x70-0x77) */
+#define AT42QT2120_SIM_BUS_MAX_MUXES 8
+
+struct at42qt2120_sim_bus;
+
+/**
+ * @brief A simulated device attached to a simulated bus.
+ */
+typedef struct {
+    struct at42qt2120_sim_bus* bus;         // Bus the device is attached to
+    at42qt2120_sim_t* sim;                  // Simulated device
+    uint8_t mux;                            // Mux index on the bus, AT42QT2120_MANAGER_NO_MUX if wired directly
+    uint8_t channel;                        // Mux channel
+} at42qt2120_sim_bus_device_t;
+
+/**
+ * @brief A simulated TCA9548A-style multiplexer.
+ */
+typedef struct {
+    struct at42qt2120_sim_bus* bus;         // Bus the multiplexer is attached to
+    uint8_t channel_mask;                   // Channels currently enabled
+} at42qt2120_sim_mux_t;
+
+/**
+ * @brief Structure representing a simulated I2C bus.
+ */
+typedef struct at42qt2120_sim_bus {
+    uint32_t scl_speed_hz;                                          // Bus clock used for mux writes and NACKed transactions
+    int64_t now_us;                                                 // Virtual time of the bus
+    at42qt2120_sim_bus_device_t devices[AT42QT2120_SIM_BUS_MAX_DEVICES];   // Attached devices
+    size_t device_count;                                            // Number of attached devices
+    at42qt2120_sim_mux_t muxes[AT42QT2120_SIM_BUS_MAX_MUXES];       // Attached multiplexers
+    size_t mux_count;                                               // Number of attached multiplexers
+    at42qt2120_sim_stats_t stats;                                   // Bus activity of all devices and multiplexers
+    uint32_t mux_writes;                                            // Channel select writes
+    uint32_t collisions;                                            // Transactions NACKed because several devices were connected
+    uint32_t misrouted;                                             // Transactions that reached another device than intended
+} at42qt2120_sim_bus_t;
+
+/**
+ * @brief Initializes a simulated device in its power-on state (calibration running).
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param config Pointer to the simulator configuration.
+ */
+void at42qt2120_sim_init(at42qt2120_sim_t* sim, const at42qt2120_sim_config_t* config);
+
+/**
+ * @brief Sets the scripted touch trace. Steps must be sorted by time. The trace is not copied.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param trace Touch trace (NULL to clear).
+ * @param trace_length Number of steps in trace.
+ */
+void at42qt2120_sim_set_trace(at42qt2120_sim_t* sim, const at42qt2120_sim_touch_t* trace, size_t trace_length);
+
+/**
+ * @brief Sets the touch applied while no trace is set. Clears slider_fraction, set sim->touch.slider_fraction
+ *        afterwards for a finger between two slider units.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param key_mask Keys touched.
+ * @param slider_position Finger position on the slider/wheel, AT42QT2120_SIM_NO_SLIDER_TOUCH if none.
+ */
+void at42qt2120_sim_set_touch(at42qt2120_sim_t* sim, uint16_t key_mask, int16_t slider_position);
+
+/**
+ * @brief Advances the virtual clock, running every measurement cycle in between.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param time_us Time to advance by in microseconds.
+ */
+void at42qt2120_sim_advance(at42qt2120_sim_t* sim, int64_t time_us);
+
+/**
+ * @brief Advances the virtual clock to an absolute time (no-op if it lies in the past).
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param time_us Absolute virtual time in microseconds.
+ */
+void at42qt2120_sim_advance_to(at42qt2120_sim_t* sim, int64_t time_us);
+
+/**
+ * @brief Sets the random fault injection. A zero nack_per_mille turns it off.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param faults Pointer to the fault settings (copied).
+ */
+void at42qt2120_sim_set_faults(at42qt2120_sim_t* sim, const at42qt2120_sim_faults_t* faults);
+
+/**
+ * @brief Sets the environmental drift of a key's signal, starting at the current virtual time.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param key Key index (0-11).
+ * @param millicounts_per_s Drift rate in 1/1000 signal counts per second, positive towards touch.
+ */
+void at42qt2120_sim_set_drift(at42qt2120_sim_t* sim, uint8_t key, int32_t millicounts_per_s);
+
+/**
+ * @brief Sets the sensor and noise model.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param sensor Pointer to the model (copied).
+ */
+void at42qt2120_sim_set_sensor(at42qt2120_sim_t* sim, const at42qt2120_sim_sensor_t* sensor);
+
+/**
+ * @brief Acquisition time of one measurement burst over all keys with the current pulse and charge time settings.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @return int64_t Burst time in microseconds.
+ */
+int64_t at42qt2120_sim_burst_us(const at42qt2120_sim_t* sim);
+
+/**
+ * @brief Makes the device NACK every transaction for a while, as on a glitching bus.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param duration_us Length of the glitch in microseconds.
+ */
+void at42qt2120_sim_glitch(at42qt2120_sim_t* sim, int64_t duration_us);
+
+/**
+ * @brief Simulates a brown-out: the device restarts like at power-on, with its setup registers back
+ *        at their defaults, NACKs for the reset time and calibrates.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param corrupt_chip_id Whether the device comes back in a bad state that reports a wrong chip ID until it is reset.
+ */
+void at42qt2120_sim_brown_out(at42qt2120_sim_t* sim, bool corrupt_chip_id);
+
+/**
+ * @brief Returns whether the CHANGE line is asserted (unread status changes pending).
+ *
+ * @param sim Pointer to the simulator structure.
+ * @return bool True while CHANGE is held low.
+ */
+bool at42qt2120_sim_change_asserted(const at42qt2120_sim_t* sim);
+
+/**
+ * @brief Fills a transport that routes driver transactions to the simulated device.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param transport Pointer to the transport to fill.
+ */
+void at42qt2120_sim_transport(at42qt2120_sim_t* sim, at42qt2120_transport_t* transport);
+
+/**
+ * @brief Returns the time the simulated bus needs for a transaction of the given size.
+ *
+ * @param sim Pointer to the simulator structure.
+ * @param wire_bytes Bytes on the wire including address bytes.
+ * @return int64_t Transaction time in microseconds.
+ */
+int64_t at42qt2120_sim_bus_time_us(const at42qt2120_sim_t* sim, size_t wire_bytes);
+
+/**
+ * @brief Initializes an empty simulated bus at virtual time 0.
+ *
+ * @param bus Pointer to the bus structure.
+ * @param scl_speed_hz Bus clock, should match the scl_speed_hz of the attached devices.
+ */
+void at42qt2120_sim_bus_init(at42qt2120_sim_bus_t* bus, uint32_t scl_speed_hz);
+
+/**
+ * @brief Attaches a multiplexer (all channels disabled) and fills its backend.
+ *
+ * @param bus Pointer to the bus structure.
+ * @param mux Pointer to the multiplexer backend to fill.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the bus is full.
+ */
+esp_err_t at42qt2120_sim_bus_add_mux(at42qt2120_sim_bus_t* bus, at42qt2120_mux_t* mux);
+
+/**
+ * @brief Attaches a simulated device and fills the transport addressing it. The transport only
+ *        reaches the device while its mux channel is the only path to the device address.
+ *
+ * @param bus Pointer to the bus structure.
+ * @param sim Pointer to the simulated device.
+ * @param mux Index of the mux in attach order, AT42QT2120_MANAGER_NO_MUX if wired directly.
+ * @param channel Mux channel.
+ * @param transport Pointer to the transport to fill.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the bus is full, ESP_ERR_INVALID_ARG on an invalid mux or channel.
+ */
+esp_err_t at42qt2120_sim_bus_add_device(at42qt2120_sim_bus_t* bus, at42qt2120_sim_t* sim, uint8_t mux, uint8_t channel, at42qt2120_transport_t* transport);
+
+/**
+ * @brief Advances the bus clock and every attached device.
+ *
+ * @param bus Pointer to the bus structure.
+ * @param time_us Time to advance by in microseconds.
+ */
+void at42qt2120_sim_bus_advance(at42qt2120_sim_bus_t* bus, int64_t time_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef ESP_AT42QT2120_HPP
+#define ESP_AT42QT2120_HPP
+
+#if __cplusplus < 201703L
+#error "esp_at42qt2120.hpp requires C++17"
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+/**
+ * @file esp_at42qt2120.hpp
+ * @brief Header-only C++17 layer over the AT42QT2120 C API with a compile-time register map.
+ *
+ * Every register is a type carrying its address, width, access mode and byte order. Bitfields
+ * are types carrying their register, position and width, bursts are types spanning a range of
+ * registers. Key indices are template parameters. Out of range keys, bursts leaving the register
+ * map, writes to read-only or command registers and constants that do not fit a bitfield fail to
+ * compile.
+ *
+ * at42qt2120::device only forwards to the C API with constant arguments: reads go to
+ * at42qt2120_register_read(), writes to the register shadow followed by at42qt2120_shadow_flush(),
+ * exactly like at42qt2120_enable_slider() and friends. The resulting bus traffic is the same as
+ * that of hand-written C.
+ *
+ * @code{.cpp}
+ * at42qt2120::device touch(&at42qt2120);
+ * touch.write<at42qt2120::regs::key_dthr<3>>(20);
+ * touch.write<at42qt2120::regs::slider_options>(at42qt2120::fields::slider_enable::of<1>() | at42qt2120::fields::slider_wheel::of<1>());
+ *
+ * uint16_t signal;
+ * touch.read<at42qt2120::regs::key_signal<5>>(signal);
+ * @endcode
+ */
+
+namespace at42qt2120 {
+
+/**
+ * @brief How a register may be accessed through the wrapper.
+ */
+enum class access : uint8_t {
+    read_only,                              // Status, signal and reference registers
+    read_write,                             // Setup registers, written through the register shadow
+    command,                                // Calibrate and reset, only triggered through device::calibrate()/device::reset()
+};
+
+/**
+ * @brief Byte order of a multi-byte register.
+ */
+enum class byte_order : uint8_t {
+    msb_first,                              // Signals and references
+    lsb_first,                              // Key status (keys 0-7 before keys 8-11)
+};
+
+/** @brief Number of registers in the register map (0x00-0x63) */
+inline constexpr uint8_t register_count = AT42QT2120_REG_KEY_11_LSB_REFERENCE + 1;
+
+namespace detail {
+
+/* Rejects key indices beyond the last key wherever a key index is a template parameter */
+template <uint8_t Key>
+struct key_index {
+    static_assert(Key < AT42QT2120_NUM_KEYS, "AT42QT2120 key index out of range (0-11)");
+    static constexpr uint8_t value = Key;
+};
+
+constexpr bool is_setup_range(uint8_t address, uint8_t length) {
+    return address >= AT42QT2120_REG_CONFIG_FIRST && address + length - 1 <= AT42QT2120_REG_CONFIG_LAST;
+}
+
+/* Registers are their own reg_type, bitfields name the register they live in, bursts have a length */
+template <typename T>
+inline constexpr bool is_field_v = !std::is_same_v<typename T::reg_type, T>;
+
+template <typename T, typename = void>
+struct is_burst : std::false_type {};
+template <typename T>
+struct is_burst<T, std::void_t<decltype(T::length)>> : std::true_type {};
+
+} // namespace detail
+
+/**
+ * @brief Compile-time descriptor of a register.
+ *
+ * @tparam Address Register address.
+ * @tparam Width Width in bytes (1 or 2).
+ * @tparam Access Access mode.
+ * @tparam Order Byte order of a 2-byte register.
+ */
+template <uint8_t Address, uint8_t Width, access Access, byte_order Order = byte_order::msb_first>
+struct register_desc {
+    static_assert(Width == 1 || Width == 2, "AT42QT2120 registers are 1 or 2 bytes wide");
+    static_assert(Address + Width <= register_count, "Register lies outside the AT42QT2120 register map");
+    static_assert(Access != access::read_write || detail::is_setup_range(Address, Width), "Only the setup registers (0x08-0x33) are writable");
+
+    using reg_type = register_desc;
+    using value_type = std::conditional_t<Width == 1, uint8_t, uint16_t>;
+
+    static constexpr uint8_t address = Address;
+    static constexpr uint8_t width = Width;
+    static constexpr access mode = Access;
+    static constexpr byte_order order = Order;
+    static constexpr bool writable = Access == access::read_write;
+
+    /** @brief Decodes the register from its bytes in bus order */
+    static constexpr value_type decode(const uint8_t* raw) {
+        if constexpr (Width == 1)
+            return raw[0];
+        else if constexpr (Order == byte_order::msb_first)
+            return (value_type)((raw[0] << 8) | raw[1]);
+        else
+            return (value_type)((raw[1] << 8) | raw[0]);
+    }
+};
+
+/**
+ * @brief Compile-time descriptor of a bitfield within a register.
+ *
+ * @tparam Reg Register descriptor.
+ * @tparam Shift Position of the lowest bit.
+ * @tparam Bits Width in bits.
+ */
+template <typename Reg, uint8_t Shift, uint8_t Bits>
+struct bitfield {
+    static_assert(Bits > 0 && Shift + Bits <= 8 * Reg::width, "Bitfield does not fit its register");
+
+    using reg_type = Reg;
+    using value_type = typename Reg::value_type;
+
+    static constexpr uint8_t shift = Shift;
+    static constexpr uint8_t bits = Bits;
+    static constexpr value_type max = (value_type)((1u << Bits) - 1);
+    static constexpr value_type mask = (value_type)(max << Shift);
+    static constexpr bool writable = Reg::writable;
+
+    /** @brief Places a runtime value in the field, excess bits are dropped */
+    static constexpr value_type encode(value_type value) { return (value_type)((value << Shift) & mask); }
+
+    /** @brief Extracts the field from a register value */
+    static constexpr value_type decode(value_type reg_value) { return (value_type)((reg_value & mask) >> Shift); }
+
+    /** @brief Places a constant in the field, constants that do not fit fail to compile */
+    template <unsigned Value>
+    static constexpr value_type of() {
+        static_assert(Value <= max, "Value does not fit the bitfield");
+        return encode((value_type)Value);
+    }
+};
+
+/**
+ * @brief Compile-time descriptor of a burst over the registers First to Last.
+ *
+ * @tparam First Register descriptor of the first register.
+ * @tparam Last Register descriptor of the last register.
+ */
+template <typename First, typename Last>
+struct burst {
+    static_assert(First::address <= Last::address, "Burst must run towards higher addresses");
+
+    static constexpr uint8_t address = First::address;
+    static constexpr uint8_t length = Last::address + Last::width - First::address;
+    static constexpr bool writable = detail::is_setup_range(address, length);
+
+    using value_type = std::array<uint8_t, length>;
+
+    /** @brief Offset of a register within the burst */
+    template <typename Reg>
+    static constexpr uint8_t offset() {
+        static_assert(Reg::address >= address && Reg::address + Reg::width <= address + length, "Register is not part of the burst");
+        return Reg::address - address;
+    }
+
+    /** @brief Decodes a register or bitfield from the burst bytes */
+    template <typename T>
+    static constexpr typename T::value_type get(const value_type& raw) {
+        if constexpr (detail::is_field_v<T>)
+            return T::decode(get<typename T::reg_type>(raw));
+        else
+            return T::decode(raw.data() + offset<T>());
+    }
+};
+
+namespace regs {
+
+template <uint8_t Address, uint8_t Width, access Access, byte_order Order = byte_order::msb_first>
+using reg = register_desc<Address, Width, Access, Order>;
+
+using chip_id = reg<AT42QT2120_REG_CHIP_ID, 1, access::read_only>;
+using firmware_version = reg<AT42QT2120_REG_FIRMWARE_VERSION, 1, access::read_only>;
+using detection_status = reg<AT42QT2120_REG_DETECTION_STATUS, 1, access::read_only>;
+using key_status = reg<AT42QT2120_REG_KEY_STATUS_07_00, 2, access::read_only, byte_order::lsb_first>;
+using slider_position = reg<AT42QT2120_REG_SLIDER_POSITION, 1, access::read_only>;
+using calibrate = reg<AT42QT2120_REG_CALIBRATE, 1, access::command>;
+using reset = reg<AT42QT2120_REG_RESET, 1, access::command>;
+using low_power_mode = reg<AT42QT2120_REG_LOW_POWER_MODE, 1, access::read_write>;
+using ttd = reg<AT42QT2120_REG_TTD_MODE, 1, access::read_write>;
+using atd = reg<AT42QT2120_REG_ATD_MODE, 1, access::read_write>;
+using detection_integrator = reg<AT42QT2120_REG_DETECTION_INTEGRATOR, 1, access::read_write>;
+using touch_recal_delay = reg<AT42QT2120_REG_TOUCH_RECAL_DELAY, 1, access::read_write>;
+using drift_hold_time = reg<AT42QT2120_REG_DRIFT_HOLD_TIME, 1, access::read_write>;
+using slider_options = reg<AT42QT2120_REG_SLIDER_OPTIONS, 1, access::read_write>;
+using charge_time = reg<AT42QT2120_REG_CHARGE_TIME, 1, access::read_write>;
+
+template <uint8_t Key>
+using key_dthr = reg<AT42QT2120_REG_KEY_00_DTHR + detail::key_index<Key>::value, 1, access::read_write>;
+template <uint8_t Key>
+using key_ctrl = reg<AT42QT2120_REG_KEY_00_CTRL + detail::key_index<Key>::value, 1, access::read_write>;
+template <uint8_t Key>
+using key_pulse_scale = reg<AT42QT2120_REG_KEY_00_PULSE_SCALE + detail::key_index<Key>::value, 1, access::read_write>;
+template <uint8_t Key>
+using key_signal = reg<AT42QT2120_REG_KEY_00_MSB_SIGNAL + 2 * detail::key_index<Key>::value, 2, access::read_only>;
+template <uint8_t Key>
+using key_reference = reg<AT42QT2120_REG_KEY_00_MSB_REFERENCE + 2 * detail::key_index<Key>::value, 2, access::read_only>;
+
+} // namespace regs
+
+namespace fields {
+
+using touch_detected = bitfield<regs::detection_status, 0, 1>;
+using slider_detected = bitfield<regs::detection_status, 1, 1>;
+using overflow = bitfield<regs::detection_status, 6, 1>;
+using calibrating = bitfield<regs::detection_status, 7, 1>;
+using slider_wheel = bitfield<regs::slider_options, 6, 1>;
+using slider_enable = bitfield<regs::slider_options, 7, 1>;
+
+template <uint8_t Key>
+using key = bitfield<regs::key_status, detail::key_index<Key>::value, 1>;
+
+template <uint8_t Key>
+using key_disable = bitfield<regs::key_ctrl<Key>, 0, 1>;
+template <uint8_t Key>
+using key_gpo = bitfield<regs::key_ctrl<Key>, 1, 1>;
+template <uint8_t Key>
+using key_aks = bitfield<regs::key_ctrl<Key>, 2, 2>;
+template <uint8_t Key>
+using key_guard = bitfield<regs::key_ctrl<Key>, 4, 1>;
+
+template <uint8_t Key>
+using key_scale = bitfield<regs::key_pulse_scale<Key>, 0, 4>;
+template <uint8_t Key>
+using key_pulse = bitfield<regs::key_pulse_scale<Key>, 4, 4>;
+
+} // namespace fields
+
+namespace bursts {
+
+using state = burst<regs::detection_status, regs::slider_position>;
+using setup = burst<regs::low_power_mode, regs::key_pulse_scale<AT42QT2120_NUM_KEYS - 1>>;
+using signals = burst<regs::key_signal<0>, regs::key_signal<AT42QT2120_NUM_KEYS - 1>>;
+using references = burst<regs::key_reference<0>, regs::key_reference<AT42QT2120_NUM_KEYS - 1>>;
+
+static_assert(state::length == AT42QT2120_STATE_REG_COUNT, "State burst does not match the C API");
+static_assert(setup::length == AT42QT2120_CONFIG_REG_COUNT, "Setup burst does not match the C API");
+static_assert(signals::length == AT42QT2120_SIGNAL_BLOCK_SIZE, "Signal burst does not match the C API");
+static_assert(references::length == AT42QT2120_REFERENCE_BLOCK_SIZE, "Reference burst does not match the C API");
+
+} // namespace bursts
+
+/**
+ * @brief Typed access to one AT42QT2120. Does not own the handle.
+ */
+class device {
+public:
+    explicit constexpr device(at42qt2120_handle_t* at42qt2120_handle) : handle_(at42qt2120_handle) {}
+
+    /** @brief Underlying C handle, for the parts of the C API not wrapped here */
+    at42qt2120_handle_t* handle() const { return handle_; }
+
+    /**
+     * @brief Reads a register, a bitfield (its whole register) or a burst in one transaction.
+     *
+     * @tparam T Register, bitfield or burst descriptor.
+     * @param value Buffer to store the value.
+     * @return esp_err_t ESP_OK on success, otherwise an error code.
+     */
+    template <typename T>
+    esp_err_t read(typename T::value_type& value) const {
+        if constexpr (detail::is_burst<T>::value) {
+            return at42qt2120_register_read(handle_, T::address, value.data(), T::length);
+        } else {
+            using reg_type = typename T::reg_type;
+            uint8_t raw[reg_type::width];
+            esp_err_t ret = at42qt2120_register_read(handle_, reg_type::address, raw, reg_type::width);
+            if (ret != ESP_OK)
+                return ret;
+            if constexpr (detail::is_field_v<T>)
+                value = T::decode(reg_type::decode(raw));
+            else
+                value = reg_type::decode(raw);
+            return ESP_OK;
+        }
+    }
+
+    /**
+     * @brief Stages a setup register, bitfield or burst in the register shadow without touching the bus.
+     *
+     * @tparam T Register, bitfield or burst descriptor.
+     * @param value Value to stage. Bits beyond a bitfield are dropped.
+     * @return esp_err_t ESP_OK on success, otherwise an error code.
+     */
+    template <typename T>
+    esp_err_t stage(const typename T::value_type& value) {
+        static_assert(T::writable, "Only setup registers (0x08-0x33) can be written");
+        if constexpr (detail::is_burst<T>::value) {
+            for (uint8_t index = 0; index < T::length; index++) {
+                esp_err_t ret = at42qt2120_shadow_write(handle_, T::address + index, value[index]);
+                if (ret != ESP_OK)
+                    return ret;
+            }
+            return ESP_OK;
+        } else if constexpr (detail::is_field_v<T>) {
+            return at42qt2120_shadow_update_bits(handle_, T::reg_type::address, T::mask, T::encode(value));
+        } else {
+            return at42qt2120_shadow_write(handle_, T::address, value);
+        }
+    }
+
+    /**
+     * @brief Stages a setup register, bitfield or burst and writes the shadow to the device.
+     *
+     * @tparam T Register, bitfield or burst descriptor.
+     * @param value Value to write. Bits beyond a bitfield are dropped.
+     * @return esp_err_t ESP_OK on success, otherwise an error code.
+     */
+    template <typename T>
+    esp_err_t write(const typename T::value_type& value) {
+        esp_err_t ret = stage<T>(value);
+        if (ret == ESP_OK)
+            ret = flush();
+        return ret;
+    }
+
+    /** @brief Writes every staged register to the device, see at42qt2120_shadow_flush() */
+    esp_err_t flush() { return at42qt2120_shadow_flush(handle_); }
+
+    /** @brief Starts a calibration, see at42qt2120_calibrate() */
+    esp_err_t calibrate() { return at42qt2120_calibrate(handle_); }
+
+    /** @brief Resets the device and waits for it, see at42qt2120_reset() */
+    esp_err_t reset() { return at42qt2120_reset(handle_); }
+
+private:
+    at42qt2120_handle_t* handle_;
+};
+
+} // namespace at42qt2120
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef ESP_AT42QT2120_CONFIG_H
+#define ESP_AT42QT2120_CONFIG_H
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_config.h
+ * @brief Declarative configuration of the AT42QT2120 setup registers.
+ *
+ * at42qt2120_config_t mirrors the writable register map (0x08-0x33) byte for byte, so a whole
+ * device configuration can be described in one place and applied as a minimal set of burst writes.
+ */
+
+/**
+ * @brief Complete contents of the writable setup registers. Field order matches the register map.
+ */
+typedef struct {
+    uint8_t low_power_mode;                             // 0x08 Low power mode (measurement interval in 8 ms steps)
+    uint8_t ttd;                                        // 0x09 Toward touch drift
+    uint8_t atd;                                        // 0x0A Away from touch drift
+    uint8_t detection_integrator;                       // 0x0B Measurements required to confirm a touch
+    uint8_t touch_recal_delay;                          // 0x0C Touch recalibration delay
+    uint8_t drift_hold_time;                            // 0x0D Drift hold time
+    uint8_t slider_options;                             // 0x0E Slider/wheel enable bits
+    uint8_t charge_time;                                // 0x0F Charge time
+    uint8_t key_dthr[AT42QT2120_NUM_KEYS];              // 0x10-0x1B Detection threshold per key
+    uint8_t key_ctrl[AT42QT2120_NUM_KEYS];              // 0x1C-0x27 Control settings per key
+    uint8_t key_pulse_scale[AT42QT2120_NUM_KEYS];       // 0x28-0x33 Pulse/scale settings per key
+} at42qt2120_config_t;
+
+/**
+ * @brief Fills a configuration with the device's power-on defaults.
+ *
+ * @param config Pointer to the configuration to fill.
+ */
+void at42qt2120_config_default(at42qt2120_config_t* config);
+
+/**
+ * @brief Stages a complete configuration in the register shadow without touching the bus
+ *        (besides a resync if the shadow is not valid yet). Use at42qt2120_shadow_plan() to inspect the resulting writes.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param config Pointer to the configuration to stage.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_config_stage(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_config_t* config);
+
+/**
+ * @brief Applies a complete configuration: diffs it against the device, writes the difference as a
+ *        minimal ordered set of bursts and verifies the result with one burst read.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param config Pointer to the configuration to apply.
+ * @param plan Optional pointer receiving the executed write plan (NULL if unused).
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_RESPONSE if the read back does not match, otherwise an error code.
+ */
+esp_err_t at42qt2120_apply_config(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_config_t* config, at42qt2120_write_plan_t* plan);
+
+/**
+ * @brief Returns the current configuration as held by the register shadow (resyncs it first if needed).
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param config Pointer to the configuration to fill.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_get_config(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_config_t* config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
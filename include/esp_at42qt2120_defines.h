@@ -16,6 +16,8 @@ extern "C" {
 /* ------------------ Device Address ------------------ */
 /** @brief AT42QT2120 I2C slave address (fixed and not changeable) */
 #define AT42QT2120_SLAVE_ADDRESS 0x1C
+/** @brief Value of the chip ID register */
+#define AT42QT2120_CHIP_ID 0x3E
 
 /* ------------------ General Registers ------------------ */
 /** @brief Register storing the chip ID (Always 0x3E) */
@@ -51,6 +53,29 @@ extern "C" {
 /** @brief Charge time register setting */
 #define AT42QT2120_REG_CHARGE_TIME 0x0F
 
+/* ------------------ Detection Status Bits ------------------ */
+/** @brief Set while at least one key is in detect */
+#define AT42QT2120_DETECTION_STATUS_TDET (1 << 0)
+/** @brief Set while the slider or wheel is in detect */
+#define AT42QT2120_DETECTION_STATUS_SDET (1 << 1)
+/** @brief Set when the acquisition cycle overran its time budget */
+#define AT42QT2120_DETECTION_STATUS_OVERFLOW (1 << 6)
+/** @brief Set while a calibration cycle is in progress */
+#define AT42QT2120_DETECTION_STATUS_CALIBRATE (1 << 7)
+
+/* ------------------ Slider Options Bits ------------------ */
+/** @brief Enables the slider/wheel on keys 0-2 */
+#define AT42QT2120_SLIDER_OPTIONS_EN (1 << 7)
+/** @brief Selects wheel instead of slider operation (requires AT42QT2120_SLIDER_OPTIONS_EN) */
+#define AT42QT2120_SLIDER_OPTIONS_WHEEL (1 << 6)
+/** @brief Number of keys (starting at key 0) forming the slider/wheel */
+#define AT42QT2120_SLIDER_NUM_KEYS 3
+
+/** @brief Number of touch keys on the AT42QT2120 */
+#define AT42QT2120_NUM_KEYS 12
+/** @brief Mask covering the valid bits of the combined 12-bit key status */
+#define AT42QT2120_KEY_MASK_ALL 0x0FFF
+
 /* ------------------ Key Threshold Registers ------------------ */
 /** @brief Detection threshold per key */
 #define AT42QT2120_REG_KEY_00_DTHR 0x10
@@ -96,6 +121,14 @@ extern "C" {
 #define AT42QT2120_REG_KEY_10_PULSE_SCALE 0x32
 #define AT42QT2120_REG_KEY_11_PULSE_SCALE 0x33
 
+/* ------------------ Writable Configuration Range ------------------ */
+/** @brief First writable setup register */
+#define AT42QT2120_REG_CONFIG_FIRST AT42QT2120_REG_LOW_POWER_MODE
+/** @brief Last writable setup register */
+#define AT42QT2120_REG_CONFIG_LAST AT42QT2120_REG_KEY_11_PULSE_SCALE
+/** @brief Number of writable setup registers (0x08-0x33) */
+#define AT42QT2120_CONFIG_REG_COUNT (AT42QT2120_REG_CONFIG_LAST - AT42QT2120_REG_CONFIG_FIRST + 1)
+
 /* ------------------ Key Signal Registers (MSB & LSB) ------------------ */
 /** @brief Signal values per key */
 #define AT42QT2120_REG_KEY_00_MSB_SIGNAL 0x34
@@ -123,6 +156,9 @@ extern "C" {
 #define AT42QT2120_REG_KEY_11_MSB_SIGNAL 0x4A
 #define AT42QT2120_REG_KEY_11_LSB_SIGNAL 0x4B
 
+/** @brief Size in bytes of the key signal block (0x34-0x4B) */
+#define AT42QT2120_SIGNAL_BLOCK_SIZE (2 * AT42QT2120_NUM_KEYS)
+
 /* ------------------ Key Reference Data Registers (MSB & LSB) ------------------ */
 /** @brief Reference Data values per key */
 #define AT42QT2120_REG_KEY_00_MSB_REFERENCE 0x4C
@@ -149,6 +185,8 @@ extern "C" {
 #define AT42QT2120_REG_KEY_10_LSB_REFERENCE 0x61
 #define AT42QT2120_REG_KEY_11_MSB_REFERENCE 0x62
 #define AT42QT2120_REG_KEY_11_LSB_REFERENCE 0x63
+/** @brief Size in bytes of the key reference block (0x4C-0x63) */
+#define AT42QT2120_REFERENCE_BLOCK_SIZE (2 * AT42QT2120_NUM_KEYS)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,212 @@
+#ifndef ESP_AT42QT2120_DRIFT_H
+#define ESP_AT42QT2120_DRIFT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_drift.h
+ * @brief Baseline drift monitor that calibrates only when it has to.
+ *
+ * Every sample reads the status registers and the signal/reference block and feeds the
+ * signal - reference delta of each monitored key into two exponential moving averages in
+ * Q8 fixed point: the mean delta and its mean absolute deviation. Samples taken while anything
+ * is in detect are not averaged, the device does not compensate drift then.
+ *
+ * A mean beyond drift_delta with a small deviation is systematic drift the device does not keep
+ * up with; a large deviation means a step such as a removed object. On drift the monitor halves
+ * TTD (drift towards touch) or ATD (away from touch), and again only if the drift still grows,
+ * at most once per tune_holdoff_ms and not below ttd_min/atd_min. Once no key has drifted for
+ * relax_time_ms, it doubles them back one step at a time towards their values at
+ * at42qt2120_drift_init().
+ *
+ * A calibration is only started when it is needed and safe:
+ * - it is needed when a key has been in detect for stuck_time_ms, or when its mean delta is beyond
+ *   recalibrate_delta;
+ * - it is safe when no other key and not the slider have been touched for quiet_time_ms, and no
+ *   calibration ran in the last calibrate_holdoff_ms.
+ * The device only calibrates all keys at once, so the gain is in how rarely it happens.
+ */
+
+/**
+ * @brief Drift monitor configuration.
+ */
+typedef struct {
+    uint16_t monitored_keys;                // Keys watched by the monitor (bit n for key n)
+    uint8_t ewma_shift;                     // Averaging weight 1/2^ewma_shift per sample
+    uint8_t drift_delta;                    // Mean delta in counts that counts as systematic drift and tunes TTD/ATD
+    uint8_t recalibrate_delta;              // Mean delta in counts that requires a calibration
+    uint32_t stuck_time_ms;                 // Time in detect after which a key counts as stuck
+    uint32_t quiet_time_ms;                 // Time without touches required before calibrating
+    uint32_t calibrate_holdoff_ms;          // Minimum time between two calibrations
+    bool tune_drift;                        // Tune TTD/ATD on systematic drift
+    uint8_t ttd_min;                        // Lower bound of TTD when tuning
+    uint8_t atd_min;                        // Lower bound of ATD when tuning
+    uint32_t tune_holdoff_ms;               // Minimum time between two tuning steps
+    uint32_t relax_time_ms;                 // Time without drift before TTD/ATD step back towards their initial values
+#ifdef ESP_PLATFORM
+    uint32_t sample_period_ms;              // Sample period of the monitor task
+    uint32_t task_stack_size;               // Stack size of the monitor task in bytes
+    UBaseType_t task_priority;              // Priority of the monitor task
+#endif
+} at42qt2120_drift_config_t;
+
+#ifdef ESP_PLATFORM
+/** @brief Default drift monitor configuration */
+#define AT42QT2120_DRIFT_CONFIG_DEFAULT() {         \
+    .monitored_keys = AT42QT2120_KEY_MASK_ALL,      \
+    .ewma_shift = 3,                                \
+    .drift_delta = 3,                               \
+    .recalibrate_delta = 8,                         \
+    .stuck_time_ms = 15000,                         \
+    .quiet_time_ms = 2000,                          \
+    .calibrate_holdoff_ms = 10000,                  \
+    .tune_drift = true,                             \
+    .ttd_min = 2,                                   \
+    .atd_min = 1,                                   \
+    .tune_holdoff_ms = 5000,                        \
+    .relax_time_ms = 300000,                        \
+    .sample_period_ms = 250,                        \
+    .task_stack_size = 3072,                        \
+    .task_priority = 5,                             \
+}
+#else
+/** @brief Default drift monitor configuration */
+#define AT42QT2120_DRIFT_CONFIG_DEFAULT() {         \
+    .monitored_keys = AT42QT2120_KEY_MASK_ALL,      \
+    .ewma_shift = 3,                                \
+    .drift_delta = 3,                               \
+    .recalibrate_delta = 8,                         \
+    .stuck_time_ms = 15000,                         \
+    .quiet_time_ms = 2000,                          \
+    .calibrate_holdoff_ms = 10000,                  \
+    .tune_drift = true,                             \
+    .ttd_min = 2,                                   \
+    .atd_min = 1,                                   \
+    .tune_holdoff_ms = 5000,                        \
+    .relax_time_ms = 300000,                        \
+}
+#endif
+
+/**
+ * @brief Incremental delta statistics of one key.
+ */
+typedef struct {
+    int32_t mean_q8;                        // Moving average of signal - reference, Q8
+    int32_t deviation_q8;                   // Moving average of |delta - mean|, Q8 (noise estimate)
+    int64_t detect_since_us;                // Time the key entered detect, 0 while not in detect
+} at42qt2120_key_drift_t;
+
+/**
+ * @brief Counters of a drift monitor.
+ */
+typedef struct {
+    uint32_t samples;                       // Samples read
+    uint32_t averaged;                      // Samples fed into the averages (no touch)
+    uint32_t read_errors;                   // Failed reads
+    uint32_t calibrations;                  // Calibrations started by the monitor
+    uint32_t tunings;                       // TTD/ATD writes
+} at42qt2120_drift_stats_t;
+
+/**
+ * @brief Structure representing a drift monitor.
+ */
+typedef struct {
+    at42qt2120_handle_t* at42qt2120_handle;             // Device the monitor watches
+    at42qt2120_drift_config_t config;                   // Configuration given to at42qt2120_drift_init()
+    at42qt2120_key_drift_t keys[AT42QT2120_NUM_KEYS];   // Statistics per key
+    bool primed;                                        // Averages hold at least one sample
+    uint16_t drifting_mask;                             // Keys whose mean delta is beyond drift_delta
+    uint16_t stuck_mask;                                // Keys in detect for longer than stuck_time_ms
+    int64_t last_touch_us;                              // Time of the last sample with a touch (stuck keys excluded)
+    int64_t last_calibrate_us;                          // Time of the last calibration seen (started by anyone)
+    int64_t last_tune_us;                               // Time of the last TTD/ATD write
+    int64_t last_drift_us;                              // Time of the last sample with a drifting key
+    int32_t toward_peak_q8;                             // Largest drift towards touch at the last TTD step, Q8
+    int32_t away_peak_q8;                               // Largest drift away from touch at the last ATD step, Q8
+    uint8_t ttd;                                        // TTD currently programmed
+    uint8_t atd;                                        // ATD currently programmed
+    uint8_t ttd_initial;                                // TTD at at42qt2120_drift_init()
+    uint8_t atd_initial;                                // ATD at at42qt2120_drift_init()
+    at42qt2120_drift_stats_t stats;                     // Counters
+#ifdef ESP_PLATFORM
+    TaskHandle_t monitor_task;                          // Monitor task (NULL while stopped)
+    SemaphoreHandle_t stopped_sem;                      // Given by the monitor task when it exits
+    volatile bool running;                              // Cleared to request the monitor task to exit
+#endif
+} at42qt2120_drift_monitor_t;
+
+/**
+ * @brief Initializes a drift monitor and records the current TTD/ATD as the values to relax back to.
+ *
+ * @param monitor Pointer to the monitor structure.
+ * @param at42qt2120_handle Pointer to an initialized at42qt2120 handle.
+ * @param config Pointer to the configuration.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_drift_init(at42qt2120_drift_monitor_t* monitor, at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_drift_config_t* config);
+
+/**
+ * @brief Deinitializes a drift monitor. Stops the monitor task first if it is running.
+ *
+ * @param monitor Pointer to the monitor structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_drift_deinit(at42qt2120_drift_monitor_t* monitor);
+
+/**
+ * @brief Feeds one sample read elsewhere into the monitor, then tunes or calibrates if needed.
+ *
+ * @param monitor Pointer to the monitor structure.
+ * @param state Pointer to the state read together with the signals.
+ * @param signals Signal of each key.
+ * @param references Reference of each key.
+ * @param time_us Time the sample was read.
+ * @return esp_err_t ESP_OK on success, otherwise the error of a failed TTD/ATD write or calibration start.
+ */
+esp_err_t at42qt2120_drift_update(at42qt2120_drift_monitor_t* monitor, const at42qt2120_state_t* state, const uint16_t signals[AT42QT2120_NUM_KEYS],
+                                  const uint16_t references[AT42QT2120_NUM_KEYS], int64_t time_us);
+
+/**
+ * @brief Reads the state and the signal/reference block (two bursts) and feeds them to at42qt2120_drift_update().
+ *
+ * @param monitor Pointer to the monitor structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_drift_sample(at42qt2120_drift_monitor_t* monitor);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Starts the monitor task, which calls at42qt2120_drift_sample() every sample_period_ms.
+ *
+ * @param monitor Pointer to the monitor structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_drift_start(at42qt2120_drift_monitor_t* monitor);
+
+/**
+ * @brief Stops the monitor task and waits for it to exit.
+ *
+ * @param monitor Pointer to the monitor structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_drift_stop(at42qt2120_drift_monitor_t* monitor);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,24 +1,277 @@
 #ifndef ESP_AT42QT2120_DRIVER_H
 #define ESP_AT42QT2120_DRIVER_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <esp_err.h>
+#ifdef ESP_PLATFORM
 #include <driver/i2c_master.h>
+#endif
+
+#include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_transport.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** @brief Number of consecutive status registers (0x02-0x05) read by at42qt2120_read_state() */
+#define AT42QT2120_STATE_REG_COUNT 4
+
 /**
- * @brief Structure representing a at42qt2120 handle.
+ * @brief Bus traffic counters kept per at42qt2120 handle.
+ */
+typedef struct {
+    uint32_t transactions;                  // Number of I2C transactions issued by at42qt2120_register_read/at42qt2120_register_write
+    uint32_t bytes;                         // Bytes moved on the bus, including the register address byte (excludes the I2C address byte)
+} at42qt2120_bus_stats_t;
+
+/**
+ * @brief Transaction instrumentation in at42qt2120_register_read/at42qt2120_register_write.
+ *        Compiled in only when AT42QT2120_INSTRUMENTATION is defined to 1; otherwise the handle
+ *        carries no instrumentation state and the register functions no extra code.
+ */
+#ifndef AT42QT2120_INSTRUMENTATION
+#define AT42QT2120_INSTRUMENTATION 0
+#endif
+/** @brief Number of log2 latency buckets. Bucket 0 counts latencies of 0 ticks, bucket n latencies in [2^(n-1), 2^n) */
+#define AT42QT2120_LATENCY_BUCKETS 24
+/** @brief Number of distinct error codes counted individually, further codes are counted in other_errors */
+#define AT42QT2120_ERROR_CODE_SLOTS 6
+
+/**
+ * @brief Monotonic clock used to time transactions. Defaults to the transport time in microseconds.
+ */
+typedef struct {
+    uint32_t (*now)(void* ctx);             // Free running counter, wraps at 2^32
+    void* ctx;                              // Context passed to now
+    uint32_t ticks_per_us;                  // Counter ticks per microsecond, for reporting
+} at42qt2120_clock_t;
+
+/**
+ * @brief Counters of one transaction direction.
+ */
+typedef struct {
+    uint32_t transactions;                                  // Transactions issued
+    uint32_t bytes;                                         // Bytes moved, including the register address byte
+    uint32_t errors;                                        // Transactions that did not return ESP_OK
+    uint32_t latency_max;                                   // Longest transaction in clock ticks
+    uint64_t latency_total;                                 // Sum of all transaction times in clock ticks
+    uint32_t latency_histogram[AT42QT2120_LATENCY_BUCKETS]; // Transactions per log2 latency bucket
+} at42qt2120_transfer_stats_t;
+
+/**
+ * @brief Number of transactions that failed with one error code.
+ */
+typedef struct {
+    esp_err_t code;                         // Error code
+    uint32_t count;                         // Transactions that returned code
+} at42qt2120_error_count_t;
+
+/**
+ * @brief Snapshot of the transaction instrumentation of a handle.
+ */
+typedef struct {
+    at42qt2120_transfer_stats_t read;                               // at42qt2120_register_read transactions
+    at42qt2120_transfer_stats_t write;                              // at42qt2120_register_write transactions
+    at42qt2120_error_count_t errors[AT42QT2120_ERROR_CODE_SLOTS];   // Failures by error code, in order of first occurrence
+    uint32_t other_errors;                                          // Failures whose code did not fit into errors
+    uint32_t ticks_per_us;                                          // Resolution of the latency figures
+} at42qt2120_instrumentation_t;
+
+/**
+ * @brief Decoded snapshot of the at42qt2120 status registers (0x02-0x05).
+ */
+typedef struct {
+    uint8_t detection_status;               // Raw detection status byte
+    bool touch_detected;                    // TDET: at least one key is in detect
+    bool slider_detected;                   // SDET: slider/wheel is in detect
+    bool overflow;                          // OVERFLOW: acquisition cycle overran its time budget
+    bool calibrating;                       // CALIBRATE: calibration cycle in progress
+    uint16_t key_mask;                      // Bit n is set while key n is in detect (12 valid bits)
+    uint8_t slider_position;                // Slider/wheel position (0-255), 0 when slider/wheel is disabled
+} at42qt2120_state_t;
+
+/**
+ * @brief Host-side shadow of the writable setup registers (0x08-0x33).
+ */
+typedef struct {
+    uint8_t regs[AT42QT2120_CONFIG_REG_COUNT];  // Cached register values, index 0 is AT42QT2120_REG_CONFIG_FIRST
+    uint64_t dirty;                             // Bit n is set while regs[n] holds a value not yet written to the device
+    bool valid;                                 // True once regs[] mirrors the device (cleared by reset)
+} at42qt2120_shadow_t;
+
+/** @brief Upper bound of bursts needed to flush the setup registers (every other register dirty) */
+#define AT42QT2120_WRITE_PLAN_MAX_BURSTS ((AT42QT2120_CONFIG_REG_COUNT + 1) / 2)
+
+/**
+ * @brief A single contiguous burst write.
+ */
+typedef struct {
+    uint8_t reg;                            // First register of the burst
+    uint8_t length;                         // Number of registers written
+} at42qt2120_write_burst_t;
+
+/**
+ * @brief Ordered list of burst writes needed to flush the shadow.
+ */
+typedef struct {
+    at42qt2120_write_burst_t bursts[AT42QT2120_WRITE_PLAN_MAX_BURSTS]; // Bursts in ascending register order
+    uint8_t burst_count;                                                // Number of valid entries in bursts
+    uint8_t byte_count;                                                 // Total number of register bytes written
+} at42qt2120_write_plan_t;
+
+/**
+ * @brief Device operations whose completion is tracked by the driver.
+ */
+typedef enum {
+    AT42QT2120_PENDING_NONE,                // Nothing in progress
+    AT42QT2120_PENDING_RESET,               // Reset cycle (followed by a calibration)
+    AT42QT2120_PENDING_CALIBRATE,           // Calibration cycle
+} at42qt2120_pending_type_t;
+
+struct at42qt2120_handle;
+
+/**
+ * @brief Callback invoked once a reset or calibration completed (result ESP_OK), timed out (ESP_ERR_TIMEOUT)
+ *        or was superseded by a newer reset or calibration with another callback (ESP_ERR_INVALID_STATE).
+ */
+typedef void (*at42qt2120_ready_cb_t)(struct at42qt2120_handle* at42qt2120_handle, esp_err_t result, void* user_ctx);
+
+/**
+ * @brief Completion tracking of a reset or calibration started with at42qt2120_reset_async()/at42qt2120_calibrate_async().
+ */
+typedef struct {
+    at42qt2120_pending_type_t type;         // Operation in progress
+    int64_t deadline_us;                    // Time after which the operation is reported as timed out
+    int64_t next_poll_us;                   // Earliest time of the next status poll
+    uint32_t backoff_us;                    // Current poll interval, doubled after every unfinished poll
+    at42qt2120_ready_cb_t callback;         // Completion callback (NULL if unused)
+    void* user_ctx;                         // User context passed to callback
+} at42qt2120_pending_op_t;
+
+/** @brief Capacity of the per-handle error ring */
+#ifndef AT42QT2120_ERROR_RING_SIZE
+#define AT42QT2120_ERROR_RING_SIZE 16
+#endif
+
+/**
+ * @brief Operations that can fail and end up in the error ring.
+ */
+typedef enum {
+    AT42QT2120_ERROR_OP_READ,               // Register read
+    AT42QT2120_ERROR_OP_WRITE,              // Register write
+    AT42QT2120_ERROR_OP_PROBE,              // Address probe during recovery
+    AT42QT2120_ERROR_OP_CHIP_ID,            // Chip ID read back wrong during recovery or a profile boot
+    AT42QT2120_ERROR_OP_REAPPLY,            // Setup registers had to be re-applied (device lost its configuration)
+    AT42QT2120_ERROR_OP_VERIFY,             // Configuration read back differs from the one applied
+    AT42QT2120_ERROR_OP_READY_TIMEOUT,      // Reset or calibration did not complete before its deadline
+} at42qt2120_error_op_t;
+
+/**
+ * @brief One entry of the error ring. Identical consecutive errors are folded into one entry.
+ */
+typedef struct {
+    int64_t time_us;                        // Time of the first occurrence
+    esp_err_t code;                         // Error code (ESP_OK for AT42QT2120_ERROR_OP_REAPPLY)
+    at42qt2120_error_op_t op;               // Failed operation
+    uint8_t reg;                            // Register involved (AT42QT2120_REG_CONFIG_FIRST for AT42QT2120_ERROR_OP_REAPPLY, 0 if none)
+    uint8_t value;                          // Value read back: chip ID for CHIP_ID, device value of reg for VERIFY, number of registers for REAPPLY, else 0
+    uint16_t repeats;                       // Further occurrences folded into this entry
+} at42qt2120_error_record_t;
+
+/**
+ * @brief Rate-limited error ring. The oldest entry is overwritten when the ring is full.
+ */
+typedef struct {
+    at42qt2120_error_record_t records[AT42QT2120_ERROR_RING_SIZE];  // Ring storage
+    uint32_t head;                                                  // Next entry written
+    uint32_t tail;                                                  // Next entry popped
+    int64_t window_start_us;                                        // Start of the current rate limit window
+    uint16_t window_records;                                        // Entries added in the current window
+    uint32_t suppressed;                                            // Errors dropped by the rate limit
+    uint32_t overwritten;                                           // Entries lost because the ring was full
+} at42qt2120_error_log_t;
+
+/**
+ * @brief Retry and recovery settings.
+ */
+typedef struct {
+    uint8_t max_retries;                    // Retries of a failed transaction (0 disables retries)
+    uint8_t backoff_min_ms;                 // Delay before the first retry, doubled for every further retry
+    uint8_t backoff_max_ms;                 // Upper bound of the retry delay
+    bool auto_recover;                      // Flag a recovery when the retries run out or an unexpected calibration shows up, see at42qt2120_recover_poll()
+    uint16_t recover_interval_min_ms;       // Time between a failed recovery attempt and the next one, doubled after every further failure
+    uint16_t recover_interval_max_ms;       // Upper bound of the time between recovery attempts
+    uint16_t error_rate_limit;              // Entries added to the error ring per window (0 disables the limit)
+    uint32_t error_window_ms;               // Length of the rate limit window
+} at42qt2120_recovery_config_t;
+
+/** @brief Default retry and recovery settings, applied by the init functions */
+#define AT42QT2120_RECOVERY_CONFIG_DEFAULT() {  \
+    .max_retries = 3,                           \
+    .backoff_min_ms = 1,                        \
+    .backoff_max_ms = 8,                        \
+    .auto_recover = true,                       \
+    .recover_interval_min_ms = 50,              \
+    .recover_interval_max_ms = 2000,            \
+    .error_rate_limit = 8,                      \
+    .error_window_ms = 1000,                    \
+}
+
+/**
+ * @brief Retry and recovery counters.
  */
 typedef struct {
+    uint32_t retries;                       // Transactions repeated after a failure
+    uint32_t recoveries;                    // Recovery runs (automatic or at42qt2120_recover())
+    uint32_t reapplied;                     // Recoveries that found the configuration lost and wrote it back
+    uint32_t device_resets;                 // Recoveries that had to reset the device (wrong chip ID)
+    uint32_t failed;                        // Recoveries that did not bring the device back
+} at42qt2120_recovery_stats_t;
+
+/**
+ * @brief Recovery state of a handle.
+ */
+typedef struct {
+    at42qt2120_recovery_config_t config;    // Settings, see at42qt2120_set_recovery_config()
+    at42qt2120_recovery_stats_t stats;      // Counters, see at42qt2120_get_recovery_stats()
+    bool active;                            // Recovery in progress, its own failed transactions do not flag another one
+    bool calibrate_checked;                 // The current unexpected calibration was already flagged
+    bool needed;                            // A recovery was flagged and has not succeeded yet
+    bool resetting;                         // The recovery reset the device and continues once the reset completed
+    bool cached;                            // wanted holds a configuration to restore
+    uint8_t wanted[AT42QT2120_CONFIG_REG_COUNT]; // Setup registers to restore, taken from the shadow when the recovery started
+    int64_t next_attempt_us;                // Earliest time of the next attempt of at42qt2120_recover_poll()
+    uint32_t interval_ms;                   // Current time between attempts
+} at42qt2120_recovery_t;
+
+/**
+ * @brief Structure representing a at42qt2120 handle.
+ */
+typedef struct at42qt2120_handle {
+#ifdef ESP_PLATFORM
     i2c_device_config_t device_config;      // I2C device configuration (Contains i2c address, address bit length, and clock speed)
+    i2c_master_bus_handle_t bus_handle;     // I2C bus the device was added to
     i2c_master_dev_handle_t device_handle;  // I2C device handle
+#endif
+    at42qt2120_transport_t transport;       // Transport every transaction goes through
     int transaction_timeout_ms;             // Timeout for I2C transactions in milliseconds (-1 results in an infinite wait time)
+    at42qt2120_bus_stats_t bus_stats;       // Bus traffic counters, see at42qt2120_get_bus_stats()
+    at42qt2120_shadow_t shadow;             // Shadow of the setup registers, see at42qt2120_shadow_write()
+    at42qt2120_pending_op_t pending_op;     // Reset/calibration in progress, see at42qt2120_poll_ready()
+    at42qt2120_recovery_t recovery;         // Retry and recovery state, see at42qt2120_recover()
+    at42qt2120_error_log_t error_log;       // Rate-limited error ring, see at42qt2120_error_pop()
+#if AT42QT2120_INSTRUMENTATION
+    at42qt2120_clock_t clock;               // Clock timing the transactions (now == NULL uses the transport time)
+    at42qt2120_instrumentation_t instrumentation; // Transaction instrumentation, see at42qt2120_get_instrumentation()
+#endif
 } at42qt2120_handle_t;
 
+#ifdef ESP_PLATFORM
 /**
- * @brief Initialize a at42qt2120 device.
+ * @brief Initialize a at42qt2120 device on an ESP-IDF I2C master bus.
+ *        The handle must stay at the same address until it is deinitialized.
  *
  * @param bus_handle Handle to the I2C master bus.
  * @param at42qt2120_handle Pointer to the return at42qt2120 handle structure.
@@ -27,6 +280,17 @@ typedef struct {
  * @return esp_err_t ESP_OK on success, otherwise an error code.
  */
 esp_err_t at42qt2120_init(i2c_master_bus_handle_t bus_handle, at42qt2120_handle_t* at42qt2120_handle, size_t clock_speed, int time_out);
+#endif
+
+/**
+ * @brief Initialize a at42qt2120 device on a custom transport (e.g. the host simulator).
+ *
+ * @param at42qt2120_handle Pointer to the return at42qt2120 handle structure.
+ * @param transport Pointer to the transport to use. It is copied into the handle.
+ * @param time_out Time in ms to wait for I2C response. -1 results in infinite wait time
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_init_with_transport(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_transport_t* transport, int time_out);
 
 /**
  * @brief Deinitialize a at42qt2120 device.
@@ -38,6 +302,8 @@ esp_err_t at42qt2120_deinit(at42qt2120_handle_t* at42qt2120_handle);
 
 /**
  * @brief Read a register from the at42qt2120 device.
+ *        A failed transaction is reported to the error ring and nothing in the driver logs it, so a glitching bus
+ *        cannot stall the polling paths on console output. See at42qt2120_error_pop().
  *
  * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
  * @param reg_to_read Register address to read from.
@@ -49,6 +315,9 @@ esp_err_t at42qt2120_register_read(at42qt2120_handle_t* at42qt2120_handle, uint8
 
 /**
  * @brief Write to a register from the at42qt2120 device.
+ *        Setup registers (0x08-0x33) it writes are mirrored into the register shadow and drop any value
+ *        staged for them, so a later at42qt2120_shadow_flush() neither skips nor overwrites them. A failed
+ *        write leaves the shadow unchanged.
  *
  * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
  * @param reg_to_write Register address to write to.
@@ -58,6 +327,35 @@ esp_err_t at42qt2120_register_read(at42qt2120_handle_t* at42qt2120_handle, uint8
  */
 esp_err_t at42qt2120_register_write(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg_to_write, uint8_t* write_buf, uint8_t write_buf_size);
 
+/**
+ * @brief Decodes the raw contents of the status registers (0x02-0x05) into a state snapshot.
+ *
+ * @param raw Bytes read from AT42QT2120_REG_DETECTION_STATUS through AT42QT2120_REG_SLIDER_POSITION.
+ * @param state Pointer to the state structure to fill.
+ */
+void at42qt2120_decode_state(const uint8_t raw[AT42QT2120_STATE_REG_COUNT], at42qt2120_state_t* state);
+
+/**
+ * @brief Reads detection status, key status and slider position in a single I2C transaction.
+ *        Completes a pending reset/calibration and, with auto_recover, flags a recovery once when a
+ *        calibration shows up that the driver did not start (the device reset itself). The recovery
+ *        itself never runs here, see at42qt2120_recover_poll().
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param state Pointer to the state structure to fill.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_read_state(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_state_t* state);
+
+/**
+ * @brief Reads the at42qt2120 device's key status as a 12-bit mask (bit n set while key n is in detect).
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param key_mask Buffer to store the key status mask.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_read_key_status(at42qt2120_handle_t* at42qt2120_handle, uint16_t* key_mask);
+
 /**
  * @brief Reads the at42qt2120 device's detection byte. The purpose of specifc bits can be referenced in the at42qt2120 device's datasheet
  *
@@ -77,21 +375,77 @@ esp_err_t at42qt2120_read_detection_status(at42qt2120_handle_t* at42qt2120_handl
 esp_err_t at42qt2120_read_slider_position(at42qt2120_handle_t* at42qt2120_handle, uint8_t* position_buf);
 
 /**
- * @brief Starts the calibration cycle of the at42qt2120 device.
+ * @brief Starts the calibration cycle of the at42qt2120 device and returns immediately.
+ *        Use at42qt2120_wait_ready() to block until the calibration finished. A calibration
+ *        still in progress is restarted.
  *
  * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
- * @return esp_err_t ESP_OK on success, otherwise an error code.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE while a reset is pending (it ends with a calibration),
+ *         otherwise an error code.
  */
 esp_err_t at42qt2120_calibrate(at42qt2120_handle_t* at42qt2120_handle);
 
 /**
- * @brief Resets the at42qt2120 device to initial state.
+ * @brief Resets the at42qt2120 device to initial state. Blocks until the device finished
+ *        its reset and the following calibration, then resyncs the register shadow.
  *
  * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
  * @return esp_err_t ESP_OK on success, otherwise an error code.
  */
 esp_err_t at42qt2120_reset(at42qt2120_handle_t* at42qt2120_handle);
 
+/**
+ * @brief Starts a reset cycle and returns immediately. Completion is detected by at42qt2120_poll_ready()
+ *        or by the event engine when the CHANGE line asserts. A pending reset or calibration is superseded:
+ *        its callback, if it differs from this one, is invoked with ESP_ERR_INVALID_STATE.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param callback Optional completion callback (NULL if unused).
+ * @param user_ctx User context passed to callback.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_reset_async(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_ready_cb_t callback, void* user_ctx);
+
+/**
+ * @brief Starts a calibration cycle and returns immediately. Completion is detected by at42qt2120_poll_ready()
+ *        or by the event engine when the CHANGE line asserts. A pending calibration is restarted, and its
+ *        callback, if it differs from this one, is invoked with ESP_ERR_INVALID_STATE.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param callback Optional completion callback (NULL if unused).
+ * @param user_ctx User context passed to callback.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE while a reset is pending (it ends with a calibration),
+ *         otherwise an error code.
+ */
+esp_err_t at42qt2120_calibrate_async(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_ready_cb_t callback, void* user_ctx);
+
+/**
+ * @brief Advances completion detection of a pending reset or calibration without blocking.
+ *        Reads the status registers only once the current backoff interval elapsed.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK once nothing is pending, ESP_ERR_NOT_FINISHED while the operation is in progress,
+ *         ESP_ERR_TIMEOUT if it did not complete in time, otherwise an error code.
+ */
+esp_err_t at42qt2120_poll_ready(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Blocks until a pending reset or calibration completed, sleeping between polls with bounded backoff.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param timeout_ms Maximum time to wait in ms. -1 waits until the operation's own deadline
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT if the device did not become ready, otherwise an error code.
+ */
+esp_err_t at42qt2120_wait_ready(at42qt2120_handle_t* at42qt2120_handle, int timeout_ms);
+
+/**
+ * @brief Feeds a state read elsewhere to the completion detection. at42qt2120_read_state() does this itself.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param state Pointer to the freshly read state.
+ */
+void at42qt2120_pending_op_update(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_state_t* state);
+
 /**
  * @brief Enables the slider option for the at42qt2120 device
  *
@@ -116,8 +470,198 @@ esp_err_t at42qt2120_enable_wheel(at42qt2120_handle_t* at42qt2120_handle);
  */
 esp_err_t at42qt2120_disable_slider_wheel(at42qt2120_handle_t* at42qt2120_handle);
 
+/**
+ * @brief Stages a setup register value in the shadow. Nothing is sent until at42qt2120_shadow_flush().
+ *        Values equal to the cached device value are not marked dirty.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param reg Setup register address (AT42QT2120_REG_CONFIG_FIRST to AT42QT2120_REG_CONFIG_LAST).
+ * @param value Value to stage.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_shadow_write(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg, uint8_t value);
+
+/**
+ * @brief Stages a read-modify-write of a setup register using the cached value (resyncs the shadow first if needed).
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param reg Setup register address (AT42QT2120_REG_CONFIG_FIRST to AT42QT2120_REG_CONFIG_LAST).
+ * @param mask Bits to modify.
+ * @param value New value of the bits selected by mask.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_shadow_update_bits(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg, uint8_t mask, uint8_t value);
+
+/**
+ * @brief Reads a setup register from the shadow. Only touches the bus if the shadow has to be resynced.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param reg Setup register address (AT42QT2120_REG_CONFIG_FIRST to AT42QT2120_REG_CONFIG_LAST).
+ * @param value Buffer to store the register value (including staged, not yet flushed writes).
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_shadow_read(at42qt2120_handle_t* at42qt2120_handle, uint8_t reg, uint8_t* value);
+
+/**
+ * @brief Computes the burst writes at42qt2120_shadow_flush() would issue, without touching the bus.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param plan Pointer to the plan structure to fill.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_shadow_plan(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_write_plan_t* plan);
+
+/**
+ * @brief Writes all dirty setup registers using the fewest contiguous burst writes.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code. Registers that failed to write stay dirty.
+ */
+esp_err_t at42qt2120_shadow_flush(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Reloads the shadow from the device with one burst read. Staged (dirty) values are kept.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_shadow_resync(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Marks the shadow as no longer mirroring the device, e.g. after the device was reset externally.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_shadow_invalidate(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Blocks the caller for at least delay_ms using the handle's transport.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param delay_ms Time to wait in ms.
+ */
+void at42qt2120_delay_ms(at42qt2120_handle_t* at42qt2120_handle, uint32_t delay_ms);
+
+/**
+ * @brief Returns the monotonic time of the handle's transport.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return int64_t Time in microseconds.
+ */
+int64_t at42qt2120_time_us(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Copies the bus traffic counters of the at42qt2120 handle.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param stats Pointer to the structure receiving the counters.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_get_bus_stats(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_bus_stats_t* stats);
+
+/**
+ * @brief Clears the bus traffic counters of the at42qt2120 handle.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_reset_bus_stats(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Copies the transaction instrumentation of the at42qt2120 handle.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param instrumentation Pointer to the structure receiving the snapshot.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED if instrumentation is compiled out, otherwise an error code.
+ */
+esp_err_t at42qt2120_get_instrumentation(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_instrumentation_t* instrumentation);
+
+/**
+ * @brief Clears the transaction instrumentation of the at42qt2120 handle.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED if instrumentation is compiled out, otherwise an error code.
+ */
+esp_err_t at42qt2120_reset_instrumentation(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Sets the clock used to time transactions, e.g. a CPU cycle counter for sub-microsecond resolution.
+ *        Clears the instrumentation since old and new figures are not comparable.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param clock Pointer to the clock (copied), NULL restores the transport time.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_SUPPORTED if instrumentation is compiled out, otherwise an error code.
+ */
+esp_err_t at42qt2120_set_instrumentation_clock(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_clock_t* clock);
+
+/**
+ * @brief Sets the retry and recovery settings.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param config Pointer to the settings (copied).
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_set_recovery_config(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_recovery_config_t* config);
+
+/**
+ * @brief Brings the device back after bus errors: re-probes the address with backoff, checks the chip ID
+ *        (resetting the device if it reads back wrong) and compares the setup registers with the shadow.
+ *        Registers the device lost, e.g. after a brown-out, are written back and a calibration is started.
+ *        Blocks until a reset it needed completed; at42qt2120_recover_poll() runs it without blocking.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK once the device answers with its configuration in place, otherwise an error code.
+ */
+esp_err_t at42qt2120_recover(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Runs a recovery flagged by the read path (retries ran out, or the device reset itself) outside of it,
+ *        e.g. from the polling task after the state was handled. Does nothing unless a recovery is flagged. A
+ *        reset of the recovery is tracked like at42qt2120_reset_async() and continued by later calls. After a
+ *        failed attempt the next one waits recover_interval_min_ms, doubling up to recover_interval_max_ms,
+ *        so a disconnected device costs one attempt per interval. While a recovery is flagged, transactions
+ *        are not retried.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @return esp_err_t ESP_OK if no recovery is flagged or it succeeded, ESP_ERR_NOT_FINISHED while the next attempt
+ *         is not due or the recovery's reset is in progress, otherwise the error of the failed attempt.
+ */
+esp_err_t at42qt2120_recover_poll(at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Adds an entry to the error ring. A repeat of the newest entry only increments its repeat count.
+ *        Beyond error_rate_limit entries per window, errors are only counted as suppressed.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param op Failed operation.
+ * @param reg Register involved (0 if none).
+ * @param value Value read back, see at42qt2120_error_record_t (0 if none).
+ * @param code Error code.
+ */
+void at42qt2120_error_report(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_error_op_t op, uint8_t reg, uint8_t value, esp_err_t code);
+
+/**
+ * @brief Takes the oldest entry from the error ring, e.g. to log it from a low priority task.
+ *        The ring is the only record of bus failures: the driver returns their codes without logging them.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param record Pointer to the structure receiving the entry.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the ring is empty.
+ */
+esp_err_t at42qt2120_error_pop(at42qt2120_handle_t* at42qt2120_handle, at42qt2120_error_record_t* record);
+
+/**
+ * @brief Copies the retry and recovery counters.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param stats Pointer to the structure receiving the counters.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_get_recovery_stats(const at42qt2120_handle_t* at42qt2120_handle, at42qt2120_recovery_stats_t* stats);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
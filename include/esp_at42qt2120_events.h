@@ -0,0 +1,207 @@
+#ifndef ESP_AT42QT2120_EVENTS_H
+#define ESP_AT42QT2120_EVENTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#ifdef ESP_PLATFORM
+#include <driver/gpio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_keys.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_events.h
+ * @brief CHANGE-pin driven event engine for the AT42QT2120.
+ *
+ * The AT42QT2120 pulls its open-drain CHANGE line low whenever the status registers hold
+ * unread changes, and releases it once they have been read. The event engine waits on that
+ * line, reads the state only when it asserts and turns the difference to the previous
+ * state into key and slider events. No bus traffic is generated while the device is idle.
+ *
+ * The key difference is taken by a key decoder (see esp_at42qt2120_keys.h) with debounce, long
+ * press, repeat and chords off, so releases are dispatched before presses, each in key order.
+ *
+ * The worker task, event queue and GPIO backend are only available on ESP-IDF. On other
+ * platforms the engine is driven by calling at42qt2120_event_engine_service() whenever the
+ * (simulated) CHANGE line asserts.
+ */
+
+/**
+ * @brief Types of events produced by the event engine.
+ */
+typedef enum {
+    AT42QT2120_EVENT_KEY_DOWN,              // A key entered detect
+    AT42QT2120_EVENT_KEY_UP,                // A key left detect
+    AT42QT2120_EVENT_SLIDER_MOVE,           // The slider/wheel is touched and its position changed
+    AT42QT2120_EVENT_SLIDER_RELEASE,        // The slider/wheel left detect
+} at42qt2120_event_type_t;
+
+/**
+ * @brief Structure describing a single decoded event.
+ */
+typedef struct {
+    at42qt2120_event_type_t type;           // Event type
+    uint8_t key;                            // Key index for AT42QT2120_EVENT_KEY_DOWN/AT42QT2120_EVENT_KEY_UP
+    uint8_t position;                       // Slider position for slider events
+    uint16_t key_mask;                      // Key status mask after this change
+} at42qt2120_event_t;
+
+/**
+ * @brief Callback invoked for every event, from the context calling at42qt2120_event_engine_service().
+ */
+typedef void (*at42qt2120_event_cb_t)(const at42qt2120_event_t* event, void* user_ctx);
+
+/**
+ * @brief Abstraction of the CHANGE line so the engine can run on a GPIO or a simulated line.
+ */
+typedef struct {
+    esp_err_t (*enable)(void* ctx, void (*isr_handler)(void* arg), void* arg);  // Arm the line. isr_handler is called (possibly from an ISR) when the line asserts
+    void (*disable)(void* ctx);                                                 // Disarm the line
+    bool (*is_asserted)(void* ctx);                                             // Returns true while the line is held low
+    void* ctx;                                                                  // Backend context passed to the functions above
+} at42qt2120_change_line_t;
+
+/**
+ * @brief Configuration of the event engine.
+ */
+typedef struct {
+    at42qt2120_change_line_t change_line;   // CHANGE line backend, see at42qt2120_change_line_gpio()
+    at42qt2120_event_cb_t callback;         // Optional event callback (NULL if unused)
+    void* user_ctx;                         // User context passed to callback
+#ifdef ESP_PLATFORM
+    size_t queue_length;                    // Length of the event queue (0 disables the queue)
+    uint32_t task_stack_size;               // Stack size of the worker task in bytes
+    UBaseType_t task_priority;              // Priority of the worker task
+#endif
+} at42qt2120_event_config_t;
+
+#ifdef ESP_PLATFORM
+/** @brief Default event engine configuration (CHANGE line still has to be filled in) */
+#define AT42QT2120_EVENT_CONFIG_DEFAULT() {         \
+    .change_line = { 0 },                           \
+    .callback = NULL,                               \
+    .user_ctx = NULL,                               \
+    .queue_length = 16,                             \
+    .task_stack_size = 3072,                        \
+    .task_priority = 10,                            \
+}
+#else
+/** @brief Default event engine configuration (CHANGE line still has to be filled in) */
+#define AT42QT2120_EVENT_CONFIG_DEFAULT() {         \
+    .change_line = { 0 },                           \
+    .callback = NULL,                               \
+    .user_ctx = NULL,                               \
+}
+#endif
+
+/**
+ * @brief Structure representing an event engine.
+ */
+typedef struct {
+    at42qt2120_handle_t* at42qt2120_handle; // Device the engine reads from
+    at42qt2120_event_config_t config;       // Configuration given to at42qt2120_event_engine_init()
+#ifdef ESP_PLATFORM
+    QueueHandle_t event_queue;              // Event queue (NULL if disabled)
+    TaskHandle_t worker_task;               // Worker task (NULL while stopped)
+    SemaphoreHandle_t stopped_sem;          // Given by the worker task when it exits
+    volatile bool running;                  // Cleared to request the worker task to exit
+#endif
+    at42qt2120_key_decoder_t keys;          // Key decoder holding the key status mask of the previous state
+    bool slider_detected;                   // Slider detect state of the previous state
+    uint8_t slider_position;                // Slider position of the previous state
+    uint32_t dropped_events;                // Events dropped because the event queue was full
+} at42qt2120_event_engine_t;
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Fills a CHANGE line backend that uses an ESP32 GPIO. The GPIO is configured as input with pull-up.
+ *
+ * @param gpio_num GPIO connected to the at42qt2120 CHANGE pin.
+ * @param change_line Pointer to the backend structure to fill.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_change_line_gpio(gpio_num_t gpio_num, at42qt2120_change_line_t* change_line);
+#endif
+
+/**
+ * @brief Initializes an event engine. Allocates the event queue if enabled.
+ *
+ * @param engine Pointer to the event engine structure.
+ * @param at42qt2120_handle Pointer to an initialized at42qt2120 handle.
+ * @param config Pointer to the engine configuration.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_event_engine_init(at42qt2120_event_engine_t* engine, at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_event_config_t* config);
+
+/**
+ * @brief Deinitializes an event engine. Stops it first if it is running.
+ *
+ * @param engine Pointer to the event engine structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_event_engine_deinit(at42qt2120_event_engine_t* engine);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Starts the worker task and arms the CHANGE line.
+ *
+ * @param engine Pointer to the event engine structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_event_engine_start(at42qt2120_event_engine_t* engine);
+
+/**
+ * @brief Disarms the CHANGE line and waits for the worker task to exit.
+ *
+ * @param engine Pointer to the event engine structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_event_engine_stop(at42qt2120_event_engine_t* engine);
+#endif
+
+/**
+ * @brief Reads the device state once and dispatches the resulting events.
+ *        Called by the worker task when CHANGE asserts. May be called directly when the engine is not started,
+ *        e.g. to drive it from a simulated CHANGE line.
+ *
+ * @param engine Pointer to the event engine structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_event_engine_service(at42qt2120_event_engine_t* engine);
+
+/**
+ * @brief Dispatches the events resulting from a new state without touching the bus.
+ *
+ * @param engine Pointer to the event engine structure.
+ * @param state Pointer to the newly read state.
+ * @return size_t Number of events dispatched.
+ */
+size_t at42qt2120_event_engine_process(at42qt2120_event_engine_t* engine, const at42qt2120_state_t* state);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Waits for the next event in the event queue.
+ *
+ * @param engine Pointer to the event engine structure.
+ * @param event Pointer to the structure receiving the event.
+ * @param timeout_ms Time in ms to wait for an event. -1 results in infinite wait time
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT if no event arrived, otherwise an error code.
+ */
+esp_err_t at42qt2120_event_engine_receive(at42qt2120_event_engine_t* engine, at42qt2120_event_t* event, int timeout_ms);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef ESP_AT42QT2120_GESTURE_H
+#define ESP_AT42QT2120_GESTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_gesture.h
+ * @brief Slider/wheel gesture recognition on timestamped position samples.
+ *
+ * The engine consumes one sample per read of the slider/wheel (touched flag, 8-bit position
+ * and timestamp) and emits tap, double-tap, swipe and rotate events. Positions are filtered
+ * with a 3-tap median followed by a first order IIR, both in Q8 fixed point. In wheel mode the
+ * 0-255 wrap-around is unwrapped into a continuous angle (256 units per revolution) before
+ * filtering. The angle restarts at the raw position on every touch down and stops at 8192
+ * revolutions within one touch, so a wheel spun forever never overflows the Q8 arithmetic. Velocity is the IIR-smoothed derivative of the filtered position.
+ *
+ * Every sample costs the same constant amount of work and the engine holds no buffers beyond
+ * its fixed-size structure. A tap is reported as soon as the finger lifts. A second tap within
+ * the double-tap window is reported as AT42QT2120_GESTURE_DOUBLE_TAP instead of another tap.
+ */
+
+/**
+ * @brief Types of gesture events.
+ */
+typedef enum {
+    AT42QT2120_GESTURE_TAP,                 // Short touch without significant travel
+    AT42QT2120_GESTURE_DOUBLE_TAP,          // Second tap within the double-tap window at about the same position
+    AT42QT2120_GESTURE_SWIPE,               // Touch travelled far and fast enough, reported on release
+    AT42QT2120_GESTURE_ROTATE,              // Wheel angle changed by at least rotate_step while touched
+} at42qt2120_gesture_type_t;
+
+/**
+ * @brief Structure describing a single gesture event. Positions are in slider units (0-255 per slider length or wheel revolution).
+ */
+typedef struct {
+    at42qt2120_gesture_type_t type;         // Event type
+    int64_t time_us;                        // Timestamp of the sample that produced the event
+    int32_t position;                       // Filtered position (wheel: angle unwrapped from the touch down position) at the event
+    int32_t delta;                          // Swipe: travel since touch down. Rotate: angle change since the last rotate event
+    int32_t velocity;                       // Smoothed velocity in units per second (swipe: at release)
+    uint32_t duration_us;                   // Tap/swipe: touch duration
+} at42qt2120_gesture_event_t;
+
+/**
+ * @brief Callback invoked for every gesture event, from the context feeding the samples.
+ */
+typedef void (*at42qt2120_gesture_cb_t)(const at42qt2120_gesture_event_t* event, void* user_ctx);
+
+/**
+ * @brief One timestamped slider/wheel sample, e.g. from a recorded trace.
+ */
+typedef struct {
+    int64_t time_us;                        // Time the sample was taken
+    bool touched;                           // Slider/wheel in detect
+    uint8_t position;                       // Raw position register value (ignored while not touched)
+} at42qt2120_gesture_sample_t;
+
+/**
+ * @brief Gesture engine configuration.
+ */
+typedef struct {
+    bool wheel;                             // Unwrap positions as a wheel instead of a linear slider
+    uint8_t position_shift;                 // IIR coefficient of the position filter, 1/2^shift (0 disables the IIR)
+    uint8_t velocity_shift;                 // IIR coefficient of the velocity filter, 1/2^shift (0 disables the IIR)
+    uint32_t tap_max_duration_us;           // Longest touch still counted as a tap
+    uint16_t tap_max_travel;                // Largest travel still counted as a tap
+    uint32_t double_tap_window_us;          // Longest time between the end of the first and the end of the second tap
+    uint16_t swipe_min_travel;              // Shortest travel counted as a swipe
+    uint16_t swipe_min_velocity;            // Lowest average velocity (units per second) counted as a swipe
+    uint16_t rotate_step;                   // Angle change that produces a rotate event (wheel only)
+    at42qt2120_gesture_cb_t callback;       // Event callback
+    void* user_ctx;                         // User context passed to callback
+} at42qt2120_gesture_config_t;
+
+/** @brief Default gesture configuration for a slider (set .wheel for a wheel, callback still has to be filled in) */
+#define AT42QT2120_GESTURE_CONFIG_DEFAULT() {   \
+    .wheel = false,                             \
+    .position_shift = 1,                        \
+    .velocity_shift = 2,                        \
+    .tap_max_duration_us = 250000,              \
+    .tap_max_travel = 16,                       \
+    .double_tap_window_us = 350000,             \
+    .swipe_min_travel = 48,                     \
+    .swipe_min_velocity = 200,                  \
+    .rotate_step = 8,                           \
+    .callback = NULL,                           \
+    .user_ctx = NULL,                           \
+}
+
+/**
+ * @brief Structure representing a gesture engine.
+ */
+typedef struct {
+    at42qt2120_gesture_config_t config;     // Configuration given to at42qt2120_gesture_init()
+    bool touched;                           // Touched in the previous sample
+    uint8_t last_raw;                       // Raw position of the previous touched sample
+    int32_t unwrapped;                      // Raw position with wheel wrap-arounds since touch down removed
+    int32_t history[3];                     // Last three unwrapped positions for the median filter
+    int32_t filtered_q8;                    // Filtered position in Q8
+    int32_t velocity_q8;                    // Smoothed velocity in Q8 units per second
+    int64_t last_time_us;                   // Timestamp of the previous touched sample
+    int64_t down_time_us;                   // Timestamp of the touch down
+    int32_t down_position_q8;               // Filtered position at touch down in Q8
+    int32_t rotate_anchor_q8;               // Angle of the last rotate event in Q8
+    int64_t last_tap_time_us;               // End of the last single tap (0 if none is pending)
+    int32_t last_tap_position_q8;           // Position of the last single tap in Q8
+    uint32_t samples;                       // Samples consumed
+} at42qt2120_gesture_engine_t;
+
+/**
+ * @brief Initializes a gesture engine.
+ *
+ * @param engine Pointer to the gesture engine structure.
+ * @param config Pointer to the configuration.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_gesture_init(at42qt2120_gesture_engine_t* engine, const at42qt2120_gesture_config_t* config);
+
+/**
+ * @brief Consumes one sample and dispatches the resulting events.
+ *
+ * @param engine Pointer to the gesture engine structure.
+ * @param time_us Time the sample was taken.
+ * @param touched Slider/wheel in detect.
+ * @param position Raw position register value (ignored while not touched).
+ * @return size_t Number of events dispatched.
+ */
+size_t at42qt2120_gesture_feed(at42qt2120_gesture_engine_t* engine, int64_t time_us, bool touched, uint8_t position);
+
+/**
+ * @brief Consumes the slider/wheel part of a state read with at42qt2120_read_state().
+ *
+ * @param engine Pointer to the gesture engine structure.
+ * @param time_us Time the state was read, e.g. at42qt2120_time_us().
+ * @param state Pointer to the state.
+ * @return size_t Number of events dispatched.
+ */
+size_t at42qt2120_gesture_feed_state(at42qt2120_gesture_engine_t* engine, int64_t time_us, const at42qt2120_state_t* state);
+
+/**
+ * @brief Consumes a recorded trace of samples.
+ *
+ * @param engine Pointer to the gesture engine structure.
+ * @param samples Samples sorted by time.
+ * @param sample_count Number of samples.
+ * @return size_t Number of events dispatched.
+ */
+size_t at42qt2120_gesture_feed_samples(at42qt2120_gesture_engine_t* engine, const at42qt2120_gesture_sample_t* samples, size_t sample_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef ESP_AT42QT2120_KEYS_H
+#define ESP_AT42QT2120_KEYS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_keys.h
+ * @brief Key event decoder: software debounce, long press, repeat and chords on timestamped key masks.
+ *
+ * The decoder consumes one 12-bit key status mask per sample, e.g. from at42qt2120_read_state().
+ * The XOR with the previous mask gives the keys that changed, and a bit scan visits only those. A
+ * change is accepted once the key kept its new level for debounce_us; a key flipping back earlier
+ * is simply dropped from the pending set.
+ *
+ * Debounce, long press, repeat and the chord window share no timer per key. Each key keeps the
+ * time of its pending change and of its next long press or repeat, and the decoder keeps the
+ * earliest of all these deadlines. A sample that changes nothing before that deadline costs one
+ * comparison. Only when it has passed are the keys waiting on it scanned, and the deadline is
+ * recomputed. The work per sample is thus proportional to the keys that changed or fired.
+ *
+ * A chord is two or more keys going down within chord_window_us of the first one. It is reported
+ * once the window closes, or earlier when one of its keys is released. The key down events are
+ * not held back for it.
+ *
+ * Events of one sample are delivered together, up to AT42QT2120_KEY_BATCH_MAX of them: first the
+ * timers that ran out (chord window, long presses and repeats), then releases and a chord one of
+ * them ends, then presses, each group in key order. The decoder allocates nothing.
+ */
+
+/** @brief Largest number of events one sample can produce */
+#define AT42QT2120_KEY_BATCH_MAX 32
+
+/**
+ * @brief Types of key events.
+ */
+typedef enum {
+    AT42QT2120_KEY_DOWN,                    // Key pressed (after debounce)
+    AT42QT2120_KEY_UP,                      // Key released (after debounce)
+    AT42QT2120_KEY_LONG_PRESS,              // Key held for long_press_us
+    AT42QT2120_KEY_REPEAT,                  // Key still held, every repeat_us after the long press
+    AT42QT2120_KEY_CHORD,                   // Two or more keys pressed within the chord window
+} at42qt2120_key_event_type_t;
+
+/**
+ * @brief Structure describing a single key event.
+ */
+typedef struct {
+    at42qt2120_key_event_type_t type;       // Event type
+    uint8_t key;                            // Key index (lowest key of a chord)
+    uint16_t key_mask;                      // Debounced key mask after the sample. Chord: the keys of the chord
+    uint16_t repeat;                        // Repeat: repeats since the long press, starting at 1
+    int64_t time_us;                        // Timestamp of the sample that produced the event
+    uint32_t duration_us;                   // Up, long press, repeat: time since the key went down
+} at42qt2120_key_event_t;
+
+/**
+ * @brief Callback receiving the events of one sample, from the context feeding the samples.
+ */
+typedef void (*at42qt2120_key_batch_cb_t)(const at42qt2120_key_event_t* events, size_t event_count, void* user_ctx);
+
+/**
+ * @brief Key decoder configuration. Times of 0 disable the feature.
+ */
+typedef struct {
+    uint16_t keys;                          // Keys decoded (bit n for key n), other keys are ignored
+    uint32_t debounce_us;                   // Time a key must keep its new level before the change is accepted
+    uint32_t long_press_us;                 // Hold time that produces a long press
+    uint32_t repeat_us;                     // Repeat period after the long press
+    uint32_t chord_window_us;               // Time after the first key down in which further key downs join a chord
+    at42qt2120_key_batch_cb_t callback;     // Optional batch callback (NULL if unused, see at42qt2120_key_decoder_t::batch)
+    void* user_ctx;                         // User context passed to callback
+} at42qt2120_key_config_t;
+
+/** @brief Default key decoder configuration. The detection integrator of the device already filters short touches, so software debounce is off */
+#define AT42QT2120_KEY_CONFIG_DEFAULT() {       \
+    .keys = AT42QT2120_KEY_MASK_ALL,            \
+    .debounce_us = 0,                           \
+    .long_press_us = 500000,                    \
+    .repeat_us = 100000,                        \
+    .chord_window_us = 50000,                   \
+    .callback = NULL,                           \
+    .user_ctx = NULL,                           \
+}
+
+/**
+ * @brief Structure representing a key decoder.
+ */
+typedef struct {
+    at42qt2120_key_config_t config;                         // Configuration given to at42qt2120_key_decoder_init()
+    uint16_t raw;                                           // Key mask of the previous sample
+    uint16_t debounced;                                     // Accepted key mask
+    uint16_t pending;                                       // Keys whose raw level differs from the accepted one
+    uint16_t timed;                                         // Held keys waiting for a long press or repeat
+    uint16_t long_pressed;                                  // Held keys whose long press was reported
+    uint16_t chord;                                         // Keys that went down in the open chord window
+    int64_t change_us[AT42QT2120_NUM_KEYS];                 // Time the pending change of each key started
+    int64_t down_us[AT42QT2120_NUM_KEYS];                   // Time each held key went down
+    int64_t fire_us[AT42QT2120_NUM_KEYS];                   // Time of the next long press or repeat of each timed key
+    uint16_t repeats[AT42QT2120_NUM_KEYS];                  // Repeats reported since the long press of each key
+    int64_t debounce_deadline_us;                           // Earliest time a pending change can be accepted
+    int64_t timer_deadline_us;                              // Earliest long press or repeat
+    int64_t chord_deadline_us;                              // End of the open chord window
+    int64_t deadline_us;                                    // Earliest of the three deadlines
+    at42qt2120_key_event_t batch[AT42QT2120_KEY_BATCH_MAX]; // Events of the last sample
+    size_t batch_count;                                     // Events in batch
+    uint32_t samples;                                       // Samples consumed
+} at42qt2120_key_decoder_t;
+
+/**
+ * @brief Initializes a key decoder with all keys released.
+ *
+ * @param decoder Pointer to the decoder structure.
+ * @param config Pointer to the configuration.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_key_decoder_init(at42qt2120_key_decoder_t* decoder, const at42qt2120_key_config_t* config);
+
+/**
+ * @brief Consumes one key mask and delivers the resulting events as one batch.
+ *
+ * @param decoder Pointer to the decoder structure.
+ * @param time_us Time the mask was read. Samples must not go back in time.
+ * @param key_mask Key status mask (bit n for key n).
+ * @return size_t Number of events in the batch.
+ */
+size_t at42qt2120_key_decoder_feed(at42qt2120_key_decoder_t* decoder, int64_t time_us, uint16_t key_mask);
+
+/**
+ * @brief Consumes the key mask of a state read with at42qt2120_read_state().
+ *
+ * @param decoder Pointer to the decoder structure.
+ * @param time_us Time the state was read, e.g. at42qt2120_time_us().
+ * @param state Pointer to the state.
+ * @return size_t Number of events in the batch.
+ */
+size_t at42qt2120_key_decoder_feed_state(at42qt2120_key_decoder_t* decoder, int64_t time_us, const at42qt2120_state_t* state);
+
+/**
+ * @brief Lets time pass without a new sample, e.g. between CHANGE interrupts, so debounce, long press,
+ *        repeat and the chord window fire on time.
+ *
+ * @param decoder Pointer to the decoder structure.
+ * @param time_us Current time.
+ * @return size_t Number of events in the batch.
+ */
+size_t at42qt2120_key_decoder_tick(at42qt2120_key_decoder_t* decoder, int64_t time_us);
+
+/**
+ * @brief Returns the time at42qt2120_key_decoder_tick() has something to do at, e.g. to sleep until then.
+ *
+ * @param decoder Pointer to the decoder structure.
+ * @return int64_t Time of the next deadline, INT64_MAX if nothing is pending.
+ */
+int64_t at42qt2120_key_decoder_next_deadline(const at42qt2120_key_decoder_t* decoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef ESP_AT42QT2120_MANAGER_H
+#define ESP_AT42QT2120_MANAGER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#ifdef ESP_PLATFORM
+#include <driver/i2c_master.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_manager.h
+ * @brief Manager for several AT42QT2120 sensors on multiple I2C buses and behind I2C multiplexers.
+ *
+ * The AT42QT2120 has a fixed address, so every bus carries at most one sensor per
+ * multiplexer channel (or a single sensor wired directly). The manager owns the sensor
+ * handles and wraps their transports so the right mux channel is selected before every
+ * transaction. Selections are cached per bus and only written when they change.
+ *
+ * at42qt2120_manager_scan() reads the state of every sensor. Sensors of one bus are read in
+ * mux/channel order, alternating the direction so the channel left selected by the previous
+ * scan is read first. A scan thus costs one channel switch per additional sensor plus one
+ * per additional mux. On ESP-IDF, at42qt2120_manager_start() runs one worker task per bus so
+ * buses are scanned concurrently and the scan latency is that of the busiest bus. On other
+ * platforms the buses are scanned one after another, each on its own (simulated) bus clock.
+ *
+ * The manager holds all sensor handles and is referenced by their transports. It must not
+ * be moved after at42qt2120_manager_init() and is best placed in static storage.
+ */
+
+/** @brief Maximum number of sensors per manager */
+#ifndef AT42QT2120_MANAGER_MAX_SENSORS
+#define AT42QT2120_MANAGER_MAX_SENSORS 64
+#endif
+/** @brief Maximum number of I2C buses per manager */
+#define AT42QT2120_MANAGER_MAX_BUSES 8
+/** @brief Maximum number of multiplexers per manager */
+#define AT42QT2120_MANAGER_MAX_MUXES 16
+/** @brief Number of channels of a TCA9548A-style multiplexer */
+#define AT42QT2120_MUX_NUM_CHANNELS 8
+/** @brief Value of at42qt2120_sensor_location_t::mux for a sensor wired directly to its bus */
+#define AT42QT2120_MANAGER_NO_MUX 0xFF
+
+/**
+ * @brief Abstraction of a TCA9548A-style I2C multiplexer.
+ */
+typedef struct {
+    esp_err_t (*select)(void* ctx, uint8_t channel_mask, int timeout_ms);  // Writes the channel enable mask (0 disconnects every channel)
+    void* ctx;                                                              // Backend context passed to select
+} at42qt2120_mux_t;
+
+/**
+ * @brief Position of a sensor in the bus topology.
+ */
+typedef struct {
+    uint8_t bus;                            // Index of the bus the sensor (or its mux) is connected to
+    uint8_t mux;                            // Index returned by at42qt2120_manager_add_mux(), AT42QT2120_MANAGER_NO_MUX if wired directly
+    uint8_t channel;                        // Mux channel (0-7), ignored without mux
+} at42qt2120_sensor_location_t;
+
+struct at42qt2120_manager;
+
+/**
+ * @brief A sensor owned by the manager.
+ */
+typedef struct {
+    struct at42qt2120_manager* manager;     // Manager owning the sensor
+    at42qt2120_sensor_location_t location;  // Position in the bus topology
+    at42qt2120_transport_t transport;       // Underlying transport, wrapped by the manager's mux-selecting transport
+    at42qt2120_handle_t handle;             // Driver handle of the sensor
+    at42qt2120_state_t state;               // State read by the last scan
+    esp_err_t last_error;                   // Result of the last scan for this sensor
+} at42qt2120_manager_sensor_t;
+
+/**
+ * @brief A multiplexer registered with the manager.
+ */
+typedef struct {
+    at42qt2120_mux_t mux;                   // Multiplexer backend
+    uint8_t bus;                            // Bus the multiplexer is connected to
+    uint8_t channel_mask;                   // Channels currently enabled
+} at42qt2120_manager_mux_t;
+
+/**
+ * @brief Per-bus scheduling state.
+ */
+typedef struct {
+    uint8_t sensors[AT42QT2120_MANAGER_MAX_SENSORS];    // Sensor indices in scan order (mux, then channel)
+    uint8_t sensor_count;                               // Number of sensors on the bus
+    bool reverse;                                       // Direction of the next scan, alternates so the channel left selected is read first
+    uint8_t active_mux;                                 // Mux with an enabled channel, AT42QT2120_MANAGER_NO_MUX if none
+    uint32_t mux_switches;                              // Mux select writes issued on this bus
+    int64_t last_scan_us;                               // Duration of the last scan of this bus
+    esp_err_t last_result;                              // Result of the last scan of this bus
+#ifdef ESP_PLATFORM
+    struct at42qt2120_manager* manager;                 // Manager owning the bus, used by the worker task
+    TaskHandle_t worker_task;                           // Worker task scanning this bus (NULL while stopped)
+#endif
+} at42qt2120_manager_bus_t;
+
+/**
+ * @brief Structure representing a multi-sensor manager.
+ */
+typedef struct at42qt2120_manager {
+    at42qt2120_manager_sensor_t sensors[AT42QT2120_MANAGER_MAX_SENSORS];    // Sensors in the order they were added
+    uint8_t sensor_count;                                                   // Number of sensors
+    at42qt2120_manager_mux_t muxes[AT42QT2120_MANAGER_MAX_MUXES];           // Multiplexers in the order they were added
+    uint8_t mux_count;                                                      // Number of multiplexers
+    at42qt2120_manager_bus_t buses[AT42QT2120_MANAGER_MAX_BUSES];           // Scheduling state per bus
+    uint8_t bus_count;                                                      // Highest bus index in use + 1
+    int transaction_timeout_ms;                                             // Timeout of mux select writes
+#ifdef ESP_PLATFORM
+    EventGroupHandle_t done_group;                                          // One bit per bus, set by its worker when its scan finished
+    volatile bool running;                                                  // Cleared to request the worker tasks to exit
+#endif
+} at42qt2120_manager_t;
+
+/**
+ * @brief Initializes an empty manager.
+ *
+ * @param manager Pointer to the manager structure.
+ * @param time_out Timeout of mux select writes in ms.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_manager_init(at42qt2120_manager_t* manager, int time_out);
+
+/**
+ * @brief Deinitializes every sensor and stops the worker tasks if they are running.
+ *
+ * @param manager Pointer to the manager structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_manager_deinit(at42qt2120_manager_t* manager);
+
+/**
+ * @brief Registers a multiplexer and disconnects all its channels.
+ *
+ * @param manager Pointer to the manager structure.
+ * @param bus Index of the bus the multiplexer is connected to.
+ * @param mux Pointer to the multiplexer backend (copied).
+ * @param mux_index Pointer receiving the index to use in at42qt2120_sensor_location_t::mux.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_manager_add_mux(at42qt2120_manager_t* manager, uint8_t bus, const at42qt2120_mux_t* mux, uint8_t* mux_index);
+
+/**
+ * @brief Adds a sensor reachable through the given transport and initializes its handle.
+ *        The transport only has to address the device, the manager selects the mux channel.
+ *
+ * @param manager Pointer to the manager structure.
+ * @param location Pointer to the position of the sensor.
+ * @param transport Pointer to the transport of the sensor (copied).
+ * @param time_out Transaction timeout in ms.
+ * @param sensor_index Pointer receiving the sensor index (NULL if unused).
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_manager_add_sensor(at42qt2120_manager_t* manager, const at42qt2120_sensor_location_t* location,
+                                        const at42qt2120_transport_t* transport, int time_out, uint8_t* sensor_index);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Adds a sensor on an ESP32 I2C bus. See at42qt2120_manager_add_sensor().
+ *
+ * @param manager Pointer to the manager structure.
+ * @param bus_handle Handle of the I2C bus with index location->bus.
+ * @param location Pointer to the position of the sensor.
+ * @param clock_speed SCL speed in Hz.
+ * @param time_out Transaction timeout in ms.
+ * @param sensor_index Pointer receiving the sensor index (NULL if unused).
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_manager_add_i2c_sensor(at42qt2120_manager_t* manager, i2c_master_bus_handle_t bus_handle, const at42qt2120_sensor_location_t* location,
+                                            size_t clock_speed, int time_out, uint8_t* sensor_index);
+
+/**
+ * @brief Fills a multiplexer backend for a TCA9548A on an ESP32 I2C bus.
+ *
+ * @param bus_handle Handle of the I2C bus the TCA9548A is connected to.
+ * @param address I2C address of the TCA9548A (0x70-0x77).
+ * @param clock_speed SCL speed in Hz.
+ * @param mux Pointer to the multiplexer backend to fill. Its context is the I2C device handle.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_mux_tca9548a(i2c_master_bus_handle_t bus_handle, uint8_t address, size_t clock_speed, at42qt2120_mux_t* mux);
+
+/**
+ * @brief Starts one worker task per bus so at42qt2120_manager_scan() reads the buses concurrently.
+ *
+ * @param manager Pointer to the manager structure.
+ * @param task_stack_size Stack size of each worker task in bytes.
+ * @param task_priority Priority of the worker tasks.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_manager_start(at42qt2120_manager_t* manager, uint32_t task_stack_size, UBaseType_t task_priority);
+
+/**
+ * @brief Stops the worker tasks. Later scans run in the calling task again.
+ *
+ * @param manager Pointer to the manager structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_manager_stop(at42qt2120_manager_t* manager);
+#endif
+
+/**
+ * @brief Returns the handle of a sensor, e.g. to configure it.
+ *
+ * @param manager Pointer to the manager structure.
+ * @param sensor_index Index of the sensor.
+ * @return at42qt2120_handle_t* The handle, NULL if the index is invalid.
+ */
+at42qt2120_handle_t* at42qt2120_manager_get_handle(at42qt2120_manager_t* manager, uint8_t sensor_index);
+
+/**
+ * @brief Reads the state of every sensor into at42qt2120_manager_sensor_t::state, then runs the recoveries
+ *        the reads flagged (at42qt2120_recover_poll()). Sensor handles must not be used from other tasks while a scan runs.
+ *
+ * @param manager Pointer to the manager structure.
+ * @return esp_err_t ESP_OK if every sensor was read, otherwise the first error (the remaining sensors are still read).
+ */
+esp_err_t at42qt2120_manager_scan(at42qt2120_manager_t* manager);
+
+/**
+ * @brief Returns the latency of the last scan, i.e. the duration of the slowest bus.
+ *
+ * @param manager Pointer to the manager structure.
+ * @return int64_t Scan latency in microseconds.
+ */
+int64_t at42qt2120_manager_scan_latency_us(const at42qt2120_manager_t* manager);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef ESP_AT42QT2120_POLL_H
+#define ESP_AT42QT2120_POLL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_poll.h
+ * @brief Adaptive polling for designs without the CHANGE line.
+ *
+ * The scheduler polls at min_period_ms while a key or the slider is touched. Once nothing has
+ * been touched or moved for idle_hold_ms, the period doubles with every poll up to
+ * max_period_ms. Any activity brings it back to min_period_ms on the poll that sees it.
+ *
+ * With track_low_power set, AT42QT2120_REG_LOW_POWER_MODE is programmed so that the device
+ * measures about as often as the host polls (8 ms per step). The register is only written when
+ * the period changes, which happens at most log2(max_period_ms / min_period_ms) times per idle
+ * phase. A slow device rate does not delay detection by more than one interval: once a key
+ * crosses its threshold, the device takes the confirming measurements without sleeping.
+ *
+ * The status registers are not latched, so a touch shorter than the idle period can be missed
+ * altogether. Keep max_period_ms below the shortest tap that must register.
+ */
+
+/** @brief Measurement interval per step of AT42QT2120_REG_LOW_POWER_MODE in ms */
+#define AT42QT2120_LOW_POWER_STEP_MS 8
+
+/**
+ * @brief Callback invoked with every polled state, from the polling task.
+ */
+typedef void (*at42qt2120_poll_cb_t)(const at42qt2120_state_t* state, void* user_ctx);
+
+/**
+ * @brief Polling scheduler configuration.
+ */
+typedef struct {
+    uint32_t min_period_ms;                 // Poll period while touched or moving
+    uint32_t max_period_ms;                 // Longest poll period while idle
+    uint32_t idle_hold_ms;                  // Time without activity before the period starts to back off
+    uint8_t motion_threshold;               // Slider position change counted as motion
+    bool track_low_power;                   // Program the low power mode to follow the poll period
+    at42qt2120_poll_cb_t callback;          // Optional state callback of the polling task (NULL if unused)
+    void* user_ctx;                         // User context passed to callback
+#ifdef ESP_PLATFORM
+    uint32_t task_stack_size;               // Stack size of the polling task in bytes
+    UBaseType_t task_priority;              // Priority of the polling task
+#endif
+} at42qt2120_poll_config_t;
+
+#ifdef ESP_PLATFORM
+/** @brief Default polling scheduler configuration */
+#define AT42QT2120_POLL_CONFIG_DEFAULT() {          \
+    .min_period_ms = 16,                            \
+    .max_period_ms = 64,                            \
+    .idle_hold_ms = 500,                            \
+    .motion_threshold = 2,                          \
+    .track_low_power = true,                        \
+    .callback = NULL,                               \
+    .user_ctx = NULL,                               \
+    .task_stack_size = 3072,                        \
+    .task_priority = 10,                            \
+}
+#else
+/** @brief Default polling scheduler configuration */
+#define AT42QT2120_POLL_CONFIG_DEFAULT() {          \
+    .min_period_ms = 16,                            \
+    .max_period_ms = 64,                            \
+    .idle_hold_ms = 500,                            \
+    .motion_threshold = 2,                          \
+    .track_low_power = true,                        \
+    .callback = NULL,                               \
+    .user_ctx = NULL,                               \
+}
+#endif
+
+/**
+ * @brief Structure representing a polling scheduler.
+ */
+typedef struct {
+    at42qt2120_handle_t* at42qt2120_handle; // Device the scheduler polls
+    at42qt2120_poll_config_t config;        // Configuration given to at42qt2120_poll_init()
+    uint32_t period_ms;                     // Current poll period
+    int64_t last_activity_us;               // Time of the last poll that saw a touch or motion
+    bool touched;                           // Touched in the previous poll
+    uint8_t slider_position;                // Slider position of the previous poll
+    uint8_t low_power_mode;                 // Low power mode last written (0 until the first write)
+    uint32_t polls;                         // States read
+    uint32_t read_errors;                   // Failed reads
+    uint32_t low_power_writes;              // Writes of the low power mode register
+#ifdef ESP_PLATFORM
+    TaskHandle_t poll_task;                 // Polling task (NULL while stopped)
+    SemaphoreHandle_t stopped_sem;          // Given by the polling task when it exits
+    volatile bool running;                  // Cleared to request the polling task to exit
+#endif
+} at42qt2120_poll_scheduler_t;
+
+/**
+ * @brief Initializes a polling scheduler at min_period_ms and programs the matching low power mode.
+ *
+ * @param scheduler Pointer to the scheduler structure.
+ * @param at42qt2120_handle Pointer to an initialized at42qt2120 handle.
+ * @param config Pointer to the configuration.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_poll_init(at42qt2120_poll_scheduler_t* scheduler, at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_poll_config_t* config);
+
+/**
+ * @brief Deinitializes a polling scheduler. Stops the polling task first if it is running.
+ *
+ * @param scheduler Pointer to the scheduler structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_poll_deinit(at42qt2120_poll_scheduler_t* scheduler);
+
+/**
+ * @brief Updates the poll period from a state read elsewhere and reprograms the low power mode if it changed.
+ *        A low power mode write that failed is retried on every update until it succeeds.
+ *
+ * @param scheduler Pointer to the scheduler structure.
+ * @param state Pointer to the state.
+ * @param time_us Time the state was read.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_poll_update(at42qt2120_poll_scheduler_t* scheduler, const at42qt2120_state_t* state, int64_t time_us);
+
+/**
+ * @brief Reads the state once and updates the poll period. The caller waits scheduler->period_ms before the next call.
+ *
+ * @param scheduler Pointer to the scheduler structure.
+ * @param state Buffer to store the state.
+ * @return esp_err_t ESP_OK on success, otherwise an error code. A failed read keeps the current period.
+ */
+esp_err_t at42qt2120_poll_once(at42qt2120_poll_scheduler_t* scheduler, at42qt2120_state_t* state);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Starts the polling task, which calls at42qt2120_poll_once(), the callback and at42qt2120_recover_poll() every period.
+ *
+ * @param scheduler Pointer to the scheduler structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_poll_start(at42qt2120_poll_scheduler_t* scheduler);
+
+/**
+ * @brief Stops the polling task and waits for it to exit.
+ *
+ * @param scheduler Pointer to the scheduler structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_poll_stop(at42qt2120_poll_scheduler_t* scheduler);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
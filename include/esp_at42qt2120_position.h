@@ -0,0 +1,148 @@
+#ifndef ESP_AT42QT2120_POSITION_H
+#define ESP_AT42QT2120_POSITION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_position.h
+ * @brief High-resolution slider/wheel position interpolated from the raw signals of keys 0-2.
+ *
+ * The estimator reads the signals and references of the slider keys in one burst (0x34-0x51) and
+ * interpolates between the key with the largest delta and its neighbours in Q16 fixed point:
+ * key + (next - previous) / (previous + key + next). A slider clamps at its ends, a wheel wraps
+ * around. The result is mapped through a calibration fitted against the chip's own position
+ * register, optionally smoothed by a first order IIR and scaled to resolution_bits.
+ *
+ * A touch starts as soon as the summed delta reaches touch_threshold, without waiting for the
+ * detection integrator, and the position follows every measurement of the device. The resolution
+ * is bounded by the deltas: a touch of D counts resolves about D positions per key pitch, while the
+ * position register resolves 128 per pitch on a slider (85 on a wheel). Below register_below summed
+ * counts at42qt2120_position_read() therefore also reads the register and reports it instead, as long
+ * as it agrees with the interpolation (the chip confirms a touch later and holds the last position).
+ */
+
+/** @brief Calibration pairs accumulated at most, further pairs are ignored */
+#define AT42QT2120_POSITION_CALIBRATION_MAX_SAMPLES 1024
+
+/**
+ * @brief Position estimator configuration.
+ */
+typedef struct {
+    bool wheel;                             // Interpolate as a wheel (wraps around) instead of a linear slider
+    uint8_t resolution_bits;                // Bits of the reported position (8-16)
+    uint16_t touch_threshold;               // Summed slider delta that starts a touch
+    uint16_t release_threshold;             // Summed slider delta below which a touch ends
+    uint8_t filter_shift;                   // IIR coefficient of the position filter, 1/2^shift (0 disables the IIR)
+    uint16_t register_below;                // Summed slider delta below which the position register is preferred (0 always interpolates)
+} at42qt2120_position_config_t;
+
+/** @brief Default position estimator configuration for a slider (set .wheel for a wheel) */
+#define AT42QT2120_POSITION_CONFIG_DEFAULT() {  \
+    .wheel = false,                             \
+    .resolution_bits = 12,                      \
+    .touch_threshold = 20,                      \
+    .release_threshold = 10,                    \
+    .filter_shift = 0,                          \
+    .register_below = 128,                      \
+}
+
+/**
+ * @brief One position estimate.
+ */
+typedef struct {
+    bool touched;                           // Summed delta above the touch threshold (with hysteresis)
+    uint16_t position;                      // Position in resolution_bits (wheel: one revolution), held while not touched
+    uint16_t strength;                      // Summed delta of the slider keys
+} at42qt2120_position_t;
+
+/**
+ * @brief Pairs of raw estimates and chip positions collected for the calibration.
+ */
+typedef struct {
+    uint32_t samples;                       // Pairs collected
+    int64_t sum_raw;                        // Sum of the raw estimates
+    int64_t sum_chip;                       // Sum of the chip positions (wheel: of the chip - raw differences)
+    int64_t sum_raw_raw;                    // Sum of the squared raw estimates
+    int64_t sum_raw_chip;                   // Sum of raw estimate * chip position
+} at42qt2120_position_calibration_t;
+
+/**
+ * @brief Structure representing a position estimator. Positions inside are in 16-bit units
+ *        (0-65535 per slider length or wheel revolution).
+ */
+typedef struct {
+    at42qt2120_handle_t* at42qt2120_handle;             // Device the estimator reads
+    at42qt2120_position_config_t config;                // Configuration given to at42qt2120_position_init()
+    int32_t gain_q16;                                   // Calibration gain, Q16 (slider only)
+    int32_t offset;                                     // Calibration offset
+    bool touched;                                       // Touched at the last update
+    uint16_t raw;                                       // Interpolated position of the last touched update, before calibration
+    int32_t filtered;                                   // Calibrated and filtered position
+    at42qt2120_position_calibration_t calibration;      // Pairs collected since the last at42qt2120_position_calibrate_finish()
+} at42qt2120_position_estimator_t;
+
+/**
+ * @brief Initializes a position estimator with an identity calibration.
+ *
+ * @param estimator Pointer to the estimator structure.
+ * @param at42qt2120_handle Pointer to an initialized at42qt2120 handle (may be NULL if only at42qt2120_position_update() is used).
+ * @param config Pointer to the configuration.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_position_init(at42qt2120_position_estimator_t* estimator, at42qt2120_handle_t* at42qt2120_handle,
+                                   const at42qt2120_position_config_t* config);
+
+/**
+ * @brief Computes a position from the deltas of the slider keys, e.g. taken from at42qt2120_read_signals_references().
+ *        Without the position register it interpolates at any strength, register_below is not applied.
+ *
+ * @param estimator Pointer to the estimator structure.
+ * @param deltas Signal - reference of keys 0-2.
+ * @param position Pointer receiving the estimate.
+ */
+void at42qt2120_position_update(at42qt2120_position_estimator_t* estimator, const int16_t deltas[AT42QT2120_SLIDER_NUM_KEYS],
+                                at42qt2120_position_t* position);
+
+/**
+ * @brief Reads the signals and references of the slider keys in one 30-byte burst and computes a position.
+ *        A touch weaker than register_below adds a one-byte read of the position register.
+ *
+ * @param estimator Pointer to the estimator structure.
+ * @param position Pointer receiving the estimate.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_position_read(at42qt2120_position_estimator_t* estimator, at42qt2120_position_t* position);
+
+/**
+ * @brief Pairs the last touched estimate with the chip's position register for the calibration.
+ *        Call it while the finger rests, right after an update, with the position read alongside.
+ *
+ * @param estimator Pointer to the estimator structure.
+ * @param chip_position Value of the slider position register (0-255).
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the last update was not touched.
+ */
+esp_err_t at42qt2120_position_calibrate_add(at42qt2120_position_estimator_t* estimator, uint8_t chip_position);
+
+/**
+ * @brief Fits the calibration to the collected pairs and clears them on success. A slider gets a gain and an
+ *        offset (least squares), a wheel an offset only.
+ *
+ * @param estimator Pointer to the estimator structure.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the pairs do not span enough of the slider.
+ */
+esp_err_t at42qt2120_position_calibrate_finish(at42qt2120_position_estimator_t* estimator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
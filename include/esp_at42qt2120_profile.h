@@ -0,0 +1,193 @@
+#ifndef ESP_AT42QT2120_PROFILE_H
+#define ESP_AT42QT2120_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_config.h"
+#include "esp_at42qt2120_gesture.h"
+#include "esp_at42qt2120_poll.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_profile.h
+ * @brief Persisted tuning profile and warm boot.
+ *
+ * A profile holds the writable register map (0x08-0x33) and the numeric gesture and polling
+ * settings. It is stored as a little-endian blob:
+ *   magic "QT21" | version (1 byte) | reserved (1 byte) | payload length (2 bytes) | payload | CRC-32 (4 bytes)
+ * The CRC (IEEE 802.3) covers everything before it. A blob of another version, length or CRC is
+ * rejected as a whole, the caller then falls back to its compiled-in profile.
+ *
+ * at42qt2120_profile_boot() reads the setup registers with one burst and compares them with the
+ * profile. If the device kept its configuration, e.g. across a reset of the host alone, nothing is
+ * written and nothing is recalibrated. If only registers that do not affect the measurement
+ * differ (0x08-0x0D and the detection thresholds), they are written without a calibration.
+ * Otherwise the differing registers are written and the device is calibrated once. It is only
+ * reset first when it reports a wrong chip ID or the burst read fails.
+ *
+ * Storage is pluggable: a file backend works wherever stdio does (Linux, VFS on ESP-IDF), an
+ * NVS backend is available on ESP-IDF.
+ */
+
+/** @brief Current version of the profile blob */
+#define AT42QT2120_PROFILE_VERSION 1
+/** @brief Size of a version 1 profile blob in bytes */
+#define AT42QT2120_PROFILE_BLOB_SIZE 89
+
+/**
+ * @brief Complete tuning profile. Callbacks, user contexts and task settings are not persisted
+ *        and keep whatever the profile held before it was loaded.
+ */
+typedef struct {
+    at42qt2120_config_t config;             // Writable register map
+    at42qt2120_gesture_config_t gesture;    // Gesture engine settings
+    at42qt2120_poll_config_t poll;          // Polling scheduler settings
+} at42qt2120_profile_t;
+
+/**
+ * @brief Functions implemented by a profile storage backend.
+ */
+typedef struct {
+    esp_err_t (*load)(void* ctx, uint8_t* blob, size_t capacity, size_t* size);    // Reads the stored blob, ESP_ERR_NOT_FOUND if there is none
+    esp_err_t (*save)(void* ctx, const uint8_t* blob, size_t size);                 // Replaces the stored blob
+} at42qt2120_profile_storage_ops_t;
+
+/**
+ * @brief Structure binding a storage backend to its context.
+ */
+typedef struct {
+    const at42qt2120_profile_storage_ops_t* ops;    // Backend functions
+    void* ctx;                                      // Backend context passed to every function
+} at42qt2120_profile_storage_t;
+
+/**
+ * @brief Context of the file storage backend.
+ */
+typedef struct {
+    const char* path;                       // File holding the blob
+} at42qt2120_profile_file_t;
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Context of the NVS storage backend.
+ */
+typedef struct {
+    const char* namespace_name;             // NVS namespace (at most 15 characters)
+    const char* key;                        // NVS key of the blob (at most 15 characters)
+} at42qt2120_profile_nvs_t;
+#endif
+
+/**
+ * @brief How at42qt2120_profile_boot() brought the device up.
+ */
+typedef enum {
+    AT42QT2120_PROFILE_BOOT_WARM,           // Registers matched, nothing written
+    AT42QT2120_PROFILE_BOOT_PATCHED,        // Only registers not affecting the measurement differed, written without a calibration
+    AT42QT2120_PROFILE_BOOT_COLD,           // Configuration written and calibrated, see at42qt2120_profile_boot_result_t::reset
+} at42qt2120_profile_boot_mode_t;
+
+/**
+ * @brief Outcome of at42qt2120_profile_boot().
+ */
+typedef struct {
+    at42qt2120_profile_boot_mode_t mode;    // Path taken
+    esp_err_t load_result;                  // Result of loading the stored profile (ESP_OK if it was used)
+    bool saved;                             // The profile was written to storage
+    bool reset;                             // The chip ID was wrong or the register read failed, so the cold boot started with a reset
+    int64_t duration_us;                    // Time from the start of the boot until the device was ready
+} at42qt2120_profile_boot_result_t;
+
+/**
+ * @brief Fills a profile with the device's power-on registers and the default gesture and polling settings.
+ *
+ * @param profile Pointer to the profile to fill.
+ */
+void at42qt2120_profile_default(at42qt2120_profile_t* profile);
+
+/**
+ * @brief Serializes a profile into a blob.
+ *
+ * @param profile Pointer to the profile.
+ * @param blob Buffer receiving the blob.
+ * @param capacity Size of blob, at least AT42QT2120_PROFILE_BLOB_SIZE.
+ * @param size Pointer receiving the blob size.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if blob is too small.
+ */
+esp_err_t at42qt2120_profile_encode(const at42qt2120_profile_t* profile, uint8_t* blob, size_t capacity, size_t* size);
+
+/**
+ * @brief Checks a blob and deserializes it into a profile. The profile is only modified if the blob is valid.
+ *
+ * @param blob The blob.
+ * @param size Size of the blob.
+ * @param profile Pointer to the profile to update.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_CRC on a corrupt blob, ESP_ERR_INVALID_VERSION on another
+ *         version, ESP_ERR_INVALID_SIZE on a truncated blob or a wrong magic.
+ */
+esp_err_t at42qt2120_profile_decode(const uint8_t* blob, size_t size, at42qt2120_profile_t* profile);
+
+/**
+ * @brief Loads a profile from storage.
+ *
+ * @param storage Pointer to the storage backend.
+ * @param profile Pointer to the profile to update.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if nothing is stored, otherwise the error of the backend or the decoder.
+ */
+esp_err_t at42qt2120_profile_load(const at42qt2120_profile_storage_t* storage, at42qt2120_profile_t* profile);
+
+/**
+ * @brief Saves a profile to storage.
+ *
+ * @param storage Pointer to the storage backend.
+ * @param profile Pointer to the profile.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_profile_save(const at42qt2120_profile_storage_t* storage, const at42qt2120_profile_t* profile);
+
+/**
+ * @brief Brings the device up with the stored profile, or with profile as given if none is stored.
+ *        Without a valid stored profile, profile is saved once the device is up.
+ *
+ * @param at42qt2120_handle Pointer to an initialized at42qt2120 handle.
+ * @param storage Pointer to the storage backend (NULL to boot from profile without storage).
+ * @param profile Pointer to the fallback profile, updated with the stored one when that is valid.
+ * @param result Optional pointer receiving the outcome (NULL if unused).
+ * @return esp_err_t ESP_OK on success, otherwise the error of the configuration or calibration. A missing or
+ *         corrupt stored profile is not an error, see result->load_result.
+ */
+esp_err_t at42qt2120_profile_boot(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_profile_storage_t* storage, at42qt2120_profile_t* profile,
+                                  at42qt2120_profile_boot_result_t* result);
+
+/**
+ * @brief Sets up a storage backend that keeps the blob in a file.
+ *
+ * @param file Pointer to the backend context, must outlive the storage.
+ * @param path Path of the file.
+ * @param storage Pointer to the storage structure to fill.
+ */
+void at42qt2120_profile_storage_file(at42qt2120_profile_file_t* file, const char* path, at42qt2120_profile_storage_t* storage);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Sets up a storage backend that keeps the blob in NVS. nvs_flash_init() must have been called.
+ *
+ * @param nvs Pointer to the backend context, must outlive the storage.
+ * @param namespace_name NVS namespace.
+ * @param key NVS key of the blob.
+ * @param storage Pointer to the storage structure to fill.
+ */
+void at42qt2120_profile_storage_nvs(at42qt2120_profile_nvs_t* nvs, const char* namespace_name, const char* key, at42qt2120_profile_storage_t* storage);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef ESP_AT42QT2120_PUBLISH_H
+#define ESP_AT42QT2120_PUBLISH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+#include "esp_at42qt2120_driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_publish.h
+ * @brief Lock-free publication of the latest AT42QT2120 state to any number of tasks.
+ *
+ * A single acquisition task owns the bus and publishes every decoded state. Readers on either
+ * core fetch the latest snapshot from a sequence lock: the writer makes the sequence odd while
+ * it copies the snapshot and even again afterwards, readers retry until they saw the same even
+ * sequence before and after their copy. Readers never touch the bus, never take a lock and
+ * never delay the writer.
+ *
+ * Snapshots whose state differs from the previous one are additionally pushed to a
+ * single-producer/single-consumer ring for one consumer that must not miss transitions. When
+ * the ring is full the new snapshot is dropped and counted in ring_overruns.
+ */
+
+/** @brief Capacity of the transition ring (power of two) */
+#ifndef AT42QT2120_SNAPSHOT_RING_SIZE
+#define AT42QT2120_SNAPSHOT_RING_SIZE 32
+#endif
+/** @brief Size of a snapshot in 32-bit words */
+#define AT42QT2120_SNAPSHOT_WORDS (sizeof(at42qt2120_snapshot_t) / sizeof(uint32_t))
+
+/**
+ * @brief A published state.
+ */
+typedef struct {
+    at42qt2120_state_t state;               // Decoded state
+    int64_t time_us;                        // Time the state was read
+    uint32_t sequence;                      // Number of the publication that produced the snapshot (1 for the first)
+} at42qt2120_snapshot_t;
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Configuration of the acquisition task.
+ */
+typedef struct {
+    uint32_t period_ms;                     // Read period
+    uint32_t task_stack_size;               // Stack size of the acquisition task in bytes
+    UBaseType_t task_priority;              // Priority of the acquisition task
+    BaseType_t core_id;                     // Core the acquisition task is pinned to (tskNO_AFFINITY for none)
+} at42qt2120_publisher_config_t;
+
+/** @brief Default acquisition task configuration */
+#define AT42QT2120_PUBLISHER_CONFIG_DEFAULT() {     \
+    .period_ms = 10,                                \
+    .task_stack_size = 3072,                        \
+    .task_priority = 10,                            \
+    .core_id = tskNO_AFFINITY,                      \
+}
+#endif
+
+/**
+ * @brief Structure representing a state publisher.
+ */
+typedef struct {
+    at42qt2120_handle_t* at42qt2120_handle;                     // Device read by at42qt2120_publisher_acquire()
+    uint32_t sequence;                                          // Sequence lock, odd while the latest snapshot is being written
+    uint32_t latest[AT42QT2120_SNAPSHOT_WORDS];                 // Latest snapshot, accessed word by word
+    at42qt2120_snapshot_t ring[AT42QT2120_SNAPSHOT_RING_SIZE];  // Transition ring
+    uint32_t ring_head;                                         // Next slot written by the producer
+    uint32_t ring_tail;                                         // Next slot read by the consumer
+    uint32_t ring_overruns;                                     // Transitions dropped because the ring was full
+    uint32_t read_errors;                                       // Failed acquisitions
+    at42qt2120_state_t previous_state;                          // State of the previous publication
+#ifdef ESP_PLATFORM
+    at42qt2120_publisher_config_t config;                       // Configuration given to at42qt2120_publisher_start()
+    TaskHandle_t acquisition_task;                              // Acquisition task (NULL while stopped)
+    SemaphoreHandle_t stopped_sem;                              // Given by the acquisition task when it exits
+    volatile bool running;                                      // Cleared to request the acquisition task to exit
+#endif
+} at42qt2120_publisher_t;
+
+/**
+ * @brief Initializes a publisher. Nothing is published until the first acquisition.
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @param at42qt2120_handle Pointer to an initialized at42qt2120 handle, owned by the publisher from now on.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_publisher_init(at42qt2120_publisher_t* publisher, at42qt2120_handle_t* at42qt2120_handle);
+
+/**
+ * @brief Deinitializes a publisher. Stops the acquisition task first if it is running.
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_publisher_deinit(at42qt2120_publisher_t* publisher);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Starts the acquisition task, which reads and publishes the state every period.
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @param config Pointer to the task configuration.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_publisher_start(at42qt2120_publisher_t* publisher, const at42qt2120_publisher_config_t* config);
+
+/**
+ * @brief Stops the acquisition task and waits for it to exit.
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_publisher_stop(at42qt2120_publisher_t* publisher);
+#endif
+
+/**
+ * @brief Reads the state once and publishes it. Must only be called by the single writer
+ *        (the acquisition task when it is running).
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_publisher_acquire(at42qt2120_publisher_t* publisher);
+
+/**
+ * @brief Publishes a state read elsewhere. Must only be called by the single writer.
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @param state Pointer to the state.
+ * @param time_us Time the state was read.
+ */
+void at42qt2120_publisher_publish(at42qt2120_publisher_t* publisher, const at42qt2120_state_t* state, int64_t time_us);
+
+/**
+ * @brief Copies the latest snapshot. Lock-free, safe from any task on any core.
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @param snapshot Pointer to the structure receiving the snapshot.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if nothing was published yet.
+ */
+esp_err_t at42qt2120_publisher_get_latest(const at42qt2120_publisher_t* publisher, at42qt2120_snapshot_t* snapshot);
+
+/**
+ * @brief Takes the oldest transition from the ring. Only one consumer task may call this.
+ *
+ * @param publisher Pointer to the publisher structure.
+ * @param snapshot Pointer to the structure receiving the snapshot.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the ring is empty.
+ */
+esp_err_t at42qt2120_publisher_ring_pop(at42qt2120_publisher_t* publisher, at42qt2120_snapshot_t* snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef ESP_AT42QT2120_SIGNALS_H
+#define ESP_AT42QT2120_SIGNALS_H
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_signals.h
+ * @brief Bulk acquisition of the raw key signal (0x34-0x4B) and reference (0x4C-0x63) registers.
+ *
+ * Every function fetches its whole block in a single burst read and decodes it into
+ * caller-owned arrays. Nothing is allocated per call.
+ */
+
+/**
+ * @brief Reads the signal of all 12 keys in one 24-byte burst.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param signals Array receiving the signal of each key.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_read_signals(at42qt2120_handle_t* at42qt2120_handle, uint16_t signals[AT42QT2120_NUM_KEYS]);
+
+/**
+ * @brief Reads the reference of all 12 keys in one 24-byte burst.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param references Array receiving the reference of each key.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_read_references(at42qt2120_handle_t* at42qt2120_handle, uint16_t references[AT42QT2120_NUM_KEYS]);
+
+/**
+ * @brief Reads signals and references of all 12 keys in one 48-byte burst and computes the per-key deltas.
+ *
+ * @param at42qt2120_handle Pointer to the at42qt2120 handle structure.
+ * @param signals Array receiving the signal of each key.
+ * @param references Array receiving the reference of each key.
+ * @param deltas Optional array receiving signal - reference of each key (NULL if unused).
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_read_signals_references(at42qt2120_handle_t* at42qt2120_handle, uint16_t signals[AT42QT2120_NUM_KEYS],
+                                             uint16_t references[AT42QT2120_NUM_KEYS], int16_t deltas[AT42QT2120_NUM_KEYS]);
+
+/**
+ * @brief Computes signal - reference for all 12 keys, e.g. to pair a fresh signal read with cached references.
+ *
+ * @param signals Signal of each key.
+ * @param references Reference of each key.
+ * @param deltas Array receiving signal - reference of each key.
+ */
+void at42qt2120_compute_deltas(const uint16_t signals[AT42QT2120_NUM_KEYS], const uint16_t references[AT42QT2120_NUM_KEYS],
+                               int16_t deltas[AT42QT2120_NUM_KEYS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
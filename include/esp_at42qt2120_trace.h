@@ -0,0 +1,164 @@
+#ifndef ESP_AT42QT2120_TRACE_H
+#define ESP_AT42QT2120_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_trace.h
+ * @brief Bus transaction recorder and reader of its dumps.
+ *
+ * The recorder is a transport that forwards to another one and logs every write, write-read
+ * and probe into a caller-provided byte ring: time, direction, register, payload and result.
+ * Retries and recovery traffic show up as the separate transactions they are. When the ring is
+ * full the oldest records make room. Records are variable-length:
+ *   flags (1 byte: op in bits 0-1, bit 2 set if failed) | time since the previous record (LEB128, us)
+ *   | register (1 byte) | length (1 byte) | esp_err_t (4 bytes, failed only) | payload
+ * A probe has neither register nor length. The payload is the data written after the register,
+ * or the data read; a failed read carries none. A status poll takes 9 bytes.
+ *
+ * A dump is the ring in order behind a header:
+ *   magic "QTTR" | version (1 byte) | reserved (3 bytes) | base time (8 bytes) | records (4 bytes) | dropped (4 bytes)
+ * all little-endian; the base time is what the first record's time is relative to. The reader
+ * walks a dump record by record, e.g. to replay it (see esp_at42qt2120_replay.h on the host).
+ *
+ * The recorder takes no lock: dump it from the task that owns the handle.
+ */
+
+/** @brief Current version of the dump format */
+#define AT42QT2120_TRACE_VERSION 1
+/** @brief Size of the dump header in bytes */
+#define AT42QT2120_TRACE_HEADER_SIZE 24
+/** @brief Largest record in bytes, a failed write of 255 bytes */
+#define AT42QT2120_TRACE_MAX_RECORD_SIZE (1 + 10 + 2 + 4 + 255)
+
+/**
+ * @brief Kinds of recorded transactions.
+ */
+typedef enum {
+    AT42QT2120_TRACE_WRITE,                 // Register write (at42qt2120_register_write())
+    AT42QT2120_TRACE_READ,                  // Register address write followed by a read (at42qt2120_register_read())
+    AT42QT2120_TRACE_PROBE,                 // Address probe
+} at42qt2120_trace_op_t;
+
+/**
+ * @brief One decoded record.
+ */
+typedef struct {
+    int64_t time_us;                        // Transport time at the start of the transaction
+    at42qt2120_trace_op_t op;               // Kind of transaction
+    uint8_t reg;                            // First register (0 for probes)
+    uint8_t length;                         // Bytes written after the register, or bytes requested
+    esp_err_t result;                       // Result returned by the transport
+    const uint8_t* payload;                 // Data written or read, inside the dump (NULL if none)
+} at42qt2120_trace_record_t;
+
+/**
+ * @brief Structure representing a recorder.
+ */
+typedef struct {
+    at42qt2120_transport_t inner;           // Transport the transactions are forwarded to
+    uint8_t* buffer;                        // Ring storage
+    size_t capacity;                        // Size of the ring storage
+    size_t head;                            // Offset the next record is written at
+    size_t tail;                            // Offset of the oldest record
+    size_t used;                            // Bytes held by records
+    int64_t base_time_us;                   // Time the oldest record's time is relative to
+    int64_t last_time_us;                   // Time of the newest record
+    uint32_t records;                       // Records held
+    uint32_t dropped;                       // Records overwritten or too large for the ring
+    bool enabled;                           // Recording (transactions are forwarded either way)
+} at42qt2120_trace_t;
+
+/**
+ * @brief Structure walking a dump.
+ */
+typedef struct {
+    const uint8_t* data;                    // The dump
+    size_t size;                            // Size of the dump
+    size_t offset;                          // Offset of the next record
+    int64_t time_us;                        // Time of the last record returned
+    uint32_t records;                       // Records in the dump
+    uint32_t dropped;                       // Records the recorder had dropped before the dump
+} at42qt2120_trace_reader_t;
+
+/**
+ * @brief Sets up a recorder in front of a transport. Pass the returned transport to at42qt2120_init_with_transport().
+ *
+ * @param trace Pointer to the recorder structure, must outlive the transport.
+ * @param buffer Ring storage, must outlive the recorder.
+ * @param capacity Size of buffer, at least AT42QT2120_TRACE_MAX_RECORD_SIZE.
+ * @param inner Pointer to the transport to forward to (copied).
+ * @param transport Pointer receiving the recording transport.
+ * @return esp_err_t ESP_OK on success, otherwise an error code.
+ */
+esp_err_t at42qt2120_trace_init(at42qt2120_trace_t* trace, uint8_t* buffer, size_t capacity, const at42qt2120_transport_t* inner,
+                                at42qt2120_transport_t* transport);
+
+/**
+ * @brief Pauses or resumes recording.
+ *
+ * @param trace Pointer to the recorder structure.
+ * @param enabled Record transactions.
+ */
+void at42qt2120_trace_enable(at42qt2120_trace_t* trace, bool enabled);
+
+/**
+ * @brief Discards all records and the dropped count.
+ *
+ * @param trace Pointer to the recorder structure.
+ */
+void at42qt2120_trace_clear(at42qt2120_trace_t* trace);
+
+/**
+ * @brief Returns the size a dump of the current records takes.
+ *
+ * @param trace Pointer to the recorder structure.
+ * @return size_t Dump size in bytes.
+ */
+size_t at42qt2120_trace_dump_size(const at42qt2120_trace_t* trace);
+
+/**
+ * @brief Writes the records, oldest first, behind a dump header. The records stay in the ring.
+ *
+ * @param trace Pointer to the recorder structure.
+ * @param dump Buffer receiving the dump.
+ * @param capacity Size of dump, at least at42qt2120_trace_dump_size().
+ * @param size Pointer receiving the dump size.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if dump is too small.
+ */
+esp_err_t at42qt2120_trace_dump(const at42qt2120_trace_t* trace, uint8_t* dump, size_t capacity, size_t* size);
+
+/**
+ * @brief Checks a dump header and prepares to walk its records.
+ *
+ * @param reader Pointer to the reader structure.
+ * @param dump The dump, must outlive the reader.
+ * @param size Size of the dump.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE on a truncated dump or a wrong magic,
+ *         ESP_ERR_INVALID_VERSION on another version.
+ */
+esp_err_t at42qt2120_trace_reader_init(at42qt2120_trace_reader_t* reader, const uint8_t* dump, size_t size);
+
+/**
+ * @brief Decodes the next record.
+ *
+ * @param reader Pointer to the reader structure.
+ * @param record Pointer receiving the record. Its payload points into the dump.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND after the last record, ESP_ERR_INVALID_SIZE on a truncated record.
+ */
+esp_err_t at42qt2120_trace_next(at42qt2120_trace_reader_t* reader, at42qt2120_trace_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
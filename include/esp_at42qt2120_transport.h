@@ -0,0 +1,46 @@
+#ifndef ESP_AT42QT2120_TRANSPORT_H
+#define ESP_AT42QT2120_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_transport.h
+ * @brief Thin transport interface between the AT42QT2120 driver and the platform.
+ *
+ * The driver never calls the I2C master driver or FreeRTOS directly. Every bus transaction
+ * and every wait goes through an at42qt2120_transport_t. The ESP-IDF I2C master backend is
+ * installed by at42qt2120_init(), other backends (e.g. the host simulator) are passed to
+ * at42qt2120_init_with_transport().
+ */
+
+/**
+ * @brief Functions implemented by a transport backend.
+ */
+typedef struct {
+    esp_err_t (*transmit_receive)(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms); // Write then read with a repeated start
+    esp_err_t (*transmit)(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms);                                             // Write only
+    esp_err_t (*probe)(void* ctx, int timeout_ms);                                                                                              // Check that the device ACKs its address
+    esp_err_t (*release)(void* ctx);                                                                                                            // Optional, frees backend resources on deinit (NULL if unused)
+    void (*delay_ms)(void* ctx, uint32_t delay_ms);                                                                                             // Blocks the caller for at least delay_ms
+    int64_t (*time_us)(void* ctx);                                                                                                              // Monotonic time in microseconds
+} at42qt2120_transport_ops_t;
+
+/**
+ * @brief Structure binding a transport backend to its context.
+ */
+typedef struct {
+    const at42qt2120_transport_ops_t* ops;  // Backend functions
+    void* ctx;                              // Backend context passed to every function
+} at42qt2120_transport_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef ESP_AT42QT2120_TUNE_H
+#define ESP_AT42QT2120_TUNE_H
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_config.h"
+#include "esp_at42qt2120_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file esp_at42qt2120_tune.h
+ * @brief Automatic tuning of the detection thresholds, pulse/scale and charge time.
+ *
+ * The sweep measures all tuned keys at once. Each step writes the pulse/scale registers of every
+ * key and the charge time in one flush, then reads signals and references in 48-byte bursts:
+ * first untouched (noise: standard deviation of signal - reference), then with all keys touched
+ * through the touch callback (touch delta: difference of the means). Pulse settings 0..max_pulse
+ * are swept at charge time 0, then charge times 1..max_charge_time at max_pulse. Combinations are
+ * predicted from the two sweeps instead of being measured one by one.
+ *
+ * The selection raises the pulse of the key with the lowest signal-to-noise ratio, one step at a
+ * time, as long as the predicted worst-case response time stays within response_time_us and the
+ * burst fits in the measurement interval. A step that does not improve that key (noise common to
+ * all keys grows with the pulses just like the signal) freezes it. Every charge time is tried and
+ * the best lowest ratio wins. Scale keeps the untouched signal below max_signal, the detection
+ * threshold is threshold_percent of the touch delta, at least min_noise_sigmas noise deviations.
+ *
+ * The worst-case response time is modelled from the low power mode and detection integrator of the
+ * device: one measurement interval (or burst, if longer) until the first measurement, then the
+ * integrator's confirmation measurements at confirm_spacing_us (or one burst, if longer), then the
+ * burst itself. The burst is the sum over all keys of 2^pulse pulses of pulse_time_us plus
+ * charge_step_time_us per charge time step; measure both on the board, e.g. with the OVERFLOW bit.
+ *
+ * The device is left with its configuration from before the sweep and recalibrated. The result
+ * holds the tuned configuration for at42qt2120_apply_config(), followed by a calibration.
+ */
+
+/** @brief Highest pulse setting the sweep accepts */
+#define AT42QT2120_TUNE_MAX_PULSE 8
+/** @brief Highest charge time the sweep accepts */
+#define AT42QT2120_TUNE_MAX_CHARGE_TIME 7
+
+/**
+ * @brief Callback applying a touch to the keys in key_mask, or removing it (key_mask 0). It returns once the touch
+ *        is in place: a jig on the production line, an operator prompt, at42qt2120_sim_set_touch() on the host.
+ */
+typedef void (*at42qt2120_tune_touch_cb_t)(uint16_t key_mask, void* user_ctx);
+
+/**
+ * @brief Tuning configuration.
+ */
+typedef struct {
+    uint16_t keys;                          // Keys to tune (bit n for key n), all touched together
+    uint32_t response_time_us;              // Longest acceptable time from touch to detection (worst case)
+    uint8_t max_pulse;                      // Highest pulse setting swept (0-AT42QT2120_TUNE_MAX_PULSE)
+    uint8_t max_charge_time;                // Highest charge time swept (0-AT42QT2120_TUNE_MAX_CHARGE_TIME)
+    uint16_t max_signal;                    // Scale is raised until the untouched signal stays below this
+    uint8_t samples;                        // Untouched samples per step, half as many touched (at least 4)
+    uint8_t threshold_percent;              // Detection threshold as a share of the touch delta (1-99)
+    uint8_t min_noise_sigmas;               // Detection threshold of at least this many noise standard deviations
+    uint16_t pulse_time_us;                 // Acquisition time of one pulse of one key at charge time 0
+    uint16_t charge_step_time_us;           // Acquisition time added to every pulse per charge time step
+    uint16_t confirm_spacing_us;            // Spacing of the detection integrator's confirmation measurements
+    at42qt2120_tune_touch_cb_t touch;       // Applies and removes the touch on the tuned keys
+    void* user_ctx;                         // User context passed to the touch callback
+} at42qt2120_tune_config_t;
+
+/** @brief Default tuning configuration, set .touch before use */
+#define AT42QT2120_TUNE_CONFIG_DEFAULT() {          \
+    .keys = AT42QT2120_KEY_MASK_ALL,                \
+    .response_time_us = 40000,                      \
+    .max_pulse = 6,                                 \
+    .max_charge_time = 3,                           \
+    .max_signal = 16384,                            \
+    .samples = 16,                                  \
+    .threshold_percent = 50,                        \
+    .min_noise_sigmas = 5,                          \
+    .pulse_time_us = 4,                             \
+    .charge_step_time_us = 1,                       \
+    .confirm_spacing_us = 2000,                     \
+    .touch = NULL,                                  \
+    .user_ctx = NULL,                               \
+}
+
+/**
+ * @brief Tuned settings and predicted performance of one key.
+ */
+typedef struct {
+    uint8_t pulse;                          // Pulse setting (2^pulse pulses per measurement)
+    uint8_t scale;                          // Scale setting (sum divided by 2^scale)
+    uint8_t dthr;                           // Detection threshold
+    uint16_t delta;                         // Touch delta with these settings, in counts
+    uint16_t noise_q8;                      // Standard deviation of the untouched delta, Q8 counts
+    uint16_t snr_q8;                        // Touch delta / noise, Q8
+    uint16_t margin_q8;                     // Noise deviations between the threshold and the nearer of idle and touch level, Q8
+} at42qt2120_tune_key_t;
+
+/**
+ * @brief Outcome of at42qt2120_tune().
+ */
+typedef struct {
+    at42qt2120_config_t config;                     // Tuned configuration, ready for at42qt2120_apply_config()
+    at42qt2120_tune_key_t keys[AT42QT2120_NUM_KEYS];// Settings per key (zero for keys not tuned)
+    uint8_t charge_time;                            // Chosen charge time
+    uint16_t baseline_snr_q8;                       // Lowest touch delta / noise of the tuned keys before tuning, Q8
+    uint16_t snr_q8;                                // Lowest touch delta / noise of the tuned keys after tuning, Q8
+    uint32_t burst_time_us;                         // Predicted burst time
+    uint32_t response_time_us;                      // Predicted worst-case response time
+    uint32_t steps;                                 // Sweep steps measured
+    uint32_t reads;                                 // Burst reads of signals and references
+    int64_t duration_us;                            // Time the sweep took, including the calibrations
+} at42qt2120_tune_result_t;
+
+/**
+ * @brief Sweeps pulse/scale and charge time, and picks the settings with the best signal-to-noise margin
+ *        that meet the response time. Nothing else may use the device during the sweep.
+ *
+ * @param at42qt2120_handle Pointer to an initialized at42qt2120 handle.
+ * @param config Pointer to the tuning configuration.
+ * @param result Pointer receiving the tuned configuration and its predicted performance.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the response time cannot be met even without
+ *         extra pulses, ESP_ERR_NOT_FOUND if a tuned key showed no touch delta, otherwise an error code.
+ */
+esp_err_t at42qt2120_tune(at42qt2120_handle_t* at42qt2120_handle, const at42qt2120_tune_config_t* config, at42qt2120_tune_result_t* result);
+
+/**
+ * @brief Predicts the worst-case response time of a configuration with the burst model of a tuning configuration.
+ *
+ * @param config Pointer to the tuning configuration (burst model).
+ * @param device_config Pointer to the device configuration.
+ * @param burst_time_us Optional pointer receiving the predicted burst time (NULL if unused).
+ * @return uint32_t Worst-case time from touch to detection in microseconds.
+ */
+uint32_t at42qt2120_tune_response_time(const at42qt2120_tune_config_t* config, const at42qt2120_config_t* device_config, uint32_t* burst_time_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
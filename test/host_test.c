@@ -0,0 +1,1413 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <esp_err.h>
+#include <esp_log.h>
+
+#include "esp_at42qt2120_driver.h"
+#include "esp_at42qt2120_defines.h"
+#include "esp_at42qt2120_config.h"
+#include "esp_at42qt2120_keys.h"
+#include "esp_at42qt2120_manager.h"
+#include "esp_at42qt2120_events.h"
+#include "esp_at42qt2120_gesture.h"
+#include "esp_at42qt2120_poll.h"
+#include "esp_at42qt2120_profile.h"
+#include "esp_at42qt2120_publish.h"
+#include "esp_at42qt2120_position.h"
+#include "esp_at42qt2120_trace.h"
+#include "esp_at42qt2120_sim.h"
+
+/* Checks run so far and the ones that failed, main() exits nonzero on any failure */
+static unsigned test_checks;
+static unsigned test_failures;
+
+#define TEST_CHECK(condition) do {                                                              \
+        test_checks++;                                                                          \
+        if (!(condition)) {                                                                     \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);                \
+            test_failures++;                                                                    \
+        }                                                                                       \
+    } while (0)
+
+#define TEST_CHECK_EQ(actual, expected) do {                                                    \
+        long long actual_ = (long long)(actual), expected_ = (long long)(expected);            \
+        test_checks++;                                                                          \
+        if (actual_ != expected_) {                                                             \
+            printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, actual_, expected_); \
+            test_failures++;                                                                    \
+        }                                                                                       \
+    } while (0)
+
+/* A simulated device and the driver handle talking to it, optionally through a transaction recorder */
+typedef struct {
+    at42qt2120_sim_t sim;
+    at42qt2120_handle_t handle;
+    at42qt2120_trace_t trace;
+    uint8_t trace_ring[4096];
+} test_device_t;
+
+/* One expected bus transaction, a NULL payload is not compared */
+typedef struct {
+    at42qt2120_trace_op_t op;
+    uint8_t reg;
+    uint8_t length;
+    const uint8_t* payload;
+} test_transaction_t;
+
+/* Key 4 touched from 300 ms to 420 ms */
+static const at42qt2120_sim_touch_t test_trace[] = {
+    { .time_us = 300000, .key_mask = 1 << 4, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+    { .time_us = 420000, .key_mask = 0, .slider_position = AT42QT2120_SIM_NO_SLIDER_TOUCH },
+};
+
+static void test_device_init(test_device_t* device, bool recorded) {
+    at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+    at42qt2120_sim_init(&device->sim, &sim_config);
+
+    at42qt2120_transport_t transport;
+    at42qt2120_sim_transport(&device->sim, &transport);
+    if (recorded) {
+        at42qt2120_transport_t inner = transport;
+        ESP_ERROR_CHECK(at42qt2120_trace_init(&device->trace, device->trace_ring, sizeof(device->trace_ring), &inner, &transport));
+    }
+    ESP_ERROR_CHECK(at42qt2120_init_with_transport(&device->handle, &transport, 100));
+
+    /* Let the power-on calibration finish */
+    at42qt2120_sim_advance(&device->sim, 200000);
+}
+
+/* Transport and simulator: chip ID, auto-incrementing bursts, status snapshot cost, reset timing and the scripted trace */
+static void test_transport_sim(void) {
+    test_device_t device;
+    test_device_init(&device, false);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    uint8_t ids[2];
+    TEST_CHECK_EQ(at42qt2120_register_read(handle, AT42QT2120_REG_CHIP_ID, ids, sizeof(ids)), ESP_OK);
+    TEST_CHECK_EQ(ids[0], AT42QT2120_CHIP_ID);
+    TEST_CHECK_EQ(ids[1], AT42QT2120_SIM_FIRMWARE_VERSION);
+
+    /* One burst for the whole status block: register address out, four bytes in */
+    at42qt2120_state_t state;
+    at42qt2120_bus_stats_t stats;
+    at42qt2120_reset_bus_stats(handle);
+    TEST_CHECK_EQ(at42qt2120_read_state(handle, &state), ESP_OK);
+    at42qt2120_get_bus_stats(handle, &stats);
+    TEST_CHECK_EQ(stats.transactions, 1);
+    TEST_CHECK_EQ(stats.bytes, 5);
+    TEST_CHECK(!state.calibrating);
+    TEST_CHECK_EQ(state.key_mask, 0);
+
+    /* Written bursts auto-increment as well */
+    uint8_t thresholds[3] = { 21, 22, 23 };
+    TEST_CHECK_EQ(at42qt2120_register_write(handle, AT42QT2120_REG_KEY_00_DTHR, thresholds, sizeof(thresholds)), ESP_OK);
+    TEST_CHECK(memcmp(&device.sim.regs[AT42QT2120_REG_KEY_00_DTHR], thresholds, sizeof(thresholds)) == 0);
+
+    /* The device NACKs while it resets, then calibrates with its setup registers at their defaults */
+    int64_t reset_us = device.sim.now_us;
+    TEST_CHECK_EQ(at42qt2120_reset(handle), ESP_OK);
+    TEST_CHECK(device.sim.now_us - reset_us >= device.sim.config.reset_time_us + device.sim.config.calibrate_time_us);
+    TEST_CHECK(device.sim.stats.nacks > 0);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_KEY_00_DTHR], 10);
+
+    /* Touches follow the trace once the detection integrator confirmed them */
+    at42qt2120_sim_set_trace(&device.sim, test_trace, sizeof(test_trace) / sizeof(test_trace[0]));
+    at42qt2120_sim_advance_to(&device.sim, 380000);
+    TEST_CHECK_EQ(at42qt2120_read_state(handle, &state), ESP_OK);
+    TEST_CHECK_EQ(state.key_mask, 1 << 4);
+    TEST_CHECK(state.touch_detected);
+
+    at42qt2120_sim_advance_to(&device.sim, 500000);
+    TEST_CHECK_EQ(at42qt2120_read_state(handle, &state), ESP_OK);
+    TEST_CHECK_EQ(state.key_mask, 0);
+
+    at42qt2120_deinit(handle);
+}
+
+/* Compares the recorded transactions with the expected ones, then clears the recorder */
+static void test_check_transactions(test_device_t* device, const test_transaction_t* expected, size_t expected_count) {
+    static uint8_t dump[sizeof(device->trace_ring) + AT42QT2120_TRACE_HEADER_SIZE];
+    size_t size;
+    TEST_CHECK_EQ(at42qt2120_trace_dump(&device->trace, dump, sizeof(dump), &size), ESP_OK);
+    at42qt2120_trace_clear(&device->trace);
+
+    at42qt2120_trace_reader_t reader;
+    TEST_CHECK_EQ(at42qt2120_trace_reader_init(&reader, dump, size), ESP_OK);
+    TEST_CHECK_EQ(reader.records, expected_count);
+
+    at42qt2120_trace_record_t record;
+    for (size_t index = 0; index < expected_count && at42qt2120_trace_next(&reader, &record) == ESP_OK; index++) {
+        TEST_CHECK_EQ(record.op, expected[index].op);
+        TEST_CHECK_EQ(record.reg, expected[index].reg);
+        TEST_CHECK_EQ(record.length, expected[index].length);
+        TEST_CHECK_EQ(record.result, ESP_OK);
+        if (expected[index].payload != NULL)
+            TEST_CHECK(record.payload != NULL && memcmp(record.payload, expected[index].payload, expected[index].length) == 0);
+    }
+}
+
+/* Declarative configuration: the exact write plan and the transactions at42qt2120_apply_config() issues for it */
+static void test_config_plan(void) {
+    test_device_t device;
+    test_device_init(&device, true);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    /* Slider options (0x0E) and the thresholds (0x10-0x1B) differ from the defaults. The unchanged charge
+     * time (0x0F) in between is bridged, one burst is cheaper than two transactions */
+    at42qt2120_config_t config;
+    at42qt2120_config_default(&config);
+    config.slider_options = AT42QT2120_SLIDER_OPTIONS_EN;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        config.key_dthr[key] = 18;
+
+    static const uint8_t slider_thresholds[14] = { AT42QT2120_SLIDER_OPTIONS_EN, 0, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18 };
+    const test_transaction_t slider_transactions[] = {
+        { AT42QT2120_TRACE_READ, AT42QT2120_REG_CONFIG_FIRST, AT42QT2120_CONFIG_REG_COUNT, NULL },      // Shadow resync for the diff
+        { AT42QT2120_TRACE_WRITE, AT42QT2120_REG_SLIDER_OPTIONS, 14, slider_thresholds },
+        { AT42QT2120_TRACE_READ, AT42QT2120_REG_CONFIG_FIRST, AT42QT2120_CONFIG_REG_COUNT, NULL },      // Verify
+    };
+
+    at42qt2120_trace_clear(&device.trace);
+    at42qt2120_write_plan_t plan;
+    TEST_CHECK_EQ(at42qt2120_apply_config(handle, &config, &plan), ESP_OK);
+    TEST_CHECK_EQ(plan.burst_count, 1);
+    TEST_CHECK_EQ(plan.bursts[0].reg, AT42QT2120_REG_SLIDER_OPTIONS);
+    TEST_CHECK_EQ(plan.bursts[0].length, 14);
+    TEST_CHECK_EQ(plan.byte_count, 14);
+    test_check_transactions(&device, slider_transactions, sizeof(slider_transactions) / sizeof(slider_transactions[0]));
+
+    /* Re-applying the same configuration only verifies it */
+    const test_transaction_t verify_transactions[] = {
+        { AT42QT2120_TRACE_READ, AT42QT2120_REG_CONFIG_FIRST, AT42QT2120_CONFIG_REG_COUNT, NULL },
+    };
+    TEST_CHECK_EQ(at42qt2120_apply_config(handle, &config, &plan), ESP_OK);
+    TEST_CHECK_EQ(plan.burst_count, 0);
+    test_check_transactions(&device, verify_transactions, 1);
+
+    /* The pulse/scale block is twelve unchanged key control registers away and gets its own burst */
+    config.charge_time = 1;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        config.key_pulse_scale[key] = 0x21;
+
+    static const uint8_t charge_time[1] = { 1 };
+    static const uint8_t pulse_scales[AT42QT2120_NUM_KEYS] = { 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21 };
+    const test_transaction_t pulse_transactions[] = {
+        { AT42QT2120_TRACE_WRITE, AT42QT2120_REG_CHARGE_TIME, 1, charge_time },
+        { AT42QT2120_TRACE_WRITE, AT42QT2120_REG_KEY_00_PULSE_SCALE, AT42QT2120_NUM_KEYS, pulse_scales },
+        { AT42QT2120_TRACE_READ, AT42QT2120_REG_CONFIG_FIRST, AT42QT2120_CONFIG_REG_COUNT, NULL },
+    };
+    TEST_CHECK_EQ(at42qt2120_apply_config(handle, &config, &plan), ESP_OK);
+    TEST_CHECK_EQ(plan.burst_count, 2);
+    TEST_CHECK_EQ(plan.bursts[0].reg, AT42QT2120_REG_CHARGE_TIME);
+    TEST_CHECK_EQ(plan.bursts[0].length, 1);
+    TEST_CHECK_EQ(plan.bursts[1].reg, AT42QT2120_REG_KEY_00_PULSE_SCALE);
+    TEST_CHECK_EQ(plan.bursts[1].length, AT42QT2120_NUM_KEYS);
+    test_check_transactions(&device, pulse_transactions, sizeof(pulse_transactions) / sizeof(pulse_transactions[0]));
+    TEST_CHECK(memcmp(&device.sim.regs[AT42QT2120_REG_CONFIG_FIRST], &config, sizeof(config)) == 0);
+
+    /* Direct register writes land in the shadow: the burst bridging key 1 carries its new threshold, an equal
+     * value is not staged again and the direct write to key 4 supersedes the value staged before it */
+    uint8_t value = 30;
+    TEST_CHECK_EQ(at42qt2120_register_write(handle, AT42QT2120_REG_KEY_01_DTHR, &value, 1), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_shadow_write(handle, AT42QT2120_REG_KEY_00_DTHR, 20), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_shadow_write(handle, AT42QT2120_REG_KEY_01_DTHR, 30), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_shadow_write(handle, AT42QT2120_REG_KEY_02_DTHR, 22), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_shadow_write(handle, AT42QT2120_REG_KEY_04_DTHR, 40), ESP_OK);
+    value = 41;
+    TEST_CHECK_EQ(at42qt2120_register_write(handle, AT42QT2120_REG_KEY_04_DTHR, &value, 1), ESP_OK);
+    TEST_CHECK_EQ(handle->shadow.dirty, 0x5ULL << (AT42QT2120_REG_KEY_00_DTHR - AT42QT2120_REG_CONFIG_FIRST));
+
+    static const uint8_t bridged[3] = { 20, 30, 22 };
+    const test_transaction_t bridged_transactions[] = {
+        { AT42QT2120_TRACE_WRITE, AT42QT2120_REG_KEY_00_DTHR, 3, bridged },
+    };
+    at42qt2120_trace_clear(&device.trace);
+    TEST_CHECK_EQ(at42qt2120_shadow_flush(handle), ESP_OK);
+    test_check_transactions(&device, bridged_transactions, 1);
+    TEST_CHECK(memcmp(&device.sim.regs[AT42QT2120_REG_KEY_00_DTHR], bridged, sizeof(bridged)) == 0);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_KEY_04_DTHR], 41);
+
+    at42qt2120_deinit(handle);
+}
+
+/* Fault injection: 2% random NACKs, then glitches and brown-outs, polled every 10 ms */
+#define TEST_FAULT_NACK_PER_MILLE 20
+#define TEST_FAULT_QUIET_POLLS 1000
+#define TEST_FAULT_END_US 20000000
+/* Time a failed poll may still start after a fault ended (one poll period plus its own retries) */
+#define TEST_FAULT_SETTLE_US 50000
+/* Disconnect at the end of the schedule */
+#define TEST_FAULT_DISCONNECT_US 10000000
+
+static const struct {
+    int64_t time_us;
+    int64_t duration_us;                    // Glitch length, 0 for a brown-out
+    bool corrupt_chip_id;
+} test_faults[] = {
+    { 3000000, 20000, false },
+    { 6000000, 0, false },
+    { 12000000, 0, true },
+    { 16000000, 200000, false },
+};
+#define TEST_FAULT_COUNT (sizeof(test_faults) / sizeof(test_faults[0]))
+
+/* Sum of the backoff delays of one transaction that runs out of retries */
+static int64_t test_retry_budget_us(const at42qt2120_recovery_config_t* config) {
+    int64_t budget_us = 0;
+    uint32_t backoff_ms = config->backoff_min_ms;
+    for (uint8_t retry = 0; retry < config->max_retries; retry++) {
+        budget_us += (int64_t)backoff_ms * 1000;
+        backoff_ms = backoff_ms * 2 < config->backoff_max_ms ? backoff_ms * 2 : config->backoff_max_ms;
+    }
+    return budget_us;
+}
+
+/* Recovery: bounded call time and retries under random NACKs, no failures outside glitches and brown-outs, configuration restored */
+static void test_recovery(void) {
+    test_device_t device;
+    test_device_init(&device, false);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    at42qt2120_config_t config;
+    at42qt2120_config_default(&config);
+    config.slider_options = AT42QT2120_SLIDER_OPTIONS_EN;
+    config.charge_time = 2;
+    for (int key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        config.key_dthr[key] = 14;
+    TEST_CHECK_EQ(at42qt2120_apply_config(handle, &config, NULL), ESP_OK);
+
+    at42qt2120_recovery_config_t recovery_config = AT42QT2120_RECOVERY_CONFIG_DEFAULT();
+    TEST_CHECK_EQ(at42qt2120_set_recovery_config(handle, &recovery_config), ESP_OK);
+    at42qt2120_sim_faults_t faults = { .nack_per_mille = TEST_FAULT_NACK_PER_MILLE, .seed = 42 };
+    at42qt2120_sim_set_faults(&device.sim, &faults);
+
+    /* A status read is address, register, address and four bytes on the wire */
+    int64_t retry_budget_us = test_retry_budget_us(&recovery_config);
+    int64_t attempts_us = (1 + recovery_config.max_retries) * at42qt2120_sim_bus_time_us(&device.sim, 7);
+    at42qt2120_state_t state;
+
+    /* Random NACKs alone: every poll succeeds within one retry budget, retries stay near the NACK rate */
+    int64_t longest_call_us = 0;
+    unsigned failed = 0;
+    for (unsigned poll = 0; poll < TEST_FAULT_QUIET_POLLS; poll++) {
+        int64_t start_us = device.sim.now_us;
+        if (at42qt2120_read_state(handle, &state) != ESP_OK)
+            failed++;
+        longest_call_us = device.sim.now_us - start_us > longest_call_us ? device.sim.now_us - start_us : longest_call_us;
+        at42qt2120_delay_ms(handle, 10);
+    }
+    at42qt2120_recovery_stats_t stats;
+    at42qt2120_get_recovery_stats(handle, &stats);
+    TEST_CHECK_EQ(failed, 0);
+    TEST_CHECK_EQ(stats.recoveries, 0);
+    TEST_CHECK(longest_call_us <= retry_budget_us + attempts_us);
+    TEST_CHECK(stats.retries <= 2 * TEST_FAULT_QUIET_POLLS * TEST_FAULT_NACK_PER_MILLE / 1000);
+
+    /* Glitches and brown-outs on top. The read path never recovers: a read costs at most its own retries, and
+     * at42qt2120_recover_poll() runs the recovery after it without waiting for the device reset it may need */
+    int64_t recovery_bound_us = 3 * (retry_budget_us + attempts_us) + 4 * at42qt2120_sim_bus_time_us(&device.sim, 2 + AT42QT2120_CONFIG_REG_COUNT);
+    /* While flagged, reads get no retries and the device may be resetting until the next attempt succeeded */
+    int64_t recovery_window_us = (int64_t)recovery_config.recover_interval_max_ms * 1000 + device.sim.config.reset_time_us +
+                                 device.sim.config.calibrate_time_us;
+    int64_t longest_read_us = 0, longest_step_us = 0;
+    size_t next_fault = 0;
+    unsigned unexpected_failures = 0;
+    int64_t phase_start_us = device.sim.now_us;
+    while (device.sim.now_us - phase_start_us < TEST_FAULT_END_US) {
+        if (next_fault < TEST_FAULT_COUNT && device.sim.now_us - phase_start_us >= test_faults[next_fault].time_us) {
+            if (test_faults[next_fault].duration_us > 0)
+                at42qt2120_sim_glitch(&device.sim, test_faults[next_fault].duration_us);
+            else
+                at42qt2120_sim_brown_out(&device.sim, test_faults[next_fault].corrupt_chip_id);
+            next_fault++;
+        }
+
+        bool flagged = handle->recovery.needed;
+        int64_t start_us = device.sim.now_us;
+        esp_err_t ret = at42qt2120_read_state(handle, &state);
+        longest_read_us = device.sim.now_us - start_us > longest_read_us ? device.sim.now_us - start_us : longest_read_us;
+        int64_t step_start_us = device.sim.now_us;
+        at42qt2120_recover_poll(handle);
+        longest_step_us = device.sim.now_us - step_start_us > longest_step_us ? device.sim.now_us - step_start_us : longest_step_us;
+
+        /* A failed poll has to be explained by the last fault */
+        if (ret != ESP_OK) {
+            int64_t fault_end_us = next_fault > 0 ? test_faults[next_fault - 1].time_us + test_faults[next_fault - 1].duration_us : 0;
+            start_us -= phase_start_us;
+            bool explained = next_fault > 0 && (start_us <= fault_end_us + TEST_FAULT_SETTLE_US ||
+                                                (flagged && start_us <= fault_end_us + recovery_window_us));
+            unexpected_failures += explained ? 0 : 1;
+        }
+        at42qt2120_delay_ms(handle, 10);
+    }
+
+    at42qt2120_get_recovery_stats(handle, &stats);
+    TEST_CHECK_EQ(unexpected_failures, 0);
+    TEST_CHECK(longest_read_us <= retry_budget_us + attempts_us);
+    TEST_CHECK(longest_step_us <= recovery_bound_us);
+    TEST_CHECK_EQ(stats.device_resets, 1);
+    TEST_CHECK_EQ(stats.reapplied, 2);
+    TEST_CHECK(!handle->recovery.needed);
+    TEST_CHECK(memcmp(&device.sim.regs[AT42QT2120_REG_CONFIG_FIRST], &config, sizeof(config)) == 0);
+
+    /* A long disconnect: single attempts without retries, recovery attempts spaced out up to recover_interval_max_ms */
+    at42qt2120_recovery_stats_t before = stats;
+    int64_t single_attempt_us = at42qt2120_sim_bus_time_us(&device.sim, 7);
+    longest_read_us = 0;
+    at42qt2120_sim_glitch(&device.sim, TEST_FAULT_DISCONNECT_US);
+    phase_start_us = device.sim.now_us;
+    while (device.sim.now_us - phase_start_us < TEST_FAULT_DISCONNECT_US) {
+        int64_t start_us = device.sim.now_us;
+        if (at42qt2120_read_state(handle, &state) == ESP_OK)
+            unexpected_failures++;
+        if (device.sim.now_us - phase_start_us > TEST_FAULT_SETTLE_US)
+            longest_read_us = device.sim.now_us - start_us > longest_read_us ? device.sim.now_us - start_us : longest_read_us;
+        at42qt2120_recover_poll(handle);
+        at42qt2120_delay_ms(handle, 10);
+    }
+    at42qt2120_get_recovery_stats(handle, &stats);
+    /* 50, 100, ... 1600 ms, then every 2 s */
+    uint32_t attempts_max = 1 + 6 + TEST_FAULT_DISCONNECT_US / 1000 / recovery_config.recover_interval_max_ms;
+    TEST_CHECK_EQ(unexpected_failures, 0);
+    TEST_CHECK(longest_read_us <= single_attempt_us);
+    TEST_CHECK(stats.recoveries - before.recoveries <= attempts_max);
+    TEST_CHECK(stats.recoveries - before.recoveries >= 3);
+    TEST_CHECK(stats.retries - before.retries <= 2 * (TEST_FAULT_DISCONNECT_US / 1000 / 10) * TEST_FAULT_NACK_PER_MILLE / 1000 + 3 * attempts_max);
+
+    /* Back within the longest interval */
+    int64_t reconnect_us = device.sim.now_us;
+    while (handle->recovery.needed && device.sim.now_us - reconnect_us < 2 * (int64_t)recovery_config.recover_interval_max_ms * 1000) {
+        at42qt2120_read_state(handle, &state);
+        at42qt2120_recover_poll(handle);
+        at42qt2120_delay_ms(handle, 10);
+    }
+    TEST_CHECK(!handle->recovery.needed);
+    TEST_CHECK(device.sim.now_us - reconnect_us <= (int64_t)recovery_config.recover_interval_max_ms * 1000 + 20000);
+
+    /* The error ring names the register and the value read back: the chip ID, and the registers written back */
+    at42qt2120_error_record_t record;
+    while (at42qt2120_error_pop(handle, &record) == ESP_OK)
+        ;
+    at42qt2120_sim_set_faults(&device.sim, &(at42qt2120_sim_faults_t){ 0 });
+    at42qt2120_delay_ms(handle, recovery_config.error_window_ms);
+    at42qt2120_sim_brown_out(&device.sim, true);
+    at42qt2120_delay_ms(handle, 200);
+    TEST_CHECK_EQ(at42qt2120_recover(handle), ESP_OK);
+    bool chip_id_reported = false, reapply_reported = false;
+    while (at42qt2120_error_pop(handle, &record) == ESP_OK) {
+        if (record.op == AT42QT2120_ERROR_OP_CHIP_ID) {
+            chip_id_reported = true;
+            TEST_CHECK_EQ(record.reg, AT42QT2120_REG_CHIP_ID);
+            TEST_CHECK_EQ(record.value, (uint8_t)~AT42QT2120_SIM_CHIP_ID);
+        } else if (record.op == AT42QT2120_ERROR_OP_REAPPLY) {
+            reapply_reported = true;
+            TEST_CHECK_EQ(record.reg, AT42QT2120_REG_CONFIG_FIRST);
+            TEST_CHECK_EQ(record.value, 2 + AT42QT2120_NUM_KEYS);
+        }
+    }
+    TEST_CHECK(chip_id_reported);
+    TEST_CHECK(reapply_reported);
+
+    at42qt2120_deinit(handle);
+}
+
+/* Completion callbacks of the reset/calibration test, per user context */
+typedef struct {
+    unsigned calls;
+    esp_err_t result;
+} test_ready_t;
+
+static void test_ready(at42qt2120_handle_t* at42qt2120_handle, esp_err_t result, void* user_ctx) {
+    (void)at42qt2120_handle;
+    test_ready_t* ready = (test_ready_t*)user_ctx;
+    ready->calls++;
+    ready->result = result;
+}
+
+/* Reset and calibration: a reset supersedes a pending operation, a calibration restarts a pending calibration */
+static void test_reset_calibrate(void) {
+    test_device_t device;
+    test_device_init(&device, false);
+    at42qt2120_handle_t* handle = &device.handle;
+    uint32_t calibrate_time_us = device.sim.config.calibrate_time_us;
+
+    /* Calibrating twice as in the baseline API: both calls succeed, the second restarts the cycle */
+    TEST_CHECK_EQ(at42qt2120_calibrate(handle), ESP_OK);
+    at42qt2120_delay_ms(handle, 50);
+    int64_t restart_us = device.sim.now_us;
+    TEST_CHECK_EQ(at42qt2120_calibrate(handle), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_wait_ready(handle, -1), ESP_OK);
+    TEST_CHECK(device.sim.now_us - restart_us >= calibrate_time_us);
+
+    /* The same waiter is told once, when the restarted calibration completed */
+    test_ready_t first = { 0 }, second = { 0 };
+    TEST_CHECK_EQ(at42qt2120_calibrate_async(handle, test_ready, &first), ESP_OK);
+    at42qt2120_delay_ms(handle, 50);
+    TEST_CHECK_EQ(at42qt2120_calibrate_async(handle, test_ready, &first), ESP_OK);
+    TEST_CHECK_EQ(first.calls, 0);
+    TEST_CHECK_EQ(at42qt2120_wait_ready(handle, -1), ESP_OK);
+    TEST_CHECK_EQ(first.calls, 1);
+    TEST_CHECK_EQ(first.result, ESP_OK);
+
+    /* Another waiter takes over, the first learns that its calibration was superseded */
+    first = (test_ready_t){ 0 };
+    TEST_CHECK_EQ(at42qt2120_calibrate_async(handle, test_ready, &first), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_calibrate_async(handle, test_ready, &second), ESP_OK);
+    TEST_CHECK_EQ(first.calls, 1);
+    TEST_CHECK_EQ(first.result, ESP_ERR_INVALID_STATE);
+    TEST_CHECK_EQ(at42qt2120_wait_ready(handle, -1), ESP_OK);
+    TEST_CHECK_EQ(first.calls, 1);
+    TEST_CHECK_EQ(second.calls, 1);
+    TEST_CHECK_EQ(second.result, ESP_OK);
+
+    /* A reset during a calibration resets the chip, as it always did */
+    first = (test_ready_t){ 0 };
+    second = (test_ready_t){ 0 };
+    uint8_t threshold = 30;
+    TEST_CHECK_EQ(at42qt2120_register_write(handle, AT42QT2120_REG_KEY_00_DTHR, &threshold, 1), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_calibrate_async(handle, test_ready, &first), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_reset_async(handle, test_ready, &second), ESP_OK);
+    TEST_CHECK_EQ(first.calls, 1);
+    TEST_CHECK_EQ(first.result, ESP_ERR_INVALID_STATE);
+
+    /* The device NACKs while it resets and calibrates afterwards anyway */
+    TEST_CHECK_EQ(at42qt2120_calibrate_async(handle, NULL, NULL), ESP_ERR_INVALID_STATE);
+    TEST_CHECK_EQ(at42qt2120_wait_ready(handle, -1), ESP_OK);
+    TEST_CHECK_EQ(second.calls, 1);
+    TEST_CHECK_EQ(second.result, ESP_OK);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_KEY_00_DTHR], 10);
+
+    /* The blocking reset works while a calibration is pending */
+    TEST_CHECK_EQ(at42qt2120_calibrate(handle), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_reset(handle), ESP_OK);
+    TEST_CHECK_EQ(handle->pending_op.type, AT42QT2120_PENDING_NONE);
+    TEST_CHECK(handle->shadow.valid);
+
+    at42qt2120_deinit(handle);
+}
+
+/* Poll scheduler: a low power mode write lost to the bus is retried while the period stays the same */
+static void test_poll(void) {
+    test_device_t device;
+    test_device_init(&device, false);
+    at42qt2120_handle_t* handle = &device.handle;
+
+    at42qt2120_poll_config_t config = AT42QT2120_POLL_CONFIG_DEFAULT();
+    config.idle_hold_ms = 0;
+    at42qt2120_poll_scheduler_t scheduler;
+    TEST_CHECK_EQ(at42qt2120_poll_init(&scheduler, handle, &config), ESP_OK);
+    TEST_CHECK_EQ(scheduler.low_power_mode, 2);
+
+    at42qt2120_state_t idle = { 0 }, touched = { .touch_detected = true, .key_mask = 1 };
+    TEST_CHECK_EQ(at42qt2120_poll_update(&scheduler, &idle, at42qt2120_time_us(handle)), ESP_OK);
+    TEST_CHECK_EQ(scheduler.period_ms, 32);
+    TEST_CHECK_EQ(scheduler.low_power_mode, 4);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_LOW_POWER_MODE], 4);
+
+    /* The touch brings the period back to min_period_ms, the write of the matching mode fails */
+    at42qt2120_sim_glitch(&device.sim, 1000000);
+    TEST_CHECK(at42qt2120_poll_update(&scheduler, &touched, at42qt2120_time_us(handle)) != ESP_OK);
+    TEST_CHECK_EQ(scheduler.period_ms, config.min_period_ms);
+    TEST_CHECK_EQ(scheduler.low_power_mode, 4);
+    TEST_CHECK_EQ(scheduler.low_power_writes, 2);
+
+    at42qt2120_sim_advance(&device.sim, 1000000);
+    TEST_CHECK_EQ(at42qt2120_poll_update(&scheduler, &touched, at42qt2120_time_us(handle)), ESP_OK);
+    TEST_CHECK_EQ(scheduler.low_power_mode, 2);
+    TEST_CHECK_EQ(scheduler.low_power_writes, 3);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_LOW_POWER_MODE], 2);
+
+    /* Once written, updates at the same period stay off the bus */
+    uint32_t transactions = device.sim.stats.transactions;
+    TEST_CHECK_EQ(at42qt2120_poll_update(&scheduler, &touched, at42qt2120_time_us(handle)), ESP_OK);
+    TEST_CHECK_EQ(device.sim.stats.transactions, transactions);
+
+    at42qt2120_poll_deinit(&scheduler);
+    at42qt2120_deinit(handle);
+}
+
+/* Largest sweep error of the calibrated estimator over the slider, in 1/256 slider units */
+static int32_t test_position_sweep(int touch_delta, at42qt2120_sim_t* sim, at42qt2120_position_estimator_t* estimator) {
+    at42qt2120_position_t position;
+    at42qt2120_state_t state;
+
+    /* Calibration: the finger rests on whole units spread over the slider */
+    for (int point = 0; point < 16; point++) {
+        at42qt2120_sim_set_touch(sim, 0, (int16_t)(8 + point * 239 / 15));
+        at42qt2120_sim_advance(sim, 40000);
+        TEST_CHECK_EQ(at42qt2120_position_read(estimator, &position), ESP_OK);
+        TEST_CHECK_EQ(at42qt2120_read_state(estimator->at42qt2120_handle, &state), ESP_OK);
+        TEST_CHECK_EQ(at42qt2120_position_calibrate_add(estimator, state.slider_position), ESP_OK);
+    }
+    TEST_CHECK_EQ(at42qt2120_position_calibrate_finish(estimator), ESP_OK);
+
+    int32_t error_max = 0;
+    for (int32_t true_q8 = 8 * 256; true_q8 < 247 * 256; true_q8 += 16) {
+        at42qt2120_sim_set_touch(sim, 0, (int16_t)(true_q8 >> 8));
+        sim->touch.slider_fraction = (uint8_t)(true_q8 & 0xFF);
+        at42qt2120_sim_advance(sim, 20000);
+        if (at42qt2120_position_read(estimator, &position) != ESP_OK || !position.touched || position.strength > touch_delta) {
+            error_max = INT32_MAX;
+            continue;
+        }
+        int32_t reported_q8 = (int32_t)((int64_t)position.position * (255 * 256) / ((1 << estimator->config.resolution_bits) - 1));
+        int32_t error = reported_q8 > true_q8 ? reported_q8 - true_q8 : true_q8 - reported_q8;
+        if (error > error_max)
+            error_max = error;
+    }
+    return error_max;
+}
+
+/* Position estimator: a weak touch is no worse than the register, a strong one resolves a fraction of a unit */
+static void test_position(void) {
+    static const struct {
+        uint16_t touch_delta;
+        int32_t error_max;                  // 1/256 slider units
+        uint32_t read_bytes;                // Bus bytes of one at42qt2120_position_read()
+    } cases[] = {
+        { 60, 256, 33 + 4 },                // Below register_below: a one-byte register read follows the burst
+        { 600, 64, 33 },                    // Interpolated only
+    };
+
+    for (size_t index = 0; index < sizeof(cases) / sizeof(cases[0]); index++) {
+        at42qt2120_sim_t sim;
+        at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+        sim_config.touch_delta = cases[index].touch_delta;
+        at42qt2120_sim_init(&sim, &sim_config);
+        at42qt2120_transport_t transport;
+        at42qt2120_sim_transport(&sim, &transport);
+        at42qt2120_handle_t handle;
+        ESP_ERROR_CHECK(at42qt2120_init_with_transport(&handle, &transport, 100));
+        at42qt2120_sim_advance(&sim, 200000);
+        TEST_CHECK_EQ(at42qt2120_enable_slider(&handle), ESP_OK);
+
+        at42qt2120_position_config_t config = AT42QT2120_POSITION_CONFIG_DEFAULT();
+        at42qt2120_position_estimator_t estimator;
+        TEST_CHECK_EQ(at42qt2120_position_init(&estimator, &handle, &config), ESP_OK);
+        int32_t error_max = test_position_sweep(cases[index].touch_delta, &sim, &estimator);
+        TEST_CHECK(error_max <= cases[index].error_max);
+
+        at42qt2120_position_t position;
+        uint32_t bytes = sim.stats.bytes;
+        TEST_CHECK_EQ(at42qt2120_position_read(&estimator, &position), ESP_OK);
+        TEST_CHECK_EQ(sim.stats.bytes - bytes, cases[index].read_bytes);
+
+        /* The register holds the previous touch until the chip confirms a new one, it must not be reported */
+        at42qt2120_sim_set_touch(&sim, 0, AT42QT2120_SIM_NO_SLIDER_TOUCH);
+        at42qt2120_sim_advance(&sim, 100000);
+        TEST_CHECK_EQ(at42qt2120_position_read(&estimator, &position), ESP_OK);
+        TEST_CHECK(!position.touched);
+        at42qt2120_sim_set_touch(&sim, 0, 20);
+        while (!position.touched && sim.now_us < 1000000000LL) {
+            at42qt2120_sim_advance(&sim, 1000);
+            TEST_CHECK_EQ(at42qt2120_position_read(&estimator, &position), ESP_OK);
+        }
+        TEST_CHECK(sim.regs[AT42QT2120_REG_SLIDER_POSITION] > 200);
+        TEST_CHECK(position.touched);
+        TEST_CHECK(position.position < (1 << config.resolution_bits) / 8);
+
+        at42qt2120_deinit(&handle);
+    }
+}
+
+/* Gesture events summed by type, with the range of reported positions */
+typedef struct {
+    size_t counts[AT42QT2120_GESTURE_ROTATE + 1];
+    int64_t rotate_sum;
+    int32_t swipe_min;
+    int32_t position_min;
+    int32_t position_max;
+} test_gesture_log_t;
+
+static void test_gesture(const at42qt2120_gesture_event_t* event, void* user_ctx) {
+    test_gesture_log_t* log = (test_gesture_log_t*)user_ctx;
+    log->counts[event->type]++;
+    if (event->type == AT42QT2120_GESTURE_ROTATE)
+        log->rotate_sum += event->delta;
+    if (event->type == AT42QT2120_GESTURE_SWIPE && event->delta < log->swipe_min)
+        log->swipe_min = event->delta;
+    if (event->position < log->position_min)
+        log->position_min = event->position;
+    if (event->position > log->position_max)
+        log->position_max = event->position;
+}
+
+static void test_gesture_reset(test_gesture_log_t* log) {
+    memset(log, 0, sizeof(*log));
+    log->swipe_min = INT32_MAX;
+    log->position_min = INT32_MAX;
+    log->position_max = INT32_MIN;
+}
+
+/* Spins the wheel by revolutions in steps of 16 units while touched, one sample every 10 ms */
+static int64_t test_gesture_spin(at42qt2120_gesture_engine_t* engine, int64_t time_us, uint8_t* position, int32_t revolutions) {
+    int32_t steps = (revolutions < 0 ? -revolutions : revolutions) * 16;
+    for (int32_t step = 0; step < steps; step++) {
+        *position += revolutions < 0 ? -16 : 16;
+        time_us += 10000;
+        at42qt2120_gesture_feed(engine, time_us, true, *position);
+    }
+    return time_us;
+}
+
+static void test_gestures(void) {
+    at42qt2120_gesture_config_t config = AT42QT2120_GESTURE_CONFIG_DEFAULT();
+    config.wheel = true;
+    config.callback = test_gesture;
+    test_gesture_log_t log;
+    config.user_ctx = &log;
+    at42qt2120_gesture_engine_t engine;
+    int64_t time_us = 0;
+    uint8_t position = 0;
+
+    /* 40000 one-revolution swipes in the same direction, past the 32768 revolutions that used to overflow Q8 */
+    test_gesture_reset(&log);
+    TEST_CHECK_EQ(at42qt2120_gesture_init(&engine, &config), ESP_OK);
+    const int32_t swipes = 40000;
+    for (int32_t swipe = 0; swipe < swipes; swipe++) {
+        time_us += 10000;
+        at42qt2120_gesture_feed(&engine, time_us, true, position);
+        time_us = test_gesture_spin(&engine, time_us, &position, 1);
+        time_us += 10000;
+        at42qt2120_gesture_feed(&engine, time_us, false, 0);
+    }
+    TEST_CHECK_EQ(log.counts[AT42QT2120_GESTURE_SWIPE], swipes);
+    TEST_CHECK_EQ(log.counts[AT42QT2120_GESTURE_TAP] + log.counts[AT42QT2120_GESTURE_DOUBLE_TAP], 0);
+    TEST_CHECK(log.swipe_min > 192 && log.swipe_min <= 256);
+    TEST_CHECK(log.rotate_sum > (int64_t)swipes * 192 && log.rotate_sum <= (int64_t)swipes * 256);
+    TEST_CHECK(log.position_min >= 0 && log.position_max < 512);
+
+    /* A double tap across the 255/0 seam is still a double tap, a tap half a turn away is not */
+    test_gesture_reset(&log);
+    const uint8_t taps[][2] = { { 250, 3 }, { 120, 250 } };
+    for (size_t pair = 0; pair < 2; pair++) {
+        for (size_t tap = 0; tap < 2; tap++) {
+            time_us += 100000;
+            at42qt2120_gesture_feed(&engine, time_us, true, taps[pair][tap]);
+            at42qt2120_gesture_feed(&engine, time_us + 10000, true, taps[pair][tap]);
+            at42qt2120_gesture_feed(&engine, time_us + 20000, false, 0);
+        }
+        time_us += 1000000;
+    }
+    TEST_CHECK_EQ(log.counts[AT42QT2120_GESTURE_DOUBLE_TAP], 1);
+    TEST_CHECK_EQ(log.counts[AT42QT2120_GESTURE_TAP], 3);
+
+    /* One touch past the bound stops there, turning back moves off it at once */
+    test_gesture_reset(&log);
+    time_us += 10000;
+    position = 0;
+    at42qt2120_gesture_feed(&engine, time_us, true, position);
+    time_us = test_gesture_spin(&engine, time_us, &position, 10000);
+    TEST_CHECK_EQ(engine.unwrapped, 1 << 21);
+    TEST_CHECK(log.rotate_sum > (1 << 21) - 64 && log.rotate_sum <= 1 << 21);
+    int64_t forward_sum = log.rotate_sum;
+    time_us = test_gesture_spin(&engine, time_us, &position, -1);
+    TEST_CHECK(log.rotate_sum - forward_sum < -192 && log.rotate_sum - forward_sum >= -256);
+    TEST_CHECK(log.position_max <= 1 << 21);
+    time_us += 10000;
+    at42qt2120_gesture_feed(&engine, time_us, false, 0);
+    time_us += 10000;
+    at42qt2120_gesture_feed(&engine, time_us, true, 77);
+    TEST_CHECK_EQ(engine.unwrapped, 77);
+}
+
+/* One decoder input: a key mask read at time_us, or only time passing */
+typedef struct {
+    int64_t time_us;
+    uint16_t key_mask;
+    bool tick;
+} test_key_sample_t;
+
+/* Events delivered by the batch callback, in order */
+typedef struct {
+    at42qt2120_key_event_t events[64];
+    size_t event_count;
+    size_t batch_max;
+} test_key_log_t;
+
+static void test_key_batch(const at42qt2120_key_event_t* events, size_t event_count, void* user_ctx) {
+    test_key_log_t* log = (test_key_log_t*)user_ctx;
+    if (event_count > log->batch_max)
+        log->batch_max = event_count;
+    for (size_t index = 0; index < event_count && log->event_count < sizeof(log->events) / sizeof(log->events[0]); index++)
+        log->events[log->event_count++] = events[index];
+}
+
+/* Event engine events, in order */
+typedef struct {
+    at42qt2120_event_t events[16];
+    size_t event_count;
+} test_event_log_t;
+
+static void test_event(const at42qt2120_event_t* event, void* user_ctx) {
+    test_event_log_t* log = (test_event_log_t*)user_ctx;
+    if (log->event_count < sizeof(log->events) / sizeof(log->events[0]))
+        log->events[log->event_count++] = *event;
+}
+
+/* Feeds a script through a fresh decoder and compares every delivered event with the expected sequence */
+static void test_key_script(at42qt2120_key_config_t config, const test_key_sample_t* samples, size_t sample_count,
+                            const at42qt2120_key_event_t* expected, size_t expected_count, test_key_log_t* log) {
+    memset(log, 0, sizeof(*log));
+    config.callback = test_key_batch;
+    config.user_ctx = log;
+    at42qt2120_key_decoder_t decoder;
+    TEST_CHECK_EQ(at42qt2120_key_decoder_init(&decoder, &config), ESP_OK);
+
+    for (size_t index = 0; index < sample_count; index++) {
+        size_t logged = log->event_count;
+        size_t count = samples[index].tick ? at42qt2120_key_decoder_tick(&decoder, samples[index].time_us)
+                                           : at42qt2120_key_decoder_feed(&decoder, samples[index].time_us, samples[index].key_mask);
+        TEST_CHECK_EQ(log->event_count - logged, count);
+    }
+
+    TEST_CHECK_EQ(log->event_count, expected_count);
+    for (size_t index = 0; index < log->event_count && index < expected_count; index++) {
+        const at42qt2120_key_event_t* event = &log->events[index];
+        TEST_CHECK_EQ(event->type, expected[index].type);
+        TEST_CHECK_EQ(event->key, expected[index].key);
+        TEST_CHECK_EQ(event->key_mask, expected[index].key_mask);
+        TEST_CHECK_EQ(event->repeat, expected[index].repeat);
+        TEST_CHECK_EQ(event->time_us, expected[index].time_us);
+        TEST_CHECK_EQ(event->duration_us, expected[index].duration_us);
+    }
+}
+
+/* Key decoder: debounce, long press and repeat timing, chords and the largest batch, on scripted masks */
+static void test_keys(void) {
+    test_key_log_t log;
+
+    /* A bounce shorter than debounce_us is dropped, ignored keys never show up */
+    at42qt2120_key_config_t debounce = { .keys = 0x00F, .debounce_us = 10000 };
+    static const test_key_sample_t debounce_samples[] = {
+        { 0, 0x000, false },
+        { 1000, 0x002, false },
+        { 5000, 0x100, false },
+        { 6000, 0x002, false },
+        { 15999, 0, true },
+        { 16000, 0, true },
+        { 20000, 0x000, false },
+        { 29999, 0x000, false },
+        { 30000, 0x000, false },
+    };
+    static const at42qt2120_key_event_t debounce_events[] = {
+        { .type = AT42QT2120_KEY_DOWN, .key = 1, .key_mask = 0x002, .time_us = 16000, .duration_us = 0 },
+        { .type = AT42QT2120_KEY_UP, .key = 1, .key_mask = 0x000, .time_us = 30000, .duration_us = 14000 },
+    };
+    test_key_script(debounce, debounce_samples, sizeof(debounce_samples) / sizeof(debounce_samples[0]),
+                    debounce_events, sizeof(debounce_events) / sizeof(debounce_events[0]), &log);
+
+    /* Repeats stay on the grid of the long press, periods missed between samples are skipped, and a due repeat fires before the release */
+    at42qt2120_key_config_t hold = { .keys = AT42QT2120_KEY_MASK_ALL, .long_press_us = 500000, .repeat_us = 100000 };
+    static const test_key_sample_t hold_samples[] = {
+        { 0, 0x008, false },
+        { 499999, 0, true },
+        { 500000, 0, true },
+        { 600000, 0, true },
+        { 850000, 0x008, false },
+        { 900000, 0x000, false },
+    };
+    static const at42qt2120_key_event_t hold_events[] = {
+        { .type = AT42QT2120_KEY_DOWN, .key = 3, .key_mask = 0x008, .time_us = 0, .duration_us = 0 },
+        { .type = AT42QT2120_KEY_LONG_PRESS, .key = 3, .key_mask = 0x008, .time_us = 500000, .duration_us = 500000 },
+        { .type = AT42QT2120_KEY_REPEAT, .key = 3, .key_mask = 0x008, .repeat = 1, .time_us = 600000, .duration_us = 600000 },
+        { .type = AT42QT2120_KEY_REPEAT, .key = 3, .key_mask = 0x008, .repeat = 2, .time_us = 850000, .duration_us = 850000 },
+        { .type = AT42QT2120_KEY_REPEAT, .key = 3, .key_mask = 0x008, .repeat = 3, .time_us = 900000, .duration_us = 900000 },
+        { .type = AT42QT2120_KEY_UP, .key = 3, .key_mask = 0x000, .repeat = 3, .time_us = 900000, .duration_us = 900000 },
+    };
+    test_key_script(hold, hold_samples, sizeof(hold_samples) / sizeof(hold_samples[0]),
+                    hold_events, sizeof(hold_events) / sizeof(hold_events[0]), &log);
+
+    /* A chord closes with its window or early with a release, a single key in the window is no chord */
+    at42qt2120_key_config_t chord = { .keys = AT42QT2120_KEY_MASK_ALL, .chord_window_us = 50000 };
+    static const test_key_sample_t chord_samples[] = {
+        { 0, 0x001, false },
+        { 20000, 0x021, false },
+        { 49999, 0x021, false },
+        { 50000, 0x021, false },
+        { 60000, 0x000, false },
+        { 100000, 0x006, false },
+        { 120000, 0x004, false },
+        { 210000, 0x000, false },
+        { 300000, 0x080, false },
+        { 350000, 0, true },
+    };
+    static const at42qt2120_key_event_t chord_events[] = {
+        { .type = AT42QT2120_KEY_DOWN, .key = 0, .key_mask = 0x001, .time_us = 0, .duration_us = 0 },
+        { .type = AT42QT2120_KEY_DOWN, .key = 5, .key_mask = 0x021, .time_us = 20000, .duration_us = 0 },
+        { .type = AT42QT2120_KEY_CHORD, .key = 0, .key_mask = 0x021, .time_us = 50000, .duration_us = 50000 },
+        { .type = AT42QT2120_KEY_UP, .key = 0, .key_mask = 0x000, .time_us = 60000, .duration_us = 60000 },
+        { .type = AT42QT2120_KEY_UP, .key = 5, .key_mask = 0x000, .time_us = 60000, .duration_us = 40000 },
+        { .type = AT42QT2120_KEY_DOWN, .key = 1, .key_mask = 0x006, .time_us = 100000, .duration_us = 0 },
+        { .type = AT42QT2120_KEY_DOWN, .key = 2, .key_mask = 0x006, .time_us = 100000, .duration_us = 0 },
+        { .type = AT42QT2120_KEY_UP, .key = 1, .key_mask = 0x004, .time_us = 120000, .duration_us = 20000 },
+        { .type = AT42QT2120_KEY_CHORD, .key = 1, .key_mask = 0x006, .time_us = 120000, .duration_us = 20000 },
+        { .type = AT42QT2120_KEY_UP, .key = 2, .key_mask = 0x000, .time_us = 210000, .duration_us = 110000 },
+        { .type = AT42QT2120_KEY_DOWN, .key = 7, .key_mask = 0x080, .time_us = 300000, .duration_us = 0 },
+    };
+    test_key_script(chord, chord_samples, sizeof(chord_samples) / sizeof(chord_samples[0]),
+                    chord_events, sizeof(chord_events) / sizeof(chord_events[0]), &log);
+
+    /* Fullest sample: the chord window, every long press and every release at once, delivered as one batch in that order */
+    at42qt2120_key_config_t full = { .keys = AT42QT2120_KEY_MASK_ALL, .long_press_us = 500000, .repeat_us = 100000, .chord_window_us = 600000 };
+    static const test_key_sample_t full_samples[] = {
+        { 0, 0x03F, false },
+        { 100000, 0xFFF, false },
+        { 700000, 0x000, false },
+    };
+    at42qt2120_key_event_t full_events[2 * AT42QT2120_NUM_KEYS + 1 + 2 * AT42QT2120_NUM_KEYS];
+    size_t full_count = 0;
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++) {
+        int64_t down_us = key < 6 ? 0 : 100000;
+        full_events[full_count++] = (at42qt2120_key_event_t){ .type = AT42QT2120_KEY_DOWN, .key = key,
+                                                              .key_mask = key < 6 ? 0x03F : 0xFFF, .time_us = down_us };
+    }
+    full_events[full_count++] = (at42qt2120_key_event_t){ .type = AT42QT2120_KEY_CHORD, .key = 0, .key_mask = 0xFFF, .time_us = 700000, .duration_us = 700000 };
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        full_events[full_count++] = (at42qt2120_key_event_t){ .type = AT42QT2120_KEY_LONG_PRESS, .key = key, .key_mask = 0xFFF,
+                                                              .time_us = 700000, .duration_us = key < 6 ? 700000 : 600000 };
+    for (uint8_t key = 0; key < AT42QT2120_NUM_KEYS; key++)
+        full_events[full_count++] = (at42qt2120_key_event_t){ .type = AT42QT2120_KEY_UP, .key = key, .key_mask = 0x000,
+                                                              .time_us = 700000, .duration_us = key < 6 ? 700000 : 600000 };
+    test_key_script(full, full_samples, sizeof(full_samples) / sizeof(full_samples[0]), full_events, full_count, &log);
+    TEST_CHECK_EQ(log.batch_max, 2 * AT42QT2120_NUM_KEYS + 1);
+    TEST_CHECK(log.batch_max <= AT42QT2120_KEY_BATCH_MAX);
+
+    /* The event engine takes its key events from the decoder: releases, then presses, then the slider */
+    test_device_t device;
+    test_device_init(&device, false);
+    test_event_log_t event_log = { 0 };
+    at42qt2120_event_config_t event_config = AT42QT2120_EVENT_CONFIG_DEFAULT();
+    event_config.callback = test_event;
+    event_config.user_ctx = &event_log;
+    at42qt2120_event_engine_t engine;
+    TEST_CHECK_EQ(at42qt2120_event_engine_init(&engine, &device.handle, &event_config), ESP_OK);
+    at42qt2120_state_t state = { .key_mask = 0x009 };
+    TEST_CHECK_EQ(at42qt2120_event_engine_process(&engine, &state), 2);
+    TEST_CHECK_EQ(at42qt2120_event_engine_process(&engine, &state), 0);
+    state = (at42qt2120_state_t){ .key_mask = 0x006, .slider_detected = true, .slider_position = 40 };
+    TEST_CHECK_EQ(at42qt2120_event_engine_process(&engine, &state), 5);
+
+    static const struct {
+        at42qt2120_event_type_t type;
+        uint8_t key;
+        uint16_t key_mask;
+    } engine_events[] = {
+        { AT42QT2120_EVENT_KEY_DOWN, 0, 0x009 },
+        { AT42QT2120_EVENT_KEY_DOWN, 3, 0x009 },
+        { AT42QT2120_EVENT_KEY_UP, 0, 0x006 },
+        { AT42QT2120_EVENT_KEY_UP, 3, 0x006 },
+        { AT42QT2120_EVENT_KEY_DOWN, 1, 0x006 },
+        { AT42QT2120_EVENT_KEY_DOWN, 2, 0x006 },
+        { AT42QT2120_EVENT_SLIDER_MOVE, 0, 0x006 },
+    };
+    TEST_CHECK_EQ(event_log.event_count, sizeof(engine_events) / sizeof(engine_events[0]));
+    for (size_t index = 0; index < event_log.event_count && index < sizeof(engine_events) / sizeof(engine_events[0]); index++) {
+        TEST_CHECK_EQ(event_log.events[index].type, engine_events[index].type);
+        TEST_CHECK_EQ(event_log.events[index].key, engine_events[index].key);
+        TEST_CHECK_EQ(event_log.events[index].key_mask, engine_events[index].key_mask);
+    }
+    TEST_CHECK_EQ(event_log.events[6].position, 40);
+    TEST_CHECK_EQ(at42qt2120_event_engine_deinit(&engine), ESP_OK);
+    at42qt2120_deinit(&device.handle);
+}
+
+/* Bitwise CRC-32 (IEEE 802.3), independent of the table-driven one in the profile code */
+static uint32_t test_crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t index = 0; index < size; index++) {
+        crc ^= data[index];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+/* Rewrites the trailing CRC after a blob was edited on purpose */
+static void test_profile_seal(uint8_t blob[AT42QT2120_PROFILE_BLOB_SIZE]) {
+    uint32_t crc = test_crc32(blob, AT42QT2120_PROFILE_BLOB_SIZE - 4);
+    for (int index = 0; index < 4; index++)
+        blob[AT42QT2120_PROFILE_BLOB_SIZE - 4 + index] = (uint8_t)(crc >> (8 * index));
+}
+
+/* Profile blob: round trip, rejected blobs leave the profile alone, and the boot path chosen for each device state */
+static void test_profile(void) {
+    at42qt2120_profile_t tuned;
+    at42qt2120_profile_default(&tuned);
+    tuned.config.slider_options = AT42QT2120_SLIDER_OPTIONS_EN;
+    tuned.config.key_pulse_scale[5] = 0x21;
+    tuned.gesture.wheel = true;
+    tuned.gesture.tap_max_duration_us = 123456;
+    tuned.gesture.rotate_step = 17;
+    tuned.poll.max_period_ms = 128;
+    tuned.poll.track_low_power = false;
+
+    uint8_t blob[AT42QT2120_PROFILE_BLOB_SIZE];
+    size_t size = 0;
+    TEST_CHECK_EQ(at42qt2120_profile_encode(&tuned, blob, sizeof(blob), &size), ESP_OK);
+    TEST_CHECK_EQ(size, AT42QT2120_PROFILE_BLOB_SIZE);
+    TEST_CHECK(memcmp(blob, "QT21", 4) == 0);
+    TEST_CHECK_EQ(blob[4], AT42QT2120_PROFILE_VERSION);
+    uint32_t crc = blob[85] | blob[86] << 8 | blob[87] << 16 | (uint32_t)blob[88] << 24;
+    TEST_CHECK_EQ(crc, test_crc32(blob, size - 4));
+
+    at42qt2120_profile_t decoded;
+    at42qt2120_profile_default(&decoded);
+    decoded.gesture.user_ctx = &decoded;
+    TEST_CHECK_EQ(at42qt2120_profile_decode(blob, size, &decoded), ESP_OK);
+    TEST_CHECK(memcmp(&decoded.config, &tuned.config, sizeof(tuned.config)) == 0);
+    TEST_CHECK_EQ(decoded.gesture.wheel, true);
+    TEST_CHECK_EQ(decoded.gesture.tap_max_duration_us, 123456);
+    TEST_CHECK_EQ(decoded.gesture.rotate_step, 17);
+    TEST_CHECK_EQ(decoded.gesture.swipe_min_travel, tuned.gesture.swipe_min_travel);
+    TEST_CHECK_EQ(decoded.poll.max_period_ms, 128);
+    TEST_CHECK_EQ(decoded.poll.track_low_power, false);
+    TEST_CHECK(decoded.gesture.user_ctx == &decoded);
+
+    /* Each damaged blob is rejected with its own code and nothing is copied out of it */
+    at42qt2120_profile_t untouched;
+    at42qt2120_profile_default(&untouched);
+    at42qt2120_profile_t target = untouched;
+    uint8_t damaged[AT42QT2120_PROFILE_BLOB_SIZE];
+
+    memcpy(damaged, blob, sizeof(damaged));
+    damaged[20] ^= 0x01;
+    TEST_CHECK_EQ(at42qt2120_profile_decode(damaged, size, &target), ESP_ERR_INVALID_CRC);
+    damaged[20] ^= 0x01;
+    damaged[size - 1] ^= 0x80;
+    TEST_CHECK_EQ(at42qt2120_profile_decode(damaged, size, &target), ESP_ERR_INVALID_CRC);
+
+    memcpy(damaged, blob, sizeof(damaged));
+    damaged[4] = AT42QT2120_PROFILE_VERSION + 1;
+    test_profile_seal(damaged);
+    TEST_CHECK_EQ(at42qt2120_profile_decode(damaged, size, &target), ESP_ERR_INVALID_VERSION);
+
+    memcpy(damaged, blob, sizeof(damaged));
+    damaged[0] = 'X';
+    TEST_CHECK_EQ(at42qt2120_profile_decode(damaged, size, &target), ESP_ERR_INVALID_SIZE);
+    TEST_CHECK_EQ(at42qt2120_profile_decode(blob, size - 1, &target), ESP_ERR_INVALID_SIZE);
+    TEST_CHECK_EQ(at42qt2120_profile_decode(blob, 11, &target), ESP_ERR_INVALID_SIZE);
+    TEST_CHECK_EQ(at42qt2120_profile_decode(blob, 0, &target), ESP_ERR_INVALID_SIZE);
+    TEST_CHECK(memcmp(&target, &untouched, sizeof(target)) == 0);
+
+    /* Boot paths, in order on one device: matching, a live register off, a measurement register off, a brown-out */
+    at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+    test_device_t device;
+    test_device_init(&device, false);
+    at42qt2120_profile_t profile;
+    at42qt2120_profile_default(&profile);
+    at42qt2120_profile_boot_result_t result;
+
+    TEST_CHECK_EQ(at42qt2120_profile_boot(&device.handle, NULL, &profile, &result), ESP_OK);
+    TEST_CHECK_EQ(result.mode, AT42QT2120_PROFILE_BOOT_WARM);
+    TEST_CHECK(!result.reset);
+    TEST_CHECK(!result.saved);
+
+    profile.config.low_power_mode = 4;
+    TEST_CHECK_EQ(at42qt2120_profile_boot(&device.handle, NULL, &profile, &result), ESP_OK);
+    TEST_CHECK_EQ(result.mode, AT42QT2120_PROFILE_BOOT_PATCHED);
+    TEST_CHECK(!result.reset);
+    TEST_CHECK(result.duration_us < sim_config.calibrate_time_us);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_LOW_POWER_MODE], 4);
+
+    profile.config.key_pulse_scale[5] = 0x21;
+    TEST_CHECK_EQ(at42qt2120_profile_boot(&device.handle, NULL, &profile, &result), ESP_OK);
+    TEST_CHECK_EQ(result.mode, AT42QT2120_PROFILE_BOOT_COLD);
+    TEST_CHECK(!result.reset);
+    TEST_CHECK(result.duration_us >= sim_config.calibrate_time_us);
+    TEST_CHECK(result.duration_us < sim_config.calibrate_time_us + sim_config.reset_time_us);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_KEY_00_PULSE_SCALE + 5], 0x21);
+
+    TEST_CHECK_EQ(at42qt2120_profile_boot(&device.handle, NULL, &profile, &result), ESP_OK);
+    TEST_CHECK_EQ(result.mode, AT42QT2120_PROFILE_BOOT_WARM);
+
+    at42qt2120_sim_brown_out(&device.sim, true);
+    at42qt2120_sim_advance(&device.sim, 200000);
+    TEST_CHECK_EQ(at42qt2120_profile_boot(&device.handle, NULL, &profile, &result), ESP_OK);
+    TEST_CHECK_EQ(result.mode, AT42QT2120_PROFILE_BOOT_COLD);
+    TEST_CHECK(result.reset);
+    TEST_CHECK(result.duration_us >= sim_config.reset_time_us + sim_config.calibrate_time_us);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_CHIP_ID], AT42QT2120_SIM_CHIP_ID);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_KEY_00_PULSE_SCALE + 5], 0x21);
+    TEST_CHECK_EQ(device.sim.regs[AT42QT2120_REG_LOW_POWER_MODE], 4);
+
+    at42qt2120_error_record_t record;
+    TEST_CHECK_EQ(at42qt2120_error_pop(&device.handle, &record), ESP_OK);
+    TEST_CHECK_EQ(record.op, AT42QT2120_ERROR_OP_CHIP_ID);
+    TEST_CHECK_EQ(record.value, (uint8_t)~AT42QT2120_SIM_CHIP_ID);
+
+    at42qt2120_deinit(&device.handle);
+}
+
+/* Scripted bus behind the recorder: fixed results, the read data is the register address counting up */
+typedef struct {
+    int64_t now_us;
+    esp_err_t result;
+} test_bus_t;
+
+static esp_err_t test_bus_transmit_receive(void* ctx, const uint8_t* write_buf, size_t write_size, uint8_t* read_buf, size_t read_size, int timeout_ms) {
+    (void)write_size;
+    (void)timeout_ms;
+    for (size_t index = 0; index < read_size; index++)
+        read_buf[index] = (uint8_t)(write_buf[0] + index);
+    return ((test_bus_t*)ctx)->result;
+}
+
+static esp_err_t test_bus_transmit(void* ctx, const uint8_t* write_buf, size_t write_size, int timeout_ms) {
+    (void)write_buf;
+    (void)write_size;
+    (void)timeout_ms;
+    return ((test_bus_t*)ctx)->result;
+}
+
+static esp_err_t test_bus_probe(void* ctx, int timeout_ms) {
+    (void)timeout_ms;
+    return ((test_bus_t*)ctx)->result;
+}
+
+static void test_bus_delay_ms(void* ctx, uint32_t delay_ms) {
+    ((test_bus_t*)ctx)->now_us += (int64_t)delay_ms * 1000;
+}
+
+static int64_t test_bus_time_us(void* ctx) {
+    return ((test_bus_t*)ctx)->now_us;
+}
+
+static const at42qt2120_transport_ops_t test_bus_ops = {
+    .transmit_receive = test_bus_transmit_receive,
+    .transmit = test_bus_transmit,
+    .probe = test_bus_probe,
+    .release = NULL,
+    .delay_ms = test_bus_delay_ms,
+    .time_us = test_bus_time_us,
+};
+
+/* Trace recorder: ring wrap, drop-oldest accounting with mixed record sizes, and truncated dumps */
+static void test_trace_ring(void) {
+    test_bus_t bus = { .now_us = 1000, .result = ESP_OK };
+    at42qt2120_transport_t inner = { .ops = &test_bus_ops, .ctx = &bus };
+    at42qt2120_transport_t transport;
+    at42qt2120_trace_t trace;
+    static uint8_t ring[AT42QT2120_TRACE_MAX_RECORD_SIZE + 3];
+    TEST_CHECK_EQ(at42qt2120_trace_init(&trace, ring, sizeof(ring), &inner, &transport), ESP_OK);
+
+    /* 8-byte status reads 100 us apart: 34 fill 272 of the 275 bytes, the next 6 drop the oldest and wrap the ring */
+    uint8_t data[300] = { 0 };
+    for (uint8_t reg = 0; reg < 40; reg++) {
+        TEST_CHECK_EQ(transport.ops->transmit_receive(transport.ctx, &reg, 1, data, 4, 100), ESP_OK);
+        bus.now_us += 100;
+    }
+    TEST_CHECK_EQ(trace.records, 34);
+    TEST_CHECK_EQ(trace.dropped, 6);
+    TEST_CHECK_EQ(trace.used, 272);
+    TEST_CHECK(trace.head < trace.tail);
+    /* The oldest record's delta counts from the last one dropped */
+    TEST_CHECK_EQ(trace.base_time_us, 1000 + 5 * 100);
+
+    /* Failed read (8 bytes) drops 1, a 20-byte write 1 ms later (25 bytes) drops 3, a probe (2 bytes) fills the ring exactly */
+    uint8_t reg = 0x50;
+    bus.result = ESP_ERR_TIMEOUT;
+    TEST_CHECK_EQ(transport.ops->transmit_receive(transport.ctx, &reg, 1, data, 4, 100), ESP_ERR_TIMEOUT);
+    TEST_CHECK_EQ(trace.dropped, 7);
+    bus.result = ESP_OK;
+    bus.now_us += 1000;
+    data[0] = 0x28;
+    for (int index = 1; index <= 20; index++)
+        data[index] = (uint8_t)(0xA0 + index);
+    TEST_CHECK_EQ(transport.ops->transmit(transport.ctx, data, 21, 100), ESP_OK);
+    TEST_CHECK_EQ(trace.dropped, 10);
+    TEST_CHECK_EQ(trace.records, 32);
+    bus.now_us += 100;
+    TEST_CHECK_EQ(transport.ops->probe(transport.ctx, 100), ESP_OK);
+    TEST_CHECK_EQ(trace.records, 33);
+    TEST_CHECK_EQ(trace.used, sizeof(ring));
+    TEST_CHECK_EQ(trace.dropped, 10);
+
+    /* A record larger than a length byte allows is only counted */
+    TEST_CHECK_EQ(transport.ops->transmit(transport.ctx, data, sizeof(data), 100), ESP_OK);
+    TEST_CHECK_EQ(trace.records, 33);
+    TEST_CHECK_EQ(trace.dropped, 11);
+
+    static uint8_t dump[AT42QT2120_TRACE_HEADER_SIZE + sizeof(ring)];
+    size_t size = 0;
+    TEST_CHECK_EQ(at42qt2120_trace_dump_size(&trace), sizeof(dump));
+    TEST_CHECK_EQ(at42qt2120_trace_dump(&trace, dump, sizeof(dump), &size), ESP_OK);
+    TEST_CHECK_EQ(size, sizeof(dump));
+
+    /* The oldest record left is read 10, times are rebuilt from the advanced base time */
+    at42qt2120_trace_reader_t reader;
+    TEST_CHECK_EQ(at42qt2120_trace_reader_init(&reader, dump, size), ESP_OK);
+    TEST_CHECK_EQ(reader.records, 33);
+    TEST_CHECK_EQ(reader.dropped, 11);
+    size_t ends[33];
+    at42qt2120_trace_record_t record;
+    for (uint32_t index = 0; index < 30; index++) {
+        TEST_CHECK_EQ(at42qt2120_trace_next(&reader, &record), ESP_OK);
+        TEST_CHECK_EQ(record.op, AT42QT2120_TRACE_READ);
+        TEST_CHECK_EQ(record.reg, 10 + index);
+        TEST_CHECK_EQ(record.length, 4);
+        TEST_CHECK_EQ(record.time_us, 1000 + (10 + index) * 100);
+        TEST_CHECK(record.payload != NULL && record.payload[0] == 10 + index && record.payload[3] == 13 + index);
+        ends[index] = reader.offset;
+    }
+    TEST_CHECK_EQ(at42qt2120_trace_next(&reader, &record), ESP_OK);
+    TEST_CHECK_EQ(record.reg, 0x50);
+    TEST_CHECK_EQ(record.result, ESP_ERR_TIMEOUT);
+    TEST_CHECK(record.payload == NULL);
+    TEST_CHECK_EQ(record.time_us, 5000);
+    ends[30] = reader.offset;
+    TEST_CHECK_EQ(at42qt2120_trace_next(&reader, &record), ESP_OK);
+    TEST_CHECK_EQ(record.op, AT42QT2120_TRACE_WRITE);
+    TEST_CHECK_EQ(record.reg, 0x28);
+    TEST_CHECK_EQ(record.length, 20);
+    TEST_CHECK(record.payload != NULL && memcmp(record.payload, data + 1, 20) == 0);
+    TEST_CHECK_EQ(record.time_us, 6000);
+    ends[31] = reader.offset;
+    TEST_CHECK_EQ(at42qt2120_trace_next(&reader, &record), ESP_OK);
+    TEST_CHECK_EQ(record.op, AT42QT2120_TRACE_PROBE);
+    TEST_CHECK_EQ(record.time_us, 6100);
+    ends[32] = reader.offset;
+    TEST_CHECK_EQ(ends[32], size);
+    TEST_CHECK_EQ(at42qt2120_trace_next(&reader, &record), ESP_ERR_NOT_FOUND);
+
+    /* Cut anywhere in the last three records: the complete ones still decode, the cut one is reported, nothing reads past the end */
+    for (size_t cut = ends[29] + 1; cut < size; cut++) {
+        TEST_CHECK_EQ(at42qt2120_trace_reader_init(&reader, dump, cut), ESP_OK);
+        size_t complete = 0;
+        while (complete < 33 && ends[complete] <= cut)
+            complete++;
+        for (size_t index = 0; index < complete; index++)
+            TEST_CHECK_EQ(at42qt2120_trace_next(&reader, &record), ESP_OK);
+        bool boundary = complete > 0 && ends[complete - 1] == cut;
+        TEST_CHECK_EQ(at42qt2120_trace_next(&reader, &record), boundary ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_SIZE);
+    }
+
+    TEST_CHECK_EQ(at42qt2120_trace_reader_init(&reader, dump, AT42QT2120_TRACE_HEADER_SIZE - 1), ESP_ERR_INVALID_SIZE);
+    dump[4] = AT42QT2120_TRACE_VERSION + 1;
+    TEST_CHECK_EQ(at42qt2120_trace_reader_init(&reader, dump, size), ESP_ERR_INVALID_VERSION);
+}
+
+/* Publisher stress: publications while readers copy the latest snapshot, and a consumer draining the transition ring */
+#define TEST_PUBLISH_COUNT 200000
+#define TEST_PUBLISH_READERS 2
+#define TEST_RING_PUBLISH_COUNT 20000
+
+typedef struct {
+    at42qt2120_publisher_t* publisher;
+    volatile bool* done;
+    volatile bool started;
+    unsigned long reads;
+    unsigned long torn;
+} test_reader_t;
+
+typedef struct {
+    at42qt2120_publisher_t* publisher;
+    volatile bool* done;
+    unsigned long popped;
+    unsigned long out_of_order;
+} test_consumer_t;
+
+/* Every field derives from the publication number, so a torn copy is detectable. The state changes every fourth publication */
+static void test_publish_state(uint32_t count, at42qt2120_state_t* state) {
+    uint8_t raw[AT42QT2120_STATE_REG_COUNT] = { (count / 4) & 1 ? AT42QT2120_DETECTION_STATUS_TDET : 0, (count / 4) & 0xFF, (count / 1024) & 0x0F, (count / 4) & 0xFF };
+    at42qt2120_decode_state(raw, state);
+}
+
+static bool test_snapshot_consistent(const at42qt2120_snapshot_t* snapshot) {
+    at42qt2120_state_t expected;
+    test_publish_state(snapshot->sequence, &expected);
+    return snapshot->time_us == (int64_t)snapshot->sequence * 10 && snapshot->state.key_mask == expected.key_mask &&
+           snapshot->state.slider_position == expected.slider_position && snapshot->state.detection_status == expected.detection_status;
+}
+
+static void* test_reader(void* arg) {
+    test_reader_t* reader = (test_reader_t*)arg;
+    at42qt2120_snapshot_t snapshot;
+    reader->started = true;
+    while (!*reader->done) {
+        if (at42qt2120_publisher_get_latest(reader->publisher, &snapshot) != ESP_OK)
+            continue;
+        reader->reads++;
+        reader->torn += !test_snapshot_consistent(&snapshot);
+    }
+    return NULL;
+}
+
+static void* test_consumer(void* arg) {
+    test_consumer_t* consumer = (test_consumer_t*)arg;
+    at42qt2120_snapshot_t snapshot;
+    uint32_t previous = 0;
+    while (true) {
+        bool done = *consumer->done;
+        while (at42qt2120_publisher_ring_pop(consumer->publisher, &snapshot) == ESP_OK) {
+            consumer->popped++;
+            consumer->out_of_order += snapshot.sequence <= previous || !test_snapshot_consistent(&snapshot);
+            previous = snapshot.sequence;
+        }
+        if (done)
+            break;
+    }
+    return NULL;
+}
+
+/* Seqlock publisher: no torn snapshot under concurrent readers, every transition popped in order or counted as an overrun */
+static void test_publisher(void) {
+    static at42qt2120_publisher_t publisher;
+    test_device_t device;
+    test_device_init(&device, false);
+    TEST_CHECK_EQ(at42qt2120_publisher_init(&publisher, &device.handle), ESP_OK);
+
+    at42qt2120_snapshot_t snapshot;
+    TEST_CHECK_EQ(at42qt2120_publisher_get_latest(&publisher, &snapshot), ESP_ERR_NOT_FOUND);
+    TEST_CHECK_EQ(at42qt2120_publisher_ring_pop(&publisher, &snapshot), ESP_ERR_NOT_FOUND);
+    TEST_CHECK_EQ(at42qt2120_publisher_acquire(&publisher), ESP_OK);
+    TEST_CHECK_EQ(at42qt2120_publisher_get_latest(&publisher, &snapshot), ESP_OK);
+    TEST_CHECK_EQ(snapshot.sequence, 1);
+    TEST_CHECK_EQ(snapshot.time_us, device.sim.now_us);
+
+    TEST_CHECK_EQ(at42qt2120_publisher_init(&publisher, &device.handle), ESP_OK);
+    volatile bool done = false;
+    test_reader_t readers[TEST_PUBLISH_READERS];
+    pthread_t reader_threads[TEST_PUBLISH_READERS];
+    for (int index = 0; index < TEST_PUBLISH_READERS; index++) {
+        readers[index] = (test_reader_t){ .publisher = &publisher, .done = &done };
+        pthread_create(&reader_threads[index], NULL, test_reader, &readers[index]);
+    }
+    for (int index = 0; index < TEST_PUBLISH_READERS; index++) {
+        while (!readers[index].started)
+            sched_yield();
+    }
+    for (uint32_t count = 1; count <= TEST_PUBLISH_COUNT; count++) {
+        at42qt2120_state_t state;
+        test_publish_state(count, &state);
+        at42qt2120_publisher_publish(&publisher, &state, (int64_t)count * 10);
+    }
+    done = true;
+    for (int index = 0; index < TEST_PUBLISH_READERS; index++) {
+        pthread_join(reader_threads[index], NULL);
+        TEST_CHECK(readers[index].reads > 0);
+        TEST_CHECK_EQ(readers[index].torn, 0);
+    }
+    TEST_CHECK_EQ(at42qt2120_publisher_get_latest(&publisher, &snapshot), ESP_OK);
+    TEST_CHECK_EQ(snapshot.sequence, TEST_PUBLISH_COUNT);
+
+    /* The writer pauses like an acquisition task now and then, so the consumer keeps up with most transitions */
+    TEST_CHECK_EQ(at42qt2120_publisher_init(&publisher, &device.handle), ESP_OK);
+    done = false;
+    pthread_t consumer_thread;
+    test_consumer_t consumer = { .publisher = &publisher, .done = &done };
+    pthread_create(&consumer_thread, NULL, test_consumer, &consumer);
+    for (uint32_t count = 1; count <= TEST_RING_PUBLISH_COUNT; count++) {
+        at42qt2120_state_t state;
+        test_publish_state(count, &state);
+        at42qt2120_publisher_publish(&publisher, &state, (int64_t)count * 10);
+        if (count % (AT42QT2120_SNAPSHOT_RING_SIZE * 2) == 0)
+            nanosleep(&(struct timespec){ .tv_nsec = 100000 }, NULL);
+    }
+    done = true;
+    pthread_join(consumer_thread, NULL);
+    TEST_CHECK_EQ(consumer.out_of_order, 0);
+    TEST_CHECK_EQ(consumer.popped + publisher.ring_overruns, TEST_RING_PUBLISH_COUNT / 4 + 1);
+    TEST_CHECK(consumer.popped > 0);
+
+    at42qt2120_publisher_deinit(&publisher);
+    at42qt2120_deinit(&device.handle);
+}
+
+/* Multi-sensor scan: sensors behind 8-channel muxes, wired round-robin over up to six buses */
+#define TEST_SENSOR_COUNT 48
+#define TEST_MAX_BUSES 6
+#define TEST_SCANS 10
+
+/* Manager: every sensor reports its own state, and a scan costs one channel switch per additional sensor plus one per additional mux */
+static void test_manager(void) {
+    static at42qt2120_sim_t sims[TEST_SENSOR_COUNT];
+    static at42qt2120_sim_bus_t buses[TEST_MAX_BUSES];
+    static at42qt2120_manager_t manager;
+    static const int bus_counts[] = { 1, 2, 3, 6 };
+
+    for (size_t config = 0; config < sizeof(bus_counts) / sizeof(bus_counts[0]); config++) {
+        int bus_count = bus_counts[config];
+        at42qt2120_sim_config_t sim_config = AT42QT2120_SIM_CONFIG_DEFAULT();
+        TEST_CHECK_EQ(at42qt2120_manager_init(&manager, 100), ESP_OK);
+        for (int bus = 0; bus < bus_count; bus++)
+            at42qt2120_sim_bus_init(&buses[bus], sim_config.scl_speed_hz);
+
+        uint8_t mux_index[TEST_MAX_BUSES][AT42QT2120_SIM_BUS_MAX_MUXES];
+        for (int sensor = 0; sensor < TEST_SENSOR_COUNT; sensor++) {
+            int bus = sensor % bus_count;
+            int slot = sensor / bus_count;
+            int mux = slot / AT42QT2120_MUX_NUM_CHANNELS;
+            if (slot % AT42QT2120_MUX_NUM_CHANNELS == 0) {
+                at42qt2120_mux_t mux_backend;
+                TEST_CHECK_EQ(at42qt2120_sim_bus_add_mux(&buses[bus], &mux_backend), ESP_OK);
+                TEST_CHECK_EQ(at42qt2120_manager_add_mux(&manager, bus, &mux_backend, &mux_index[bus][mux]), ESP_OK);
+            }
+
+            at42qt2120_sim_init(&sims[sensor], &sim_config);
+            at42qt2120_transport_t transport;
+            TEST_CHECK_EQ(at42qt2120_sim_bus_add_device(&buses[bus], &sims[sensor], mux, slot % AT42QT2120_MUX_NUM_CHANNELS, &transport), ESP_OK);
+            at42qt2120_sensor_location_t location = { .bus = bus, .mux = mux_index[bus][mux], .channel = slot % AT42QT2120_MUX_NUM_CHANNELS };
+            TEST_CHECK_EQ(at42qt2120_manager_add_sensor(&manager, &location, &transport, 100, NULL), ESP_OK);
+        }
+        for (int bus = 0; bus < bus_count; bus++)
+            at42qt2120_sim_bus_advance(&buses[bus], 200000);
+
+        /* One key per sensor, so a transaction that reached a neighbour shows up as a wrong state */
+        for (int sensor = 0; sensor < TEST_SENSOR_COUNT; sensor++)
+            at42qt2120_sim_set_touch(&sims[sensor], 1 << (sensor % AT42QT2120_NUM_KEYS), AT42QT2120_SIM_NO_SLIDER_TOUCH);
+        for (int bus = 0; bus < bus_count; bus++)
+            at42qt2120_sim_bus_advance(&buses[bus], 100000);
+
+        /* The first scan starts from the selection left by setup, the following ones reverse direction each time */
+        TEST_CHECK_EQ(at42qt2120_manager_scan(&manager), ESP_OK);
+        uint32_t first_mux_writes = 0;
+        for (int bus = 0; bus < bus_count; bus++)
+            first_mux_writes += buses[bus].mux_writes;
+
+        int wrong_states = 0;
+        for (int scan = 1; scan < TEST_SCANS; scan++) {
+            TEST_CHECK_EQ(at42qt2120_manager_scan(&manager), ESP_OK);
+            for (int sensor = 0; sensor < TEST_SENSOR_COUNT; sensor++)
+                wrong_states += manager.sensors[sensor].state.key_mask != (1 << (sensor % AT42QT2120_NUM_KEYS));
+        }
+        TEST_CHECK_EQ(wrong_states, 0);
+
+        uint32_t mux_writes = 0, misrouted = 0, expected_per_scan = 0;
+        for (int bus = 0; bus < bus_count; bus++) {
+            int sensors = TEST_SENSOR_COUNT / bus_count;
+            int muxes = (sensors + AT42QT2120_MUX_NUM_CHANNELS - 1) / AT42QT2120_MUX_NUM_CHANNELS;
+            expected_per_scan += (sensors - 1) + (muxes - 1);
+            mux_writes += buses[bus].mux_writes;
+            misrouted += buses[bus].misrouted + buses[bus].collisions;
+        }
+        TEST_CHECK_EQ(mux_writes - first_mux_writes, (TEST_SCANS - 1) * expected_per_scan);
+        TEST_CHECK_EQ(misrouted, 0);
+        at42qt2120_manager_deinit(&manager);
+    }
+}
+
+int main(void) {
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    test_transport_sim();
+    test_config_plan();
+    test_reset_calibrate();
+    test_recovery();
+    test_poll();
+    test_position();
+    test_gestures();
+    test_keys();
+    test_profile();
+    test_trace_ring();
+    test_publisher();
+    test_manager();
+
+    printf("%u checks, %u failed\n", test_checks, test_failures);
+    return test_failures == 0 ? 0 : 1;
+}